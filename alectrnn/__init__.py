@@ -26,4 +26,9 @@ information from nervous sytems
 
 objective: This module contains objective functions for the games
 
+layer_generator_double, nn_generator_double, nn_handler_double,
+agent_generator_double, agent_handler_double, objective_double: The same
+modules for double precision nervous systems and their agents (see
+NervousSystem's dtype and the handlers' dtype)
+
 """
\ No newline at end of file
@@ -17,6 +17,9 @@
  * decrements it on destruction.
  * Py_DECREF(ale_capsule);
  * Py_XINCREF(ale_capsule);
+ *
+ * Built as agent_generator_double when ALECTRNN_DOUBLE is defined, which only
+ * takes networks from nn_generator_double (see precision.hpp).
  */
 
 #include <Python.h>
@@ -24,6 +27,7 @@
 #include <cstddef>
 #include <iostream>
 #include "../nervous_system/nervous_system.hpp"
+#include "../nervous_system/precision.hpp"
 #include "agent_generator.hpp"
 #include "player_agent.hpp"
 // Add includes to agents you wish to add below:
@@ -34,12 +38,14 @@
 #include "reward_mod_agent.hpp"
 #include "feedback_agent.hpp"
 
+using nervous_system::Real;
+
 /*
  * DeleteAgent can be shared among the agents as a destructor
  */
 static void DeleteAgent(PyObject *agent_capsule) {
   delete (alectrnn::PlayerAgent *)PyCapsule_GetPointer(
-        agent_capsule, "agent_generator.agent");
+        agent_capsule, nervous_system::AGENT_CAPSULE_NAME);
 }
 
 /*
@@ -86,7 +92,7 @@ static PyObject *CreateCtrnnAgent(PyObject *self, PyObject *args,
       static_cast<std::size_t>(update_rate));
 
   PyObject* agent_capsule = PyCapsule_New(static_cast<void*>(agent),
-                                "agent_generator.agent", DeleteAgent);
+                                nervous_system::AGENT_CAPSULE_NAME, DeleteAgent);
   return agent_capsule;
 }
 
@@ -115,22 +121,22 @@ static PyObject *CreateNervousSystemAgent(PyObject *self, PyObject *args,
   ALEInterface* ale = static_cast<ALEInterface*>(PyCapsule_GetPointer(
       ale_capsule, "ale_generator.ale"));
 
-  if (!PyCapsule_IsValid(nervous_system_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nervous_system_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NervousSystem returned from capsule,"
         " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nervous_system = 
-      static_cast<nervous_system::NervousSystem<float>*>(PyCapsule_GetPointer(
-      nervous_system_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nervous_system = 
+      static_cast<nervous_system::NervousSystem<Real>*>(PyCapsule_GetPointer(
+      nervous_system_capsule, nervous_system::NN_CAPSULE_NAME));
 
   bool is_logging = static_cast<bool>(logging);
-  alectrnn::PlayerAgent *agent = new alectrnn::NervousSystemAgent(
+  alectrnn::PlayerAgent *agent = new alectrnn::NervousSystemAgent<Real>(
     ale, *nervous_system, update_rate, is_logging);
 
   PyObject* agent_capsule = PyCapsule_New(static_cast<void*>(agent),
-                                "agent_generator.agent", DeleteAgent);
+                                nervous_system::AGENT_CAPSULE_NAME, DeleteAgent);
   return agent_capsule;
 }
 
@@ -161,24 +167,24 @@ static PyObject *CreateSoftMaxAgent(PyObject *self, PyObject *args,
   ALEInterface* ale = static_cast<ALEInterface*>(PyCapsule_GetPointer(
   ale_capsule, "ale_generator.ale"));
 
-  if (!PyCapsule_IsValid(nervous_system_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nervous_system_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NervousSystem returned from capsule,"
     " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nervous_system =
-    static_cast<nervous_system::NervousSystem<float>*>(PyCapsule_GetPointer(
-    nervous_system_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nervous_system =
+    static_cast<nervous_system::NervousSystem<Real>*>(PyCapsule_GetPointer(
+    nervous_system_capsule, nervous_system::NN_CAPSULE_NAME));
 
   bool is_logging = static_cast<bool>(logging);
-  alectrnn::PlayerAgent *agent = new alectrnn::SoftMaxAgent(ale,
+  alectrnn::PlayerAgent *agent = new alectrnn::SoftMaxAgent<Real>(ale,
                                                             *nervous_system,
                                                             update_rate,
                                                             is_logging, seed);
 
   PyObject* agent_capsule = PyCapsule_New(static_cast<void*>(agent),
-                                          "agent_generator.agent", DeleteAgent);
+                                          nervous_system::AGENT_CAPSULE_NAME, DeleteAgent);
   return agent_capsule;
 }
 
@@ -207,22 +213,22 @@ static PyObject *CreateSharedMotorAgent(PyObject *self, PyObject *args,
   ALEInterface* ale = static_cast<ALEInterface*>(PyCapsule_GetPointer(
   ale_capsule, "ale_generator.ale"));
 
-  if (!PyCapsule_IsValid(nervous_system_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nervous_system_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NervousSystem returned from capsule,"
     " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nervous_system =
-    static_cast<nervous_system::NervousSystem<float>*>(PyCapsule_GetPointer(
-    nervous_system_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nervous_system =
+    static_cast<nervous_system::NervousSystem<Real>*>(PyCapsule_GetPointer(
+    nervous_system_capsule, nervous_system::NN_CAPSULE_NAME));
 
   bool is_logging = static_cast<bool>(logging);
-  alectrnn::PlayerAgent *agent = new alectrnn::SharedMotorAgent(
+  alectrnn::PlayerAgent *agent = new alectrnn::SharedMotorAgent<Real>(
     ale, *nervous_system, update_rate, is_logging);
 
   PyObject* agent_capsule = PyCapsule_New(static_cast<void*>(agent),
-                                          "agent_generator.agent", DeleteAgent);
+                                          nervous_system::AGENT_CAPSULE_NAME, DeleteAgent);
   return agent_capsule;
 }
 
@@ -254,22 +260,22 @@ static PyObject *CreateFeedbackAgent(PyObject *self, PyObject *args,
   ALEInterface* ale = static_cast<ALEInterface*>(PyCapsule_GetPointer(
       ale_capsule, "ale_generator.ale"));
 
-  if (!PyCapsule_IsValid(nervous_system_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nervous_system_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NervousSystem returned from capsule,"
                  " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nervous_system =
-      static_cast<nervous_system::NervousSystem<float>*>(PyCapsule_GetPointer(
-          nervous_system_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nervous_system =
+      static_cast<nervous_system::NervousSystem<Real>*>(PyCapsule_GetPointer(
+          nervous_system_capsule, nervous_system::NN_CAPSULE_NAME));
 
   bool is_logging = static_cast<bool>(logging);
-  alectrnn::PlayerAgent *agent = new alectrnn::FeedbackAgent(
+  alectrnn::PlayerAgent *agent = new alectrnn::FeedbackAgent<Real>(
       ale, *nervous_system, update_rate, is_logging, motor_index, feedback_index);
 
   PyObject* agent_capsule = PyCapsule_New(static_cast<void*>(agent),
-                                          "agent_generator.agent", DeleteAgent);
+                                          nervous_system::AGENT_CAPSULE_NAME, DeleteAgent);
   return agent_capsule;
 }
 
@@ -298,22 +304,22 @@ static PyObject *CreateRewardModulatedAgent(PyObject *self, PyObject *args,
   ALEInterface* ale = static_cast<ALEInterface*>(PyCapsule_GetPointer(
   ale_capsule, "ale_generator.ale"));
 
-  if (!PyCapsule_IsValid(nervous_system_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nervous_system_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NervousSystem returned from capsule,"
     " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nervous_system =
-      static_cast<nervous_system::NervousSystem<float>*>(PyCapsule_GetPointer(
-      nervous_system_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nervous_system =
+      static_cast<nervous_system::NervousSystem<Real>*>(PyCapsule_GetPointer(
+      nervous_system_capsule, nervous_system::NN_CAPSULE_NAME));
 
   bool is_logging = static_cast<bool>(logging);
-      alectrnn::PlayerAgent *agent = new alectrnn::RewardModulatedAgent(
+      alectrnn::PlayerAgent *agent = new alectrnn::RewardModulatedAgent<Real>(
       ale, *nervous_system, update_rate, is_logging);
 
   PyObject* agent_capsule = PyCapsule_New(static_cast<void*>(agent),
-                                          "agent_generator.agent", DeleteAgent);
+                                          nervous_system::AGENT_CAPSULE_NAME, DeleteAgent);
   return agent_capsule;
 }
 
@@ -343,6 +349,22 @@ static PyMethodDef AgentMethods[] = {
   { NULL, NULL, 0, NULL}
 };
 
+#ifdef ALECTRNN_DOUBLE
+
+static struct PyModuleDef AgentModule = {
+  PyModuleDef_HEAD_INIT,
+  "agent_generator_double",
+  "Returns a handle to an Agent with a double precision Nervous System",
+  -1,
+  AgentMethods
+};
+
+PyMODINIT_FUNC PyInit_agent_generator_double(void) {
+  return PyModule_Create(&AgentModule);
+}
+
+#else
+
 static struct PyModuleDef AgentModule = {
   PyModuleDef_HEAD_INIT,
   "agent_generator",
@@ -354,3 +376,5 @@ static struct PyModuleDef AgentModule = {
 PyMODINIT_FUNC PyInit_agent_generator(void) {
   return PyModule_Create(&AgentModule);
 }
+
+#endif
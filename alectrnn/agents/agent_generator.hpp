@@ -20,6 +20,10 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#ifdef ALECTRNN_DOUBLE
+PyMODINIT_FUNC PyInit_agent_generator_double(void);
+#else
 PyMODINIT_FUNC PyInit_agent_generator(void);
+#endif
 
 #endif /* AGENTS_AGENT_GENERATOR_H_ */
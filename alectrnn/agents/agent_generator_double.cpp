@@ -0,0 +1,9 @@
+/*
+ * agent_generator_double.cpp
+ *
+ * Builds agent_generator.cpp as the agent_generator_double module, which
+ * makes agents for double networks (see precision.hpp).
+ */
+
+#define ALECTRNN_DOUBLE
+#include "agent_generator.cpp"
@@ -4,19 +4,30 @@
  *  Created on: Jan 20, 2018
  *      Author: Nathaniel Rodriguez
  *
+ * Built as agent_handler_double when ALECTRNN_DOUBLE is defined, which only
+ * takes agents from agent_generator_double and returns float64 layer
+ * histories (see precision.hpp).
  */
 
 #include <Python.h>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <exception>
+#include <vector>
+#include <memory>
 #include "../common/multi_array.hpp"
+#include "../common/capi_tools.hpp"
 #include "numpy/arrayobject.h"
 #include "nervous_system.hpp"
+#include "precision.hpp"
 #include "agent_handler.hpp"
 #include "player_agent.hpp"
 // Add includes to agents you wish to add below:
 #include "nervous_system_agent.hpp"
 
+using nervous_system::Real;
+
 static PyObject *GetScreenHistory(PyObject *self, PyObject *args,
                                   PyObject *kwargs) {
 
@@ -30,18 +41,35 @@ static PyObject *GetScreenHistory(PyObject *self, PyObject *args,
     return NULL;
   }
 
-  if (!PyCapsule_IsValid(agent_capsule, "agent_generator.agent"))
+  if (!PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to Agent returned from capsule,"
     " or is not a capsule." << std::endl;
     return NULL;
   }
-  alectrnn::NervousSystemAgent* agent = static_cast<alectrnn::NervousSystemAgent*>(
-  PyCapsule_GetPointer(agent_capsule, "agent_generator.agent"));
+  alectrnn::NervousSystemAgent<Real>* agent = static_cast<alectrnn::NervousSystemAgent<Real>*>(
+  PyCapsule_GetPointer(agent_capsule, nervous_system::AGENT_CAPSULE_NAME));
 
-  PyObject* np_history = ConvertLogToPyArray(agent->GetScreenLog().GetHistory());
+  const alectrnn::FrameLogger<>& screen_log = agent->GetScreenLog();
+  if (screen_log.size() == 0) {
+    PyErr_SetString(PyExc_ValueError, "No screens have been logged");
+    return NULL;
+  }
 
-  return np_history;
+  // Frames are decoded straight into a [# frames, screen shape] uint8 array
+  std::vector<npy_intp> shape(1 + screen_log.GetShape().size());
+  shape[0] = screen_log.size();
+  for (std::size_t iii = 0; iii < screen_log.GetShape().size(); ++iii) {
+    shape[iii+1] = screen_log.GetShape()[iii];
+  }
+  PyObject* py_array = PyArray_SimpleNew(shape.size(), shape.data(), NPY_UINT8);
+  if (py_array == NULL) {
+    return NULL;
+  }
+  screen_log.Decode(reinterpret_cast<std::uint8_t*>(
+      PyArray_DATA(reinterpret_cast<PyArrayObject*>(py_array))));
+
+  return py_array;
 }
 
 /*
@@ -61,40 +89,240 @@ static PyObject *GetLayerHistory(PyObject *self, PyObject *args,
     return NULL;
   }
 
-  if (!PyCapsule_IsValid(agent_capsule, "agent_generator.agent"))
+  if (!PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to Agent returned from capsule,"
         " or is not a capsule." << std::endl;
     return NULL;
   }
-  alectrnn::NervousSystemAgent* agent = static_cast<alectrnn::NervousSystemAgent*>(
-      PyCapsule_GetPointer(agent_capsule, "agent_generator.agent"));
+  alectrnn::NervousSystemAgent<Real>* agent = static_cast<alectrnn::NervousSystemAgent<Real>*>(
+      PyCapsule_GetPointer(agent_capsule, nervous_system::AGENT_CAPSULE_NAME));
+
+  if (agent->GetLog().IsMapped()) {
+    PyErr_SetString(PyExc_ValueError, "Agent state log is memory mapped,"
+                    " open its directory with numpy.memmap");
+    return NULL;
+  }
+
+  if ((layer_index < 0)
+      || (static_cast<std::size_t>(layer_index) >= agent->GetLog().size())
+      || agent->GetLog().GetLayerHistory(layer_index)->empty()) {
+    PyErr_SetString(PyExc_ValueError, "Layer has no logged states");
+    return NULL;
+  }
 
-  PyObject* np_history = ConvertLogToPyArray(agent->GetLog().GetLayerHistory(layer_index));
+  PyObject* np_history = ConvertLogToPyArray(agent->GetLog(), layer_index);
 
   return np_history;
 }
 
-PyObject *ConvertLogToPyArray(const std::vector<multi_array::Tensor<float>>& history) {
-  // Determine the new shape from the layer shape + the temporal dimension
-  std::vector<npy_intp> shape(1+history[0].ndimensions());
-  shape[0] = history.size();
-  for (std::size_t iii = 0; iii < history[0].ndimensions(); ++iii) {
-    shape[iii+1] = history[0].shape()[iii];
-  }
-
-  // Build and fill python array
-  PyObject* py_array = PyArray_SimpleNew(shape.size(), shape.data(), NPY_FLOAT32);
-  PyArrayObject *np_array = reinterpret_cast<PyArrayObject*>(py_array);
-  npy_float32* data = reinterpret_cast<npy_float32*>(np_array->data);
-  std::vector<std::size_t> strides(shape.size());
-  multi_array::CalculateStrides(shape.data(), strides.data(), shape.size());
-  for (std::size_t iii = 0; iii < history.size(); ++iii) {
-    for (std::size_t jjj = 0; jjj < history[iii].size(); ++jjj) {
-      data[iii * strides[0] + jjj] = history[iii][jjj];
+/*
+ * Has a NervousSystemAgent stream its state log into memory mapped files
+ */
+static PyObject *SetLogDirectory(PyObject *self, PyObject *args,
+                                 PyObject *kwargs) {
+
+  static char *keyword_list[] = {"agent", "directory", NULL};
+
+  PyObject *agent_capsule;
+  char *directory;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Os", keyword_list,
+                                   &agent_capsule, &directory)){
+    std::cerr << "Error parsing SetLogDirectory arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
+  {
+    std::cerr << "Invalid pointer to Agent returned from capsule,"
+        " or is not a capsule." << std::endl;
+    return NULL;
+  }
+  alectrnn::NervousSystemAgent<Real>* agent = static_cast<alectrnn::NervousSystemAgent<Real>*>(
+      PyCapsule_GetPointer(agent_capsule, nervous_system::AGENT_CAPSULE_NAME));
+
+  try {
+    agent->SetLogDirectory(directory);
+  }
+  catch (const std::exception& error) {
+    PyErr_SetString(PyExc_OSError, error.what());
+    return NULL;
+  }
+
+  Py_RETURN_NONE;
+}
+
+/*
+ * Reads a Python sequence of non-negative ints into indices. Returns false
+ * with a Python exception set if it can't.
+ */
+static bool SequenceToIndices(PyObject* sequence,
+                              std::vector<std::size_t>& indices) {
+  PyObject* fast_sequence = PySequence_Fast(sequence, "expected a sequence of ints");
+  if (fast_sequence == NULL) {
+    return false;
+  }
+  const Py_ssize_t size = PySequence_Fast_GET_SIZE(fast_sequence);
+  indices.resize(size);
+  for (Py_ssize_t iii = 0; iii < size; ++iii) {
+    const long index = PyLong_AsLong(PySequence_Fast_GET_ITEM(fast_sequence, iii));
+    if ((index == -1) && PyErr_Occurred()) {
+      Py_DECREF(fast_sequence);
+      return false;
+    }
+    if (index < 0) {
+      PyErr_SetString(PyExc_ValueError, "indices must be non-negative");
+      Py_DECREF(fast_sequence);
+      return false;
     }
+    indices[iii] = static_cast<std::size_t>(index);
   }
-  return py_array;
+  Py_DECREF(fast_sequence);
+  return true;
+}
+
+/*
+ * Narrows what a NervousSystemAgent logs. layers and neurons are sequences
+ * (None for all), reduction is a LOG_REDUCTION value and screen_compression
+ * a SCREEN_COMPRESSION value.
+ */
+static PyObject *SetLoggingSpec(PyObject *self, PyObject *args,
+                                PyObject *kwargs) {
+
+  static char *keyword_list[] = {"agent", "layers", "neurons", "stride",
+                                 "reduction", "spike_threshold",
+                                 "screen_stride", "screen_compression", NULL};
+
+  PyObject *agent_capsule;
+  PyObject *layers = Py_None;
+  PyObject *neurons = Py_None;
+  int stride = 1;
+  int reduction = nervous_system::NO_REDUCTION;
+  float spike_threshold = 0.0;
+  int screen_stride = 1;
+  int screen_compression = alectrnn::RAW_SCREENS;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOiifii", keyword_list,
+                                   &agent_capsule, &layers, &neurons, &stride,
+                                   &reduction, &spike_threshold,
+                                   &screen_stride, &screen_compression)){
+    std::cerr << "Error parsing SetLoggingSpec arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
+  {
+    std::cerr << "Invalid pointer to Agent returned from capsule,"
+        " or is not a capsule." << std::endl;
+    return NULL;
+  }
+  alectrnn::NervousSystemAgent<Real>* agent = static_cast<alectrnn::NervousSystemAgent<Real>*>(
+      PyCapsule_GetPointer(agent_capsule, nervous_system::AGENT_CAPSULE_NAME));
+
+  if ((stride < 1) || (screen_stride < 0) || (reduction < 0)
+      || (reduction > nervous_system::SPIKE_COUNT_REDUCTION)
+      || (screen_compression < 0)
+      || (screen_compression > alectrnn::DELTA_SCREENS)) {
+    PyErr_SetString(PyExc_ValueError, "stride must be positive, screen_stride"
+                    " non-negative, reduction a LOG_REDUCTION and"
+                    " screen_compression a SCREEN_COMPRESSION");
+    return NULL;
+  }
+
+  nervous_system::LoggingSpec<Real> spec;
+  spec.stride = static_cast<std::size_t>(stride);
+  spec.reduction = static_cast<nervous_system::LOG_REDUCTION>(reduction);
+  spec.spike_threshold = spike_threshold;
+  spec.screen_stride = static_cast<std::size_t>(screen_stride);
+  if ((layers != Py_None) && !SequenceToIndices(layers, spec.layers)) {
+    return NULL;
+  }
+  if (neurons != Py_None) {
+    PyObject* fast_neurons = PySequence_Fast(neurons, "expected a sequence"
+                                             " of neuron index sequences");
+    if (fast_neurons == NULL) {
+      return NULL;
+    }
+    spec.neurons.resize(PySequence_Fast_GET_SIZE(fast_neurons));
+    for (std::size_t iii = 0; iii < spec.neurons.size(); ++iii) {
+      PyObject* layer_neurons = PySequence_Fast_GET_ITEM(fast_neurons, iii);
+      if ((layer_neurons != Py_None)
+          && !SequenceToIndices(layer_neurons, spec.neurons[iii])) {
+        Py_DECREF(fast_neurons);
+        return NULL;
+      }
+    }
+    Py_DECREF(fast_neurons);
+  }
+
+  try {
+    agent->SetLoggingSpec(spec, static_cast<alectrnn::SCREEN_COMPRESSION>(
+        screen_compression));
+  }
+  catch (const std::exception& error) {
+    PyErr_SetString(PyExc_ValueError, error.what());
+    return NULL;
+  }
+
+  Py_RETURN_NONE;
+}
+
+/*
+ * Writes out a NervousSystemAgent's mapped state log so it can be read
+ */
+static PyObject *FlushLog(PyObject *self, PyObject *args, PyObject *kwargs) {
+
+  static char *keyword_list[] = {"agent", NULL};
+
+  PyObject *agent_capsule;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keyword_list,
+                                   &agent_capsule)){
+    std::cerr << "Error parsing FlushLog arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
+  {
+    std::cerr << "Invalid pointer to Agent returned from capsule,"
+        " or is not a capsule." << std::endl;
+    return NULL;
+  }
+  alectrnn::NervousSystemAgent<Real>* agent = static_cast<alectrnn::NervousSystemAgent<Real>*>(
+      PyCapsule_GetPointer(agent_capsule, nervous_system::AGENT_CAPSULE_NAME));
+
+  try {
+    agent->FlushLog();
+  }
+  catch (const std::exception& error) {
+    PyErr_SetString(PyExc_OSError, error.what());
+    return NULL;
+  }
+
+  Py_RETURN_NONE;
+}
+
+/*
+ * Wraps a layer's logged states in a read-only numpy array without copying.
+ * The array shares the log's buffer, which the log leaves untouched while
+ * the array is alive.
+ */
+PyObject *ConvertLogToPyArray(const nervous_system::StateLogger<Real>& log,
+                              std::size_t layer) {
+  // Determine the new shape from the record shape + the temporal dimension
+  const std::vector<std::size_t>& record_shape = log.GetRecordShape(layer);
+  std::shared_ptr<const std::vector<Real>> history = log.GetLayerHistory(layer);
+  std::size_t record_size = 1;
+  std::vector<npy_intp> shape(1+record_shape.size());
+  for (std::size_t iii = 0; iii < record_shape.size(); ++iii) {
+    shape[iii+1] = record_shape[iii];
+    record_size *= record_shape[iii];
+  }
+  shape[0] = history->size() / record_size;
+
+  return alectrnn::SharedBufferToPyArray<Real>(history, shape,
+                                              alectrnn::NumpyType<Real>::value);
 }
 
 static PyMethodDef AgentHandlerMethods[] = {
@@ -104,10 +332,37 @@ static PyMethodDef AgentHandlerMethods[] = {
   { "GetScreenHistory", (PyCFunction) GetScreenHistory,
     METH_VARARGS | METH_KEYWORDS,
     "Returns PyArray of ALE screen history" },
+  { "SetLogDirectory", (PyCFunction) SetLogDirectory,
+    METH_VARARGS | METH_KEYWORDS,
+    "Streams the agent state log into memory mapped files in a directory" },
+  { "SetLoggingSpec", (PyCFunction) SetLoggingSpec,
+    METH_VARARGS | METH_KEYWORDS,
+    "Picks the layers, neurons, stride and reduction the agent logs and how"
+    " its screens are stored" },
+  { "FlushLog", (PyCFunction) FlushLog,
+    METH_VARARGS | METH_KEYWORDS,
+    "Writes out the agent's memory mapped state log" },
       //Additional agents here, make sure to add includes top
   { NULL, NULL, 0, NULL}
 };
 
+#ifdef ALECTRNN_DOUBLE
+
+static struct PyModuleDef AgentHandlerModule = {
+  PyModuleDef_HEAD_INIT,
+  "agent_handler_double",
+  "Returns a handle to an Agent with a double precision Nervous System",
+  -1,
+  AgentHandlerMethods
+};
+
+PyMODINIT_FUNC PyInit_agent_handler_double(void) {
+  import_array();
+  return PyModule_Create(&AgentHandlerModule);
+}
+
+#else
+
 static struct PyModuleDef AgentHandlerModule = {
   PyModuleDef_HEAD_INIT,
   "agent_handler",
@@ -120,3 +375,5 @@ PyMODINIT_FUNC PyInit_agent_handler(void) {
   import_array();
   return PyModule_Create(&AgentHandlerModule);
 }
+
+#endif
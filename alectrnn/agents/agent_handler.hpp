@@ -12,9 +12,16 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
-#include "../common/multi_array.hpp"
+#include <cstddef>
+#include "../nervous_system/precision.hpp"
+#include "../nervous_system/state_logger.hpp"
 
+#ifdef ALECTRNN_DOUBLE
+PyMODINIT_FUNC PyInit_agent_handler_double(void);
+#else
 PyMODINIT_FUNC PyInit_agent_handler(void);
-PyObject *ConvertLogToPyArray(const std::vector<multi_array::Tensor<float>>& history);
+#endif
+PyObject *ConvertLogToPyArray(const nervous_system::StateLogger<nervous_system::Real>& log,
+                              std::size_t layer);
 
 #endif /* AGENTS_AGENT_HANDLER_H_ */
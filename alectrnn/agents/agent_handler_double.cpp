@@ -0,0 +1,9 @@
+/*
+ * agent_handler_double.cpp
+ *
+ * Builds agent_handler.cpp as the agent_handler_double module, which works
+ * with agents of double networks (see precision.hpp).
+ */
+
+#define ALECTRNN_DOUBLE
+#include "agent_handler.cpp"
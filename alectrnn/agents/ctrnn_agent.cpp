@@ -41,9 +41,10 @@ CtrnnAgent::CtrnnAgent(ALEInterface* ale,
     full_screen_.resize(
         ale_->environment->getScreenHeight() *
         ale_->environment->getScreenWidth());
-    buffer_screen_.resize(
-        ale_->environment->getScreenHeight() *
-        ale_->environment->getScreenWidth());
+    screen_resizer_ = GrayScreenResizer(ale_->environment->getScreenWidth(),
+                                        ale_->environment->getScreenHeight(),
+                                        input_screen_width_,
+                                        input_screen_height_);
     downsized_screen_.resize(num_sensors_);
   }
   else {
@@ -52,9 +53,6 @@ CtrnnAgent::CtrnnAgent(ALEInterface* ale,
     full_screen_.resize(
         ale_->environment->getScreenHeight() *
         ale_->environment->getScreenWidth() * 4);
-    buffer_screen_.resize(
-        ale_->environment->getScreenHeight() *
-        ale_->environment->getScreenWidth() * 4);
     downsized_screen_.resize(num_sensors_);
   }
 
@@ -116,6 +114,17 @@ void CtrnnAgent::Configure(const float *parameters) {
   is_configured_ = true;
 }
 
+/*
+ * Bias, tau and gain per neuron, then the circuit and sensor weights
+ */
+std::size_t CtrnnAgent::GetParameterCount() const {
+  std::size_t num_sensor_weights = 0;
+  for (const std::vector<ctrnn::InEdge>& sensor_edges : node_sensors_) {
+    num_sensor_weights += sensor_edges.size();
+  }
+  return 3 * num_neurons_ + num_neurons_ * num_neurons_ + num_sensor_weights;
+}
+
 void CtrnnAgent::Reset() {
   PlayerAgent::Reset();
   agent_neural_system_->Reset();
@@ -126,13 +135,7 @@ Action CtrnnAgent::Act() {
   if (!use_color_) {
     ale_->getScreenGrayscale(full_screen_);
     // Need to downsize the screen
-    ResizeGrayScreen(ale_->environment->getScreenWidth(),
-                     ale_->environment->getScreenHeight(),
-                     input_screen_width_,
-                     input_screen_height_,
-                     full_screen_,
-                     downsized_screen_,
-                     buffer_screen_);
+    screen_resizer_(full_screen_, downsized_screen_);
   }
   else {
     /*
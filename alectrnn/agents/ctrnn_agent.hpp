@@ -25,6 +25,7 @@
 #include "player_agent.hpp"
 #include "../common/network_constructor.hpp"
 #include "../common/ctrnn.hpp"
+#include "../common/screen_preprocessing.hpp"
 
 namespace alectrnn {
 
@@ -39,6 +40,7 @@ class CtrnnAgent : public PlayerAgent {
         std::size_t input_screen_height, bool use_color, float step_size);
     ~CtrnnAgent();
     void Configure(const float *parameters);
+    std::size_t GetParameterCount() const;
     void Reset();
 
   protected:
@@ -48,7 +50,7 @@ class CtrnnAgent : public PlayerAgent {
     std::unique_ptr<ctrnn::NeuralNetwork> agent_neural_system_;
     std::vector<std::vector<ctrnn::InEdge> > node_sensors_;
     std::vector<std::vector<ctrnn::InEdge> > node_neighbors_;
-    std::vector<std::uint8_t> buffer_screen_;
+    GrayScreenResizer screen_resizer_;
     std::vector<std::uint8_t> full_screen_;
     std::vector<std::uint8_t> downsized_screen_;
     std::size_t num_neurons_;
@@ -11,19 +11,24 @@
 namespace alectrnn
 {
 
-FeedbackAgent::FeedbackAgent(ALEInterface* ale,
-                             nervous_system::NervousSystem<float>& neural_net,
+template<typename TReal>
+FeedbackAgent<TReal>::FeedbackAgent(ALEInterface* ale,
+                             nervous_system::NervousSystem<TReal>& neural_net,
                              Index update_rate, bool is_logging,
                              Index motor_index, Index feedback_index)
     : super_type(ale, neural_net, update_rate, is_logging),
       motor_index_(motor_index), feedback_index_(feedback_index)
 {}
 
-void FeedbackAgent::RewardFeedback(const int reward)
+template<typename TReal>
+void FeedbackAgent<TReal>::RewardFeedback(const int reward)
 {
-  nervous_system::FeedbackLayer<float>& feedback_layer =
-    dynamic_cast<nervous_system::FeedbackLayer<float>&>(neural_net_[feedback_index_]);
-  feedback_layer.update_feedback(reward, &neural_net_[motor_index_]);
+  nervous_system::FeedbackLayer<TReal>& feedback_layer =
+    dynamic_cast<nervous_system::FeedbackLayer<TReal>&>(this->neural_net_[feedback_index_]);
+  feedback_layer.update_feedback(reward, &this->neural_net_[motor_index_]);
 }
 
+template class FeedbackAgent<float>;
+template class FeedbackAgent<double>;
+
 }
@@ -8,14 +8,15 @@
 namespace alectrnn
 {
 
-class FeedbackAgent : public SharedMotorAgent
+template<typename TReal>
+class FeedbackAgent : public SharedMotorAgent<TReal>
 {
   public:
-    using super_type = SharedMotorAgent;
-    using Index = super_type::Index;
+    using super_type = SharedMotorAgent<TReal>;
+    using Index = typename super_type::Index;
 
     FeedbackAgent(ALEInterface* ale,
-                  nervous_system::NervousSystem<float>& neural_net,
+                  nervous_system::NervousSystem<TReal>& neural_net,
                   Index update_rate, bool is_logging,
                   Index motor_index, Index feedback_index);
     virtual ~FeedbackAgent()=default;
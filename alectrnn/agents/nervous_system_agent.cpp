@@ -1,4 +1,5 @@
 #include <stdexcept>
+#include <string>
 #include <ale_interface.hpp>
 #include "nervous_system_agent.hpp"
 #include "player_agent.hpp"
@@ -10,8 +11,9 @@
 
 namespace alectrnn {
 
-NervousSystemAgent::NervousSystemAgent(ALEInterface* ale, 
-    nervous_system::NervousSystem<float>& neural_net) 
+template<typename TReal>
+NervousSystemAgent<TReal>::NervousSystemAgent(ALEInterface* ale, 
+    nervous_system::NervousSystem<TReal>& neural_net) 
     : NervousSystemAgent(ale, neural_net, 1, false) {
 }
 
@@ -23,10 +25,11 @@ NervousSystemAgent::NervousSystemAgent(ALEInterface* ale,
  * recent screen. Note: these need not be contiguous screens, as controller
  * has control over what screens the NervousSystem receives.
  */
-NervousSystemAgent::NervousSystemAgent(ALEInterface* ale, 
-    nervous_system::NervousSystem<float>& neural_net, 
+template<typename TReal>
+NervousSystemAgent<TReal>::NervousSystemAgent(ALEInterface* ale, 
+    nervous_system::NervousSystem<TReal>& neural_net, 
     Index update_rate, bool is_logging) : PlayerAgent(ale), neural_net_(neural_net), 
-    update_rate_(update_rate), is_logging_(is_logging) {
+    update_rate_(update_rate), is_logging_(is_logging), screen_step_(0) {
 
   is_configured_ = false;
 
@@ -36,65 +39,68 @@ NervousSystemAgent::NervousSystemAgent(ALEInterface* ale,
                                 "3 dimensions");
   }
 
-  buffer_screen1_.resize(ale_->environment->getScreenHeight() *
-        ale_->environment->getScreenWidth());
-  buffer_screen2_.resize(ale_->environment->getScreenHeight() *
-        ale_->environment->getScreenWidth());
+  screen_resizer_ = GrayScreenResizer(ale_->environment->getScreenWidth(),
+                                      ale_->environment->getScreenHeight(),
+                                      neural_net_[0].shape()[2],//  major input_screen_width_
+                                      neural_net_[0].shape()[1]);//  minor input_screen_height_
   grey_screen_.resize(ale_->environment->getScreenHeight() *
         ale_->environment->getScreenWidth());
-  downsized_screen_.resize(neural_net_[0].shape()[1] * neural_net_[0].shape()[2]);
 
   if (is_logging_) {
-    log_ = nervous_system::StateLogger<float>(neural_net_);
+    log_ = nervous_system::StateLogger<TReal>(neural_net_);
   }
 
   color_screen_.resize(3 * ale_->environment->getScreenHeight()
                        * ale_->environment->getScreenWidth());
-  screen_log_ = ScreenLogger<float>({ale_->environment->getScreenHeight(),
-                                     ale_->environment->getScreenWidth(), 3});
+  screen_log_ = FrameLogger<>({ale_->environment->getScreenHeight(),
+                               ale_->environment->getScreenWidth(), 3});
 }
 
-void NervousSystemAgent::Configure(const float *parameters) {
+template<typename TReal>
+void NervousSystemAgent<TReal>::Configure(const float *parameters) {
   // Assumed that parameters is a contiguous array with # elements == par count
   // User must make sure this holds, as the slices only guarantee that it won't
   // exceed count
-  neural_net_.Configure(multi_array::ConstArraySlice<float>(
-    parameters, 0, neural_net_.GetParameterCount(), 1));
+  neural_net_.Configure(multi_array::ConstArraySlice<TReal>(
+    NetworkParameters(parameters), 0, neural_net_.GetParameterCount(), 1));
+}
+
+template<typename TReal>
+std::size_t NervousSystemAgent<TReal>::GetParameterCount() const {
+  return neural_net_.GetParameterCount();
 }
 
-void NervousSystemAgent::Reset() {
+template<typename TReal>
+void NervousSystemAgent<TReal>::Reset() {
   PlayerAgent::Reset();
   neural_net_.Reset();
 }
 
-void NervousSystemAgent::UpdateScreen() {
+template<typename TReal>
+void NervousSystemAgent<TReal>::UpdateScreen() {
   // Need to get the screen
   ale_->getScreenGrayscale(grey_screen_);
 
-  if (is_logging_) {
-    ale_->getScreenRGB(color_screen_);
-    screen_log_(color_screen_);
+  // The color screen is only fetched for the frames that are logged
+  const Index screen_stride = log_.GetSpec().screen_stride;
+  if (is_logging_ && (screen_stride != 0)) {
+    if (screen_step_ % screen_stride == 0) {
+      ale_->getScreenRGB(color_screen_);
+      screen_log_(color_screen_);
+    }
+    ++screen_step_;
   }
-
-  // Need to downsize the screen
-  ResizeGrayScreen(ale_->environment->getScreenWidth(),
-                   ale_->environment->getScreenHeight(),
-                   neural_net_[0].shape()[2],//  major input_screen_width_
-                   neural_net_[0].shape()[1],//  minor input_screen_height_
-                   grey_screen_,
-                   downsized_screen_,
-                   buffer_screen1_,
-                   buffer_screen2_);
 }
 
-Action NervousSystemAgent::GetActionFromNervousSystem() {
+template<typename TReal>
+Action NervousSystemAgent<TReal>::GetActionFromNervousSystem() {
 
   // Read values from last X neurons, X==LastNeuronIndex - Action#
   Action preferred_action(PLAYER_A_NOOP);
-  float preferred_output(std::numeric_limits<float>::lowest());
+  TReal preferred_output(std::numeric_limits<TReal>::lowest());
   Action last_action(PLAYER_A_NOOP);
-  float last_output(std::numeric_limits<float>::lowest());
-  const multi_array::Tensor<float>& output = neural_net_.GetOutput();
+  TReal last_output(std::numeric_limits<TReal>::lowest());
+  const multi_array::Tensor<TReal>& output = neural_net_.GetOutput();
   for (std::size_t iii = 0; iii < available_actions_.size(); iii++) {
     last_output = output[iii];
     last_action = available_actions_[iii];
@@ -107,32 +113,14 @@ Action NervousSystemAgent::GetActionFromNervousSystem() {
   return preferred_action;
 }
 
-void NervousSystemAgent::UpdateNervousSystemInput() {
-
-  auto& input_state(neural_net_.GetLayerState(0));
-  auto input_layer_view = input_state.accessor();
-  Index filter = 1;
-  // if temporal channels exist, move contents of each input forward one channel
-  while (filter != input_layer_view.extent(0)) {
-    for (Index iii = 0; iii < input_layer_view.extent(1); ++iii) {
-      for (Index jjj = 0; jjj < input_layer_view.extent(2); ++jjj) {
-        input_layer_view[filter-1][iii][jjj] = input_layer_view[filter][iii][jjj];
-      }
-    }
-    ++filter;
-  }
-
-  // Write in new screen input into last input channel
-  auto end_channel = input_layer_view.extent(0) - 1;
-  for (Index iii = 0; iii < input_layer_view.extent(1); ++iii) {
-    for (Index jjj = 0; jjj < input_layer_view.extent(2); ++jjj) {
-      input_layer_view[end_channel][iii][jjj] = downsized_screen_[iii * input_layer_view.extent(2)
-                                                                  + jjj];
-    }
-  }
+template<typename TReal>
+void NervousSystemAgent<TReal>::UpdateNervousSystemInput() {
+  // Downsize the screen straight into the most recent input channel
+  screen_resizer_(grey_screen_, neural_net_.AdvanceInputChannel());
 }
 
-void NervousSystemAgent::StepNervousSystem() {
+template<typename TReal>
+void NervousSystemAgent<TReal>::StepNervousSystem() {
   /*
    * Screen is updated once, but the network can be updated multiple times for
    * each screen update.
@@ -146,22 +134,75 @@ void NervousSystemAgent::StepNervousSystem() {
   }
 }
 
-Action NervousSystemAgent::Act() {
+template<typename TReal>
+Action NervousSystemAgent<TReal>::Act() {
   UpdateScreen();
   StepNervousSystem();
   return GetActionFromNervousSystem();
 }
 
-const nervous_system::StateLogger<float>& NervousSystemAgent::GetLog() const {
+template<typename TReal>
+const nervous_system::StateLogger<TReal>& NervousSystemAgent<TReal>::GetLog() const {
   return log_;
 }
 
-const ScreenLogger<float>& NervousSystemAgent::GetScreenLog() const {
+template<typename TReal>
+void NervousSystemAgent<TReal>::SetLogDirectory(const std::string& directory) {
+  log_ = nervous_system::StateLogger<TReal>(neural_net_, log_.GetSpec(),
+                                            directory);
+}
+
+template<typename TReal>
+void NervousSystemAgent<TReal>::SetLoggingSpec(
+    const nervous_system::LoggingSpec<TReal>& spec,
+    SCREEN_COMPRESSION screen_compression) {
+  log_ = nervous_system::StateLogger<TReal>(neural_net_, spec,
+                                            log_.GetDirectory());
+  screen_log_ = FrameLogger<>({ale_->environment->getScreenHeight(),
+                               ale_->environment->getScreenWidth(), 3},
+                              screen_compression);
+  screen_step_ = 0;
+}
+
+template<typename TReal>
+void NervousSystemAgent<TReal>::FlushLog() {
+  log_.Flush();
+}
+
+template<typename TReal>
+const FrameLogger<>& NervousSystemAgent<TReal>::GetScreenLog() const {
   return screen_log_;
 }
 
-const nervous_system::NervousSystem<float>& NervousSystemAgent::GetNeuralNet() const {
+template<typename TReal>
+const nervous_system::NervousSystem<TReal>& NervousSystemAgent<TReal>::GetNeuralNet() const {
+  return neural_net_;
+}
+
+template<typename TReal>
+nervous_system::NervousSystem<TReal>& NervousSystemAgent<TReal>::GetNeuralNet() {
   return neural_net_;
 }
 
+template<typename TReal>
+std::size_t NervousSystemAgent<TReal>::GetUpdateRate() const {
+  return update_rate_;
+}
+
+template<>
+const float* NervousSystemAgent<float>::NetworkParameters(
+    const float* parameters) {
+  return parameters;
+}
+
+template<>
+const double* NervousSystemAgent<double>::NetworkParameters(
+    const float* parameters) {
+  parameters_.assign(parameters, parameters + neural_net_.GetParameterCount());
+  return parameters_.data();
+}
+
+template class NervousSystemAgent<float>;
+template class NervousSystemAgent<double>;
+
 } // End namespace alectrnn
\ No newline at end of file
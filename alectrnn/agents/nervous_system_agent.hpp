@@ -1,6 +1,11 @@
 /*
  * A derived class from PlayerAgent, it uses a hybrid nervous system
  * as the basis for Action decisions.
+ *
+ * TReal is the network's floating point type. Agents are configured with
+ * float parameters like every PlayerAgent, so a double agent keeps a double
+ * copy of them for its network. Instantiated for float and double (see
+ * precision.hpp).
  */
 
 #ifndef ALECTRNN_NERVOUS_SYSTEM_AGENT_H_
@@ -8,28 +13,49 @@
 
 #include <cstddef>
 #include <vector>
+#include <string>
 #include <ale_interface.hpp>
 #include "player_agent.hpp"
 #include "../nervous_system/nervous_system.hpp"
 #include "../nervous_system/state_logger.hpp"
 #include "../common/screen_logger.hpp"
+#include "../common/screen_preprocessing.hpp"
 
 namespace alectrnn {
 
+template<typename TReal>
 class NervousSystemAgent : public PlayerAgent {
   public:
     typedef std::size_t Index;
 
-    NervousSystemAgent(ALEInterface* ale, nervous_system::NervousSystem<float>& neural_net);
-    NervousSystemAgent(ALEInterface* ale, nervous_system::NervousSystem<float>& neural_net, 
+    NervousSystemAgent(ALEInterface* ale, nervous_system::NervousSystem<TReal>& neural_net);
+    NervousSystemAgent(ALEInterface* ale, nervous_system::NervousSystem<TReal>& neural_net, 
         Index update_rate, bool is_logging);
     virtual ~NervousSystemAgent()=default;
 
     virtual void Configure(const float *parameters);
+    virtual std::size_t GetParameterCount() const;
     virtual void Reset();
-    virtual const nervous_system::StateLogger<float>& GetLog() const;
-    virtual const ScreenLogger<float>& GetScreenLog() const;
-    virtual const nervous_system::NervousSystem<float>& GetNeuralNet() const;
+    virtual const nervous_system::StateLogger<TReal>& GetLog() const;
+    /*
+     * Streams the state log into memory mapped files in directory instead of
+     * memory (see StateLogger). Replaces any states logged so far. States
+     * are still only logged if the agent was made with is_logging.
+     */
+    virtual void SetLogDirectory(const std::string& directory);
+    /*
+     * Narrows logging to what spec asks for (layers, neurons, stride,
+     * reduction and screen stride) and sets how logged screens are stored.
+     * Replaces any states logged so far.
+     */
+    virtual void SetLoggingSpec(const nervous_system::LoggingSpec<TReal>& spec,
+                                SCREEN_COMPRESSION screen_compression=RAW_SCREENS);
+    // Writes out a mapped state log so it can be read while the agent runs
+    virtual void FlushLog();
+    virtual const FrameLogger<>& GetScreenLog() const;
+    virtual const nervous_system::NervousSystem<TReal>& GetNeuralNet() const;
+    virtual nervous_system::NervousSystem<TReal>& GetNeuralNet();
+    virtual std::size_t GetUpdateRate() const;
 
   protected:
     virtual Action Act();
@@ -37,19 +63,23 @@ class NervousSystemAgent : public PlayerAgent {
     virtual void UpdateNervousSystemInput();
     virtual void StepNervousSystem();
     virtual void UpdateScreen();
+    // Returns parameters in TReal, widening them into parameters_ if needed
+    const TReal* NetworkParameters(const float* parameters);
 
   protected:
-    nervous_system::NervousSystem<float>& neural_net_;
-    nervous_system::StateLogger<float> log_;
+    nervous_system::NervousSystem<TReal>& neural_net_;
+    // Double copy of the configured parameters, unused by float agents
+    std::vector<TReal> parameters_;
+    nervous_system::StateLogger<TReal> log_;
     std::vector<std::uint8_t> grey_screen_;
     std::vector<std::uint8_t> color_screen_; // for logging
-    std::vector<float> buffer_screen1_;
-    std::vector<float> buffer_screen2_;
-    std::vector<float> downsized_screen_;
+    GrayScreenResizer screen_resizer_;
     std::size_t update_rate_;
     bool is_configured_;
     bool is_logging_;
-    ScreenLogger<float> screen_log_;
+    FrameLogger<> screen_log_;
+    // # of frames seen since screen logging (re)started
+    std::size_t screen_step_;
 };
 
 } // End alectrnn namespace
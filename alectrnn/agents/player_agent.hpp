@@ -15,6 +15,7 @@
 #ifndef ALECTRNN_AGENTS_PLAYER_AGENT_H_
 #define ALECTRNN_AGENTS_PLAYER_AGENT_H_
 
+#include <cstddef>
 #include <ale_interface.hpp>
 
 namespace alectrnn {
@@ -49,6 +50,11 @@ class PlayerAgent {
      */
     virtual void Configure(const float *parameters)=0;
 
+    /*
+     * # of parameters Configure reads
+     */
+    virtual std::size_t GetParameterCount() const=0;
+
     /*
      * Resets the agent's internal variables for a new set of episode runs
      * Make sure PlayerAgent::Reset() gets called in any derived class to ensure
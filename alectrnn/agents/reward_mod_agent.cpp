@@ -11,20 +11,25 @@
 namespace alectrnn
 {
 
-RewardModulatedAgent::RewardModulatedAgent(ALEInterface* ale,
-                                           nervous_system::NervousSystem<float>& neural_net,
+template<typename TReal>
+RewardModulatedAgent<TReal>::RewardModulatedAgent(ALEInterface* ale,
+                                           nervous_system::NervousSystem<TReal>& neural_net,
                                            Index update_rate, bool is_logging)
     : super_type(ale, neural_net, update_rate, is_logging)
 {}
 
-void RewardModulatedAgent::RewardFeedback(const int reward)
+template<typename TReal>
+void RewardModulatedAgent<TReal>::RewardFeedback(const int reward)
 {
-  for (std::size_t iii = 1; iii < neural_net_.size(); ++iii)
+  for (std::size_t iii = 1; iii < this->neural_net_.size(); ++iii)
   {
-    nervous_system::NoisyRewardModulatedLayer<float>& reward_layer =
-      dynamic_cast<nervous_system::NoisyRewardModulatedLayer<float>&>(neural_net_[iii]);
-    reward_layer.UpdateWeights(reward, &neural_net_[iii-1]);
+    nervous_system::NoisyRewardModulatedLayer<TReal>& reward_layer =
+      dynamic_cast<nervous_system::NoisyRewardModulatedLayer<TReal>&>(this->neural_net_[iii]);
+    reward_layer.UpdateWeights(reward, &this->neural_net_[iii-1]);
   }
 }
 
+template class RewardModulatedAgent<float>;
+template class RewardModulatedAgent<double>;
+
 }
\ No newline at end of file
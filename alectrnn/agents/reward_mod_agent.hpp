@@ -12,14 +12,15 @@
 namespace alectrnn
 {
 
-class RewardModulatedAgent : public SharedMotorAgent
+template<typename TReal>
+class RewardModulatedAgent : public SharedMotorAgent<TReal>
 {
   public:
-    using super_type = SharedMotorAgent;
-    using Index = super_type::Index;
+    using super_type = SharedMotorAgent<TReal>;
+    using Index = typename super_type::Index;
 
     RewardModulatedAgent(ALEInterface* ale,
-                         nervous_system::NervousSystem<float>& neural_net,
+                         nervous_system::NervousSystem<TReal>& neural_net,
                          Index update_rate, bool is_logging);
     virtual ~RewardModulatedAgent()=default;
 
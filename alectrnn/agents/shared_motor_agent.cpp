@@ -10,8 +10,9 @@
 
 namespace alectrnn {
 
-SharedMotorAgent::SharedMotorAgent(ALEInterface *ale,
-                                   nervous_system::NervousSystem<float> &neural_net,
+template<typename TReal>
+SharedMotorAgent<TReal>::SharedMotorAgent(ALEInterface *ale,
+                                   nervous_system::NervousSystem<TReal> &neural_net,
                                    Index update_rate, bool is_logging)
     : super_type(ale, neural_net, update_rate, is_logging) {
 }
@@ -22,14 +23,15 @@ SharedMotorAgent::SharedMotorAgent(ALEInterface *ale,
 //  return GetActionFromNervousSystem();
 //}
 
-Action SharedMotorAgent::GetActionFromNervousSystem() {
+template<typename TReal>
+Action SharedMotorAgent<TReal>::GetActionFromNervousSystem() {
 
   // Read values from NN output and find preferred action
   Action preferred_action(PLAYER_A_NOOP);
-  float preferred_output(std::numeric_limits<float>::lowest());
+  TReal preferred_output(std::numeric_limits<TReal>::lowest());
   Action last_action(PLAYER_A_NOOP);
-  float last_output(std::numeric_limits<float>::lowest());
-  const multi_array::Tensor<float>& output = super_type::neural_net_.GetOutput();
+  TReal last_output(std::numeric_limits<TReal>::lowest());
+  const multi_array::Tensor<TReal>& output = super_type::neural_net_.GetOutput();
   for (std::size_t iii = 0; iii < super_type::available_actions_.size(); iii++) {
     // Motor outputs not in the minimal set are ignored.
     last_output = output[static_cast<std::size_t>(super_type::available_actions_[iii])];
@@ -43,4 +45,7 @@ Action SharedMotorAgent::GetActionFromNervousSystem() {
   return preferred_action;
 }
 
+template class SharedMotorAgent<float>;
+template class SharedMotorAgent<double>;
+
 }
\ No newline at end of file
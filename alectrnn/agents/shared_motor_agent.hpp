@@ -20,13 +20,14 @@ namespace alectrnn {
  * to the action with value I. This allows you to keep a single motor layer
  * (and potentially a single network) between games.
  */
-class SharedMotorAgent : public NervousSystemAgent {
+template<typename TReal>
+class SharedMotorAgent : public NervousSystemAgent<TReal> {
   public:
-    typedef NervousSystemAgent super_type;
+    typedef NervousSystemAgent<TReal> super_type;
     typedef typename super_type::Index Index;
 
     SharedMotorAgent(ALEInterface* ale,
-                     nervous_system::NervousSystem<float>& neural_net,
+                     nervous_system::NervousSystem<TReal>& neural_net,
                      Index update_rate, bool is_logging);
     virtual ~SharedMotorAgent()=default;
 
@@ -7,22 +7,25 @@
 
 namespace alectrnn {
 
-void SoftMaxAgent::seed(int new_seed) {
+template<typename TReal>
+void SoftMaxAgent<TReal>::seed(int new_seed) {
   rng_.seed(new_seed);
 }
 
-Action SoftMaxAgent::Act() {
+template<typename TReal>
+Action SoftMaxAgent<TReal>::Act() {
   super_type::UpdateScreen();
   super_type::StepNervousSystem();
   return GetActionFromNervousSystem();
 }
 
-Action SoftMaxAgent::GetActionFromNervousSystem() {
+template<typename TReal>
+Action SoftMaxAgent<TReal>::GetActionFromNervousSystem() {
 
   Action preferred_action(PLAYER_A_NOOP);
-  float cdf = 0.0;
-  float rv = rand_real_(rng_);
-  const multi_array::Tensor<float>& output = super_type::neural_net_.GetOutput();
+  TReal cdf = 0.0;
+  TReal rv = rand_real_(rng_);
+  const multi_array::Tensor<TReal>& output = super_type::neural_net_.GetOutput();
   for (std::size_t iii = 0; iii < super_type::available_actions_.size(); iii++) {
     cdf += output[iii];
     if (rv <= cdf) {
@@ -33,4 +36,7 @@ Action SoftMaxAgent::GetActionFromNervousSystem() {
   return preferred_action;
 }
 
+template class SoftMaxAgent<float>;
+template class SoftMaxAgent<double>;
+
 }
\ No newline at end of file
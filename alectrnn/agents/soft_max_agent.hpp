@@ -12,13 +12,14 @@
 
 namespace alectrnn {
 
-class SoftMaxAgent : public NervousSystemAgent {
+template<typename TReal>
+class SoftMaxAgent : public NervousSystemAgent<TReal> {
   public:
-    typedef NervousSystemAgent super_type;
+    typedef NervousSystemAgent<TReal> super_type;
     typedef typename super_type::Index Index;
 
     SoftMaxAgent(ALEInterface* ale,
-                 nervous_system::NervousSystem<float>& neural_net,
+                 nervous_system::NervousSystem<TReal>& neural_net,
                  Index update_rate, bool is_logging, int seed)
         : super_type(ale, neural_net, update_rate, is_logging),
           rng_(seed), rand_real_(0.0, 1.0) {
@@ -32,7 +33,7 @@ class SoftMaxAgent : public NervousSystemAgent {
 
   protected:
     std::mt19937 rng_;
-    std::uniform_real_distribution<float> rand_real_;
+    std::uniform_real_distribution<TReal> rand_real_;
 };
 
 } // end alectrnn namespace
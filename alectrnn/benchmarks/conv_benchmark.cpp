@@ -0,0 +1,139 @@
+/*
+ * Compares the IM2COL_CONV and TILED_CONV algorithms of ConvEigenIntegrator
+ * over the filter/stride configurations typical of Atari networks. Both
+ * algorithms are run on the same input and weights, and the largest
+ * difference between their outputs is reported along with the time per step.
+ * The two algorithms are timed in alternating rounds and the median round is
+ * reported, so that clock and cache noise hit both alike; differences of less
+ * than ~10% are within run to run noise.
+ *
+ * The integrators are header-only, so this builds without ALE:
+ *   python setup.py build_benchmarks
+ *   build/benchmarks/conv_benchmark [# steps per round] [# rounds]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "nervous_system/integrator.hpp"
+#include "common/multi_array.hpp"
+
+namespace {
+
+typedef std::size_t Index;
+
+struct ConvConfig {
+  Index channels;
+  Index height;
+  Index width;
+  Index num_filters;
+  Index kernel;
+  Index stride;
+};
+
+// Returns seconds per step
+double TimeConv(nervous_system::ConvEigenIntegrator<float>& integrator,
+                const multi_array::Tensor<float>& src,
+                multi_array::Tensor<float>& tar, std::size_t num_steps) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t step = 0; step < num_steps; ++step) {
+    integrator(src, tar);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / num_steps;
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+} // End anonymous namespace
+
+int main(int argc, char* argv[]) {
+  const std::size_t num_steps = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 50;
+  const std::size_t num_rounds = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 9;
+  const std::vector<ConvConfig> configs = {
+    {1, 88, 88, 32, 8, 4},
+    {4, 88, 88, 32, 8, 4},
+    {4, 84, 84, 16, 5, 1},
+    {4, 88, 88, 32, 3, 1},
+    {32, 22, 22, 64, 4, 2},
+    {64, 11, 11, 64, 3, 1}
+  };
+
+  std::mt19937 rng(1);
+  std::normal_distribution<float> normal(0.0, 1.0);
+  std::cout << std::setw(24) << "config (CxHxW, FxK/S)"
+            << std::setw(14) << "im2col (us)"
+            << std::setw(14) << "tiled (us)"
+            << std::setw(10) << "speedup"
+            << std::setw(14) << "max diff" << std::endl;
+  for (const ConvConfig& config : configs) {
+    const Index pad = config.kernel / 2;
+    const Index out_height = (config.height + 2 * pad - config.kernel) / config.stride + 1;
+    const Index out_width = (config.width + 2 * pad - config.kernel) / config.stride + 1;
+    const multi_array::Array<Index, 3> filter_shape({config.channels, config.kernel,
+                                                     config.kernel});
+    const multi_array::Array<Index, 3> layer_shape({config.num_filters, out_height,
+                                                    out_width});
+    const multi_array::Array<Index, 3> prev_layer_shape({config.channels, config.height,
+                                                         config.width});
+
+    nervous_system::ConvEigenIntegrator<float> im2col(filter_shape, layer_shape,
+        prev_layer_shape, config.stride, nervous_system::IM2COL_CONV);
+    nervous_system::ConvEigenIntegrator<float> tiled(filter_shape, layer_shape,
+        prev_layer_shape, config.stride, nervous_system::TILED_CONV);
+
+    multi_array::Tensor<float> weights({im2col.GetParameterCount()});
+    for (Index iii = 0; iii < weights.size(); ++iii) {
+      weights[iii] = normal(rng);
+    }
+    const multi_array::ConstArraySlice<float> weight_slice(weights.data(), 0,
+                                                           weights.size());
+    im2col.Configure(weight_slice);
+    tiled.Configure(weight_slice);
+
+    multi_array::Tensor<float> src({config.channels, config.height, config.width});
+    for (Index iii = 0; iii < src.size(); ++iii) {
+      src[iii] = normal(rng);
+    }
+    multi_array::Tensor<float> im2col_tar({config.num_filters, out_height, out_width});
+    multi_array::Tensor<float> tiled_tar({config.num_filters, out_height, out_width});
+
+    im2col(src, im2col_tar);
+    tiled(src, tiled_tar);
+    std::vector<double> im2col_times;
+    std::vector<double> tiled_times;
+    for (std::size_t round = 0; round < num_rounds; ++round) {
+      im2col_times.push_back(TimeConv(im2col, src, im2col_tar, num_steps));
+      tiled_times.push_back(TimeConv(tiled, src, tiled_tar, num_steps));
+    }
+    const double im2col_time = Median(im2col_times);
+    const double tiled_time = Median(tiled_times);
+    float max_diff = 0.0;
+    for (Index iii = 0; iii < im2col_tar.size(); ++iii) {
+      max_diff = std::max(max_diff, std::abs(im2col_tar[iii] - tiled_tar[iii]));
+    }
+
+    std::cout << std::setw(24) << (std::to_string(config.channels) + "x"
+                                   + std::to_string(config.height) + "x"
+                                   + std::to_string(config.width) + ", "
+                                   + std::to_string(config.num_filters) + "x"
+                                   + std::to_string(config.kernel) + "/"
+                                   + std::to_string(config.stride))
+              << std::setw(14) << std::fixed << std::setprecision(1) << im2col_time * 1e6
+              << std::setw(14) << tiled_time * 1e6
+              << std::setw(10) << std::setprecision(2) << im2col_time / tiled_time
+              << std::setw(14) << std::scientific << std::setprecision(2) << max_diff
+              << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * Compares float and double networks built from the same templates, as the
+ * layer_generator/nn_generator/nn_handler modules and their _double twins do
+ * (see nervous_system/precision.hpp). Each network is built in both
+ * precisions with the same float parameters and run on the same inputs. The
+ * time per step of each is reported, along with how far the double states
+ * drift from the float ones, which shows how float-sensitive the dynamics
+ * are. For IAF networks a state difference is a spike that moved.
+ *
+ * The networks are header-only, so this builds without ALE:
+ *   python setup.py build_benchmarks
+ *   build/benchmarks/precision_benchmark [# steps]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "nervous_system/nervous_system.hpp"
+#include "nervous_system/layer.hpp"
+#include "nervous_system/integrator.hpp"
+#include "nervous_system/activator.hpp"
+#include "nervous_system/parameter_types.hpp"
+#include "common/multi_array.hpp"
+
+namespace {
+
+typedef std::size_t Index;
+
+enum NETWORK_TYPE {
+  CTRNN_NETWORK,
+  IAF_NETWORK,
+  ATARI_CNN_NETWORK
+};
+
+struct NetworkConfig {
+  std::string name;
+  NETWORK_TYPE type;
+  Index num_neurons;
+};
+
+const Index NUM_INPUTS = 64;
+const Index NUM_OUTPUTS = 18;
+
+/*
+ * # of pre-synaptic neurons of a neuron in each layer (the input layer is
+ * layer 0), which scales its weights
+ */
+std::vector<Index> LayerFanIns(const NetworkConfig& config) {
+  if (config.type == ATARI_CNN_NETWORK) {
+    return {0, 4 * 7 * 7, 32 * 3 * 3, 64 * 11 * 11, config.num_neurons};
+  }
+  return {0, NUM_INPUTS + config.num_neurons, config.num_neurons};
+}
+
+template<typename TReal>
+nervous_system::Activator<TReal>* NewActivator(NETWORK_TYPE type, Index num_states) {
+  if (type == IAF_NETWORK) {
+    return new nervous_system::IafActivator<TReal>(num_states, 0.1, 1.0, 0.0);
+  }
+  return new nervous_system::CTRNNActivator<TReal>(num_states, 0.1);
+}
+
+/*
+ * Builds a network with the layers NervousSystem (nervous_system.py) would
+ * use for it: an all-to-all recurrent layer and motor for CTRNN/IAF, and
+ * StandardAtariCNN's conv stack
+ */
+template<typename TReal>
+std::unique_ptr<nervous_system::NervousSystem<TReal>> BuildNetwork(
+    const NetworkConfig& config) {
+  if (config.type == ATARI_CNN_NETWORK) {
+    std::unique_ptr<nervous_system::NervousSystem<TReal>> network(
+        new nervous_system::NervousSystem<TReal>({4, 88, 88}));
+    network->AddLayer(new nervous_system::Layer<TReal>({32, 22, 22},
+        new nervous_system::ConvEigenIntegrator<TReal>({4, 7, 7}, {32, 22, 22},
+                                                       {4, 88, 88}, 4),
+        new nervous_system::NoneIntegrator<TReal>(),
+        new nervous_system::ReLuActivator<TReal>({32, 22, 22}, true)));
+    network->AddLayer(new nervous_system::Layer<TReal>({64, 11, 11},
+        new nervous_system::ConvEigenIntegrator<TReal>({32, 3, 3}, {64, 11, 11},
+                                                       {32, 22, 22}, 2),
+        new nervous_system::NoneIntegrator<TReal>(),
+        new nervous_system::ReLuActivator<TReal>({64, 11, 11}, true)));
+    network->AddLayer(new nervous_system::Layer<TReal>({config.num_neurons},
+        new nervous_system::All2AllEigenIntegrator<TReal>(config.num_neurons,
+                                                          64 * 11 * 11),
+        new nervous_system::NoneIntegrator<TReal>(),
+        new nervous_system::ReLuActivator<TReal>({config.num_neurons}, false)));
+    network->AddLayer(new nervous_system::EigenMotorLayer<TReal>(NUM_OUTPUTS,
+        config.num_neurons,
+        new nervous_system::ReLuActivator<TReal>({NUM_OUTPUTS}, false)));
+    return network;
+  }
+
+  std::unique_ptr<nervous_system::NervousSystem<TReal>> network(
+      new nervous_system::NervousSystem<TReal>({1, 1, NUM_INPUTS}));
+  network->AddLayer(new nervous_system::RecurrentLayer<TReal>({config.num_neurons},
+      new nervous_system::All2AllEigenIntegrator<TReal>(config.num_neurons,
+                                                        NUM_INPUTS),
+      new nervous_system::All2AllEigenIntegrator<TReal>(config.num_neurons,
+                                                        config.num_neurons),
+      NewActivator<TReal>(config.type, config.num_neurons)));
+  network->AddLayer(new nervous_system::EigenMotorLayer<TReal>(NUM_OUTPUTS,
+      config.num_neurons, NewActivator<TReal>(config.type, NUM_OUTPUTS)));
+  return network;
+}
+
+/*
+ * Draws float parameters from ranges like the ones used to start evolution,
+ * with weights scaled by 1/sqrt(# pre-synaptic neurons)
+ */
+std::vector<float> DrawParameters(
+    const std::vector<nervous_system::PARAMETER_TYPE>& layout,
+    const std::vector<int>& layer_indices, const std::vector<Index>& fan_ins,
+    std::mt19937& rng) {
+  std::uniform_real_distribution<float> uniform(0.0, 1.0);
+  std::vector<float> parameters(layout.size());
+  for (Index iii = 0; iii < layout.size(); ++iii) {
+    float low = -1.0;
+    float high = 1.0;
+    switch (layout[iii]) {
+      case nervous_system::WEIGHT: {
+        const float bound = 1.0f / std::sqrt(static_cast<float>(
+            fan_ins[layer_indices[iii]]));
+        low = -bound;
+        high = bound;
+        break;
+      }
+      case nervous_system::RTAUS:
+        low = 0.1;
+        break;
+      case nervous_system::RANGE:
+        // IAF thresholds low enough for the neurons to spike on these inputs
+        low = 0.05;
+        high = 0.5;
+        break;
+      case nervous_system::RESISTANCE:
+      case nervous_system::GAIN:
+        low = 0.5;
+        high = 2.0;
+        break;
+      case nervous_system::REFRACTORY:
+        low = 0.0;
+        high = 2.0;
+        break;
+      case nervous_system::DECAY:
+        low = 0.0;
+        break;
+      default:
+        break;
+    }
+    parameters[iii] = low + (high - low) * uniform(rng);
+  }
+  return parameters;
+}
+
+struct RunResult {
+  double seconds_per_step;
+  std::vector<double> states;
+};
+
+// Runs the network on every input and records the states of its layers
+template<typename TReal>
+RunResult RunNetwork(nervous_system::NervousSystem<TReal>& network,
+                     const std::vector<float>& parameters,
+                     const std::vector<std::vector<float>>& inputs) {
+  const std::vector<TReal> real_parameters(parameters.begin(), parameters.end());
+  network.Configure(multi_array::ConstArraySlice<TReal>(real_parameters.data(), 0,
+                                                        real_parameters.size()));
+  network.Reset();
+
+  RunResult result;
+  std::chrono::duration<double> elapsed(0);
+  for (const std::vector<float>& input : inputs) {
+    network.SetInput(input);
+    auto start = std::chrono::steady_clock::now();
+    network.Step();
+    elapsed += std::chrono::steady_clock::now() - start;
+    for (Index layer = 1; layer < network.size(); ++layer) {
+      const multi_array::Tensor<TReal>& state = network[layer].state();
+      result.states.insert(result.states.end(), state.data(),
+                           state.data() + state.size());
+    }
+  }
+  result.seconds_per_step = elapsed.count() / inputs.size();
+  return result;
+}
+
+} // End anonymous namespace
+
+int main(int argc, char* argv[]) {
+  const std::size_t num_steps = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 200;
+  const std::vector<NetworkConfig> configs = {
+    {"ctrnn 256", CTRNN_NETWORK, 256},
+    {"ctrnn 1024", CTRNN_NETWORK, 1024},
+    {"iaf 256", IAF_NETWORK, 256},
+    {"iaf 1024", IAF_NETWORK, 1024},
+    {"atari cnn", ATARI_CNN_NETWORK, 512}
+  };
+
+  std::mt19937 rng(1);
+  std::normal_distribution<float> normal(0.0, 1.0);
+  std::cout << std::setw(14) << "network"
+            << std::setw(14) << "float (us)"
+            << std::setw(14) << "double (us)"
+            << std::setw(10) << "cost"
+            << std::setw(14) << "max diff"
+            << std::setw(14) << "rms diff" << std::endl;
+  for (const NetworkConfig& config : configs) {
+    std::unique_ptr<nervous_system::NervousSystem<float>> float_network =
+        BuildNetwork<float>(config);
+    std::unique_ptr<nervous_system::NervousSystem<double>> double_network =
+        BuildNetwork<double>(config);
+
+    const std::vector<float> parameters = DrawParameters(
+        float_network->GetParameterLayout(),
+        float_network->GetParameterLayerIndices(), LayerFanIns(config), rng);
+    std::vector<std::vector<float>> inputs(num_steps,
+        std::vector<float>((*float_network)[0].NumNeurons()));
+    // Slowly varying inputs with unit variance, like successive screens,
+    // which the IAF neurons' slow membranes can integrate up to spiking
+    for (Index step = 0; step < inputs.size(); ++step) {
+      for (Index iii = 0; iii < inputs[step].size(); ++iii) {
+        const float previous = (step > 0) ? inputs[step - 1][iii] : normal(rng);
+        inputs[step][iii] = 0.95f * previous + 0.31f * normal(rng);
+      }
+    }
+
+    const RunResult float_result = RunNetwork(*float_network, parameters, inputs);
+    const RunResult double_result = RunNetwork(*double_network, parameters, inputs);
+    double max_diff = 0.0;
+    double sum_squared_diff = 0.0;
+    for (Index iii = 0; iii < float_result.states.size(); ++iii) {
+      const double diff = std::abs(double_result.states[iii]
+                                   - float_result.states[iii]);
+      max_diff = std::max(max_diff, diff);
+      sum_squared_diff += diff * diff;
+    }
+    const double rms_diff = std::sqrt(sum_squared_diff
+        / std::max<std::size_t>(float_result.states.size(), 1));
+
+    std::cout << std::setw(14) << config.name
+              << std::setw(14) << std::fixed << std::setprecision(1)
+              << float_result.seconds_per_step * 1e6
+              << std::setw(14) << double_result.seconds_per_step * 1e6
+              << std::setw(10) << std::setprecision(2)
+              << double_result.seconds_per_step / float_result.seconds_per_step
+              << std::setw(14) << std::scientific << std::setprecision(2) << max_diff
+              << std::setw(14) << rms_diff << std::endl;
+  }
+
+  return 0;
+}
@@ -14,6 +14,9 @@
 #include <Python.h>
 #include <ale_interface.hpp>
 #include <iostream>
+#include <string>
+#include <memory>
+#include <mutex>
 #include "ale_generator.hpp"
 
 static void DeleteALE(PyObject *ale_capsule) {
@@ -73,20 +76,22 @@ static PyObject *CreateALE(PyObject *self, PyObject *args, PyObject *kwargs) {
     std::cout << "Warning, frame_skip can't be less than 1, setting to 1" << std::endl;
   }
 
+  alectrnn::ALESettings settings;
+  settings.repeat_action_probability = repeat_action_probability;
+  settings.display_screen = static_cast<bool>(display_screen);
+  settings.sound = static_cast<bool>(sound);
+  settings.color_avg = static_cast<bool>(color_avg);
+  settings.frame_skip = frame_skip;
+  settings.max_num_frames = max_num_frames;
+  settings.max_num_episodes = max_num_episodes;
+  settings.max_num_frames_per_episode = max_num_frames_per_episode;
+  settings.print_screen = static_cast<bool>(print_screen);
+  settings.num_reset_steps = num_reset_steps;
+  settings.stochastic_environment = static_cast<bool>(stochastic_environment);
+  settings.num_random_environments = num_random_environments;
+
   ALEInterface* ale = new ALEInterface();
-  ale->setInt("random_seed", seed);
-  ale->setFloat("repeat_action_probability", repeat_action_probability);
-  ale->setBool("display_screen", static_cast<bool>(display_screen));
-  ale->setBool("sound", static_cast<bool>(sound));
-  ale->setBool("print_screen", static_cast<bool>(print_screen));
-  ale->setBool("color_averaging", static_cast<bool>(color_avg));
-  ale->setInt("frame_skip", frame_skip);
-  ale->setInt("max_num_frames", max_num_frames);
-  ale->setInt("max_num_episodes", max_num_episodes);
-  ale->setInt("max_num_frames_per_episode", max_num_frames_per_episode);
-  ale->setInt("system_reset_steps", num_reset_steps);
-  ale->setBool("use_environment_distribution", static_cast<bool>(stochastic_environment));
-  ale->setInt("num_random_environments", num_random_environments);
+  alectrnn::ConfigureALE(ale, settings, seed);
   ale->loadROM(rom_path);
 
   PyObject* ale_capsule = PyCapsule_New(static_cast<void*>(ale),
@@ -94,9 +99,153 @@ static PyObject *CreateALE(PyObject *self, PyObject *args, PyObject *kwargs) {
   return ale_capsule;
 }
 
+static void DeleteALEPool(PyObject *pool_capsule) {
+  delete (alectrnn::ALEPool *)PyCapsule_GetPointer(pool_capsule,
+                                                   "ale_generator.pool");
+}
+
+/*
+ * Leased ALE capsules share the "ale_generator.ale" name so they can be used
+ * anywhere a regular ALE capsule can. Instead of deleting the ALE, their
+ * destructor hands it back to the pool. The capsule context holds a reference
+ * to the pool capsule so the pool outlives all of its leases.
+ */
+static void ReturnALE(PyObject *ale_capsule) {
+  PyObject* pool_capsule = static_cast<PyObject*>(
+      PyCapsule_GetContext(ale_capsule));
+  alectrnn::ALEPool* pool = static_cast<alectrnn::ALEPool*>(
+      PyCapsule_GetPointer(pool_capsule, "ale_generator.pool"));
+  pool->Return(static_cast<ALEInterface*>(
+      PyCapsule_GetPointer(ale_capsule, "ale_generator.ale")));
+  Py_DECREF(pool_capsule);
+}
+
+static PyObject *CreateALEPool(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"repeat_action_probability",
+                                 "display_screen", "sound", "color_avg",
+                                 "frame_skip", "max_num_frames", "max_num_episodes",
+                                 "max_num_frames_per_episode", "print_screen",
+                                 "system_reset_steps",
+                                 "use_environment_distribution",
+                                 "num_random_environments", NULL};
+  /*
+   * Creates a pool of ALEs that share every setting except the rom and seed,
+   * which are given when an ALE is leased. Defaults match CreateALE.
+   */
+
+  float repeat_action_probability(0.0);
+  int display_screen(0);
+  int sound(0);
+  int color_avg(1);
+  int frame_skip(1);
+  int max_num_frames(0);
+  int max_num_episodes(0);
+  int max_num_frames_per_episode(0);
+  int print_screen(0);
+  int num_reset_steps(4);
+  int stochastic_environment(1);
+  int num_random_environments(30);
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|fiiiiiiiiiii", keyword_list,
+                                   &repeat_action_probability,
+                                   &display_screen, &sound, &color_avg,
+                                   &frame_skip, &max_num_frames, &max_num_episodes,
+                                   &max_num_frames_per_episode, &print_screen,
+                                   &num_reset_steps, &stochastic_environment,
+                                   &num_random_environments)){
+    std::cerr << "Error parsing ALE pool arguments" << std::endl;
+    return NULL;
+  }
+
+  if (frame_skip < 1) {
+    frame_skip = 1;
+    std::cout << "Warning, frame_skip can't be less than 1, setting to 1" << std::endl;
+  }
+
+  alectrnn::ALESettings settings;
+  settings.repeat_action_probability = repeat_action_probability;
+  settings.display_screen = static_cast<bool>(display_screen);
+  settings.sound = static_cast<bool>(sound);
+  settings.color_avg = static_cast<bool>(color_avg);
+  settings.frame_skip = frame_skip;
+  settings.max_num_frames = max_num_frames;
+  settings.max_num_episodes = max_num_episodes;
+  settings.max_num_frames_per_episode = max_num_frames_per_episode;
+  settings.print_screen = static_cast<bool>(print_screen);
+  settings.num_reset_steps = num_reset_steps;
+  settings.stochastic_environment = static_cast<bool>(stochastic_environment);
+  settings.num_random_environments = num_random_environments;
+
+  alectrnn::ALEPool* pool = new alectrnn::ALEPool(settings);
+  PyObject* pool_capsule = PyCapsule_New(static_cast<void*>(pool),
+                                         "ale_generator.pool", DeleteALEPool);
+  return pool_capsule;
+}
+
+static PyObject *LeaseALE(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"pool", "rom_path", "seed", NULL};
+
+  PyObject* pool_capsule;
+  char *rom_path;
+  int seed;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Osi", keyword_list,
+                                   &pool_capsule, &rom_path, &seed)){
+    std::cerr << "Error parsing ALE lease arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(pool_capsule, "ale_generator.pool")) {
+    std::cerr << "Invalid pointer to returned from capsule,"
+        " or is not correct capsule." << std::endl;
+    return NULL;
+  }
+
+  alectrnn::ALEPool* pool = static_cast<alectrnn::ALEPool*>(
+      PyCapsule_GetPointer(pool_capsule, "ale_generator.pool"));
+  ALEInterface* ale = pool->Lease(rom_path, seed);
+
+  PyObject* ale_capsule = PyCapsule_New(static_cast<void*>(ale),
+                                        "ale_generator.ale", ReturnALE);
+  if (ale_capsule == NULL) {
+    pool->Return(ale);
+    return NULL;
+  }
+  Py_INCREF(pool_capsule);
+  PyCapsule_SetContext(ale_capsule, static_cast<void*>(pool_capsule));
+  return ale_capsule;
+}
+
+static PyObject *NumIdleALEs(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"pool", NULL};
+
+  PyObject* pool_capsule;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keyword_list,
+                                   &pool_capsule)){
+    std::cerr << "Error parsing ALE pool arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(pool_capsule, "ale_generator.pool")) {
+    std::cerr << "Invalid pointer to returned from capsule,"
+        " or is not correct capsule." << std::endl;
+    return NULL;
+  }
+
+  alectrnn::ALEPool* pool = static_cast<alectrnn::ALEPool*>(
+      PyCapsule_GetPointer(pool_capsule, "ale_generator.pool"));
+  return Py_BuildValue("n", static_cast<Py_ssize_t>(pool->NumIdle()));
+}
+
 static PyMethodDef ALEMethods[] = {
   { "CreatALE", (PyCFunction) CreateALE, METH_VARARGS | METH_KEYWORDS,
       "Returns a handle to an ALE"},
+  { "CreateALEPool", (PyCFunction) CreateALEPool, METH_VARARGS | METH_KEYWORDS,
+      "Returns a handle to a pool of warm ALEs"},
+  { "LeaseALE", (PyCFunction) LeaseALE, METH_VARARGS | METH_KEYWORDS,
+      "Returns a handle to an ALE from the pool, which is returned on release"},
+  { "NumIdleALEs", (PyCFunction) NumIdleALEs, METH_VARARGS | METH_KEYWORDS,
+      "Returns the number of idle ALEs in the pool"},
   { NULL, NULL, 0, NULL}
 };
 
@@ -111,3 +260,80 @@ static struct PyModuleDef ALEModule = {
 PyMODINIT_FUNC PyInit_ale_generator(void) {
   return PyModule_Create(&ALEModule);
 }
+
+namespace alectrnn {
+
+void ConfigureALE(ALEInterface* ale, const ALESettings& settings, int seed) {
+  ale->setInt("random_seed", seed);
+  ale->setFloat("repeat_action_probability", settings.repeat_action_probability);
+  ale->setBool("display_screen", settings.display_screen);
+  ale->setBool("sound", settings.sound);
+  ale->setBool("print_screen", settings.print_screen);
+  ale->setBool("color_averaging", settings.color_avg);
+  ale->setInt("frame_skip", settings.frame_skip);
+  ale->setInt("max_num_frames", settings.max_num_frames);
+  ale->setInt("max_num_episodes", settings.max_num_episodes);
+  ale->setInt("max_num_frames_per_episode", settings.max_num_frames_per_episode);
+  ale->setInt("system_reset_steps", settings.num_reset_steps);
+  ale->setBool("use_environment_distribution", settings.stochastic_environment);
+  ale->setInt("num_random_environments", settings.num_random_environments);
+}
+
+ALEPool::ALEPool(const ALESettings& settings) : settings_(settings) {
+}
+
+/*
+ * A reused emulator is reseeded by updating the seed setting and having the
+ * OSystem re-read it, which is what loadROM would otherwise do, then it is put
+ * back at the start of a training episode.
+ */
+ALEInterface* ALEPool::Lease(const std::string& rom_path, int seed) {
+  std::unique_ptr<ALEInterface> ale;
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    auto idle = idle_ales_.find(rom_path);
+    if (idle != idle_ales_.end() && !idle->second.empty()) {
+      ale = std::move(idle->second.back());
+      idle->second.pop_back();
+    }
+  }
+
+  if (ale) {
+    ale->setInt("random_seed", seed);
+    ale->theOSystem->resetRNGSeed();
+    ale->training_reset();
+  }
+  else {
+    ale.reset(new ALEInterface());
+    ConfigureALE(ale.get(), settings_, seed);
+    ale->loadROM(rom_path);
+  }
+
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  leased_roms_[ale.get()] = rom_path;
+  return ale.release();
+}
+
+void ALEPool::Return(ALEInterface* ale) {
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  auto leased = leased_roms_.find(ale);
+  // Called from capsule destructors, so this can't throw
+  if (leased == leased_roms_.end()) {
+    std::cerr << "ALE was not leased from this pool, deleting it" << std::endl;
+    delete ale;
+    return;
+  }
+  idle_ales_[leased->second].emplace_back(ale);
+  leased_roms_.erase(leased);
+}
+
+std::size_t ALEPool::NumIdle() const {
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  std::size_t num_idle = 0;
+  for (const auto& idle : idle_ales_) {
+    num_idle += idle.second.size();
+  }
+  return num_idle;
+}
+
+} // End alectrnn namespace
@@ -16,7 +16,67 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <ale_interface.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 PyMODINIT_FUNC PyInit_ale_generator(void);
 
+namespace alectrnn {
+
+/*
+ * Holds every ALE setting other than the rom and seed. These are fixed for
+ * the lifetime of an ALEPool so that any pooled emulator can be handed out
+ * for any request on the same rom.
+ */
+struct ALESettings {
+  float repeat_action_probability;
+  bool display_screen;
+  bool sound;
+  bool color_avg;
+  int frame_skip;
+  int max_num_frames;
+  int max_num_episodes;
+  int max_num_frames_per_episode;
+  bool print_screen;
+  int num_reset_steps;
+  bool stochastic_environment;
+  int num_random_environments;
+};
+
+/*
+ * Applies the settings and seed to the ALE. Must be called before loadROM.
+ */
+void ConfigureALE(ALEInterface* ale, const ALESettings& settings, int seed);
+
+/*
+ * Keeps warm emulators with their roms already loaded, keyed by rom path.
+ * Lease returns an idle emulator for the rom if one is available, reseeding
+ * and resetting it in place, otherwise it constructs and loads a new one.
+ * Emulators handed back with Return become available to later leases. The
+ * pool retains ownership of idle emulators only; leased emulators are owned by
+ * the caller until they are returned.
+ */
+class ALEPool {
+  public:
+    ALEPool(const ALESettings& settings);
+
+    ALEInterface* Lease(const std::string& rom_path, int seed);
+    void Return(ALEInterface* ale);
+    std::size_t NumIdle() const;
+
+  protected:
+    ALESettings settings_;
+    // Maps a leased ALE back to its rom so it can be returned to the right slot
+    std::unordered_map<ALEInterface*, std::string> leased_roms_;
+    std::unordered_map<std::string,
+                       std::vector<std::unique_ptr<ALEInterface>>> idle_ales_;
+    mutable std::mutex pool_mutex_;
+};
+
+} // End alectrnn namespace
+
 #endif /* ALECTRNN_COMMON_ALE_GENERATOR_H_ */
@@ -0,0 +1,142 @@
+/*
+ * allocation_counter.cpp
+ *
+ * Replaces the global operator new and delete, and the C allocation
+ * functions, with versions that count allocations (see
+ * allocation_counter.hpp). Compiles to nothing unless
+ * ALECTRNN_COUNT_ALLOCATIONS is defined.
+ */
+
+#include "allocation_counter.hpp"
+
+#ifdef ALECTRNN_COUNT_ALLOCATIONS
+
+#include <cstddef>
+#include <cstdlib>
+#include <cerrno>
+#include <atomic>
+#include <new>
+
+#ifndef __GLIBC__
+#error "ALECTRNN_COUNT_ALLOCATIONS needs glibc to count malloc"
+#endif
+
+namespace debug {
+
+static std::atomic<std::size_t> num_allocations(0);
+
+std::size_t NumAllocations() {
+  return num_allocations.load(std::memory_order_relaxed);
+}
+
+static void RecordAllocation() {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // End debug namespace
+
+/*
+ * Eigen gets its temporaries straight from std::malloc and the tensors use
+ * posix_memalign, so the C allocation functions are counted as well. The
+ * replacements are hidden: calls made from this module bind to them when it
+ * is linked, while the rest of the process keeps glibc's. They forward to
+ * glibc's allocator, so free doesn't need replacing. Interposing the exported
+ * malloc wouldn't work, since Python loads extensions with RTLD_LOCAL and
+ * glibc's malloc comes first in the lookup.
+ */
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t num, std::size_t size);
+void* __libc_realloc(void* data, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+}
+
+// The compiler treats malloc as a builtin with default visibility, so the
+// symbols are hidden in the assembler instead of with attributes
+__asm__(".hidden malloc\n"
+        ".hidden calloc\n"
+        ".hidden realloc\n"
+        ".hidden posix_memalign\n"
+        ".hidden aligned_alloc");
+
+extern "C" {
+
+void* malloc(std::size_t size) noexcept {
+  debug::RecordAllocation();
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t num, std::size_t size) noexcept {
+  debug::RecordAllocation();
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* data, std::size_t size) noexcept {
+  debug::RecordAllocation();
+  return __libc_realloc(data, size);
+}
+
+int posix_memalign(void** data, std::size_t alignment, std::size_t size) noexcept {
+  debug::RecordAllocation();
+  void* aligned_data = __libc_memalign(alignment, size);
+  if (aligned_data == nullptr) {
+    return ENOMEM;
+  }
+  *data = aligned_data;
+  return 0;
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+  debug::RecordAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+} // End extern "C"
+
+// operator new is counted by the malloc it makes
+void* operator new(std::size_t size) {
+  // malloc(0) may return nullptr, operator new may not
+  void* data = std::malloc((size == 0) ? 1 : size);
+  if (data == nullptr) {
+    throw std::bad_alloc();
+  }
+  return data;
+}
+
+void* operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return std::malloc((size == 0) ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+  return ::operator new(size, tag);
+}
+
+void operator delete(void* data) noexcept {
+  std::free(data);
+}
+
+void operator delete[](void* data) noexcept {
+  std::free(data);
+}
+
+void operator delete(void* data, std::size_t) noexcept {
+  std::free(data);
+}
+
+void operator delete[](void* data, std::size_t) noexcept {
+  std::free(data);
+}
+
+void operator delete(void* data, const std::nothrow_t&) noexcept {
+  std::free(data);
+}
+
+void operator delete[](void* data, const std::nothrow_t&) noexcept {
+  std::free(data);
+}
+
+#endif
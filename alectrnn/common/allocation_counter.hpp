@@ -0,0 +1,43 @@
+/*
+ * Debug support for checking that hot paths don't allocate.
+ *
+ * Building with ALECTRNN_COUNT_ALLOCATIONS defined (setup.py does this when
+ * the ALECTRNN_COUNT_ALLOCATIONS environment variable is set) turns on
+ * allocation_counter.cpp. It replaces operator new and the C allocation
+ * functions (malloc, calloc, realloc, posix_memalign, aligned_alloc) for the
+ * code of the module it is linked into, so Eigen temporaries and tensor
+ * storage are counted along with everything else. This needs glibc.
+ * NervousSystem uses the count to report the allocations made by its last
+ * step, which should be 0 once it is running.
+ *
+ * Each module keeps its own count, and it covers all of the module's threads,
+ * so it is only meaningful while one network is stepped at a time. Without
+ * the define NumAllocations is always 0.
+ */
+
+#ifndef ALECTRNN_COMMON_ALLOCATION_COUNTER_H_
+#define ALECTRNN_COMMON_ALLOCATION_COUNTER_H_
+
+#include <cstddef>
+
+namespace debug {
+
+#ifdef ALECTRNN_COUNT_ALLOCATIONS
+
+constexpr bool IS_COUNTING_ALLOCATIONS = true;
+// # of heap allocations made by this module so far
+std::size_t NumAllocations();
+
+#else
+
+constexpr bool IS_COUNTING_ALLOCATIONS = false;
+
+inline std::size_t NumAllocations() {
+  return 0;
+}
+
+#endif
+
+} // End debug namespace
+
+#endif /* ALECTRNN_COMMON_ALLOCATION_COUNTER_H_ */
@@ -26,6 +26,10 @@ float *PyArrayToCArray(PyArrayObject *py_array) {
   if (array_type != NPY_FLOAT32) {
     throw std::invalid_argument("Numpy array must be of type npy_float32");
   }
+  // The data is read in bulk, so a strided view would be read wrong
+  if (!PyArray_IS_C_CONTIGUOUS(py_array)) {
+    throw std::invalid_argument("Numpy array must be C contiguous");
+  }
   return reinterpret_cast<float *>(py_array->data);
 }
 
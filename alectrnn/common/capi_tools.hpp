@@ -20,6 +20,8 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <memory>
+#include <utility>
 #include "numpy/arrayobject.h"
 #include "multi_array.hpp"
 
@@ -90,6 +92,101 @@ multi_array::SharedMultiArray<T, NumDims> PyArrayToSharedMultiArray(PyArrayObjec
                                              py_array->dimensions)));
 }
 
+// Name of the capsules that own the buffers behind wrapped numpy arrays
+constexpr const char* SHARED_BUFFER_CAPSULE_NAME = "alectrnn.shared_buffer";
+
+template<typename T>
+void DeleteSharedBuffer(PyObject* capsule) {
+  delete static_cast<std::shared_ptr<const std::vector<T>>*>(
+      PyCapsule_GetPointer(capsule, SHARED_BUFFER_CAPSULE_NAME));
+}
+
+/*
+ * Wraps buffer in a C order numpy array of the given shape and type without
+ * copying it. The array's base is a capsule holding a reference to buffer,
+ * so the data lives as long as either numpy or C++ needs it. The array is
+ * read-only unless writeable, which is only safe if numpy is left the sole
+ * owner of the buffer.
+ * Returns NULL with a Python exception set on failure.
+ */
+template<typename T>
+PyObject* SharedBufferToPyArray(std::shared_ptr<const std::vector<T>> buffer,
+                                const std::vector<npy_intp>& shape,
+                                int type_num, bool writeable=false) {
+  std::shared_ptr<const std::vector<T>>* owner =
+      new std::shared_ptr<const std::vector<T>>(std::move(buffer));
+  PyObject* capsule = PyCapsule_New(owner, SHARED_BUFFER_CAPSULE_NAME,
+                                    &DeleteSharedBuffer<T>);
+  if (capsule == NULL) {
+    delete owner;
+    return NULL;
+  }
+
+  PyObject* py_array = PyArray_New(&PyArray_Type, shape.size(),
+      const_cast<npy_intp*>(shape.data()), type_num, NULL,
+      const_cast<T*>((*owner)->data()), 0,
+      NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED
+      | (writeable ? NPY_ARRAY_WRITEABLE : 0), NULL);
+  if (py_array == NULL) {
+    Py_DECREF(capsule);
+    return NULL;
+  }
+  // Steals the capsule reference, even if it fails
+  if (PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(py_array),
+                            capsule) != 0) {
+    Py_DECREF(py_array);
+    return NULL;
+  }
+  return py_array;
+}
+
+/*
+ * Moves vec into a new writeable numpy array without copying its elements
+ */
+template<typename T>
+PyObject* VectorToPyArray(std::vector<T>&& vec,
+                          const std::vector<npy_intp>& shape,
+                          int type_num) {
+  return SharedBufferToPyArray<T>(
+      std::make_shared<const std::vector<T>>(std::move(vec)), shape, type_num,
+      true);
+}
+
+// numpy type number of T
+template<typename T>
+struct NumpyType;
+
+template<>
+struct NumpyType<float> {
+  static constexpr int value = NPY_FLOAT32;
+};
+
+template<>
+struct NumpyType<double> {
+  static constexpr int value = NPY_FLOAT64;
+};
+
+/*
+ * Returns a C contiguous view of obj with num_dims dimensions and elements of
+ * type T, new reference. It is obj itself when obj is already such an array,
+ * so inputs can be read in bulk without a copy. Returns NULL with a Python
+ * exception set if obj can't be converted.
+ */
+template<typename T>
+PyArrayObject* ContiguousPyArray(PyObject* obj, int num_dims) {
+  PyArrayObject* py_array = reinterpret_cast<PyArrayObject*>(
+      PyArray_FROM_OTF(obj, NumpyType<T>::value, NPY_ARRAY_IN_ARRAY));
+  if (py_array == NULL) {
+    return NULL;
+  }
+  if (PyArray_NDIM(py_array) != num_dims) {
+    PyErr_Format(PyExc_ValueError, "expected a %d dimensional array", num_dims);
+    Py_DECREF(py_array);
+    return NULL;
+  }
+  return py_array;
+}
+
 } // End alectrnn namespace
 
 #endif /* ALECTRNN_COMMON_CAPI_TOOLS_H_ */
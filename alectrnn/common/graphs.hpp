@@ -3,6 +3,9 @@
 
 #include <cstddef>
 #include <vector>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
 #include <Eigen/Sparse>
 #include "multi_array.hpp"
 
@@ -11,6 +14,17 @@ namespace graphs {
 typedef std::size_t NodeID;
 typedef std::size_t Index;
 
+/*
+ * Node orderings that can be applied to a square network to improve the
+ * locality of its SpMV. Should keep in sync with NODE_ORDERING in
+ * nervous_system.py
+ */
+enum NODE_ORDERING {
+  NATURAL_ORDERING,
+  RCM_ORDERING,
+  DEGREE_ORDERING
+};
+
 template<typename TReal=void>
 struct EdgeTail {
 
@@ -267,6 +281,45 @@ PredecessorGraph<TReal> ConvertEdgeListToPredecessorGraph(const multi<Integer, 2
   return graph;
 }
 
+/*
+ * Builds a compressed sparse row (CSR) layout of a PredecessorGraph so that
+ * integrators can walk the edges without chasing a vector per node. Row
+ * `node` spans [row_ptr[node], row_ptr[node+1]) of col_idx, which holds the
+ * node's predecessors in the same order as Predecessors(node), so edge ids
+ * (and therefore parameter order) are preserved.
+ */
+template<typename TReal>
+void CompressPredecessorGraph(const PredecessorGraph<TReal>& graph,
+                              std::vector<Index>& row_ptr,
+                              std::vector<NodeID>& col_idx) {
+  row_ptr.assign(graph.NumNodes() + 1, 0);
+  col_idx.resize(graph.NumEdges());
+  Index edge_id = 0;
+  for (NodeID node = 0; node < graph.NumNodes(); ++node) {
+    row_ptr[node] = edge_id;
+    for (const auto& edge : graph.Predecessors(node)) {
+      col_idx[edge_id] = edge.source;
+      ++edge_id;
+    }
+  }
+  row_ptr[graph.NumNodes()] = edge_id;
+}
+
+/*
+ * Returns the edge weights of a weighted graph in CSR (edge id) order
+ */
+template<typename TReal>
+std::vector<TReal> CompressPredecessorWeights(const PredecessorGraph<TReal>& graph) {
+  std::vector<TReal> weights;
+  weights.reserve(graph.NumEdges());
+  for (NodeID node = 0; node < graph.NumNodes(); ++node) {
+    for (const auto& edge : graph.Predecessors(node)) {
+      weights.push_back(edge.weight);
+    }
+  }
+  return weights;
+}
+
 /*
  * Converts an edge list into a sparse matrix. The tail_size, is the number
  * of nodes that act as the source of the links, and head_size is the number
@@ -322,6 +375,146 @@ Eigen::SparseMatrix<TReal> ConvertEdgeListToSparseMatrix(const MultiArray2D<Inte
   return graph;
 };
 
+/*
+ * Builds the undirected adjacency (A + A^T, without self-loops) of a square
+ * sparse matrix's sparsity pattern in CSR form. Used by the node orderings.
+ */
+template<typename TReal>
+void SymmetricAdjacency(const Eigen::SparseMatrix<TReal>& graph,
+                        std::vector<Index>& row_ptr,
+                        std::vector<NodeID>& col_idx) {
+  std::vector<std::pair<NodeID, NodeID>> edges;
+  edges.reserve(2 * graph.nonZeros());
+  for (Index col = 0; col < static_cast<Index>(graph.outerSize()); ++col) {
+    for (typename Eigen::SparseMatrix<TReal>::InnerIterator it(graph, col); it; ++it) {
+      const NodeID row = static_cast<NodeID>(it.row());
+      if (row != col) {
+        edges.emplace_back(row, col);
+        edges.emplace_back(col, row);
+      }
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+  const Index num_nodes = static_cast<Index>(graph.rows());
+  row_ptr.assign(num_nodes + 1, 0);
+  col_idx.resize(edges.size());
+  for (Index iii = 0; iii < edges.size(); ++iii) {
+    ++row_ptr[edges[iii].first + 1];
+    col_idx[iii] = edges[iii].second;
+  }
+  for (Index node = 0; node < num_nodes; ++node) {
+    row_ptr[node + 1] += row_ptr[node];
+  }
+}
+
+/*
+ * Reverse Cuthill-McKee ordering. Each connected component is walked
+ * breadth first from its lowest degree node, visiting neighbors in order of
+ * increasing degree, and the resulting order is reversed. This pulls
+ * connected nodes close together, narrowing the bandwidth of the matrix.
+ * Returns order, where order[new id] = old id.
+ */
+template<typename TReal>
+std::vector<NodeID> ReverseCuthillMcKeeOrdering(const Eigen::SparseMatrix<TReal>& graph) {
+  std::vector<Index> row_ptr;
+  std::vector<NodeID> col_idx;
+  SymmetricAdjacency(graph, row_ptr, col_idx);
+  const Index num_nodes = static_cast<Index>(graph.rows());
+  auto degree = [&row_ptr](NodeID node) {
+    return row_ptr[node + 1] - row_ptr[node];
+  };
+  auto by_degree = [&degree](NodeID a, NodeID b) {
+    return degree(a) < degree(b);
+  };
+
+  std::vector<NodeID> start_candidates(num_nodes);
+  for (NodeID node = 0; node < num_nodes; ++node) {
+    start_candidates[node] = node;
+  }
+  std::stable_sort(start_candidates.begin(), start_candidates.end(), by_degree);
+
+  std::vector<NodeID> order;
+  order.reserve(num_nodes);
+  std::vector<bool> visited(num_nodes, false);
+  std::vector<NodeID> neighbors;
+  for (NodeID start : start_candidates) {
+    if (visited[start]) {
+      continue;
+    }
+    visited[start] = true;
+    order.push_back(start);
+    // order doubles as the BFS queue
+    for (Index head = order.size() - 1; head < order.size(); ++head) {
+      const NodeID node = order[head];
+      neighbors.clear();
+      for (Index edge = row_ptr[node]; edge < row_ptr[node + 1]; ++edge) {
+        if (!visited[col_idx[edge]]) {
+          visited[col_idx[edge]] = true;
+          neighbors.push_back(col_idx[edge]);
+        }
+      }
+      std::stable_sort(neighbors.begin(), neighbors.end(), by_degree);
+      order.insert(order.end(), neighbors.begin(), neighbors.end());
+    }
+  }
+  std::reverse(order.begin(), order.end());
+
+  return order;
+}
+
+/*
+ * Orders nodes by decreasing (undirected) degree so that hubs, whose states
+ * are read most often, share cache lines. Ties keep their original order.
+ * Returns order, where order[new id] = old id.
+ */
+template<typename TReal>
+std::vector<NodeID> DegreeOrdering(const Eigen::SparseMatrix<TReal>& graph) {
+  std::vector<Index> row_ptr;
+  std::vector<NodeID> col_idx;
+  SymmetricAdjacency(graph, row_ptr, col_idx);
+  const Index num_nodes = static_cast<Index>(graph.rows());
+
+  std::vector<NodeID> order(num_nodes);
+  for (NodeID node = 0; node < num_nodes; ++node) {
+    order[node] = node;
+  }
+  std::stable_sort(order.begin(), order.end(), [&row_ptr](NodeID a, NodeID b) {
+    return (row_ptr[a + 1] - row_ptr[a]) > (row_ptr[b + 1] - row_ptr[b]);
+  });
+
+  return order;
+}
+
+/*
+ * Returns order[new id] = old id for the requested ordering of a square
+ * network.
+ */
+template<typename TReal>
+std::vector<NodeID> ComputeNodeOrdering(const Eigen::SparseMatrix<TReal>& graph,
+                                        NODE_ORDERING ordering) {
+  if (graph.rows() != graph.cols()) {
+    throw std::invalid_argument("Node orderings require a square network");
+  }
+
+  switch (ordering) {
+    case RCM_ORDERING:
+      return ReverseCuthillMcKeeOrdering(graph);
+    case DEGREE_ORDERING:
+      return DegreeOrdering(graph);
+    case NATURAL_ORDERING: {
+      std::vector<NodeID> order(graph.rows());
+      for (NodeID node = 0; node < order.size(); ++node) {
+        order[node] = node;
+      }
+      return order;
+    }
+    default:
+      throw std::invalid_argument("Invalid node ordering");
+  }
+}
+
 } // End graphs namespace
 
 #endif /* GRAPHS_H_ */
\ No newline at end of file
@@ -0,0 +1,183 @@
+/*
+ * Flat, contiguous spans and the elementwise kernels that run over them.
+ *
+ * A Span is a pointer and a size, with no strides. Tensor, MultiArray,
+ * contiguous slices and TensorView sub-blocks can all be lowered to one (see
+ * their span() methods), so that hot loops run over raw pointers instead of
+ * nested [] accessors.
+ *
+ * The kernels (Fill, Copy, Scale, Axpy, Map, Update) are plain loops over
+ * __restrict__ pointers with no branches outside of the element function, so
+ * the compiler vectorizes them for the instruction set it targets (see
+ * ALECTRNN_MARCH in setup.py). The spans a kernel is given must not overlap,
+ * except for the in-place Map and Update, whose output is also an input.
+ * Kernels throw std::invalid_argument when span sizes differ.
+ */
+
+#ifndef MULTI_ARRAY_KERNELS_H_
+#define MULTI_ARRAY_KERNELS_H_
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#define ALECTRNN_RESTRICT __restrict__
+
+namespace multi_array {
+
+template<typename T>
+class Span {
+  public:
+    typedef std::size_t Index;
+    typedef T* iterator;
+
+    Span() : data_(nullptr), size_(0) {
+    }
+
+    Span(T* data, Index size) : data_(data), size_(size) {
+    }
+
+    // Allows Span<T> -> Span<const T>
+    template<typename U, typename = typename std::enable_if<
+        std::is_convertible<U*, T*>::value>::type>
+    Span(const Span<U>& other) : data_(other.data()), size_(other.size()) {
+    }
+
+    T* data() const {
+      return data_;
+    }
+
+    Index size() const {
+      return size_;
+    }
+
+    T& operator[](Index index) const {
+      return data_[index];
+    }
+
+    iterator begin() const {
+      return data_;
+    }
+
+    iterator end() const {
+      return data_ + size_;
+    }
+
+    Span<T> subspan(Index start, Index size) const {
+      if (start + size > size_) {
+        throw std::out_of_range("Span out of bounds");
+      }
+      return Span<T>(data_ + start, size);
+    }
+
+  protected:
+    T* data_;
+    Index size_;
+};
+
+template<typename T>
+Span<T> MakeSpan(T* data, std::size_t size) {
+  return Span<T>(data, size);
+}
+
+namespace detail {
+
+// Keeps a parameter out of template deduction, so that T comes from the
+// output span alone and a Span<T> or double literal converts
+template<typename T>
+struct NonDeduced {
+  typedef T type;
+};
+
+inline void CheckSizes(std::size_t size1, std::size_t size2) {
+  if (size1 != size2) {
+    throw std::invalid_argument("Kernel spans must be the same size");
+  }
+}
+
+} // End detail namespace
+
+// x = value
+template<typename T>
+void Fill(Span<T> x, typename detail::NonDeduced<T>::type value) {
+  T* ALECTRNN_RESTRICT xp = x.data();
+  const std::size_t size = x.size();
+  for (std::size_t iii = 0; iii < size; ++iii) {
+    xp[iii] = value;
+  }
+}
+
+// y = x
+template<typename T>
+void Copy(Span<const typename detail::NonDeduced<T>::type> x, Span<T> y) {
+  detail::CheckSizes(x.size(), y.size());
+  const T* ALECTRNN_RESTRICT xp = x.data();
+  T* ALECTRNN_RESTRICT yp = y.data();
+  const std::size_t size = x.size();
+  for (std::size_t iii = 0; iii < size; ++iii) {
+    yp[iii] = xp[iii];
+  }
+}
+
+// x = alpha * x
+template<typename T>
+void Scale(typename detail::NonDeduced<T>::type alpha, Span<T> x) {
+  T* ALECTRNN_RESTRICT xp = x.data();
+  const std::size_t size = x.size();
+  for (std::size_t iii = 0; iii < size; ++iii) {
+    xp[iii] *= alpha;
+  }
+}
+
+// y = alpha * x + y
+template<typename T>
+void Axpy(typename detail::NonDeduced<T>::type alpha,
+          Span<const typename detail::NonDeduced<T>::type> x, Span<T> y) {
+  detail::CheckSizes(x.size(), y.size());
+  const T* ALECTRNN_RESTRICT xp = x.data();
+  T* ALECTRNN_RESTRICT yp = y.data();
+  const std::size_t size = x.size();
+  for (std::size_t iii = 0; iii < size; ++iii) {
+    yp[iii] += alpha * xp[iii];
+  }
+}
+
+// x = f(x)
+template<typename T, typename Function>
+void Map(Function f, Span<T> x) {
+  T* ALECTRNN_RESTRICT xp = x.data();
+  const std::size_t size = x.size();
+  for (std::size_t iii = 0; iii < size; ++iii) {
+    xp[iii] = f(xp[iii]);
+  }
+}
+
+// y = f(x)
+template<typename T, typename Function>
+void Map(Function f, Span<const typename detail::NonDeduced<T>::type> x,
+         Span<T> y) {
+  detail::CheckSizes(x.size(), y.size());
+  const T* ALECTRNN_RESTRICT xp = x.data();
+  T* ALECTRNN_RESTRICT yp = y.data();
+  const std::size_t size = x.size();
+  for (std::size_t iii = 0; iii < size; ++iii) {
+    yp[iii] = f(xp[iii]);
+  }
+}
+
+// y = f(y, x), e.g. a state updated from its input
+template<typename T, typename Function>
+void Update(Function f, Span<const typename detail::NonDeduced<T>::type> x,
+            Span<T> y) {
+  detail::CheckSizes(x.size(), y.size());
+  const T* ALECTRNN_RESTRICT xp = x.data();
+  T* ALECTRNN_RESTRICT yp = y.data();
+  const std::size_t size = x.size();
+  for (std::size_t iii = 0; iii < size; ++iii) {
+    yp[iii] = f(yp[iii], xp[iii]);
+  }
+}
+
+} // End multi_array namespace
+
+#endif /* MULTI_ARRAY_KERNELS_H_ */
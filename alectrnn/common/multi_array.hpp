@@ -31,6 +31,12 @@
  * data can not be changed. This is helpful in situations where containers need
  * to be passed as const reference.
  *
+ * MultiArray and Tensor data is ALIGNMENT byte aligned (see arena.hpp). A
+ * Tensor can also be built in, or moved into, an Arena that owns its data.
+ *
+ * Containers, contiguous slices and TensorView sub-blocks lower to a flat Span
+ * with span(), which the vectorized kernels in kernels.hpp run over.
+ *
  * TODO: Implement at() for everyone which will check bounds
  */
 
@@ -45,6 +51,9 @@
 #include <numeric>
 #include <functional>
 #include <algorithm>
+#include <type_traits>
+#include "arena.hpp"
+#include "kernels.hpp"
 
 namespace multi_array {
 
@@ -464,25 +473,26 @@ class MultiArray {
      */
     MultiArray(const Array<Index, NumDim> &shape) : shape_(shape) {
       size_ = std::accumulate(shape_.begin(), shape_.end(), 1, std::multiplies<>());
-      data_ = new T[size_];
+      data_ = AlignedAllocate<T>(size_);
       CalculateStrides();
     }
 
     MultiArray(const std::vector<Index> &shape) : shape_(shape) {
       size_ = std::accumulate(shape_.begin(), shape_.end(), 1, std::multiplies<>());
-      data_ = new T[size_];
+      data_ = AlignedAllocate<T>(size_);
       CalculateStrides();
     }
 
     MultiArray(const std::initializer_list<Index> &shape)
         : shape_(shape) {
       size_ = std::accumulate(shape_.begin(), shape_.end(), 1, std::multiplies<>());
-      data_ = new T[size_];
+      data_ = AlignedAllocate<T>(size_);
       CalculateStrides();
     }
 
     /*
-     * Generates array from existing data and takes ownership of data
+     * Generates array from existing data and takes ownership of data, which
+     * has to come from AlignedAllocate.
      * Use with caution. Prefer using SharedMultiArray.
      */
     MultiArray(TPtr data, const std::vector<Index> &shape)
@@ -497,11 +507,8 @@ class MultiArray {
      */
     MultiArray(const MultiArray<T,NumDim> &other) : shape_(other.shape_),
         strides_(other.strides_), size_(other.size_) {
-      data_ = new T[size_];
-
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = other.data_[iii];
-      }
+      data_ = AlignedAllocate<T>(size_);
+      std::copy(other.data_, other.data_ + size_, data_);
     }
 
     MultiArray(MultiArray<T,NumDim> &&other) : shape_(std::move(other.shape_)),
@@ -511,7 +518,7 @@ class MultiArray {
     }
 
     ~MultiArray() {
-      delete[] data_;
+      AlignedFree(data_);
     };
 
     void CalculateStrides() {
@@ -578,20 +585,27 @@ class MultiArray {
     }
 
     MultiArray<T,NumDim>& operator=(const MultiArray<T,NumDim>& other) {
-      delete[] data_;
+      if (this == &other) {
+        return *this;
+      }
+      // Same sized arrays keep their storage
+      if (size_ != other.size_) {
+        AlignedFree(data_);
+        data_ = AlignedAllocate<T>(other.size_);
+      }
       shape_ = other.shape_;
       strides_ = other.strides_;
       size_ = other.size_;
-
-      data_ = new T[size_];
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = other.data_[iii];
-      }
+      std::copy(other.data_, other.data_ + size_, data_);
 
       return *this;
     }
 
     MultiArray<T,NumDim>& operator=(MultiArray<T,NumDim>&& other) {
+      if (this == &other) {
+        return *this;
+      }
+      AlignedFree(data_);
       data_ = other.data_;
       other.data_ = nullptr;
       shape_ = std::move(other.shape_);
@@ -611,10 +625,16 @@ class MultiArray {
         this->shape_.data());
     }
 
+    Span<T> span() {
+      return {data_, size_};
+    }
+
+    Span<const T> span() const {
+      return {data_, size_};
+    }
+
     void Fill(T value) {
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = value;
-      }
+      multi_array::Fill(span(), value);
     }
 
     template<std::size_t OtherNumDim>
@@ -622,9 +642,7 @@ class MultiArray {
       if (other_array.size() != size_) {
         throw std::invalid_argument("Can't fill multiarray, incompatible sizes");
       }
-      for (Index iii = 0; iii < size_; ++iii) {
-        data_[iii] = other_array[iii];
-      }
+      multi_array::Copy(other_array.span(), span());
     }
 
     bool operator==(const MultiArray<T,NumDim>& other) const {
@@ -798,10 +816,16 @@ class SharedMultiArray {
         this->shape_.data());
     }
 
+    Span<T> span() {
+      return {data_, size_};
+    }
+
+    Span<const T> span() const {
+      return {data_, size_};
+    }
+
     void Fill(T value) {
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = value;
-      }
+      multi_array::Fill(span(), value);
     }
 
     template<std::size_t OtherNumDim>
@@ -809,9 +833,7 @@ class SharedMultiArray {
       if (other_array.size() != size_) {
         throw std::invalid_argument("Can't fill SharedMultiArray, incompatible sizes");
       }
-      for (Index iii = 0; iii < size_; ++iii) {
-        data_[iii] = other_array[iii];
-      }
+      multi_array::Copy(other_array.span(), span());
     }
 
     bool operator==(const SharedMultiArray<T,NumDim>& other) const {
@@ -948,6 +970,27 @@ class ArraySlice {
       return stop_;
     }
 
+    bool is_contiguous() const {
+      return (stride_ == 1) || (size_ < 2);
+    }
+
+    /*
+     * The slice's elements as a flat span. Throws if the slice is strided.
+     */
+    Span<T> span() {
+      if (!is_contiguous()) {
+        throw std::invalid_argument("Only contiguous slices lower to spans");
+      }
+      return {data_ + start_, size_};
+    }
+
+    Span<const T> span() const {
+      if (!is_contiguous()) {
+        throw std::invalid_argument("Only contiguous slices lower to spans");
+      }
+      return {data_ + start_, size_};
+    }
+
   protected:
     T* data_;
     Index start_;
@@ -1047,6 +1090,20 @@ class ConstArraySlice {
       return stop_;
     }
 
+    bool is_contiguous() const {
+      return (stride_ == 1) || (size_ < 2);
+    }
+
+    /*
+     * The slice's elements as a flat span. Throws if the slice is strided.
+     */
+    Span<const T> span() const {
+      if (!is_contiguous()) {
+        throw std::invalid_argument("Only contiguous slices lower to spans");
+      }
+      return {data_ + start_, size_};
+    }
+
   protected:
     const T* data_;
     Index start_;
@@ -1269,9 +1326,13 @@ class ConstSlice {
 
 /*
  * Tensor is a MultiArray with untyped dimension.
+ * Its data either comes from AlignedAllocate and is owned by the Tensor, or
+ * comes from an Arena that owns it. Copies are always owned.
  */
 template<typename T>
 class Tensor {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Tensor elements are kept in raw memory");
   public:
     typedef T* TPtr;
     typedef std::size_t Index;
@@ -1283,6 +1344,7 @@ class Tensor {
       ndims_ = 0;
       size_ = 0;
       data_ = nullptr;
+      owns_data_ = true;
     }
 
     /*
@@ -1290,25 +1352,36 @@ class Tensor {
      */
     template<typename Index, std::size_t NumDim>
     Tensor(const Array<Index, NumDim> &shape) : shape_(shape.begin(), shape.end()),
-        ndims_(shape.size()) {
+        ndims_(shape.size()), owns_data_(true) {
       size_ = std::accumulate(shape_.begin(), shape_.end(), 1, std::multiplies<>());
-      data_ = new T[size_];
+      data_ = AlignedAllocate<T>(size_);
       strides_.resize(ndims_);
       CalculateStrides();
     }
 
     Tensor(const std::vector<Index> &shape) : shape_(shape),
-        ndims_(shape.size()) {
+        ndims_(shape.size()), owns_data_(true) {
       size_ = std::accumulate(shape_.begin(), shape_.end(), 1, std::multiplies<>());
-      data_ = new T[size_];
+      data_ = AlignedAllocate<T>(size_);
       strides_.resize(ndims_);
       CalculateStrides();
     }
 
     Tensor(const std::initializer_list<Index> &shape)
-        : shape_(shape), ndims_(shape.size()) {
+        : shape_(shape), ndims_(shape.size()), owns_data_(true) {
       size_ = std::accumulate(shape_.begin(), shape_.end(), 1, std::multiplies<>());
-      data_ = new T[size_];
+      data_ = AlignedAllocate<T>(size_);
+      strides_.resize(ndims_);
+      CalculateStrides();
+    }
+
+    /*
+     * Build 'empty' Tensor with data from arena
+     */
+    Tensor(const std::vector<Index> &shape, Arena& arena) : shape_(shape),
+        ndims_(shape.size()), owns_data_(false) {
+      size_ = std::accumulate(shape_.begin(), shape_.end(), 1, std::multiplies<>());
+      data_ = arena.Allocate<T>(size_);
       strides_.resize(ndims_);
       CalculateStrides();
     }
@@ -1317,26 +1390,36 @@ class Tensor {
      * Copy (copies data as well)
      */
     Tensor(const Tensor<T> &other) : shape_(other.shape_),
-        strides_(other.strides_), ndims_(other.ndims_), size_(other.size_) {
-      data_ = new T[size_];
-
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = other.data_[iii];
-      }
+        strides_(other.strides_), ndims_(other.ndims_), size_(other.size_),
+        owns_data_(true) {
+      data_ = AlignedAllocate<T>(size_);
+      std::copy(other.data_, other.data_ + size_, data_);
     }
 
     Tensor(Tensor<T> &&other) noexcept
       : shape_(std::move(other.shape_)),
         strides_(std::move(other.strides_)), ndims_(std::move(other.ndims_)),
-        size_(std::move(other.size_)) {
+        size_(std::move(other.size_)), owns_data_(other.owns_data_) {
       data_ = other.data_;
       other.data_ = nullptr;
+      other.owns_data_ = true;
     }
 
     ~Tensor() {
-      delete[] data_;
+      Release();
     };
 
+    /*
+     * Moves the data into arena, which owns it from then on
+     */
+    void MoveInto(Arena& arena) {
+      T* data = arena.Allocate<T>(size_);
+      std::copy(data_, data_ + size_, data);
+      Release();
+      data_ = data;
+      owns_data_ = false;
+    }
+
     void CalculateStrides() {
       for (Index iii = 0; iii < ndims_; iii++) {
         strides_[iii] = 1;
@@ -1415,23 +1498,34 @@ class Tensor {
     }
 
     Tensor<T>& operator=(const Tensor<T>& other) {
-      delete[] data_;
+      if (this == &other) {
+        return *this;
+      }
+      // Same sized tensors keep their storage, so assignment doesn't allocate
+      // and arena data stays in the arena
+      if (size_ != other.size_) {
+        Release();
+        data_ = AlignedAllocate<T>(other.size_);
+        owns_data_ = true;
+      }
       shape_ = other.shape_;
       strides_ = other.strides_;
       size_ = other.size_;
       ndims_ = other.ndims_;
-
-      data_ = new T[size_];
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = other.data_[iii];
-      }
+      std::copy(other.data_, other.data_ + size_, data_);
 
       return *this;
     }
 
     Tensor<T>& operator=(Tensor<T>&& other) noexcept {
+      if (this == &other) {
+        return *this;
+      }
+      Release();
       data_ = other.data_;
+      owns_data_ = other.owns_data_;
       other.data_ = nullptr;
+      other.owns_data_ = true;
       shape_ = std::move(other.shape_);
       strides_ = std::move(other.strides_);
       size_ = std::move(other.size_);
@@ -1448,19 +1542,23 @@ class Tensor {
       return {this->data_, this->strides_.data(), this->shape_.data()};
     }
 
+    Span<T> span() {
+      return {data_, size_};
+    }
+
+    Span<const T> span() const {
+      return {data_, size_};
+    }
+
     void Fill(T value) {
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = value;
-      }
+      multi_array::Fill(span(), value);
     }
 
     void Fill(const Tensor<T>& other_tensor) {
       if (other_tensor.size() != size_) {
         throw std::invalid_argument("Can't fill tensor, incompatible sizes");
       }
-      for (Index iii = 0; iii < size_; ++iii) {
-        data_[iii] = other_tensor[iii];
-      }
+      multi_array::Copy(other_tensor.span(), span());
     }
 
     bool operator==(const Tensor<T>& other) const {
@@ -1485,11 +1583,20 @@ class Tensor {
     }
 
   protected:
+    void Release() {
+      if (owns_data_) {
+        AlignedFree(data_);
+      }
+      data_ = nullptr;
+    }
+
     TPtr data_;
     std::vector<Index> shape_;
     std::vector<Index> strides_;
     std::size_t ndims_;
     std::size_t size_;
+    // False if an Arena owns data_
+    bool owns_data_;
 };
 
 /*
@@ -1659,19 +1766,23 @@ class SharedTensor {
       return {this->data_, this->strides_.data(), this->shape_.data()};
     }
 
+    Span<T> span() {
+      return {data_, size_};
+    }
+
+    Span<const T> span() const {
+      return {data_, size_};
+    }
+
     void Fill(T value) {
-      for (Index iii = 0; iii < size_; iii++) {
-        data_[iii] = value;
-      }
+      multi_array::Fill(span(), value);
     }
 
     void Fill(const SharedTensor<T>& other_tensor) {
       if (other_tensor.size() != size_) {
         throw std::invalid_argument("Can't fill tensors, incompatible sizes");
       }
-      for (Index iii = 0; iii < size_; ++iii) {
-        data_[iii] = other_tensor[iii];
-      }
+      multi_array::Copy(other_tensor.span(), span());
     }
 
   protected:
@@ -1725,6 +1836,19 @@ class TensorView {
     Index extent(Index dimension) const {
       return shape[dimension];
     }
+
+    /*
+     * Lowers the view to a flat span over its next num_dims dimensions, which
+     * are contiguous. E.g. for a view of a CxHxW tensor, view[c].span(2) is
+     * channel c's H*W elements.
+     */
+    Span<T> span(Index num_dims) const {
+      Index size = 1;
+      for (Index iii = 0; iii < num_dims; ++iii) {
+        size *= shape[iii];
+      }
+      return {data, size};
+    }
 };
 
 /*
@@ -0,0 +1,195 @@
+/*
+ * A growable file of fixed size records that is written through a shared
+ * memory map, so a long log costs page cache rather than heap memory and the
+ * OS writes it out in the background. Records are stored back to back with
+ * no header, so a finished file can be opened directly with numpy.memmap.
+ *
+ * The file grows by doubling its capacity. While it is open the file may be
+ * longer than the records written to it; Flush() and the destructor trim it
+ * to exactly size() records.
+ */
+
+#ifndef ALECTRNN_COMMON_RECORD_FILE_H_
+#define ALECTRNN_COMMON_RECORD_FILE_H_
+
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace logging {
+
+// # of records a new file has room for before it first grows
+constexpr std::size_t INITIAL_RECORD_CAPACITY = 64;
+
+template<typename T>
+class RecordFile {
+  public:
+    typedef std::size_t Index;
+
+    RecordFile() : file_descriptor_(-1), record_size_(0), size_(0),
+                   capacity_(0), data_(nullptr) {
+    }
+
+    /*
+     * Creates (or truncates) the file at path for records of record_size
+     * elements of T
+     */
+    RecordFile(const std::string& path, Index record_size)
+        : path_(path), record_size_(record_size), size_(0), capacity_(0),
+          data_(nullptr) {
+      if (record_size_ == 0) {
+        throw std::invalid_argument("RecordFile records can't be empty");
+      }
+      file_descriptor_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (file_descriptor_ < 0) {
+        ThrowError("failed to open");
+      }
+      try {
+        Map(INITIAL_RECORD_CAPACITY);
+      }
+      catch (...) {
+        ::close(file_descriptor_);
+        throw;
+      }
+    }
+
+    ~RecordFile() {
+      Close();
+    }
+
+    RecordFile(const RecordFile&)=delete;
+    RecordFile& operator=(const RecordFile&)=delete;
+
+    RecordFile(RecordFile&& other) noexcept : RecordFile() {
+      Swap(other);
+    }
+
+    RecordFile& operator=(RecordFile&& other) noexcept {
+      if (this != &other) {
+        Close();
+        Swap(other);
+      }
+      return *this;
+    }
+
+    /*
+     * Returns the slot for the next record, growing the file if it is full.
+     * The slot is valid until the next call to NextRecord or Flush.
+     */
+    T* NextRecord() {
+      if (size_ == capacity_) {
+        Map(2 * std::max<Index>(capacity_, 1));
+      }
+      return data_ + record_size_ * size_++;
+    }
+
+    void Append(const T* record) {
+      std::copy(record, record + record_size_, NextRecord());
+    }
+
+    /*
+     * Trims the file to the records written so far and hands them to the OS,
+     * so the file can be read while it stays open for writing.
+     */
+    void Flush() {
+      if (file_descriptor_ < 0) {
+        return;
+      }
+      Map(size_);
+      if ((data_ != nullptr) && (::msync(data_, size_ * RecordBytes(), MS_SYNC) != 0)) {
+        ThrowError("failed to sync");
+      }
+    }
+
+    void Close() {
+      if (file_descriptor_ < 0) {
+        return;
+      }
+      Unmap();
+      if (::ftruncate(file_descriptor_, size_ * RecordBytes()) != 0) {
+        std::cerr << "failed to trim " << path_ << std::endl;
+      }
+      ::close(file_descriptor_);
+      file_descriptor_ = -1;
+    }
+
+    Index size() const {
+      return size_;
+    }
+
+    Index record_size() const {
+      return record_size_;
+    }
+
+    const std::string& path() const {
+      return path_;
+    }
+
+  protected:
+    std::size_t RecordBytes() const {
+      return record_size_ * sizeof(T);
+    }
+
+    // Resizes the file to capacity records and maps all of it
+    void Map(Index capacity) {
+      Unmap();
+      if (::ftruncate(file_descriptor_, capacity * RecordBytes()) != 0) {
+        ThrowError("failed to resize");
+      }
+      capacity_ = capacity;
+      // mmap can't map an empty range
+      if (capacity_ == 0) {
+        return;
+      }
+      void* address = ::mmap(nullptr, capacity_ * RecordBytes(),
+                             PROT_READ | PROT_WRITE, MAP_SHARED,
+                             file_descriptor_, 0);
+      if (address == MAP_FAILED) {
+        capacity_ = 0;
+        ThrowError("failed to map");
+      }
+      data_ = static_cast<T*>(address);
+    }
+
+    void Unmap() {
+      if (data_ != nullptr) {
+        ::munmap(data_, capacity_ * RecordBytes());
+        data_ = nullptr;
+      }
+    }
+
+    void Swap(RecordFile& other) {
+      std::swap(path_, other.path_);
+      std::swap(file_descriptor_, other.file_descriptor_);
+      std::swap(record_size_, other.record_size_);
+      std::swap(size_, other.size_);
+      std::swap(capacity_, other.capacity_);
+      std::swap(data_, other.data_);
+    }
+
+    void ThrowError(const char* message) const {
+      std::cerr << "record file: " << path_ << std::endl;
+      std::cerr << "error: " << std::strerror(errno) << std::endl;
+      throw std::runtime_error(std::string("RecordFile ") + message);
+    }
+
+    std::string path_;
+    int file_descriptor_;
+    Index record_size_;
+    // # of records written
+    Index size_;
+    // # of records the file and map currently have room for
+    Index capacity_;
+    T* data_;
+};
+
+} // End logging namespace
+
+#endif /* ALECTRNN_COMMON_RECORD_FILE_H_ */
@@ -6,8 +6,10 @@
 #define ALECTRNN_SCREEN_LOGGER_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <stdexcept>
+#include <algorithm>
 #include "multi_array.hpp"
 
 namespace alectrnn {
@@ -89,6 +91,185 @@ class ScreenLogger {
     Index fill_count_;
 };
 
+/*
+ * How FrameLogger stores frames.
+ * RAW_SCREENS: each frame's bytes back to back.
+ * DELTA_SCREENS: each frame as the runs of bytes that changed since the
+ *   previous frame. Atari frames change little from one to the next, so this
+ *   is usually a small fraction of the raw size.
+ * Should keep in sync with SCREEN_COMPRESSION in handlers.py
+ */
+enum SCREEN_COMPRESSION {
+  RAW_SCREENS,
+  DELTA_SCREENS
+};
+
+/*
+ * Logs uint8 screens into a single growing byte buffer, so a frame costs its
+ * (possibly compressed) bytes rather than a float Tensor. Decode() writes the
+ * whole history into a caller provided [# frames, screen shape] buffer.
+ *
+ * A DELTA_SCREENS frame is a sequence of (# unchanged bytes, # changed bytes,
+ * changed bytes) runs covering the frame, with the counts stored as base-128
+ * varints. The first frame is encoded against a frame of zeros.
+ */
+template<typename Time=std::size_t>
+class FrameLogger {
+  public:
+    typedef std::size_t Index;
+
+    FrameLogger() : frame_size_(0), compression_(RAW_SCREENS), num_frames_(0) {}
+
+    /*
+     * num_frames is a guess at the # of frames that will be logged, used to
+     * reserve the buffer
+     */
+    FrameLogger(const std::vector<Index>& screen_shape,
+                SCREEN_COMPRESSION compression=RAW_SCREENS,
+                Index num_frames=0)
+        : screen_shape_(screen_shape), compression_(compression),
+          num_frames_(0) {
+      frame_size_ = 1;
+      for (Index dimension : screen_shape_) {
+        frame_size_ *= dimension;
+      }
+      if (compression_ == RAW_SCREENS) {
+        data_.reserve(num_frames * frame_size_);
+      }
+      else {
+        previous_frame_.assign(frame_size_, 0);
+      }
+      time_stamps_.reserve(num_frames);
+    }
+
+    void operator()(const std::vector<std::uint8_t>& screen) {
+      // If no time-stamp is specified, then the frame # is used
+      (*this)(screen, num_frames_);
+    }
+
+    void operator()(const std::vector<std::uint8_t>& screen, Time time_stamp) {
+      if (screen.size() != frame_size_) {
+        throw std::out_of_range("screen is different size from logged screens");
+      }
+      if (compression_ == RAW_SCREENS) {
+        data_.insert(data_.end(), screen.begin(), screen.end());
+      }
+      else {
+        EncodeDelta(screen.data());
+        std::copy(screen.begin(), screen.end(), previous_frame_.begin());
+      }
+      time_stamps_.push_back(time_stamp);
+      ++num_frames_;
+    }
+
+    /*
+     * Writes every logged frame, oldest first, into frames, which needs room
+     * for size() * GetFrameSize() bytes
+     */
+    void Decode(std::uint8_t* frames) const {
+      if (compression_ == RAW_SCREENS) {
+        std::copy(data_.begin(), data_.end(), frames);
+        return;
+      }
+
+      const std::uint8_t* code = data_.data();
+      for (Index frame = 0; frame < num_frames_; ++frame) {
+        std::uint8_t* output = frames + frame * frame_size_;
+        // Unchanged bytes come from the previous frame
+        const std::uint8_t* previous = (frame == 0) ? nullptr : output - frame_size_;
+        Index position = 0;
+        while (position < frame_size_) {
+          const Index num_unchanged = ReadVarint(code);
+          const Index num_changed = ReadVarint(code);
+          if (previous == nullptr) {
+            std::fill(output + position, output + position + num_unchanged, 0);
+          }
+          else {
+            std::copy(previous + position, previous + position + num_unchanged,
+                      output + position);
+          }
+          position += num_unchanged;
+          std::copy(code, code + num_changed, output + position);
+          code += num_changed;
+          position += num_changed;
+        }
+      }
+    }
+
+    // # of frames logged
+    Index size() const {
+      return num_frames_;
+    }
+
+    const std::vector<Index>& GetShape() const {
+      return screen_shape_;
+    }
+
+    Index GetFrameSize() const {
+      return frame_size_;
+    }
+
+    SCREEN_COMPRESSION GetCompression() const {
+      return compression_;
+    }
+
+    // Bytes used to store the frames
+    Index GetNumBytes() const {
+      return data_.size();
+    }
+
+    const std::vector<Time>& GetTimes() const {
+      return time_stamps_;
+    }
+
+  protected:
+    void EncodeDelta(const std::uint8_t* screen) {
+      const std::uint8_t* previous = previous_frame_.data();
+      Index position = 0;
+      while (position < frame_size_) {
+        const Index unchanged_begin = position;
+        while ((position < frame_size_) && (screen[position] == previous[position])) {
+          ++position;
+        }
+        const Index changed_begin = position;
+        while ((position < frame_size_) && (screen[position] != previous[position])) {
+          ++position;
+        }
+        WriteVarint(changed_begin - unchanged_begin);
+        WriteVarint(position - changed_begin);
+        data_.insert(data_.end(), screen + changed_begin, screen + position);
+      }
+    }
+
+    void WriteVarint(Index value) {
+      while (value >= 0x80) {
+        data_.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+      }
+      data_.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    static Index ReadVarint(const std::uint8_t*& code) {
+      Index value = 0;
+      for (Index shift = 0; ; shift += 7) {
+        const std::uint8_t byte = *code++;
+        value |= static_cast<Index>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+          return value;
+        }
+      }
+    }
+
+    std::vector<Index> screen_shape_;
+    Index frame_size_;
+    SCREEN_COMPRESSION compression_;
+    Index num_frames_;
+    std::vector<std::uint8_t> data_;
+    // Last frame logged, what DELTA_SCREENS encodes against
+    std::vector<std::uint8_t> previous_frame_;
+    std::vector<Time> time_stamps_;
+};
+
 } // End alectrnn namespace
 
 #endif //ALECTRNN_SCREEN_LOGGER_HPP
@@ -9,189 +9,145 @@
 #include <cstddef>
 #include <vector>
 #include <cmath>
+#include <stdexcept>
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
 #include "screen_preprocessing.hpp"
 
 namespace alectrnn {
 
-void Apply3x3BoxFilterGray(std::vector<std::uint8_t>& src_screen,
-    std::vector<std::uint8_t>& buffer_screen, 
-    std::size_t screen_width, std::size_t screen_height) {
+//Normalized element of box 3x3 filter. No need to use array since all values
+// are the same.
+static const float box_filter = 0.33333;
+// Applied to the sum of the 3x3 window (row pass * column pass)
+static const float box_filter_scale = box_filter * box_filter;
 
-  //Normalized element of box 3x3 filter. No need to use array since all values
-  // are the same.
-  static const float box_filter = 0.33333;
-
-  // Accumulate along Columns
-  for (std::size_t row = 0; row < screen_height; row++) {
-    float cumulative_sum = 0.0;
-    // Initiate rolling sum (boundary condition uses screen edge values)
-    cumulative_sum += 2 * box_filter * src_screen[row * screen_width] \
-                    + box_filter * src_screen[row * screen_width + 1];
-    buffer_screen[row * screen_width] = \
-        static_cast<std::uint8_t>(cumulative_sum);
-    cumulative_sum += box_filter * src_screen[row * screen_width + 2] \
-                    - box_filter * src_screen[row * screen_width];
-    buffer_screen[row * screen_width + 1] = \
-        static_cast<std::uint8_t>(cumulative_sum);
-
-    // Initiate rolling sum (end before boundary conflict)
-    for (std::size_t col = 2; col < screen_width-1; col++) {
-      cumulative_sum += box_filter * src_screen[row * screen_width + col + 1] \
-                      - box_filter * src_screen[row * screen_width + col - 2];
-      buffer_screen[row * screen_width + col] = \
-          static_cast<std::uint8_t>(cumulative_sum);
-    }
+GrayScreenResizer::GrayScreenResizer() : src_width_(0), src_height_(0),
+    tar_width_(0), tar_height_(0) {
+}
 
-    // Initiate end boundary handling
-    cumulative_sum += box_filter*src_screen[row*screen_width + screen_width-1]\
-                    - box_filter*src_screen[row*screen_width + screen_width-4];
-    buffer_screen[row * screen_width + screen_width - 1] = \
-        static_cast<std::uint8_t>(cumulative_sum);
+GrayScreenResizer::GrayScreenResizer(std::size_t src_width, std::size_t src_height,
+                                     std::size_t tar_width, std::size_t tar_height)
+    : src_width_(src_width), src_height_(src_height),
+      tar_width_(tar_width), tar_height_(tar_height),
+      row_offsets_(3 * tar_height), column_indices_(3 * tar_width),
+      column_sums_(src_width) {
+  if ((src_width_ < 2) || (src_height_ < 2) || (tar_width_ > src_width_)
+      || (tar_height_ > src_height_)) {
+    throw std::invalid_argument("GrayScreenResizer can only downsample "
+                                "screens of at least 2x2");
   }
 
-  // Accumulate along Rows
-  for (std::size_t col = 0; col < screen_width; col++) {
-    float cumulative_sum = 0.0;
-    // Initiate rolling sum (boundary condition uses screen edge values)
-    cumulative_sum += 2 * box_filter * buffer_screen[col] \
-                    + box_filter * buffer_screen[1 * screen_width + col];
-    src_screen[col] = \
-        static_cast<std::uint8_t>(cumulative_sum);
-    cumulative_sum += box_filter * buffer_screen[2*screen_width + col] \
-                    - box_filter * buffer_screen[col];
-    src_screen[1 * screen_width + col] = \
-        static_cast<std::uint8_t>(cumulative_sum);
-
-    // Initiate rolling sum (end before boundary conflict)
-    for (std::size_t row = 2; row < screen_height-1; row++) {
-      cumulative_sum += box_filter * buffer_screen[(row+1)*screen_width +col] \
-                      - box_filter * buffer_screen[(row-2)*screen_width +col];
-      src_screen[row * screen_width + col] = \
-          static_cast<std::uint8_t>(cumulative_sum);
-    }
-
-    // Initiate end boundary handling
-    cumulative_sum += box_filter*buffer_screen[(screen_height-1)*screen_width+col]\
-                    - box_filter*buffer_screen[(screen_height-4)*screen_width+col];
-    src_screen[(screen_height-1) * screen_width + col] = \
-        static_cast<std::uint8_t>(cumulative_sum);
+  // Sampled pixel is floor(target index * ratio), as in nearest downsampling
+  float height_ratio = src_height_ / (float) tar_height_;
+  float width_ratio = src_width_ / (float) tar_width_;
+  for (std::size_t iii = 0; iii < tar_height_; iii++) {
+    const std::size_t row = (std::size_t) floor(iii * height_ratio);
+    row_offsets_[3 * iii] = ((row == 0) ? row : row - 1) * src_width_;
+    row_offsets_[3 * iii + 1] = row * src_width_;
+    row_offsets_[3 * iii + 2] = ((row == src_height_ - 1) ? row : row + 1) * src_width_;
   }
-}
-
-void SubsampleGrayScreen(std::size_t src_width, std::size_t src_height,
-                         std::size_t tar_width, std::size_t tar_height,
-                         const std::vector<std::uint8_t>& src_screen,
-                         std::vector<std::uint8_t>& tar_screen) {
-  tar_screen.resize(tar_width * tar_height);
-  float height_ratio = src_height / (float) tar_height;
-  float width_ratio = src_width / (float) tar_width;
-  for (std::size_t iii = 0; iii < tar_height; iii++) {
-    for (std::size_t jjj = 0; jjj < tar_width; jjj++) {
-      tar_screen[iii * tar_width + jjj] = 
-          src_screen[(std::size_t) (floor(iii * height_ratio) * src_width 
-            + floor(jjj * width_ratio))];
-    }
+  for (std::size_t jjj = 0; jjj < tar_width_; jjj++) {
+    const std::size_t col = (std::size_t) floor(jjj * width_ratio);
+    column_indices_[3 * jjj] = (col == 0) ? col : col - 1;
+    column_indices_[3 * jjj + 1] = col;
+    column_indices_[3 * jjj + 2] = (col == src_width_ - 1) ? col : col + 1;
   }
 }
 
-std::uint8_t GrayscaleAverage(std::uint8_t grayscale_value1,
-                              std::uint8_t grayscale_value2) {
-  return (std::uint8_t)( ((grayscale_value1) + (grayscale_value2)) >> 1);
+void GrayScreenResizer::SumSourceRows(const std::uint8_t* src_screen,
+                                      std::size_t tar_row) {
+  const std::uint8_t* above = src_screen + row_offsets_[3 * tar_row];
+  const std::uint8_t* center = src_screen + row_offsets_[3 * tar_row + 1];
+  const std::uint8_t* below = src_screen + row_offsets_[3 * tar_row + 2];
+  std::uint16_t* sums = column_sums_.data();
+  std::size_t col = 0;
+#if defined(__AVX2__)
+  for (; col + 16 <= src_width_; col += 16) {
+    __m256i sum = _mm256_cvtepu8_epi16(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(above + col)));
+    sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(center + col))));
+    sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(below + col))));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + col), sum);
+  }
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; col + 16 <= src_width_; col += 16) {
+    const __m128i above_pixels = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(above + col));
+    const __m128i center_pixels = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(center + col));
+    const __m128i below_pixels = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(below + col));
+    __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(above_pixels, zero),
+                                _mm_unpacklo_epi8(center_pixels, zero));
+    low = _mm_add_epi16(low, _mm_unpacklo_epi8(below_pixels, zero));
+    __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(above_pixels, zero),
+                                 _mm_unpackhi_epi8(center_pixels, zero));
+    high = _mm_add_epi16(high, _mm_unpackhi_epi8(below_pixels, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + col), low);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + col + 8), high);
+  }
+#endif
+  for (; col < src_width_; ++col) {
+    sums[col] = above[col] + center[col] + below[col];
+  }
 }
 
-void ResizeGrayScreen(std::size_t src_width, std::size_t src_height,
-                      std::size_t tar_width, std::size_t tar_height,
-                      std::vector<std::uint8_t>& src_screen,
-                      std::vector<std::uint8_t>& tar_screen,
-                      std::vector<std::uint8_t>& buffer_screen) {
-  Apply3x3BoxFilterGray(src_screen, buffer_screen, src_width, src_height);
-  SubsampleGrayScreen(src_width, src_height, tar_width, tar_height,
-                      src_screen, tar_screen);
+void GrayScreenResizer::operator()(const std::vector<std::uint8_t>& src_screen,
+                                   std::vector<float>& tar_screen) {
+  tar_screen.resize(tar_width_ * tar_height_);
+  (*this)(src_screen, tar_screen.data());
 }
 
-void Apply3x3BoxFilterGray(const std::vector<std::uint8_t>& src_screen,
-    std::vector<float>& buffer_screen1, std::vector<float>& buffer_screen2,
-    std::size_t screen_width, std::size_t screen_height) {
-
-  //Normalized element of box 3x3 filter. No need to use array since all values
-  // are the same.
-  static const float box_filter = 0.33333;
-
-  // Accumulate along Columns
-  for (std::size_t row = 0; row < screen_height; row++) {
-    float cumulative_sum = 0.0;
-    // Initiate rolling sum (boundary condition uses screen edge values)
-    cumulative_sum += 2 * box_filter * src_screen[row * screen_width] \
-                    + box_filter * src_screen[row * screen_width + 1];
-    buffer_screen1[row * screen_width] = cumulative_sum;
-    cumulative_sum += box_filter * src_screen[row * screen_width + 2] \
-                    - box_filter * src_screen[row * screen_width];
-    buffer_screen1[row * screen_width + 1] = cumulative_sum;
-
-    // Initiate rolling sum (end before boundary conflict)
-    for (std::size_t col = 2; col < screen_width-1; col++) {
-      cumulative_sum += box_filter * src_screen[row * screen_width + col + 1] \
-                      - box_filter * src_screen[row * screen_width + col - 2];
-      buffer_screen1[row * screen_width + col] = cumulative_sum;
+template<typename T>
+void GrayScreenResizer::FilterInto(const std::vector<std::uint8_t>& src_screen,
+                                   T* tar_screen) {
+  for (std::size_t iii = 0; iii < tar_height_; iii++) {
+    SumSourceRows(src_screen.data(), iii);
+    const std::size_t* columns = column_indices_.data();
+    T* tar_row = tar_screen + iii * tar_width_;
+    for (std::size_t jjj = 0; jjj < tar_width_; jjj++, columns += 3) {
+      const float pixel = box_filter_scale * (column_sums_[columns[0]]
+                                              + column_sums_[columns[1]]
+                                              + column_sums_[columns[2]]);
+      tar_row[jjj] = pixel;
     }
-
-    // Initiate end boundary handling
-    cumulative_sum += box_filter*src_screen[row*screen_width + screen_width-1]\
-                    - box_filter*src_screen[row*screen_width + screen_width-4];
-    buffer_screen1[row * screen_width + screen_width - 1] = cumulative_sum;
   }
+}
 
-  // Accumulate along Rows
-  for (std::size_t col = 0; col < screen_width; col++) {
-    float cumulative_sum = 0.0;
-    // Initiate rolling sum (boundary condition uses screen edge values)
-    cumulative_sum += 2 * box_filter * buffer_screen1[col] \
-                    + box_filter * buffer_screen1[1 * screen_width + col];
-    buffer_screen2[col] = cumulative_sum;
-    cumulative_sum += box_filter * buffer_screen1[2*screen_width + col] \
-                    - box_filter * buffer_screen1[col];
-    buffer_screen2[1 * screen_width + col] = cumulative_sum;
-
-    // Initiate rolling sum (end before boundary conflict)
-    for (std::size_t row = 2; row < screen_height-1; row++) {
-      cumulative_sum += box_filter * buffer_screen1[(row+1)*screen_width +col] \
-                      - box_filter * buffer_screen1[(row-2)*screen_width +col];
-      buffer_screen2[row * screen_width + col] = cumulative_sum;
-    }
+void GrayScreenResizer::operator()(const std::vector<std::uint8_t>& src_screen,
+                                   float* tar_screen) {
+  FilterInto(src_screen, tar_screen);
+}
 
-    // Initiate end boundary handling
-    cumulative_sum += box_filter*buffer_screen1[(screen_height-1)*screen_width+col]\
-                    - box_filter*buffer_screen1[(screen_height-4)*screen_width+col];
-    buffer_screen2[(screen_height-1) * screen_width + col] = cumulative_sum;
-  }
+void GrayScreenResizer::operator()(const std::vector<std::uint8_t>& src_screen,
+                                   double* tar_screen) {
+  FilterInto(src_screen, tar_screen);
 }
 
-void SubsampleGrayScreen(std::size_t src_width, std::size_t src_height,
-                         std::size_t tar_width, std::size_t tar_height,
-                         const std::vector<float>& src_screen,
-                         std::vector<float>& tar_screen) {
-  tar_screen.resize(tar_width * tar_height);
-  float height_ratio = src_height / (float) tar_height;
-  float width_ratio = src_width / (float) tar_width;
-  for (std::size_t iii = 0; iii < tar_height; iii++) {
-    for (std::size_t jjj = 0; jjj < tar_width; jjj++) {
-      tar_screen[iii * tar_width + jjj] = 
-          src_screen[(std::size_t) (floor(iii * height_ratio) * src_width 
-            + floor(jjj * width_ratio))];
+void GrayScreenResizer::operator()(const std::vector<std::uint8_t>& src_screen,
+                                   std::vector<std::uint8_t>& tar_screen) {
+  tar_screen.resize(tar_width_ * tar_height_);
+  for (std::size_t iii = 0; iii < tar_height_; iii++) {
+    SumSourceRows(src_screen.data(), iii);
+    const std::size_t* columns = column_indices_.data();
+    std::uint8_t* tar_row = tar_screen.data() + iii * tar_width_;
+    for (std::size_t jjj = 0; jjj < tar_width_; jjj++, columns += 3) {
+      tar_row[jjj] = static_cast<std::uint8_t>(box_filter_scale
+                                               * (column_sums_[columns[0]]
+                                                  + column_sums_[columns[1]]
+                                                  + column_sums_[columns[2]]));
     }
   }
 }
 
-void ResizeGrayScreen(std::size_t src_width, std::size_t src_height,
-                      std::size_t tar_width, std::size_t tar_height,
-                      const std::vector<std::uint8_t>& src_screen,
-                      std::vector<float>& tar_screen,
-                      std::vector<float>& buffer_screen1,
-                      std::vector<float>& buffer_screen2) {
-  Apply3x3BoxFilterGray(src_screen, buffer_screen1, 
-                        buffer_screen2, src_width, src_height);
-  SubsampleGrayScreen(src_width, src_height, tar_width, tar_height,
-                      buffer_screen2, tar_screen);
+std::uint8_t GrayscaleAverage(std::uint8_t grayscale_value1,
+                              std::uint8_t grayscale_value2) {
+  return (std::uint8_t)( ((grayscale_value1) + (grayscale_value2)) >> 1);
 }
 
-}
\ No newline at end of file
+}
@@ -4,12 +4,10 @@
  *  Created on: Sep 2, 2017
  *      Author: Nathaniel Rodriguez
  *
- * A utility function for use by the Agents to resize the ALE atari game
- * screen. ResizeGrayScreen currently just downsamples the image, but
- * GrayscaleAverage can be added easily to smooth it if need.
+ * A utility for use by the Agents to resize the ALE atari game screen.
+ * GrayScreenResizer box filters and downsamples the grayscale screen.
  *
  * (to-do: add color resizing function)
- * (to-do: add gaussian or box filter before downsizing)
  * * Note: ALE screen 1D contiguous arrays ordered by consecutive rows and so
  * can be accessed by [Y * WIDTH + X] where X is moves along columns and y 
  * along rows
@@ -25,35 +23,55 @@
 
 namespace alectrnn {
 
-void Apply3x3BoxFilterGray(std::vector<std::uint8_t>& src_screen,
-                           std::vector<std::uint8_t>& buffer_screen,
-                           std::size_t screen_width, std::size_t screen_height);
-void SubsampleGrayScreen(std::size_t src_width, std::size_t src_height,
-                         std::size_t tar_width, std::size_t tar_height,
-                         const std::vector<std::uint8_t>& src_screen,
-                         std::vector<std::uint8_t>& tar_screen);
+/*
+ * Applies a 3x3 box filter (edges replicated) to a grayscale screen and
+ * subsamples it to the target size in a single pass. Only the source pixels
+ * that are sampled get filtered: for each target row, the three source rows
+ * around it are summed column-wise with SSE2/AVX2 (whichever the build
+ * enables), then the three column sums around each sampled column are
+ * gathered through a precomputed index table. Build it once per screen size
+ * and reuse it every step.
+ */
+class GrayScreenResizer {
+  public:
+    GrayScreenResizer();
+    GrayScreenResizer(std::size_t src_width, std::size_t src_height,
+                      std::size_t tar_width, std::size_t tar_height);
+
+    void operator()(const std::vector<std::uint8_t>& src_screen,
+                    std::vector<float>& tar_screen);
+    // Writes GetTargetSize() floats to tar_screen, e.g. an input layer channel
+    void operator()(const std::vector<std::uint8_t>& src_screen,
+                    float* tar_screen);
+    // The float pixels widened, so double networks see the same inputs
+    void operator()(const std::vector<std::uint8_t>& src_screen,
+                    double* tar_screen);
+    void operator()(const std::vector<std::uint8_t>& src_screen,
+                    std::vector<std::uint8_t>& tar_screen);
+
+    std::size_t GetTargetSize() const {
+      return tar_width_ * tar_height_;
+    }
+
+  protected:
+    // Fills column_sums_ with the sums of the three rows around target row
+    void SumSourceRows(const std::uint8_t* src_screen, std::size_t tar_row);
+    template<typename T>
+    void FilterInto(const std::vector<std::uint8_t>& src_screen, T* tar_screen);
+
+    std::size_t src_width_;
+    std::size_t src_height_;
+    std::size_t tar_width_;
+    std::size_t tar_height_;
+    // Source row offsets of the rows above, at and below each sampled row
+    std::vector<std::size_t> row_offsets_;
+    // Source columns left of, at and right of each sampled column
+    std::vector<std::size_t> column_indices_;
+    std::vector<std::uint16_t> column_sums_;
+};
+
 std::uint8_t GrayscaleAverage(std::uint8_t grayscale_value1,
                               std::uint8_t grayscale_value2);
-void ResizeGrayScreen(std::size_t src_width, std::size_t src_height,
-                      std::size_t tar_width, std::size_t tar_height,
-                      std::vector<std::uint8_t>& src_screen,
-                      std::vector<std::uint8_t>& tar_screen,
-                      std::vector<std::uint8_t>& buffer_screen);
-
-void Apply3x3BoxFilterGray(const std::vector<std::uint8_t>& src_screen,
-                           std::vector<float>& buffer_screen1,
-                           std::vector<float>& buffer_screen2,
-                           std::size_t screen_width, std::size_t screen_height);
-void SubsampleGrayScreen(std::size_t src_width, std::size_t src_height,
-                         std::size_t tar_width, std::size_t tar_height,
-                         const std::vector<float>& src_screen,
-                         std::vector<float>& tar_screen);
-void ResizeGrayScreen(std::size_t src_width, std::size_t src_height,
-                      std::size_t tar_width, std::size_t tar_height,
-                      const std::vector<std::uint8_t>& src_screen,
-                      std::vector<float>& tar_screen,
-                      std::vector<float>& buffer_screen1,
-                      std::vector<float>& buffer_screen2);
 
 }
 
@@ -0,0 +1,192 @@
+/*
+ * A small fork-join thread pool for splitting the work of a single network
+ * step (intra-op parallelism). ParallelFor divides [0, size) into contiguous
+ * chunks, runs the first chunk on the calling thread and the others on the
+ * pool's workers, and returns once every chunk is done. Workers persist
+ * between calls, so the per-call overhead is a wake-up, not a thread spawn.
+ *
+ * A pool with one thread has no workers and runs everything inline.
+ * ParallelFor calls from different threads are serialized. The function is
+ * passed to the workers by pointer, so a call never allocates.
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <stdexcept>
+
+namespace parallel {
+
+typedef std::size_t Index;
+
+// Rough # of multiply-adds below which a chunk isn't worth a wake-up
+constexpr Index MIN_WORK_PER_THREAD = 16384;
+
+class ThreadPool {
+  public:
+    explicit ThreadPool(Index num_threads) : num_threads_(num_threads),
+        task_(nullptr), task_function_(nullptr), task_size_(0), num_chunks_(0),
+        generation_(0), num_pending_(0), stop_(false) {
+      if (num_threads_ == 0) {
+        throw std::invalid_argument("ThreadPool needs at least one thread");
+      }
+      workers_.reserve(num_threads_ - 1);
+      for (Index worker = 1; worker < num_threads_; ++worker) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, worker);
+      }
+    }
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      start_condition_.notify_all();
+      for (auto& worker : workers_) {
+        worker.join();
+      }
+    }
+
+    ThreadPool(const ThreadPool&)=delete;
+    ThreadPool& operator=(const ThreadPool&)=delete;
+
+    Index NumThreads() const {
+      return num_threads_;
+    }
+
+    /*
+     * Number of chunks ParallelFor will split size elements into when each
+     * chunk should have at least grain elements.
+     */
+    Index NumChunks(Index size, Index grain) const {
+      return std::max<Index>(1, std::min(num_threads_, size / std::max<Index>(1, grain)));
+    }
+
+    /*
+     * Runs function(chunk begin, chunk end, chunk id) over [0, size) split
+     * into NumChunks(size, grain) chunks. Chunk ids are in [0, NumChunks), so
+     * they can index per-chunk buffers. Exceptions thrown by a chunk are
+     * rethrown on the calling thread.
+     */
+    template<typename TFunction>
+    void ParallelFor(Index size, Index grain, const TFunction& function) {
+      const Index num_chunks = NumChunks(size, grain);
+      if (num_chunks == 1) {
+        function(0, size, 0);
+        return;
+      }
+
+      std::lock_guard<std::mutex> call_lock(call_mutex_);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &InvokeFunction<TFunction>;
+        task_function_ = &function;
+        task_size_ = size;
+        num_chunks_ = num_chunks;
+        num_pending_ = num_chunks - 1;
+        error_ = nullptr;
+        ++generation_;
+      }
+      start_condition_.notify_all();
+
+      std::exception_ptr error = nullptr;
+      try {
+        RunChunk(0);
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_condition_.wait(lock, [this] { return num_pending_ == 0; });
+      task_ = nullptr;
+      task_function_ = nullptr;
+      if (error == nullptr) {
+        error = error_;
+      }
+      lock.unlock();
+      if (error != nullptr) {
+        std::rethrow_exception(error);
+      }
+    }
+
+  protected:
+    typedef void (*TaskFunction)(const void*, Index, Index, Index);
+
+    template<typename TFunction>
+    static void InvokeFunction(const void* function, Index begin, Index end,
+                               Index chunk) {
+      (*static_cast<const TFunction*>(function))(begin, end, chunk);
+    }
+
+    void RunChunk(Index chunk) const {
+      const Index begin = chunk * task_size_ / num_chunks_;
+      const Index end = (chunk + 1) * task_size_ / num_chunks_;
+      task_(task_function_, begin, end, chunk);
+    }
+
+    void WorkerLoop(Index worker) {
+      std::size_t seen_generation = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          start_condition_.wait(lock, [this, seen_generation] {
+            return stop_ || (generation_ != seen_generation);
+          });
+          if (stop_) {
+            return;
+          }
+          seen_generation = generation_;
+          // This worker has no chunk when the task was split into fewer chunks
+          if (worker >= num_chunks_) {
+            continue;
+          }
+        }
+
+        std::exception_ptr error = nullptr;
+        try {
+          RunChunk(worker);
+        }
+        catch (...) {
+          error = std::current_exception();
+        }
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if ((error != nullptr) && (error_ == nullptr)) {
+            error_ = error;
+          }
+          --num_pending_;
+        }
+        done_condition_.notify_one();
+      }
+    }
+
+    const Index num_threads_;
+    std::vector<std::thread> workers_;
+    // serializes ParallelFor calls
+    std::mutex call_mutex_;
+    // guards the task state below
+    std::mutex mutex_;
+    std::condition_variable start_condition_;
+    std::condition_variable done_condition_;
+    TaskFunction task_;
+    const void* task_function_;
+    Index task_size_;
+    Index num_chunks_;
+    std::size_t generation_;
+    Index num_pending_;
+    std::exception_ptr error_;
+    bool stop_;
+};
+
+} // End parallel namespace
+
+#endif /* THREAD_POOL_H_ */
@@ -7,9 +7,31 @@
 
 #include <limits>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <algorithm>
 #include <type_traits>
 
+/*
+ * Marks a hot loop for function multi-versioning: GCC (and clang >= 14)
+ * build an AVX-512, an AVX2 and a baseline copy of the function, and the
+ * dynamic loader picks one from the CPU when the module is loaded. Eigen picks
+ * its instruction set when it is compiled, so the marked functions are plain
+ * loops that the compiler vectorizes for each target. The loops need
+ * -fno-trapping-math to vectorize, since they select on float compares, and
+ * every copy gives the same results with -ffp-contract=off (both are set in
+ * setup.py). Left out if the build already targets AVX2 (see ALECTRNN_MARCH
+ * in setup.py) or the platform has no ifuncs.
+ */
+#if defined(__x86_64__) && defined(__linux__) && !defined(__AVX2__) \
+    && ((defined(__clang__) && __clang_major__ >= 14) \
+        || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 6))
+#define ALECTRNN_TARGET_CLONES \
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define ALECTRNN_TARGET_CLONES
+#endif
+
 namespace utilities {
 
 typedef int Integer; // Can be signed or unsigned
@@ -80,6 +102,65 @@ TReal sigmoid(TReal x) {
   return 1 / (1 + std::exp(-x));
 }
 
+/*
+ * exp(x) for use inside loops the compiler should vectorize (std::exp is a
+ * library call and stops vectorization). Cephes' range reduction to
+ * x = n ln2 + r, |r| <= ln2/2, with a polynomial for exp(r) and 2^n built in
+ * the exponent bits. x is clamped so 2^n stays a normal number. Accurate to
+ * about an ulp.
+ */
+inline float vector_exp(float x) {
+  x = std::min(std::max(x, -87.3f), 88.3f);
+  const float fx = x * 1.44269504088896341f + 0.5f;
+  std::int32_t n = static_cast<std::int32_t>(fx);
+  n -= static_cast<std::int32_t>(static_cast<float>(n) > fx); // floor
+  const float nf = static_cast<float>(n);
+  x = x - nf * 0.693359375f + nf * 2.12194440e-4f;
+  float y = 1.9875691500e-4f;
+  y = y * x + 1.3981999507e-3f;
+  y = y * x + 8.3334519073e-3f;
+  y = y * x + 4.1665795894e-2f;
+  y = y * x + 1.6666665459e-1f;
+  y = y * x + 5.0000001201e-1f;
+  y = y * x * x + x + 1.0f;
+  const std::int32_t bits = (n + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return y * scale;
+}
+
+/*
+ * Double version, with Cephes' Pade approximant
+ * exp(r) = 1 + 2 r P(r^2) / (Q(r^2) - r P(r^2)).
+ */
+inline double vector_exp(double x) {
+  x = std::min(std::max(x, -708.0), 709.0);
+  const double fx = x * 1.4426950408889634073599 + 0.5;
+  std::int64_t n = static_cast<std::int64_t>(fx);
+  n -= static_cast<std::int64_t>(static_cast<double>(n) > fx); // floor
+  const double nf = static_cast<double>(n);
+  x = x - nf * 6.93145751953125e-1 - nf * 1.42860682030941723212e-6;
+  const double xx = x * x;
+  double px = 1.26177193074810590878e-4;
+  px = px * xx + 3.02994407707441961300e-2;
+  px = px * xx + 9.99999999999999999910e-1;
+  px *= x;
+  double qx = 3.00198505138664455042e-6;
+  qx = qx * xx + 2.52448340349684104192e-3;
+  qx = qx * xx + 2.27265548208155028766e-1;
+  qx = qx * xx + 2.00000000000000000009e0;
+  const double y = 1.0 + 2.0 * px / (qx - px);
+  const std::int64_t bits = (n + 1023) << 52;
+  double scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return y * scale;
+}
+
+template <typename TReal>
+TReal vector_sigmoid(TReal x) {
+  return 1 / (1 + vector_exp(-x));
+}
+
 template <typename TReal>
 TReal approx_sigmoid(const TReal x, const TReal scale=0.5, const TReal bias=0.5,
                      const TReal curve=1.0) {
@@ -171,6 +252,54 @@ void Im2Col(const Dtype* data_im, const Integer channels,
   }
 }
 
+/*
+ * Builds only the rows [tile_begin, tile_begin + tile_size) of the im2col
+ * matrix that Im2Col would produce (output positions are rows). The tile is
+ * written column-major, so it can be mapped directly as a
+ * (tile_size x channels * kernel_h * kernel_w) matrix.
+ * Uses NCHW memory layout, zero padding and no dilation.
+ */
+template <typename Dtype>
+void Im2ColTile(const Dtype* data_im, const Integer channels,
+                const Integer height, const Integer width,
+                const Integer kernel_h, const Integer kernel_w,
+                const Integer pad_h, const Integer pad_w,
+                const Integer stride_h, const Integer stride_w,
+                const Integer tile_begin, const Integer tile_size,
+                Dtype* data_col) {
+  const Integer output_w = (width + 2 * pad_w - kernel_w) / stride_w + 1;
+  const Integer channel_size = height * width;
+  for (Integer channel = channels; channel--; data_im += channel_size) {
+    for (Integer kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
+      for (Integer kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
+        Integer output_row = tile_begin / output_w;
+        Integer output_col = tile_begin % output_w;
+        // Walk the tile one output row segment at a time
+        for (Integer remaining = tile_size; remaining; ) {
+          const Integer segment = std::min(remaining, output_w - output_col);
+          const Integer input_row = -pad_h + kernel_row + output_row * stride_h;
+          if (!is_a_ge_zero_and_a_lt_b(input_row, height)) {
+            for (Integer position = segment; position; position--) {
+              *(data_col++) = 0;
+            }
+          } else {
+            const Dtype* input = data_im + input_row * width;
+            Integer input_col = -pad_w + kernel_col + output_col * stride_w;
+            for (Integer position = segment; position; position--) {
+              *(data_col++) = is_a_ge_zero_and_a_lt_b(input_col, width) ?
+                              input[input_col] : 0;
+              input_col += stride_w;
+            }
+          }
+          remaining -= segment;
+          output_col = 0;
+          ++output_row;
+        }
+      }
+    }
+  }
+}
+
 } // End utilities namespace
 
 #endif /* NN_UTILITIES_H_ */
\ No newline at end of file
@@ -6,61 +6,226 @@
  */
 
 #include <ale_interface.hpp>
+#include <emucore/Serializer.hxx>
+#include <emucore/Deserializer.hxx>
 #include "../agents/player_agent.hpp"
 #include "controller.hpp"
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 
 namespace alectrnn {
 
-Controller::Controller(ALEInterface* ale, PlayerAgent* agent)
+namespace {
+
+std::string SaveRng(Random& rng) {
+  Serializer serializer;
+  rng.saveState(serializer);
+  return serializer.get_str();
+}
+
+void LoadRng(Random& rng, const std::string& rng_state) {
+  Deserializer deserializer(rng_state);
+  rng.loadState(deserializer);
+}
+
+}
+
+constexpr std::size_t ResetStateCache::MAX_RESET_DRAWS;
+
+ResetStateCache::ResetStateCache(std::size_t max_states)
+      : max_states_(max_states) {
+}
+
+void ResetStateCache::TrainingReset(ALEInterface* ale) {
+  Random& rng = ale->theOSystem->rng();
+  const std::string rng_state = SaveRng(rng);
+
+  int environment_index = 0;
+  if (ale->getBool("use_environment_distribution")
+      && ale->getInt("num_random_environments") > 0) {
+    Random draws;
+    LoadRng(draws, rng_state);
+    environment_index = static_cast<int>(draws.next()
+        % static_cast<unsigned int>(ale->getInt("num_random_environments")));
+  }
+  const ResetKey key(MakeKey(ale, environment_index));
+
+  CachedReset reset;
+  if (Load(key, reset)) {
+    ale->restoreState(reset.state);
+    for (std::size_t draw = 0; draw < reset.num_draws; ++draw) {
+      rng.next();
+    }
+    return;
+  }
+
+  ale->training_reset();
+  const std::string reset_rng_state = SaveRng(rng);
+  Random draws;
+  LoadRng(draws, rng_state);
+  for (std::size_t num_draws = 0; num_draws <= MAX_RESET_DRAWS; ++num_draws) {
+    if (SaveRng(draws) == reset_rng_state) {
+      reset.state = ale->cloneState();
+      reset.num_draws = num_draws;
+      Store(key, reset);
+      return;
+    }
+    draws.next();
+  }
+}
+
+std::size_t ResetStateCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return states_.size();
+}
+
+ResetStateCache::ResetKey ResetStateCache::MakeKey(ALEInterface* ale,
+                                                   int environment_index) {
+  return ResetKey(ale->getString("rom_file"), ale->getInt("random_seed"),
+                  environment_index, ale->getInt("num_random_environments"),
+                  ale->getBool("use_environment_distribution"),
+                  ale->getInt("system_reset_steps"), ale->getInt("frame_skip"),
+                  ale->getFloat("repeat_action_probability"),
+                  ale->getBool("color_averaging"));
+}
+
+bool ResetStateCache::Load(const ResetKey& key, CachedReset& reset) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto cached = states_.find(key);
+  if (cached == states_.end()) {
+    return false;
+  }
+  recent_keys_.splice(recent_keys_.begin(), recent_keys_,
+                      cached->second.second);
+  reset = cached->second.first;
+  return true;
+}
+
+void ResetStateCache::Store(const ResetKey& key, const CachedReset& reset) {
+  if (max_states_ == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another controller may have stored it since this one's Load
+  if (states_.find(key) != states_.end()) {
+    return;
+  }
+  if (states_.size() >= max_states_) {
+    states_.erase(recent_keys_.back());
+    recent_keys_.pop_back();
+  }
+  recent_keys_.push_front(key);
+  states_.emplace(key, std::make_pair(reset, recent_keys_.begin()));
+}
+
+ScoreRateBoard::ScoreRateBoard(float percentile, std::size_t min_samples)
+      : percentile_(percentile), min_samples_(min_samples) {
+}
+
+bool ScoreRateBoard::RecordAndCheck(std::size_t checkpoint, int score) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (checkpoint >= scores_.size()) {
+    scores_.resize(checkpoint + 1);
+  }
+  std::vector<int>& scores = scores_[checkpoint];
+  bool is_below = false;
+  if (percentile_ > 0 && scores.size() >= std::max<std::size_t>(min_samples_, 1)) {
+    std::vector<int> sorted_scores(scores);
+    std::size_t rank = static_cast<std::size_t>(std::floor(
+        percentile_ / 100.0 * (sorted_scores.size() - 1)));
+    std::nth_element(sorted_scores.begin(), sorted_scores.begin() + rank,
+                     sorted_scores.end());
+    is_below = score < sorted_scores[rank];
+  }
+  scores.push_back(score);
+  return is_below;
+}
+
+Controller::Controller(ALEInterface* ale, PlayerAgent* agent,
+                       ResetStateCache* reset_cache,
+                       const EarlyStopRules* early_stop_rules,
+                       ScoreRateBoard* score_rate_board)
       : ale_(ale), agent_(agent), episode_score_(0), episode_number_(0),
         cumulative_score_(0), frame_number_(0),
         frame_skip_(ale->getInt("frame_skip")),
         max_num_frames_(ale->getInt("max_num_frames")),
         max_num_episodes_(ale->getInt("max_num_episodes")),
-        stop_episode_(false) {
-  ale_->training_reset();
+        stop_episode_(false), reset_cache_(reset_cache),
+        early_stop_rules_(early_stop_rules),
+        score_rate_board_(score_rate_board), stopped_early_(false),
+        last_reward_frame_(0), action_start_frame_(0),
+        last_action_(PLAYER_A_NOOP), next_checkpoint_(0), first_step_(true),
+        action_(PLAYER_A_NOOP) {
+  ResetEnvironment();
 }
 
 Controller::~Controller() {
 }
 
 void Controller::Run() {
-  Action agent_action;
-  bool first_step = true;
-  ale_->training_reset();
+  Start();
+  while (!IsDone()) {
+    SelectAction();
+    ApplyAction();
+  }
+}
+
+void Controller::Start() {
+  first_step_ = true;
+  ResetEnvironment();
   agent_->Reset();
+  EndFinishedEpisodes();
+}
 
-  while (!IsDone()) {
-    // Start a new episode: Check for terminal state
-    if (ale_->environment->isTerminal() || stop_episode_) {
-      EpisodeEnd();
-      first_step = true;
-      stop_episode_ = false;
-    }
-    else {
-      if (first_step) {
-        // Start a new episode; obtain actions
-        EpisodeStart(agent_action);
-        first_step = false;
-      }
-      else {
-        // Poll agents for actions
-        EpisodeStep(agent_action);
-      }
+void Controller::SelectAction() {
+  if (first_step_) {
+    // Start a new episode; obtain actions
+    EpisodeStart(action_);
+    first_step_ = false;
+  }
+  else {
+    // Poll agents for actions
+    EpisodeStep(action_);
+  }
+}
 
-      // Apply said actions
-      ApplyActions(agent_action);
-    }
+void Controller::ApplyAction() {
+  ApplyActions(action_);
+  SaveScreen();
+  EndFinishedEpisodes();
+}
 
-    if (ale_->getBool("print_screen")) {
-      std::stringstream ss;
-      ss << std::setw(10) << std::setfill('0') << frame_number_;
-      std::string framename = ss.str();
-      ale_->saveScreenPNG(framename + "_game_frame.png");
-    }
+void Controller::SetAction(Action action) {
+  action_ = action;
+}
+
+/*
+ * Starts a new episode while the current one is over (terminal state or
+ * stopped by the agent) and there is still playing to do
+ */
+void Controller::EndFinishedEpisodes() {
+  while (!IsDone() && (ale_->environment->isTerminal() || stop_episode_)) {
+    EpisodeEnd();
+    first_step_ = true;
+    stop_episode_ = false;
+    SaveScreen();
+  }
+}
+
+void Controller::SaveScreen() {
+  if (ale_->getBool("print_screen")) {
+    std::stringstream ss;
+    ss << std::setw(10) << std::setfill('0') << frame_number_;
+    std::string framename = ss.str();
+    ale_->saveScreenPNG(framename + "_game_frame.png");
   }
 }
 
@@ -68,6 +233,10 @@ int Controller::getCumulativeScore() const {
   return cumulative_score_;
 }
 
+bool Controller::StoppedEarly() const {
+  return stopped_early_;
+}
+
 void Controller::EpisodeStart(Action& action) {
   // Poll the agent for first action
   action = agent_->EpisodeStart();
@@ -81,7 +250,7 @@ void Controller::EpisodeStep(Action& action) {
 
 void Controller::EpisodeEnd() {
   agent_->EpisodeEnd();
-  ale_->training_reset();
+  ResetEnvironment();
 }
 
 void Controller::ApplyActions(Action& action) {
@@ -109,17 +278,71 @@ void Controller::ApplyActions(Action& action) {
       episode_score_ += reward;
       cumulative_score_ += reward;
       agent_->RewardFeedback(reward);
+      if (early_stop_rules_ != nullptr) {
+        CheckEarlyStop(action, reward);
+      }
       break;
   }
 }
 
+/*
+ * Called after each emulator step, when frame_number_ is the # of frames
+ * played including this step
+ */
+void Controller::CheckEarlyStop(Action action, int reward) {
+  const int step_start_frame = frame_number_ - frame_skip_;
+  if (reward != 0) {
+    last_reward_frame_ = frame_number_;
+  }
+  if (action != last_action_) {
+    last_action_ = action;
+    action_start_frame_ = step_start_frame;
+  }
+
+  if (early_stop_rules_->inactivity_frames > 0
+      && frame_number_ - last_reward_frame_
+         >= early_stop_rules_->inactivity_frames) {
+    stopped_early_ = true;
+  }
+  if (early_stop_rules_->repeated_action_frames > 0
+      && frame_number_ - action_start_frame_
+         >= early_stop_rules_->repeated_action_frames) {
+    stopped_early_ = true;
+  }
+
+  // Frame skip can step past a checkpoint, so it is checked on the first
+  // step at or after it
+  if (early_stop_rules_->rate_check_frames > 0
+      && frame_number_ >= static_cast<int>(next_checkpoint_ + 1)
+                          * early_stop_rules_->rate_check_frames) {
+    if (early_stop_rules_->min_score_rate != 0
+        && cumulative_score_ < early_stop_rules_->min_score_rate * frame_number_) {
+      stopped_early_ = true;
+    }
+    if (score_rate_board_ != nullptr
+        && score_rate_board_->RecordAndCheck(next_checkpoint_, cumulative_score_)) {
+      stopped_early_ = true;
+    }
+    ++next_checkpoint_;
+  }
+}
+
 bool Controller::IsDone() const {
-  return (agent_->HasTerminated() ||
+  return (agent_->HasTerminated() || stopped_early_ ||
       (max_num_episodes_ > 0 && episode_number_ > max_num_episodes_) ||
       (max_num_frames_ > 0 &&
           frame_number_ >= max_num_frames_));
 }
 
+void Controller::ResetEnvironment() {
+  if (reset_cache_ == nullptr) {
+    ale_->training_reset();
+  }
+  else {
+    reset_cache_->TrainingReset(ale_);
+  }
+}
+
 int Controller::GetEpisodeNumber() const {
   return episode_number_;
 }
@@ -6,22 +6,153 @@
  *
  * Setting max_num_frames = -1 allows agents to keep playing till they fail
  * Setting max_num_episodes = -1 allows agents to keep playing new games
+ *
+ * Given a ResetStateCache the controller restores a snapshot of the emulator
+ * after a training reset instead of replaying the reset prefix (see
+ * ResetStateCache).
+ *
+ * Given EarlyStopRules the controller stops playing once a member has
+ * obviously failed, and StoppedEarly() reports it. Its score is then the
+ * score up to that frame. The rules are checked after every emulator step:
+ * - inactivity: no reward for inactivity_frames frames
+ * - repeated action: the same action for repeated_action_frames frames
+ * - score rate: every rate_check_frames frames, the score per frame is below
+ *   min_score_rate, or below the score_rate_percentile of the scores other
+ *   members had at that frame (recorded in a shared ScoreRateBoard)
+ * A rule with a limit of 0 is off. rate_check_frames only sets when the
+ * score rate rules are checked, and each of min_score_rate and
+ * score_rate_percentile is off when 0, so a member with a negative score is
+ * not stopped unless min_score_rate is set.
  */
 
 #ifndef ALECTRNN_CONTROLLERS_CONTROLLER_H_
 #define ALECTRNN_CONTROLLERS_CONTROLLER_H_
 
+#include <cstddef>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 #include <ale_interface.hpp>
 #include "../agents/player_agent.hpp"
 
 namespace alectrnn {
 
+struct EarlyStopRules {
+  int inactivity_frames = 0;
+  int repeated_action_frames = 0;
+  int rate_check_frames = 0;
+  // Score per frame below which a member is stopped, 0 is off
+  float min_score_rate = 0.0;
+  // Percentile in (0, 100) of the board's scores, 0 is off
+  float score_rate_percentile = 0.0;
+  // # of scores a checkpoint needs before the percentile is used
+  std::size_t min_rate_samples = 10;
+};
+
+/*
+ * Scores that members had at each rate checkpoint, shared by the controllers
+ * evaluating a population. Members are compared with whichever members
+ * reached the checkpoint before them, so with several threads which members
+ * are pruned depends on the evaluation order. Members pruned at a
+ * checkpoint never reach the later ones, so later percentiles are taken over
+ * the survivors.
+ */
+class ScoreRateBoard {
+  public:
+    ScoreRateBoard(float percentile, std::size_t min_samples);
+    /*
+     * Records the score at the checkpoint and returns whether it is below
+     * the percentile of the scores recorded there before it
+     */
+    bool RecordAndCheck(std::size_t checkpoint, int score);
+
+  protected:
+    const float percentile_;
+    const std::size_t min_samples_;
+    std::vector<std::vector<int>> scores_;
+    std::mutex mutex_;
+};
+
+/*
+ * Emulator states right after a training reset, owned by the caller so they
+ * are reused across evaluations (e.g. one cache per ObjectiveHandler).
+ *
+ * The fork's training_reset() draws its start from the ALE's rng: with an
+ * environment distribution its first draw, modulo num_random_environments,
+ * picks the environment, otherwise the start is always the same. TrainingReset
+ * reads that draw from a copy of the rng, so the index names the environment
+ * training_reset() is about to use. A state is keyed by the index, the rom and
+ * every ALE setting that changes what training_reset() produces. On a miss the
+ * real training_reset() runs and the # of rng draws it made is stored with the
+ * state; a hit restores the state and advances the rng by as many draws. The
+ * rng therefore plays the same stream with or without the cache. A reset
+ * whose draws can't be counted (more than MAX_RESET_DRAWS) isn't cached.
+ *
+ * At most max_states are kept, and the least recently used is dropped first.
+ * Controllers on several threads may share one cache, so access is locked.
+ */
+class ResetStateCache {
+  public:
+    static constexpr std::size_t MAX_RESET_DRAWS = 1 << 16;
+
+    explicit ResetStateCache(std::size_t max_states=64);
+    // Does the equivalent of ale->training_reset()
+    void TrainingReset(ALEInterface* ale);
+    std::size_t size() const;
+
+  protected:
+    // rom, seed, environment index, # environments, environment distribution,
+    // reset steps, frame skip, repeat action probability, color averaging
+    typedef std::tuple<std::string, int, int, int, bool, int, int, float, bool>
+        ResetKey;
+    typedef std::list<ResetKey> RecencyList;
+
+    struct CachedReset {
+      ALEState state;
+      // # of rng draws the training_reset() made
+      std::size_t num_draws;
+    };
+
+    static ResetKey MakeKey(ALEInterface* ale, int environment_index);
+    bool Load(const ResetKey& key, CachedReset& reset);
+    void Store(const ResetKey& key, const CachedReset& reset);
+
+    const std::size_t max_states_;
+    // Most recently used first
+    RecencyList recent_keys_;
+    std::map<ResetKey, std::pair<CachedReset, RecencyList::iterator>> states_;
+    mutable std::mutex mutex_;
+};
+
 class Controller {
   public:
-    Controller(ALEInterface* ale, PlayerAgent* agent);
+    Controller(ALEInterface* ale, PlayerAgent* agent,
+               ResetStateCache* reset_cache=nullptr,
+               const EarlyStopRules* early_stop_rules=nullptr,
+               ScoreRateBoard* score_rate_board=nullptr);
     ~Controller();
     void Run();
+    /*
+     * Run() is Start() followed by SelectAction() and ApplyAction() until
+     * IsDone(). SelectAction() only runs the agent and ApplyAction() mostly
+     * runs the emulator, so PipelinedController can overlap the halves of
+     * different controllers on different threads.
+     */
+    void Start();
+    void SelectAction();
+    void ApplyAction();
+    /*
+     * Replaces the action picked by the last SelectAction(), for agents whose
+     * action is only known once a batch of agents has acted (VecController)
+     */
+    void SetAction(Action action);
+    bool IsDone() const;
     int getCumulativeScore() const;
+    bool StoppedEarly() const;
     int GetEpisodeNumber() const;
     int GetFrameNumber() const;
     int GetEpisodeFrameNumber() const;
@@ -32,7 +163,10 @@ class Controller {
     void EpisodeStep(Action& action);
     void EpisodeEnd();
     void ApplyActions(Action& action);
-    bool IsDone() const;
+    void EndFinishedEpisodes();
+    void SaveScreen();
+    void ResetEnvironment();
+    void CheckEarlyStop(Action action, int reward);
 
   protected:
     const int max_num_frames_;
@@ -45,6 +179,16 @@ class Controller {
     ALEInterface* ale_;
     const int frame_skip_;
     bool stop_episode_;
+    ResetStateCache* reset_cache_;
+    const EarlyStopRules* early_stop_rules_;
+    ScoreRateBoard* score_rate_board_;
+    bool stopped_early_;
+    int last_reward_frame_;
+    int action_start_frame_;
+    Action last_action_;
+    std::size_t next_checkpoint_;
+    bool first_step_;
+    Action action_;
 };
 
 }
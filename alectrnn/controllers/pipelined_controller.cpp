@@ -0,0 +1,217 @@
+/*
+ * pipelined_controller.cpp
+ *
+ * The calling thread selects actions and a second thread plays them on the
+ * emulators. Stages are handed between them through two queues, so which
+ * thread owns a stage is always determined by which queue it was last popped
+ * from. Refilling a stage (which resets its emulators) is done by the calling
+ * thread once the stage has no game left to select for.
+ */
+
+#include <algorithm>
+#include <ale_interface.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../nervous_system/nervous_system.hpp"
+#include "controller.hpp"
+#include "pipelined_controller.hpp"
+#include "vec_controller.hpp"
+
+namespace alectrnn {
+
+namespace {
+
+/*
+ * Blocking FIFO of stage indices. Pop waits for a stage and returns false
+ * once the queue is closed, dropping any stages left in it.
+ */
+class StageQueue {
+  public:
+    typedef std::size_t Index;
+
+    StageQueue() : closed_(false) {
+    }
+
+    void Push(Index stage) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stages_.push_back(stage);
+      }
+      condition_.notify_one();
+    }
+
+    bool Pop(Index& stage) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this] { return closed_ || !stages_.empty(); });
+      if (closed_) {
+        return false;
+      }
+      stage = stages_.front();
+      stages_.pop_front();
+      return true;
+    }
+
+    void Close() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+      }
+      condition_.notify_all();
+    }
+
+  protected:
+    std::deque<Index> stages_;
+    bool closed_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+};
+
+}
+
+template<typename TReal>
+PipelinedController<TReal>::PipelinedController(
+    const std::vector<ALEInterface*>& ales,
+    const std::vector<nervous_system::NervousSystem<TReal>*>& neural_nets,
+    Index update_rate, ResetStateCache* reset_cache) {
+  if (neural_nets.empty() || ales.size() < neural_nets.size()) {
+    std::cerr << "# ales: " << ales.size() << std::endl;
+    std::cerr << "# networks: " << neural_nets.size() << std::endl;
+    throw std::invalid_argument("PipelinedController needs at least one"
+                                " network and one ale per network");
+  }
+  for (Index stage = 0; stage < neural_nets.size(); ++stage) {
+    if (neural_nets[stage] == nullptr
+        || std::count(neural_nets.begin(), neural_nets.begin() + stage,
+                      neural_nets[stage]) > 0) {
+      throw std::invalid_argument("Each PipelinedController stage needs its"
+                                  " own network");
+    }
+  }
+
+  const Index num_stages = neural_nets.size();
+  stage_starts_.push_back(0);
+  for (Index stage = 0; stage < num_stages; ++stage) {
+    const Index stage_size = ales.size() / num_stages
+                             + ((stage < ales.size() % num_stages) ? 1 : 0);
+    stage_starts_.push_back(stage_starts_.back() + stage_size);
+    stages_.emplace_back(new VecController<TReal>(
+        std::vector<ALEInterface*>(ales.begin() + stage_starts_[stage],
+                                   ales.begin() + stage_starts_.back()),
+        *neural_nets[stage], update_rate, reset_cache));
+  }
+}
+
+template<typename TReal>
+PipelinedController<TReal>::~PipelinedController() {
+}
+
+template<typename TReal>
+void PipelinedController<TReal>::Run(const RefillFunction& refill) {
+  // Configures and starts the stage's next games. Returns false if none of
+  // its ales has a game left.
+  auto schedule = [&](Index stage) {
+    std::vector<const float*> parameters(stages_[stage]->size());
+    bool has_game = false;
+    for (Index env = 0; env < parameters.size(); ++env) {
+      parameters[env] = refill(stage_starts_[stage] + env);
+      has_game = has_game || (parameters[env] != nullptr);
+    }
+    if (!has_game) {
+      return false;
+    }
+    stages_[stage]->Configure(parameters);
+    stages_[stage]->Start();
+    return true;
+  };
+
+  // Stages waiting for their actions to be selected
+  StageQueue select_queue;
+  // Stages waiting for their actions to be played
+  StageQueue play_queue;
+  Index num_playing = 0;
+  for (Index stage = 0; stage < stages_.size(); ++stage) {
+    if (schedule(stage)) {
+      select_queue.Push(stage);
+      ++num_playing;
+    }
+  }
+  if (num_playing == 0) {
+    return;
+  }
+
+  // The calling thread closes the play queue once every stage is out of
+  // games, so then neither queue holds a stage. After an error on either
+  // thread both stop at their next Pop.
+  std::exception_ptr emulator_error = nullptr;
+  std::thread emulator_thread([&] {
+    try {
+      Index stage;
+      while (play_queue.Pop(stage)) {
+        stages_[stage]->ApplyActions();
+        select_queue.Push(stage);
+      }
+    }
+    catch (...) {
+      emulator_error = std::current_exception();
+      select_queue.Close();
+    }
+  });
+
+  std::exception_ptr network_error = nullptr;
+  try {
+    Index stage;
+    while (num_playing > 0 && select_queue.Pop(stage)) {
+      if (stages_[stage]->SelectActions()) {
+        play_queue.Push(stage);
+      }
+      else if (schedule(stage)) {
+        select_queue.Push(stage);
+      }
+      else {
+        --num_playing;
+      }
+    }
+  }
+  catch (...) {
+    network_error = std::current_exception();
+  }
+  play_queue.Close();
+  emulator_thread.join();
+
+  if (network_error != nullptr) {
+    std::rethrow_exception(network_error);
+  }
+  if (emulator_error != nullptr) {
+    std::rethrow_exception(emulator_error);
+  }
+}
+
+template<typename TReal>
+typename PipelinedController<TReal>::Index PipelinedController<TReal>::size() const {
+  return stage_starts_.back();
+}
+
+template<typename TReal>
+const Controller& PipelinedController<TReal>::GetController(Index ale) const {
+  if (ale >= size()) {
+    std::cerr << "ale: " << ale << std::endl;
+    throw std::invalid_argument("PipelinedController has no such ale");
+  }
+  const Index stage = std::upper_bound(stage_starts_.begin(),
+                                       stage_starts_.end(), ale)
+                      - stage_starts_.begin() - 1;
+  return stages_[stage]->GetController(ale - stage_starts_[stage]);
+}
+
+
+template class PipelinedController<float>;
+template class PipelinedController<double>;
+
+}
@@ -0,0 +1,77 @@
+/*
+ * pipelined_controller.hpp
+ *
+ * Plays several ales at once on two threads. The ales are split into
+ * stages, each a VecController with its own batched network. One thread
+ * selects a stage's actions (screen preprocessing and a single
+ * NervousSystem::BatchStep() for all of its ales), and the other plays a
+ * stage's actions on its emulators. A stage alternates between the two
+ * threads, so while the network steps one stage the emulators of another
+ * play their last actions. Each stage is only ever touched by one thread at
+ * a time. With a single stage nothing overlaps, and Run() plays like
+ * VecController::Run().
+ *
+ * Within a stage every member is run by the same network step, so members
+ * with shared weights multiply them with the whole batch, and members with
+ * their own (e.g. a population) are walked back to back by one layer at a
+ * time instead of by separate networks. A stage plays its games in lockstep
+ * and is refilled once all of them are done. As with VecController, a member
+ * whose agent skips acting while others act is still stepped. Instantiated
+ * for float and double networks (see precision.hpp).
+ */
+
+#ifndef ALECTRNN_CONTROLLERS_PIPELINED_CONTROLLER_H_
+#define ALECTRNN_CONTROLLERS_PIPELINED_CONTROLLER_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <ale_interface.hpp>
+#include "../nervous_system/nervous_system.hpp"
+#include "controller.hpp"
+#include "vec_controller.hpp"
+
+namespace alectrnn {
+
+template<typename TReal>
+class PipelinedController {
+  public:
+    typedef std::size_t Index;
+    /*
+     * Called with an ale's index when its stage is free: before Run() starts
+     * playing and after all of the stage's games are done. The caller can
+     * read the finished game's results from GetController(), and should
+     * return the parameters of the ale's next game, or nullptr if it has no
+     * game left. The parameters must outlive the game.
+     */
+    typedef std::function<const float*(Index)> RefillFunction;
+
+    /*
+     * The ales are split into one contiguous stage per network, as evenly as
+     * possible. Each network must support batch mode and is used by only
+     * its stage.
+     */
+    PipelinedController(const std::vector<ALEInterface*>& ales,
+                        const std::vector<nervous_system::NervousSystem<TReal>*>& neural_nets,
+                        Index update_rate=1,
+                        ResetStateCache* reset_cache=nullptr);
+    ~PipelinedController();
+
+    /*
+     * Plays until no ale has a game left. Exceptions from either thread are
+     * rethrown.
+     */
+    void Run(const RefillFunction& refill);
+    Index size() const;
+    const Controller& GetController(Index ale) const;
+
+  protected:
+    std::vector<std::unique_ptr<VecController<TReal>>> stages_;
+    // Index of the first ale of each stage, followed by size()
+    std::vector<Index> stage_starts_;
+};
+
+}
+
+#endif /* ALECTRNN_CONTROLLERS_PIPELINED_CONTROLLER_H_ */
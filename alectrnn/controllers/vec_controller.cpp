@@ -0,0 +1,268 @@
+/*
+ * vec_controller.cpp
+ *
+ * Each environment's Controller runs as usual. The only difference is when
+ * its agent's action becomes known: SelectAction() just records the screen,
+ * and the action is set after the batch step.
+ */
+
+#include <ale_interface.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../agents/player_agent.hpp"
+#include "../common/multi_array.hpp"
+#include "../common/screen_preprocessing.hpp"
+#include "../nervous_system/nervous_system.hpp"
+#include "controller.hpp"
+#include "vec_controller.hpp"
+
+namespace alectrnn {
+
+/*
+ * Agent for one member of a batched NervousSystem. Act() writes the screen
+ * into the member's input and the action is read from its output row after
+ * the batch step.
+ */
+template<typename TReal>
+class BatchMemberAgent : public PlayerAgent {
+  public:
+    typedef std::size_t Index;
+
+    BatchMemberAgent(ALEInterface* ale,
+                     nervous_system::NervousSystem<TReal>& neural_net,
+                     Index member)
+        : PlayerAgent(ale), neural_net_(neural_net), member_(member),
+          has_acted_(false) {
+      if (neural_net_[0].shape().size() != 3) {
+        throw std::invalid_argument("VecController needs input layer with "
+                                    "3 dimensions");
+      }
+      screen_resizer_ = GrayScreenResizer(ale_->environment->getScreenWidth(),
+                                          ale_->environment->getScreenHeight(),
+                                          neural_net_[0].shape()[2],
+                                          neural_net_[0].shape()[1]);
+      grey_screen_.resize(ale_->environment->getScreenHeight() *
+                          ale_->environment->getScreenWidth());
+    }
+
+    // The shared network is configured by the VecController
+    virtual void Configure(const float *parameters) {
+    }
+
+    virtual std::size_t GetParameterCount() const {
+      return neural_net_.GetParameterCount();
+    }
+
+    bool HasActed() const {
+      return has_acted_;
+    }
+
+    /*
+     * Argmax of the member's outputs over the available actions, the same
+     * rule as NervousSystemAgent::GetActionFromNervousSystem()
+     */
+    Action TakeBatchAction() {
+      has_acted_ = false;
+      const multi_array::Tensor<TReal>& output = neural_net_.GetBatchOutput();
+      const TReal* member_output = output.data()
+                                   + member_ * (output.size() / output.shape()[0]);
+      Action preferred_action(PLAYER_A_NOOP);
+      TReal preferred_output(std::numeric_limits<TReal>::lowest());
+      for (Index iii = 0; iii < available_actions_.size(); ++iii) {
+        if (preferred_output < member_output[iii]) {
+          preferred_output = member_output[iii];
+          preferred_action = available_actions_[iii];
+        }
+      }
+      return preferred_action;
+    }
+
+  protected:
+    virtual Action Act() {
+      ale_->getScreenGrayscale(grey_screen_);
+      screen_resizer_(grey_screen_, neural_net_.AdvanceBatchInputChannel(member_));
+      has_acted_ = true;
+      // Replaced by TakeBatchAction() once the batch has stepped
+      return PLAYER_A_NOOP;
+    }
+
+    nervous_system::NervousSystem<TReal>& neural_net_;
+    const Index member_;
+    bool has_acted_;
+    std::vector<std::uint8_t> grey_screen_;
+    GrayScreenResizer screen_resizer_;
+};
+
+template<typename TReal>
+VecController<TReal>::VecController(const std::vector<ALEInterface*>& ales,
+                                    nervous_system::NervousSystem<TReal>& neural_net,
+                                    Index update_rate,
+                                    ResetStateCache* reset_cache)
+      : ales_(ales), neural_net_(neural_net), update_rate_(update_rate),
+        reset_cache_(reset_cache), controllers_(ales.size()),
+        member_parameters_(ales.size()), is_configured_(ales.size(), true),
+        is_stepping_(ales.size(), false) {
+  if (ales_.empty()) {
+    throw std::invalid_argument("VecController needs at least one ale");
+  }
+  neural_net_.SetBatchSize(ales_.size());
+  for (Index env = 0; env < ales_.size(); ++env) {
+    agents_.emplace_back(new BatchMemberAgent<TReal>(ales_[env], neural_net_, env));
+  }
+}
+
+template<typename TReal>
+VecController<TReal>::~VecController() {
+}
+
+template<typename TReal>
+void VecController<TReal>::Configure(const float* parameters) {
+  const Index count = neural_net_.GetParameterCount();
+  neural_net_.BatchConfigure({multi_array::ConstArraySlice<TReal>(
+      NetworkParameters(parameters, count, member_parameters_[0]), 0,
+      count, 1)});
+  is_configured_.assign(size(), true);
+}
+
+template<typename TReal>
+void VecController<TReal>::Configure(const std::vector<const float*>& parameters) {
+  if (parameters.size() != size()) {
+    std::cerr << "# parameter sets: " << parameters.size() << std::endl;
+    std::cerr << "# environments: " << size() << std::endl;
+    throw std::invalid_argument("VecController needs one parameter set per"
+                                " environment");
+  }
+  // Members sitting out still need parameters, so they borrow a configured
+  // member's. Their outputs are never read.
+  const Index count = neural_net_.GetParameterCount();
+  std::vector<const TReal*> network_parameters(size(), nullptr);
+  const TReal* fallback_parameters = nullptr;
+  for (Index env = 0; env < size(); ++env) {
+    is_configured_[env] = (parameters[env] != nullptr);
+    if (is_configured_[env]) {
+      network_parameters[env] = NetworkParameters(parameters[env], count,
+                                                  member_parameters_[env]);
+      if (fallback_parameters == nullptr) {
+        fallback_parameters = network_parameters[env];
+      }
+    }
+  }
+  if (fallback_parameters == nullptr) {
+    throw std::invalid_argument("VecController needs at least one configured"
+                                " environment");
+  }
+  std::vector<multi_array::ConstArraySlice<TReal>> member_slices;
+  member_slices.reserve(size());
+  for (Index env = 0; env < size(); ++env) {
+    member_slices.emplace_back(is_configured_[env] ? network_parameters[env]
+                                                   : fallback_parameters,
+                               0, count, 1);
+  }
+  neural_net_.BatchConfigure(member_slices);
+}
+
+template<typename TReal>
+void VecController<TReal>::Run() {
+  Start();
+  while (SelectActions()) {
+    ApplyActions();
+  }
+}
+
+template<typename TReal>
+void VecController<TReal>::Start() {
+  neural_net_.BatchReset();
+  for (Index env = 0; env < size(); ++env) {
+    if (is_configured_[env]) {
+      controllers_[env].reset(new Controller(ales_[env], agents_[env].get(),
+                                             reset_cache_));
+      controllers_[env]->Start();
+    }
+    else {
+      controllers_[env].reset();
+    }
+  }
+}
+
+template<typename TReal>
+bool VecController<TReal>::SelectActions() {
+  // Environments that are done are masked out of the rest of the run. An
+  // agent can end its game while selecting, which (as in Controller::Run())
+  // still plays that action, so the mask is taken before selecting.
+  bool is_playing = false;
+  bool has_acted = false;
+  for (Index env = 0; env < size(); ++env) {
+    is_stepping_[env] = (controllers_[env] != nullptr)
+                        && !controllers_[env]->IsDone();
+    if (is_stepping_[env]) {
+      is_playing = true;
+      controllers_[env]->SelectAction();
+      has_acted = has_acted || agents_[env]->HasActed();
+    }
+  }
+  if (!is_playing) {
+    return false;
+  }
+
+  if (has_acted) {
+    for (Index iii = 0; iii < update_rate_; ++iii) {
+      neural_net_.BatchStep();
+    }
+  }
+
+  for (Index env = 0; env < size(); ++env) {
+    if (is_stepping_[env] && agents_[env]->HasActed()) {
+      controllers_[env]->SetAction(agents_[env]->TakeBatchAction());
+    }
+  }
+  return true;
+}
+
+template<typename TReal>
+void VecController<TReal>::ApplyActions() {
+  for (Index env = 0; env < size(); ++env) {
+    if (is_stepping_[env]) {
+      controllers_[env]->ApplyAction();
+    }
+  }
+}
+
+template<typename TReal>
+typename VecController<TReal>::Index VecController<TReal>::size() const {
+  return controllers_.size();
+}
+
+template<typename TReal>
+const Controller& VecController<TReal>::GetController(Index env) const {
+  if (env >= size() || controllers_[env] == nullptr) {
+    std::cerr << "environment: " << env << std::endl;
+    throw std::invalid_argument("Environment has not played a game");
+  }
+  return *controllers_[env];
+}
+
+
+template<>
+const float* VecController<float>::NetworkParameters(const float* parameters,
+                                                     Index count,
+                                                     std::vector<float>& buffer) {
+  return parameters;
+}
+
+template<>
+const double* VecController<double>::NetworkParameters(const float* parameters,
+                                                       Index count,
+                                                       std::vector<double>& buffer) {
+  buffer.assign(parameters, parameters + count);
+  return buffer.data();
+}
+
+template class VecController<float>;
+template class VecController<double>;
+
+}
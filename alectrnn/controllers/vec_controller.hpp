@@ -0,0 +1,102 @@
+/*
+ * vec_controller.hpp
+ *
+ * Plays K environments in lockstep with one set of parameters, e.g. the same
+ * game with different seeds or from an environment distribution. Each
+ * environment has its own Controller and a light agent that only writes its
+ * downsized screen into its member of the network's batch input. Then a
+ * single NervousSystem::BatchStep() runs all K members, so the all-to-all
+ * integrators multiply their shared weights with the whole batch (a GEMM)
+ * instead of once per environment. Each agent then takes the argmax of its
+ * batch output row, as NervousSystemAgent does.
+ *
+ * An environment that is done is masked out. Its controller is no longer
+ * stepped and its member's outputs are ignored. When no agent needs a
+ * network step (all skipped acting to reset an episode), the batch isn't
+ * stepped. A member whose agent skips its step while others act is still
+ * stepped with its last input. This differs from the NervousSystemAgent,
+ * which doesn't step then. It happens once per episode when
+ * max_num_frames_per_episode ends it.
+ *
+ * The network must support batch mode (no stateful activators or reward
+ * modulated integrators). Its batch size is set to K.
+ *
+ * Members can also be given their own parameters, e.g. different members of
+ * a population. Parameters are float, and are widened for a double network.
+ * Instantiated for float and double networks (see precision.hpp). Run() is Start() followed by alternating SelectActions() and
+ * ApplyActions(), which PipelinedController calls from different threads.
+ */
+
+#ifndef ALECTRNN_CONTROLLERS_VEC_CONTROLLER_H_
+#define ALECTRNN_CONTROLLERS_VEC_CONTROLLER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <ale_interface.hpp>
+#include "../nervous_system/nervous_system.hpp"
+#include "controller.hpp"
+
+namespace alectrnn {
+
+template<typename TReal>
+class BatchMemberAgent;
+
+template<typename TReal>
+class VecController {
+  public:
+    typedef std::size_t Index;
+
+    VecController(const std::vector<ALEInterface*>& ales,
+                  nervous_system::NervousSystem<TReal>& neural_net,
+                  Index update_rate=1,
+                  ResetStateCache* reset_cache=nullptr);
+    ~VecController();
+
+    /*
+     * Configures the network with parameters shared by every environment.
+     * They must outlive Run().
+     */
+    void Configure(const float* parameters);
+    /*
+     * Configures each environment's member with its own parameters. An
+     * environment whose parameters are nullptr sits out the next run.
+     */
+    void Configure(const std::vector<const float*>& parameters);
+    void Run();
+    /*
+     * Resets the network and starts a game in every configured environment
+     */
+    void Start();
+    /*
+     * Selects every playing environment's action with one batch step.
+     * Returns false, without stepping, once every game is done.
+     */
+    bool SelectActions();
+    // Plays the actions chosen by the last SelectActions()
+    void ApplyActions();
+    Index size() const;
+    const Controller& GetController(Index env) const;
+
+  protected:
+    std::vector<ALEInterface*> ales_;
+    // Returns parameters in TReal, widening them into buffer if needed
+    static const TReal* NetworkParameters(const float* parameters,
+                                          Index count,
+                                          std::vector<TReal>& buffer);
+
+    nervous_system::NervousSystem<TReal>& neural_net_;
+    Index update_rate_;
+    ResetStateCache* reset_cache_;
+    std::vector<std::unique_ptr<BatchMemberAgent<TReal>>> agents_;
+    std::vector<std::unique_ptr<Controller>> controllers_;
+    // Widened parameters of each member, unused by float networks
+    std::vector<std::vector<TReal>> member_parameters_;
+    std::vector<bool> is_configured_;
+    // Environments that were still playing at the last SelectActions()
+    std::vector<bool> is_stepping_;
+};
+
+}
+
+#endif /* ALECTRNN_CONTROLLERS_VEC_CONTROLLER_H_ */
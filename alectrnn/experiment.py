@@ -116,7 +116,8 @@ class ALEExperimentBase(ABC):
         :return: an agent handler object
         """
         partial_class_parameters['nervous_system'] = nervous_system.neural_network
-        agent_handle = agent_class(ale_handle.handle, **partial_class_parameters)
+        agent_handle = agent_class(ale_handle.handle, dtype=nervous_system.dtype,
+                                   **partial_class_parameters)
         agent_handle.create()
         return agent_handle
 
@@ -130,6 +131,7 @@ class ALEExperimentBase(ABC):
         """
         obj_handle = handlers.ObjectiveHandler(ale_handle.handle,
                                                agent_handle.handle,
+                                               dtype=agent_handle.dtype,
                                                **objective_parameters)
         obj_handle.create()
         return obj_handle
@@ -264,6 +266,7 @@ class ALEExperiment(ALEExperimentBase):
         """
         self._obj_handle = handlers.ObjectiveHandler(self._ale_handle.handle,
                                                      self._agent_handle.handle,
+                                                     dtype=self._agent_handle.dtype,
                                                      **objective_parameters)
         self._obj_handle.create()
 
@@ -12,7 +12,13 @@ from alectrnn import agent_generator
 from alectrnn import objective
 from alectrnn import ale_handler
 from alectrnn import agent_handler
+from alectrnn import agent_generator_double
+from alectrnn import objective_double
+from alectrnn import agent_handler_double
 import sys
+import os
+import numpy as np
+from enum import Enum
 from functools import partial
 from pkg_resources import resource_listdir
 from pkg_resources import resource_filename
@@ -31,6 +37,81 @@ def generate_rom_dictionary():
             for i in range(len(rom_path_list))}
 
 
+class LOG_REDUCTION(Enum):
+    """
+    How a logging stride's window of steps is combined into one record.
+    NONE keeps the state at the record step.
+    SPIKE_COUNT counts the steps a neuron's state is above spike_threshold.
+    Should keep in sync with LOG_REDUCTION in state_logger.hpp
+    """
+    NONE = 0
+    MEAN = 1
+    VARIANCE = 2
+    SPIKE_COUNT = 3
+
+
+class SCREEN_COMPRESSION(Enum):
+    """
+    How logged screens are stored in memory. DELTA keeps only the bytes that
+    changed since the previous frame, which is much smaller for long runs.
+    Should keep in sync with SCREEN_COMPRESSION in screen_logger.hpp
+    """
+    RAW = 0
+    DELTA = 1
+
+
+def load_mapped_layer_history(directory, layer_index):
+    """
+    Opens a layer's history from a memory mapped state log (see
+    LoggingAndHistoryMixin.log_to_directory) without reading it into memory.
+    :param directory: the log directory
+    :param layer_index: index of the layer in the nervous system
+    :return: a read-only numpy.memmap with dimensions (time, *record shape)
+    """
+    file_name = "layer_" + str(layer_index) + ".bin"
+    dtype = None
+    layer_shape = None
+    with open(os.path.join(directory, "log_info.txt")) as info_file:
+        for line in info_file:
+            fields = line.split()
+            if fields and fields[0] == "dtype":
+                dtype = np.dtype(fields[1])
+            elif fields and fields[0] == file_name:
+                layer_shape = tuple(int(dimension) for dimension in fields[1:])
+    if layer_shape is None:
+        raise ValueError("Layer " + str(layer_index) + " was not logged")
+
+    file_path = os.path.join(directory, file_name)
+    num_records = os.path.getsize(file_path) \
+        // (dtype.itemsize * int(np.prod(layer_shape)))
+    if num_records == 0:
+        return np.empty((0,) + layer_shape, dtype=dtype)
+    return np.memmap(file_path, dtype=dtype, mode='r',
+                     shape=(num_records,) + layer_shape)
+
+
+# The (agent_generator, agent_handler, objective) modules for agents whose
+# networks have each dtype (see nervous_system.PRECISION_MODULES). Parameters
+# are float32 for both, double agents widen them.
+PRECISION_MODULES = {
+    np.dtype(np.float32): (agent_generator, agent_handler, objective),
+    np.dtype(np.float64): (agent_generator_double, agent_handler_double,
+                           objective_double)
+}
+
+
+def precision_modules(dtype):
+    """
+    :param dtype: np.float32 or np.float64, the dtype of the agents' networks
+    :return: the (agent_generator, agent_handler, objective) modules for dtype
+    """
+    dtype = np.dtype(dtype)
+    if dtype not in PRECISION_MODULES:
+        raise ValueError("Agent dtype must be float32 or float64, not "
+                         + str(dtype))
+    return PRECISION_MODULES[dtype]
+
+
 class Handler:
     """
     Parent class for the various Handlers. Holds parameters and defines a
@@ -86,15 +167,60 @@ class ObjectiveHandler(Handler):
     """
     Subclass of handler meant to create and manage the c++ objective function.
     """
-    def __init__(self, ale, agent, obj_type, obj_parameters=None):
+    def __init__(self, ale, agent, obj_type, obj_parameters=None,
+                 dtype=np.float32):
         """
+        dtype is the dtype of the agents' (or for "vec" the network's)
+        NervousSystem, and picks objective or objective_double. Parameters
+        are float32 either way.
+
         Objective parameters:
         # Note: should not include agent/ALE/parameters, only configuration pars
-          obj_type - "totalcost"
+          obj_type - "totalcost", "s&cc", "population", "earlystop",
+            "population_earlystop", "vec"
           obj_parameters - dictionary of keyword arguments for objective
 
-            For "totalcost": none
+            All but "s&cc" take use_reset_cache (optional, default False)
+                and reset_cache_size (optional, default 64). With
+                use_reset_cache the handler keeps a cache of post-reset
+                emulator states that every call of the handle reuses, so
+                the reset prefix is only replayed once per environment
+                (see ResetStateCache in controller.hpp).
             For "s&cc": cc_scale
+            For "population": pipeline_depth (optional, default 1).
+                ale and agent should be equal length
+                sequences of ale/agent capsules, one pair per worker thread.
+                With pipeline_depth > 1 each group of pipeline_depth pairs
+                shares two threads. Its ales are split into two halves, each
+                stepped as one batch by the network of its first agent
+                (a NervousSystemAgent whose network supports batch mode).
+                One thread emulates one half while the other steps the
+                network of the other half.
+                The handle takes a 2D float32 array with one member per row
+                and returns a 1D array of costs.
+            For "earlystop": inactivity_frames, repeated_action_frames,
+                rate_check_frames, min_score_rate (all optional, rules
+                with a limit of 0 are off). Stops playing
+                when there was no reward for inactivity_frames, the same
+                action for repeated_action_frames, or the score per frame is
+                below min_score_rate at a multiple of rate_check_frames.
+                A min_score_rate of 0 is off too, so a negative score alone
+                doesn't stop a member.
+                The handle returns (cost, stopped_early), where the cost of
+                a stopped member is its score when stopped.
+            For "population_earlystop": the "earlystop" parameters plus
+                score_rate_percentile and min_rate_samples (default 10).
+                ale and agent are as for "population". At each rate check,
+                members whose score is below score_rate_percentile of the
+                scores the members that got there before them had are
+                stopped, once min_rate_samples members have. The handle
+                returns (costs, stopped_early) arrays.
+            For "vec": neural_network (a nervous system capsule),
+                update_rate (optional, default 1). ale should be a sequence of ale
+                capsules, e.g. with different seeds, and agent is unused.
+                Every ale is played in lockstep by one batched network
+                with the same parameters, and the handle returns the mean
+                cost. The network must support batch mode.
         """
         if obj_parameters is None:
             obj_parameters = {}
@@ -102,6 +228,24 @@ class ObjectiveHandler(Handler):
         super().__init__(obj_type, obj_parameters)
         self._ale = ale
         self._agent = agent
+        self._reset_cache = None
+        self.dtype = np.dtype(dtype)
+        self._objective = precision_modules(self.dtype)[2]
+
+    def _objective_parameters(self):
+        """
+        :return: the handle parameters with use_reset_cache and
+            reset_cache_size replaced by the handler's reset cache
+        """
+        parameters = dict(self._handle_parameters)
+        use_reset_cache = parameters.pop('use_reset_cache', False)
+        reset_cache_size = parameters.pop('reset_cache_size', 64)
+        if use_reset_cache:
+            if self._reset_cache is None:
+                self._reset_cache = self._objective.CreateResetCache(
+                    max_states=reset_cache_size)
+            parameters['reset_cache'] = self._reset_cache
+        return parameters
 
     def create(self):
         """
@@ -110,14 +254,34 @@ class ObjectiveHandler(Handler):
         :return: None
         """
         if self._handle_type == "totalcost":
-            self._handle = partial(objective.TotalCostObjective, 
-                                   ale=self._ale, agent=self._agent)
+            self._handle = partial(self._objective.TotalCostObjective, 
+                                   ale=self._ale, agent=self._agent,
+                                   **self._objective_parameters())
             self._handle_exists = True
         elif self._handle_type == "s&cc":
-            self._handle = partial(objective.ScoreAndConnectionCostObjective,
+            self._handle = partial(self._objective.ScoreAndConnectionCostObjective,
                 ale=self._ale, agent=self._agent,
                 cc_scale=self._handle_parameters['cc_scale'])
             self._handle_exists = True
+        elif self._handle_type == "population":
+            self._handle = partial(self._objective.PopulationCostObjective,
+                                   ales=self._ale, agents=self._agent,
+                                   **self._objective_parameters())
+            self._handle_exists = True
+        elif self._handle_type == "earlystop":
+            self._handle = partial(self._objective.EarlyStopCostObjective,
+                                   ale=self._ale, agent=self._agent,
+                                   **self._objective_parameters())
+            self._handle_exists = True
+        elif self._handle_type == "population_earlystop":
+            self._handle = partial(self._objective.PopulationEarlyStopObjective,
+                                   ales=self._ale, agents=self._agent,
+                                   **self._objective_parameters())
+            self._handle_exists = True
+        elif self._handle_type == "vec":
+            self._handle = partial(self._objective.VecTotalCostObjective,
+                                   ales=self._ale, **self._objective_parameters())
+            self._handle_exists = True
 
         else:
             raise NotImplementedError
@@ -145,8 +309,13 @@ class AgentHandler(Handler):
     """
     Handler subclass meant for dealing with ALE agents
     """
-    def __init__(self, ale, agent_type, agent_parameters=None):
+    def __init__(self, ale, agent_type, agent_parameters=None,
+                 dtype=np.float32):
         """
+        dtype is the dtype of the agent's NervousSystem, and picks
+        agent_generator or agent_generator_double (and the matching
+        agent_handler). Parameters are float32 either way.
+
         Agent parameters:
           agent_type - "ctrnn"/"nervous_system"/"softmax"/"shared_motor"/"rm"
           agent_parameters - dictionary of keyword arguments for the agent
@@ -170,6 +339,9 @@ class AgentHandler(Handler):
 
         super().__init__(agent_type, agent_parameters)
         self._ale = ale
+        self.dtype = np.dtype(dtype)
+        self._agent_generator, self._agent_handler, _ = \
+            precision_modules(self.dtype)
 
     def create(self):
         """
@@ -179,23 +351,23 @@ class AgentHandler(Handler):
         """
         # Create Agent handle
         if self._handle_type == "ctrnn":
-            self._handle = agent_generator.CreateCtrnnAgent(self._ale,
-                                                            **self._handle_parameters)
+            self._handle = self._agent_generator.CreateCtrnnAgent(
+                self._ale, **self._handle_parameters)
         elif self._handle_type == "nervous_system":
-            self._handle = agent_generator.CreateNervousSystemAgent(self._ale,
-                                                                    **self._handle_parameters)
+            self._handle = self._agent_generator.CreateNervousSystemAgent(
+                self._ale, **self._handle_parameters)
         elif self._handle_type == "softmax":
-            self._handle = agent_generator.CreateSoftMaxAgent(self._ale,
-                                                              **self._handle_parameters)
+            self._handle = self._agent_generator.CreateSoftMaxAgent(
+                self._ale, **self._handle_parameters)
         elif self._handle_type == "shared_motor":
-            self._handle = agent_generator.CreateSharedMotorAgent(self._ale,
-                                                                  **self._handle_parameters)
+            self._handle = self._agent_generator.CreateSharedMotorAgent(
+                self._ale, **self._handle_parameters)
         elif self._handle_type == "feedback":
-            self._handle = agent_generator.CreateFeedbackAgent(self._ale,
-                                                               **self._handle_parameters)
+            self._handle = self._agent_generator.CreateFeedbackAgent(
+                self._ale, **self._handle_parameters)
         elif self._handle_type == "rm":
-            self._handle = agent_generator.CreateRewardModulatedAgent(self._ale,
-                                                                      **self._handle_parameters)
+            self._handle = self._agent_generator.CreateRewardModulatedAgent(
+                self._ale, **self._handle_parameters)
         else:
             sys.exit("No agent by that name is implemented")
         self._handle_exists = True
@@ -212,14 +384,65 @@ class AgentHandler(Handler):
 
 class LoggingAndHistoryMixin:
 
+    def log_to_directory(self, directory):
+        """
+        Streams the layer states into memory mapped files in directory
+        (created if needed) instead of keeping them in memory, so long episodes
+        of large networks don't run out of RAM. Replaces the states logged so
+        far and keeps the logging spec. Has to be called again if the agent is
+        re-made.
+        :param directory: path of the log directory
+        :return: None
+        """
+        if self._handle_parameters['logging']:
+            self._agent_handler.SetLogDirectory(self._handle, directory)
+            self._log_directory = directory
+            self._log_handle = self._handle
+        else:
+            raise AssertionError("Error: Logging not active, nothing to log")
+
+    def set_logging_spec(self, layers=None, neurons=None, stride=1,
+                         reduction=LOG_REDUCTION.NONE, spike_threshold=0.0,
+                         screen_stride=1,
+                         screen_compression=SCREEN_COMPRESSION.RAW):
+        """
+        Narrows what the agent logs, so analysis runs don't pay for full
+        logging. Replaces the states logged so far and keeps the log directory
+        if one is set. Has to be called again if the agent is re-made.
+        :param layers: indices of the layers to log, None for all
+        :param neurons: for each entry of layers, a sequence of flat neuron
+            indices to log (None for all of the layer's neurons), or None to
+            log every neuron. Neuron subsets are recorded as flat vectors.
+        :param stride: # of network steps per record
+        :param reduction: a LOG_REDUCTION applied over each stride's steps
+        :param spike_threshold: state above which SPIKE_COUNT counts a spike
+        :param screen_stride: # of frames per logged screen, 0 for none
+        :param screen_compression: a SCREEN_COMPRESSION for logged screens
+        :return: None
+        """
+        if self._handle_parameters['logging']:
+            self._agent_handler.SetLoggingSpec(
+                self._handle, layers=layers, neurons=neurons, stride=stride,
+                reduction=reduction.value, spike_threshold=spike_threshold,
+                screen_stride=screen_stride,
+                screen_compression=screen_compression.value)
+        else:
+            raise AssertionError("Error: Logging not active, nothing to log")
+
     def layer_history(self, layer_index):
         """
         Returns a numpy array with dimensions equal to the layer dimensions
         and # elements = # states in that layer.
-        It will be of dtype=np.float32
+        It will be of the agent's dtype and read-only, as it shares the
+        agent's log rather than copying it. If the agent logs to a directory
+        this is a numpy.memmap of the log file.
         """
         if self._handle_parameters['logging']:
-            return agent_handler.GetLayerHistory(self._handle, layer_index)
+            if getattr(self, '_log_handle', None) is self._handle:
+                self._agent_handler.FlushLog(self._handle)
+                return load_mapped_layer_history(self._log_directory,
+                                                 layer_index)
+            return self._agent_handler.GetLayerHistory(self._handle, layer_index)
         else:
             raise AssertionError("Error: Logging not active, no history table")
 
@@ -227,10 +450,10 @@ class LoggingAndHistoryMixin:
         """
         :return: A numpy array with the history of the color screen of the
             emulator. First dimension is time, followed by HxWx3, where the
-            elements are ordered as RGB. dtype=np.float32
+            elements are ordered as RGB. dtype=np.uint8
         """
         if self._handle_parameters['logging']:
-            return agent_handler.GetScreenHistory(self._handle)
+            return self._agent_handler.GetScreenHistory(self._handle)
         else:
             raise AssertionError("Error: Logging not active, no screen history")
 
@@ -257,10 +480,12 @@ class NervousSystemAgentHandler(AgentHandler, LoggingAndHistoryMixin):
     agents, which have several distinct methods (e.g. layer_history and
     screen_history).
     """
-    def __init__(self, ale, nervous_system, update_rate, logging=False):
+    def __init__(self, ale, nervous_system, update_rate, logging=False,
+                 dtype=np.float32):
         super().__init__(ale, "nervous_system", {'nervous_system': nervous_system,
                                                  'update_rate': update_rate,
-                                                 'logging': int(logging)})
+                                                 'logging': int(logging)},
+                         dtype)
 
 
 class SharedMotorAgentHandler(AgentHandler, LoggingAndHistoryMixin):
@@ -270,10 +495,12 @@ class SharedMotorAgentHandler(AgentHandler, LoggingAndHistoryMixin):
     using the legal action set size for the motor layer. Minimal action sets
     are still used to play the game.
     """
-    def __init__(self, ale, nervous_system, update_rate, logging=False):
+    def __init__(self, ale, nervous_system, update_rate, logging=False,
+                 dtype=np.float32):
         super().__init__(ale, "shared_motor", {'nervous_system': nervous_system,
                                                'update_rate': update_rate,
-                                               'logging': int(logging)})
+                                               'logging': int(logging)},
+                         dtype)
 
 
 class FeedbackAgentHandler(AgentHandler, LoggingAndHistoryMixin):
@@ -283,12 +510,13 @@ class FeedbackAgentHandler(AgentHandler, LoggingAndHistoryMixin):
     back into a layer in the NN.
     """
     def __init__(self, ale, nervous_system, update_rate, logging,
-                 motor_index, feedback_index):
+                 motor_index, feedback_index, dtype=np.float32):
         super().__init__(ale, "feedback", {'nervous_system': nervous_system,
                                            'update_rate': update_rate,
                                            'logging': int(logging),
                                            'motor_index': int(motor_index),
-                                           'feedback_index': int(feedback_index)})
+                                           'feedback_index': int(feedback_index)},
+                         dtype)
 
 
 class RewardModulatedAgentHandler(AgentHandler, LoggingAndHistoryMixin):
@@ -297,21 +525,25 @@ class RewardModulatedAgentHandler(AgentHandler, LoggingAndHistoryMixin):
     agents, which are a subclass of shared motor agents but which also
     use reward information to update parameters online.
     """
-    def __init__(self, ale, nervous_system, update_rate, logging=False):
+    def __init__(self, ale, nervous_system, update_rate, logging=False,
+                 dtype=np.float32):
         super().__init__(ale, "rm", {'nervous_system': nervous_system,
                                      'update_rate': update_rate,
-                                     'logging': int(logging)})
+                                     'logging': int(logging)},
+                         dtype)
 
 
 class SoftMaxAgentHandler(AgentHandler, LoggingAndHistoryMixin):
     """
     Subclass of AgentHandler for easy creation and handling of SoftMaxAgentHandlers
     """
-    def __init__(self, ale, nervous_system, update_rate, seed, logging=False):
+    def __init__(self, ale, nervous_system, update_rate, seed, logging=False,
+                 dtype=np.float32):
         super().__init__(ale, "softmax", {'nervous_system': nervous_system,
                                           'update_rate': update_rate,
                                           'logging': int(logging),
-                                          'seed': int(seed)})
+                                          'seed': int(seed)},
+                         dtype)
 
 
 class ALEHandler(Handler):
@@ -330,7 +562,8 @@ class ALEHandler(Handler):
                  sound=False,
                  system_reset_steps=4,
                  use_environment_distribution=True,
-                 num_random_environments=30):
+                 num_random_environments=30,
+                 use_pool=False):
         """
         ALE parameters:
           rom - rom name (specify from list)
@@ -346,6 +579,10 @@ class ALEHandler(Handler):
           system_reset_steps - int (default=4)
           use_environment_distribution - boolean (default True)
           num_random_environments - int (default 30)
+          use_pool - boolean (default False). If True, emulators are leased
+            from a pool of warm ALEs keyed by rom. Changing the rom or seed
+            then reuses an already loaded emulator instead of creating a new
+            one. Released handles are returned to the pool.
 
         """
 
@@ -355,6 +592,8 @@ class ALEHandler(Handler):
         else:
             sys.exit("Error: " + rom + " is not installed.")
 
+        self._use_pool = use_pool
+        self._pool = None
         super().__init__("ale", {'rom_path': self.rom_path,
                                  'seed': seed,
                                  'color_avg': color_avg,
@@ -388,6 +627,11 @@ class ALEHandler(Handler):
             else:
                 sys.exit("Error: " + kwargs['rom'] + " is not installed.")
 
+        # Pooled emulators share all settings except rom and seed, so a new
+        # pool is needed if any other setting changes
+        if any(key not in ('rom_path', 'seed') for key in kwargs):
+            self._pool = None
+
         if self._handle_exists:
             self._handle_parameters.update(kwargs)
             self.create()
@@ -410,7 +654,18 @@ class ALEHandler(Handler):
 
     def create(self):
         # Create ALE handle
-        self._handle = ale_generator.CreatALE(**self._handle_parameters)
+        if self._use_pool:
+            if self._pool is None:
+                self._pool = ale_generator.CreateALEPool(
+                    **{key: value for key, value
+                       in self._handle_parameters.items()
+                       if key not in ('rom_path', 'seed')})
+            self._handle = ale_generator.LeaseALE(
+                pool=self._pool,
+                rom_path=self._handle_parameters['rom_path'],
+                seed=self._handle_parameters['seed'])
+        else:
+            self._handle = ale_generator.CreatALE(**self._handle_parameters)
         self._handle_exists = True
 
     def action_set_size(self):
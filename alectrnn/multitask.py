@@ -217,7 +217,9 @@ class RandomRomObjective:
                  cost_normalizer, seed):
         """
         :param roms: a sequence of rom names to random choose from
-        :param ale_handler: a built ale handler object
+        :param ale_handler: a built ale handler object. Build it with
+            use_pool=True so that switching roms reuses warm emulators
+            rather than loading a new one on every call.
         :param agent_handler: a built agent handler object
         :param objective_handler: a built objective handler object
         :param cost_normalizer: an instance of a cost normalizer
@@ -8,6 +8,9 @@ import numpy as np
 from alectrnn import layer_generator
 from alectrnn import nn_generator
 from alectrnn import nn_handler
+from alectrnn import layer_generator_double
+from alectrnn import nn_generator_double
+from alectrnn import nn_handler_double
 
 
 class PARAMETER_TYPE(Enum):
@@ -53,7 +56,8 @@ def normalized_weight_bound(nervous_system, norm_type='sqrt'):
     :return: a numpy float32 that is the size of the # parameters
     """
 
-    normalization_factors = nn_handler.GetWeightNormalizationFactors(nervous_system.neural_network)
+    normalization_factors = nervous_system._nn_handler.GetWeightNormalizationFactors(
+        nervous_system.neural_network)
     if norm_type == 'sqrt':
         np.sqrt(normalization_factors, out=normalization_factors)
     elif norm_type == 'norm':
@@ -202,6 +206,38 @@ class INTEGRATOR_TYPE(Enum):
     REWARD_MODULATED_CONV = 15
 
 
+class CONV_ALGORITHM(Enum):
+    """
+    How eigen convolutions are computed. IM2COL builds the full im2col matrix
+    each step, TILED builds it in cache sized blocks of output positions.
+    Should keep in sync with CONV_ALGORITHM in integrator.hpp
+    """
+    IM2COL = 0
+    TILED = 1
+
+
+class QUANTIZATION(Enum):
+    """
+    Precision of the conv and all2all eigen integrator weights when a network
+    is stepped. NONE is full precision. INT8 uses per filter/neuron scales.
+    Should keep in sync with QUANTIZATION_MODE in quantization.hpp
+    """
+    NONE = 0
+    INT8 = 1
+    FP16 = 2
+
+
+class NODE_ORDERING(Enum):
+    """
+    Node orderings that an eigen integrator can store its network in to
+    improve cache locality. The layer state is not affected.
+    Should keep in sync with NODE_ORDERING in graphs.hpp
+    """
+    NATURAL = 0
+    RCM = 1
+    DEGREE = 2
+
+
 ACTMAP = {ACTIVATOR_TYPE.IAF: ACTIVATOR_TYPE.CONV_IAF,
           ACTIVATOR_TYPE.CTRNN: ACTIVATOR_TYPE.CONV_CTRNN}
 
@@ -209,6 +245,16 @@ RESERVOIR_ACTMAP = {ACTIVATOR_TYPE.IAF: ACTIVATOR_TYPE.RESERVOIR_IAF,
                     ACTIVATOR_TYPE.CTRNN: ACTIVATOR_TYPE.RESERVOIR_CTRNN}
 
 
+# The (layer_generator, nn_generator, nn_handler) modules that build and run
+# networks of each dtype. Both are compiled from the same C++ templates (see
+# nervous_system/precision.hpp).
+PRECISION_MODULES = {
+    np.dtype(np.float32): (layer_generator, nn_generator, nn_handler),
+    np.dtype(np.float64): (layer_generator_double, nn_generator_double,
+                           nn_handler_double)
+}
+
+
 class NervousSystem:
     """
     Builds a nervous system. A single activator is chosen for the whole network.
@@ -258,6 +304,9 @@ class NervousSystem:
         'filter_shape' = 2-element list/array with filter dimensions
         'num_filters'
         'stride'
+        'conv_algorithm' = CONV_ALGORITHM (optional, default IM2COL). TILED
+            avoids building the full im2col matrix, which saves memory on
+            large inputs but isn't reliably faster (see conv_benchmark).
 
     Reservoir layers have an untrained set of connections determined the
     input graph. The back connections are determined by the input graph.
@@ -284,6 +333,9 @@ class NervousSystem:
         'input_graph' = E1x2, dtype=np.uint64 bipartite edge graph
         'num_internal_nodes' = M
         'internal_graph' = E2x2, dtype=np.uint64 edge array
+        'node_ordering' = NODE_ORDERING (optional, default NATURAL), the order
+            the internal graph is stored in. RCM or DEGREE can speed up large
+            sparse internal graphs.
 
     Feedback Recurrent layers use eigen integrators. They feed reward and
     motor outputs back to this layer. Currently, only 1 supported per agent.
@@ -372,6 +424,13 @@ class NervousSystem:
     :note: For the internal graph, all heads and tails will be interpreted as
         belonging to the current layer.
 
+    dtype is np.float32 or np.float64 and sets the precision that the network
+    steps in. A float64 network has exactly the constants of its float32 twin,
+    so comparing their states (e.g. with run_neural_network) shows how
+    sensitive the dynamics are to float rounding. Its inputs, parameters and
+    states are float64. Agents of a float64 network are made by handlers with
+    the same dtype, and widen their float32 parameters.
+
     :note: All node IDs for networks should start at 0 and correspond to the
         state index.
 
@@ -383,7 +442,7 @@ class NervousSystem:
     """
 
     def __init__(self, input_shape, num_outputs, nn_parameters,
-                 act_type, act_args, verbose=False):
+                 act_type, act_args, verbose=False, dtype=np.float32):
         """
         input_shape - shape of input into the NN (should be 3D) 1st dim is
                       channels, second is height, then width. Will be cast
@@ -402,7 +461,15 @@ class NervousSystem:
         CONV layers usually have additional arguments, like shape, for
         parameter sharing of act_args. They also have their own ACTIVATION_TYPE.
         These are automatically added to the CONV layers.
+
+        dtype = np.float32 or np.float64, the precision of the network
         """
+        self.dtype = np.dtype(dtype)
+        if self.dtype not in PRECISION_MODULES:
+            raise ValueError("NervousSystem dtype must be float32 or float64,"
+                             " not " + str(self.dtype))
+        self._layer_generator, self._nn_generator, self._nn_handler = \
+            PRECISION_MODULES[self.dtype]
         self.verbose = verbose
         self.num_outputs = num_outputs
         input_shape = np.array(input_shape, dtype=np.uint64)
@@ -436,7 +503,8 @@ class NervousSystem:
                     layer_pars['filter_shape'],
                     layer_pars['stride'],
                     layer_act_types[i],
-                    layer_act_args[i]))
+                    layer_act_args[i],
+                    layer_pars.get('conv_algorithm', CONV_ALGORITHM.IM2COL)))
 
             elif layer_pars['layer_type'] == "rm_conv":
                 layers.append(self._create_rm_conv_layer(
@@ -481,7 +549,8 @@ class NervousSystem:
                     layer_act_types[i],
                     layer_act_args[i],
                     layer_shapes[i+1],
-                    layer_shapes[i]))
+                    layer_shapes[i],
+                    layer_pars.get('node_ordering', NODE_ORDERING.NATURAL)))
             
             elif layer_pars['layer_type'] == "feedback":
                 layers.append(self._create_feedback_layer(
@@ -654,7 +723,7 @@ class NervousSystem:
                                           + layer_pars['layer_type'])
 
         # Generate NN
-        self.neural_network = nn_generator.CreateNervousSystem(input_shape,
+        self.neural_network = self._nn_generator.CreateNervousSystem(input_shape,
                                                                tuple(layers))
         self.layer_shapes = layer_shapes
         self.interpreted_shapes = interpreted_shapes
@@ -725,7 +794,7 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.RECURRENT.value
         self_args = (internal_edge_array,)
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
                                            self_args, act_type, act_args, layer_shape)
 
     def _create_a2a_a2a_layer(self, prev_layer_shape, num_internal_nodes,
@@ -748,7 +817,7 @@ class NervousSystem:
         self_args = (int(num_internal_nodes),
                      int(num_internal_nodes))
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
                                            self_args, act_type, act_args, layer_shape)
 
     def _create_a2a_ff_layer(self, prev_layer_shape, num_internal_nodes,
@@ -771,7 +840,7 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateLayer(back_type, back_args, self_type,
+        return self._layer_generator.CreateLayer(back_type, back_args, self_type,
                                            self_args, act_type, act_args, layer_shape)
 
     def _create_eigen_a2a_ff_layer(self, prev_layer_shape, num_internal_nodes,
@@ -794,7 +863,7 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateLayer(back_type, back_args, self_type,
+        return self._layer_generator.CreateLayer(back_type, back_args, self_type,
                                            self_args, act_type, act_args, layer_shape)
 
     def _create_rm_a2a_ff_layer(self, prev_layer_shape, num_internal_nodes,
@@ -825,7 +894,7 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRewardModulatedLayer(back_type, back_args,
+        return self._layer_generator.CreateRewardModulatedLayer(back_type, back_args,
                                                           self_type, self_args,
                                                           act_type, act_args,
                                                           layer_shape,
@@ -864,7 +933,7 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateNoisyRewardModulatedLayer(back_type, back_args,
+        return self._layer_generator.CreateNoisyRewardModulatedLayer(back_type, back_args,
                                                           self_type, self_args,
                                                           act_type, act_args,
                                                           layer_shape,
@@ -901,7 +970,7 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.RECURRENT.value
         self_args = (internal_edge_array,)
 
-        return layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
                                            self_args, act_type, act_args, layer_shape)
 
     def _create_conv_reservoir_layer(self, prev_layer_shape, interpreted_shape,
@@ -936,7 +1005,7 @@ class NervousSystem:
         self_args = (internal_edge_array,
                      internal_weight_array)
 
-        return layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
                                            self_args, act_type, act_args, layer_shape)
 
     def _create_recurrent_layer(self, bipartite_input_edge_array,
@@ -962,14 +1031,15 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.RECURRENT.value
         self_args = (internal_edge_array,)
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRecurrentLayer(back_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type,
                                            back_args, self_type, self_args,
                                            act_type, act_args, layer_shape)
 
     def _create_eigen_recurrent_layer(self, bipartite_input_edge_array,
                                       num_internal_nodes, internal_edge_array,
                                       act_type, act_args, layer_shape,
-                                      prev_layer_shape):
+                                      prev_layer_shape,
+                                      node_ordering=NODE_ORDERING.NATURAL):
         """
         Creates a eigen recurrent layer with graphs specifying back and self
         connections. Uses Eigen integrators
@@ -984,15 +1054,17 @@ class NervousSystem:
         :param act_args: arguments for that ACTIVATOR_TYPE
         :param layer_shape: shape of the layer
         :param prev_layer_shape: shape of last layer
+        :param node_ordering: NODE_ORDERING of the internal graph
         :return: python capsule with pointer to the layer
         """
         back_type = INTEGRATOR_TYPE.RECURRENT_EIGEN.value
         back_args = (bipartite_input_edge_array, num_internal_nodes,
                      int(np.prod(prev_layer_shape)))
         self_type = INTEGRATOR_TYPE.RECURRENT_EIGEN.value
-        self_args = (internal_edge_array, num_internal_nodes, num_internal_nodes)
+        self_args = (internal_edge_array, num_internal_nodes, num_internal_nodes,
+                     node_ordering.value)
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRecurrentLayer(back_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type,
                                            back_args, self_type, self_args,
                                            act_type, act_args, layer_shape)
 
@@ -1028,7 +1100,7 @@ class NervousSystem:
         feed_args = (feedback_edge_array, num_internal_nodes,
                      int(num_motor_neurons + 1))
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateFeedbackLayer(back_type, back_args,
+        return self._layer_generator.CreateFeedbackLayer(back_type, back_args,
                                                    self_type, self_args,
                                                    feed_type, feed_args,
                                                    num_motor_neurons,
@@ -1059,7 +1131,7 @@ class NervousSystem:
         self_type = INTEGRATOR_TYPE.TRUNCATED_RECURRENT.value
         self_args = (internal_edge_array, weight_threshold)
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type, back_args, self_type,
                                            self_args, act_type, act_args,
                                            layer_shape)
 
@@ -1089,7 +1161,7 @@ class NervousSystem:
         self_args = (internal_edge_array,
                      internal_weight_array)
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRecurrentLayer(back_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type,
                                            back_args, self_type, self_args,
                                            act_type, act_args,
                                            layer_shape)
@@ -1119,7 +1191,7 @@ class NervousSystem:
         self_args = (internal_edge_array,
                      internal_weight_array)
         assert(act_args[0] == num_internal_nodes)
-        return layer_generator.CreateRecurrentLayer(back_type,
+        return self._layer_generator.CreateRecurrentLayer(back_type,
                                            back_args, self_type, self_args,
                                            act_type, act_args,
                                            layer_shape)
@@ -1152,12 +1224,13 @@ class NervousSystem:
                      int(stride))
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
-        return layer_generator.CreateLayer(back_type,
+        return self._layer_generator.CreateLayer(back_type,
                                            back_args, self_type, self_args,
                                            act_type, act_args, interpreted_shape)
 
     def _create_eigen_conv_layer(self, prev_layer_shape, interpreted_shape,
-                                 filter_shape, stride, act_type, act_args):
+                                 filter_shape, stride, act_type, act_args,
+                                 conv_algorithm=CONV_ALGORITHM.IM2COL):
         """
         Creates a layer with convolutional back connections and no self
         connections. Uses Eigen integrators
@@ -1173,6 +1246,7 @@ class NervousSystem:
         :param stride: stride for the convolution
         :param act_type: ACTIVATOR_TYPE
         :param act_args: arguments for that ACTIVATOR_TYPE
+        :param conv_algorithm: CONV_ALGORITHM used by the integrator
         :return: python capsule with pointer to the layer
         """
 
@@ -1181,10 +1255,10 @@ class NervousSystem:
         back_args = (np.array([prev_layer_shape[0]] + list(filter_shape), dtype=np.uint64),
                      interpreted_shape,  # layer_shape funct outputs dtype=np.uint64
                      np.array(prev_layer_shape, dtype=np.uint64),
-                     int(stride))
+                     int(stride), conv_algorithm.value)
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
-        return layer_generator.CreateLayer(back_type,
+        return self._layer_generator.CreateLayer(back_type,
                                            back_args, self_type, self_args,
                                            act_type, act_args, interpreted_shape)
 
@@ -1198,7 +1272,7 @@ class NervousSystem:
 
         size_of_prev_layer = int(np.prod(prev_layer_shape))
         assert(act_args[0] == num_outputs)
-        return layer_generator.CreateMotorLayer(
+        return self._layer_generator.CreateMotorLayer(
             int(num_outputs), size_of_prev_layer, act_type, act_args)
 
     def _create_eigen_motor_layer(self, num_outputs, prev_layer_shape, act_type,
@@ -1212,7 +1286,7 @@ class NervousSystem:
 
         size_of_prev_layer = int(np.prod(prev_layer_shape))
         assert(act_args[0] == num_outputs)
-        return layer_generator.CreateEigenMotorLayer(
+        return self._layer_generator.CreateEigenMotorLayer(
             int(num_outputs), size_of_prev_layer, act_type, act_args)
 
     def _create_rm_motor_layer(self, num_outputs, prev_layer_shape,
@@ -1230,7 +1304,7 @@ class NervousSystem:
 
         size_of_prev_layer = int(np.prod(prev_layer_shape))
         assert(act_args[0] == num_outputs)
-        return layer_generator.CreateRewardModulatedMotorLayer(
+        return self._layer_generator.CreateRewardModulatedMotorLayer(
             int(num_outputs), size_of_prev_layer, float(reward_smoothing_factor),
             float(activation_smoothing_factor), float(learning_rate),
             act_type, act_args)
@@ -1252,7 +1326,7 @@ class NervousSystem:
 
         size_of_prev_layer = int(np.prod(prev_layer_shape))
         assert(act_args[0] == num_outputs)
-        return layer_generator.CreateNoisyRewardModulatedMotorLayer(
+        return self._layer_generator.CreateNoisyRewardModulatedMotorLayer(
             int(num_outputs), size_of_prev_layer, float(reward_smoothing_factor),
             float(activation_smoothing_factor), float(standard_deviation),
             int(seed), float(learning_rate),
@@ -1268,7 +1342,7 @@ class NervousSystem:
         """
 
         size_of_prev_layer = int(np.prod(prev_layer_shape))
-        return layer_generator.CreateSoftMaxMotorLayer(int(num_outputs),
+        return self._layer_generator.CreateSoftMaxMotorLayer(int(num_outputs),
                                                        size_of_prev_layer,
                                                        float(temperature))
 
@@ -1306,7 +1380,7 @@ class NervousSystem:
                      float(learning_rate))
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
-        return layer_generator.CreateRewardModulatedLayer(back_type,
+        return self._layer_generator.CreateRewardModulatedLayer(back_type,
                                                           back_args, self_type,
                                                           self_args,
                                                           act_type, act_args,
@@ -1351,7 +1425,7 @@ class NervousSystem:
                      float(learning_rate))
         self_type = INTEGRATOR_TYPE.NONE.value
         self_args = tuple()
-        return layer_generator.CreateNoisyRewardModulatedLayer(back_type,
+        return self._layer_generator.CreateNoisyRewardModulatedLayer(back_type,
                                                           back_args, self_type,
                                                           self_args,
                                                           act_type, act_args,
@@ -1366,27 +1440,45 @@ class NervousSystem:
         Returns the number of parameters needed to configure the NN
         """
 
-        return nn_handler.GetParameterCount(self.neural_network)
+        return self._nn_handler.GetParameterCount(self.neural_network)
 
     def num_layers(self):
         """
         Returns the number of parameters needed to configure the NN
         """
 
-        return nn_handler.GetSize(self.neural_network)
+        return self._nn_handler.GetSize(self.neural_network)
 
     def parameter_layout(self):
         """
         Returns an np_int array with PARAMETER_TYPE codes
         """
 
-        return nn_handler.GetParameterLayout(self.neural_network)
+        return self._nn_handler.GetParameterLayout(self.neural_network)
 
     def parameter_layer_indices(self):
         """
         Returns an np_int array with layer indices corresponding to the parameters.
         """
-        return nn_handler.GetParameterLayerIndices(self.neural_network)
+        return self._nn_handler.GetParameterLayerIndices(self.neural_network)
+
+    def set_num_threads(self, num_threads):
+        """
+        Splits each step of this network over num_threads threads. Only worth
+        it for a single large network (e.g. replaying a champion); leave at 1
+        (the default) when agents are evaluated in parallel.
+        """
+        self._nn_handler.SetNumThreads(self.neural_network, int(num_threads))
+
+    def step_allocations(self):
+        """
+        Returns the # of heap allocations made by the network's last step
+        (e.g. the final step of run_neural_network), which should be 0. Counts
+        both operator new and malloc, so Eigen temporaries are included. Only
+        available when built on glibc with the ALECTRNN_COUNT_ALLOCATIONS
+        environment variable set, raises NotImplementedError otherwise.
+        """
+        return self._nn_handler.GetStepAllocations(self.neural_network)
 
     def run_neural_network(self, inputs, parameters):
         """
@@ -1394,9 +1486,94 @@ class NervousSystem:
         is the first dimension of the matrix and I is the number of inputs into
         the NN (the dimensions should be squashed). Returns a tuple of state
         arrays for each layer. The parameters will be used to configure the
-        neural network.
-        """
-        return nn_handler.RunNeuralNetwork(self.neural_network, inputs, parameters)
+        neural network. Inputs and parameters are converted to the network's
+        dtype if needed, and the states have that dtype.
+        """
+        return self._nn_handler.RunNeuralNetwork(self.neural_network, inputs, parameters)
+
+    def run_batch_inference(self, inputs, parameters, layers=None,
+                            batch_size=0, outputs=None, replicas=()):
+        """
+        Evaluates the NN on a block of recorded input traces in batch mode and
+        returns only the requested layers. Each trace starts from a reset
+        network.
+        :param inputs: array of shape (B, T, *input shape) with B traces of T
+            time-steps, converted to the network's dtype if needed
+        :param parameters: array of shape (P,) shared by every trace, or
+            (B, P) with one parameter set per trace
+        :param layers: layer indices to return, None for the output layer
+        :param batch_size: # of traces a network steps at once, 0 splits them
+            evenly over the networks
+        :param outputs: optional sequence of preallocated C contiguous arrays
+            of the network's dtype (e.g. numpy.memmaps), one per layer, of shape
+            (B, T, *layer shape). Results are written straight into them.
+        :param replicas: other NervousSystems built with the same arguments
+            and dtype. Each adds a worker thread, so batches run in parallel.
+            self and each replica can only be given once.
+        :return: a tuple with an array of shape (B, T, *layer shape) per layer
+        """
+        networks = [self.neural_network] + [replica.neural_network
+                                            for replica in replicas]
+        return self._nn_handler.RunBatchInference(networks, inputs, parameters,
+                                            layers=layers,
+                                            batch_size=int(batch_size),
+                                            outputs=outputs)
+
+    def set_quantization(self, quantization):
+        """
+        Steps the conv and all2all eigen integrators with reduced precision
+        weights, which are quantized whenever the network is configured. Other
+        integrators, and batch mode, keep full precision.
+        :param quantization: QUANTIZATION
+        """
+        self._nn_handler.SetQuantization(self.neural_network,
+                                   QUANTIZATION(quantization).value)
+
+    def quantization(self):
+        """
+        :return: the network's QUANTIZATION
+        """
+        return QUANTIZATION(self._nn_handler.GetQuantization(self.neural_network))
+
+    def quantization_drift(self, inputs, parameters,
+                           quantization=QUANTIZATION.INT8):
+        """
+        Reports how far the network drifts from its full precision path when
+        quantized, by running it on the inputs both ways (see
+        run_neural_network). The network's quantization is restored after.
+        :param inputs: TxI float32 inputs
+        :param parameters: float32 parameters
+        :param quantization: QUANTIZATION to compare with full precision
+        :return: a list with a dict per layer with 'max_abs' (largest state
+            difference), 'rms' (root mean squared difference) and 'relative_rms'
+            (rms over the rms of the full precision states). The last layer's
+            dict also has 'argmax_agreement', the fraction of time-steps where
+            both paths have the same largest output, e.g. the same action.
+        """
+        previous = self.quantization()
+        try:
+            self.set_quantization(QUANTIZATION.NONE)
+            full_states = self.run_neural_network(inputs, parameters)
+            self.set_quantization(quantization)
+            quantized_states = self.run_neural_network(inputs, parameters)
+        finally:
+            self.set_quantization(previous)
+
+        report = []
+        for full, quantized in zip(full_states, quantized_states):
+            difference = quantized.astype(np.float64) - full
+            rms = float(np.sqrt(np.mean(difference**2))) if difference.size else 0.0
+            full_rms = float(np.sqrt(np.mean(np.square(full, dtype=np.float64)))) \
+                if full.size else 0.0
+            report.append({
+                'max_abs': float(np.max(np.abs(difference))) if difference.size else 0.0,
+                'rms': rms,
+                'relative_rms': rms / full_rms if full_rms > 0 else 0.0})
+        full_output = full_states[-1].reshape(len(full_states[-1]), -1)
+        quantized_output = quantized_states[-1].reshape(len(full_output), -1)
+        report[-1]['argmax_agreement'] = float(np.mean(
+            np.argmax(full_output, axis=1) == np.argmax(quantized_output, axis=1)))
+        return report
 
 
 def configure_layer_activations(layer_shapes, interpreted_shapes,
@@ -1518,7 +1695,8 @@ class SimpleCTRNN(NervousSystem):
     A CTRNN with all-2-all input to network connections and all-2-all network
     to motor layer connections
     """
-    def __init__(self, input_shape, num_outputs, num_neurons, step_size):
+    def __init__(self, input_shape, num_outputs, num_neurons, step_size,
+                 dtype=np.float32):
         """
         :param input_shape: shape of input into the NN (should be 3D) 1st dim is
             channels, second is height, then width. Will be cast
@@ -1527,13 +1705,15 @@ class SimpleCTRNN(NervousSystem):
             # controller inputs
         :param num_neurons: size of the network
         :param step_size: integration step size during activation
+        :param dtype: np.float32 or np.float64 precision of the network
         """
         nn_parameters = [{
             'layer_type' : "a2a_a2a",
             'num_internal_nodes': num_neurons}]
         act_type = ACTIVATOR_TYPE.CTRNN
         act_args = (float(step_size),)
-        super().__init__(input_shape, num_outputs, nn_parameters, act_type, act_args)
+        super().__init__(input_shape, num_outputs, nn_parameters, act_type,
+                         act_args, dtype=dtype)
 
 
 class StandardAtariCNN(NervousSystem):
@@ -1542,7 +1722,7 @@ class StandardAtariCNN(NervousSystem):
     It uses the legal action set size for the motor layer so that it works
     with the shared motor agent (use this only with shared motor agents).
     """
-    def __init__(self, *args, **kwargs):
+    def __init__(self, *args, dtype=np.float32, **kwargs):
         input_shape = [4, 88, 88]
         num_outputs = 18
         nn_parameters = [{
@@ -1567,7 +1747,8 @@ class StandardAtariCNN(NervousSystem):
              'motor_type': 'eigen'}]
         act_type = ACTIVATOR_TYPE.RELU
         act_args = ()
-        super().__init__(input_shape, num_outputs, nn_parameters, act_type, act_args)
+        super().__init__(input_shape, num_outputs, nn_parameters, act_type,
+                         act_args, dtype=dtype)
 
 
 # class RewardModulatedAtariCNN(NervousSystem):
@@ -22,8 +22,10 @@
 #include <cmath>
 #include <algorithm>
 #include <random>
+#include <Eigen/Core>
 #include "../common/multi_array.hpp"
 #include "../common/utilities.hpp"
+#include "../common/thread_pool.hpp"
 #include "parameter_types.hpp"
 #include "../random/pcg_random.hpp"
 
@@ -55,6 +57,7 @@ class Activator {
     Activator() {
       activator_type_ = BASE_ACTIVATOR;
       parameter_count_ = 0;
+      thread_pool_ = nullptr;
     }
     virtual ~Activator()=default;
 
@@ -92,9 +95,54 @@ class Activator {
       return activator_type_;
     }
 
+    /*
+     * Batched version of operator() used by the NervousSystem's batch mode.
+     * states and input_buffers hold one state per member back to back
+     * ([batch, ...] in C order). parameters holds one slice per member, or a
+     * single slice shared by all members. Parameters are read straight from
+     * the slices since an activator's internal copies belong to a single
+     * member. Activators with internal state don't support batching and throw.
+     */
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      std::cerr << "activator type: " << activator_type_ << std::endl;
+      throw std::invalid_argument("Activator does not support batch mode");
+    }
+
+    /*
+     * Gives the activator a pool (owned by the NervousSystem) to split its
+     * elementwise update over. nullptr, the default, runs serially.
+     * Activators with internal state or noise ignore the pool.
+     */
+    virtual void SetThreadPool(parallel::ThreadPool* thread_pool) {
+      thread_pool_ = thread_pool;
+    }
+
   protected:
+    /*
+     * Runs function over blocks of [0, size) on the thread pool, or in one
+     * block when there is no pool.
+     */
+    template<typename TFunction>
+    void ParallelFor(Index size, const TFunction& function) const {
+      if (thread_pool_ == nullptr) {
+        function(0, size, 0);
+      }
+      else {
+        thread_pool_->ParallelFor(size, parallel::MIN_WORK_PER_THREAD, function);
+      }
+    }
+
+    static const multi_array::ConstArraySlice<TReal>& MemberParameters(
+        const std::vector<multi_array::ConstArraySlice<TReal>>& parameters,
+        Index member) {
+      return (parameters.size() == 1) ? parameters[0] : parameters[member];
+    }
+
     ACTIVATOR_TYPE activator_type_;
     std::size_t parameter_count_;
+    parallel::ThreadPool* thread_pool_;
 };
 
 template<typename TReal>
@@ -112,9 +160,14 @@ class IdentityActivator : public Activator<TReal> {
 
     void operator()(multi_array::Tensor<TReal>& state, 
                     const multi_array::Tensor<TReal>& input_buffer) {
-      for (Index iii = 0; iii < state.size(); iii++) {
-        state[iii] = input_buffer[iii];
-      }
+      multi_array::Copy(input_buffer.span().subspan(0, state.size()), state.span());
+    }
+
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      multi_array::Copy(input_buffers.span().subspan(0, states.size()),
+                        states.span());
     }
 
     virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {
@@ -146,6 +199,19 @@ class SoftMaxActivator: public IdentityActivator<TReal> {
       utilities::SoftMax(state.begin(), state.end(), temperature_);
     }
 
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      super_type::BatchActivate(states, input_buffers, parameters);
+      const Index batch_size = states.shape()[0];
+      const Index member_size = states.size() / batch_size;
+      for (Index member = 0; member < batch_size; ++member) {
+        utilities::SoftMax(states.begin() + member * member_size,
+                           states.begin() + (member + 1) * member_size,
+                           temperature_);
+      }
+    }
+
     TReal GetTemperature() const {
       return temperature_;
     }
@@ -159,10 +225,12 @@ class CTRNNActivator : public Activator<TReal> {
   public:
     typedef Activator<TReal> super_type;
     typedef typename super_type::Index Index;
+    typedef Eigen::Array<TReal, Eigen::Dynamic, 1> Array;
 
     CTRNNActivator(Index num_states, TReal step_size) :
         num_states_(num_states), step_size_(step_size),
-        parameters_are_set_(false) {
+        parameters_are_set_(false), packed_biases_(num_states),
+        packed_alphas_(num_states) {
       // bias[N] and rtau[N]
       super_type::parameter_count_ = num_states * 2;
       super_type::activator_type_ = CTRNN_ACTIVATOR;
@@ -182,6 +250,7 @@ class CTRNNActivator : public Activator<TReal> {
                                                     preset_biases_.size());
       rtaus_ = multi_array::ConstArraySlice<TReal>(preset_rtaus_.data(), 0,
                                                    preset_rtaus_.size());
+      PackParameters();
     }
 
     virtual void operator()(multi_array::Tensor<TReal>& state,
@@ -193,12 +262,35 @@ class CTRNNActivator : public Activator<TReal> {
         throw std::invalid_argument("Incompatible states. State and input"
                                     " must be the same size as activator");
       }
-      // Loop through all the neurons and apply the CTRNN update equation
-      for (Index iii = 0; iii < num_states_; iii++) {
-        state[iii] += step_size_ * rtaus_[iii] * (-state[iii] +
-            utilities::sigmoid(biases_[iii] + input_buffer[iii]));
-        state[iii] = utilities::BoundState(state[iii]);
+      // Apply the CTRNN update equation to a block of neurons at once
+      super_type::ParallelFor(num_states_, [&](Index begin, Index end, Index chunk) {
+        UpdateBlock(state.data(), input_buffer.data(), nullptr, begin, end);
+      });
+    }
+
+    /*
+     * The same update for an input that is the sum of two buffers, as in a
+     * RecurrentLayer, so the sum is taken in the update's pass. The inputs are
+     * summed before the bias is added, as RecurrentLayer does, so the result
+     * matches it exactly. The state may also be one of the inputs, since each
+     * neuron only reads its own entries.
+     */
+    void operator()(multi_array::Tensor<TReal>& state,
+                    const multi_array::Tensor<TReal>& input_buffer,
+                    const multi_array::Tensor<TReal>& other_input_buffer) {
+      if (!((state.size() == num_states_) && (input_buffer.size() == num_states_)
+            && (other_input_buffer.size() == num_states_))) {
+        std::cerr << "state size: " << state.size() << std::endl;
+        std::cerr << "input size: " << input_buffer.size() << std::endl;
+        std::cerr << "other input size: " << other_input_buffer.size() << std::endl;
+        std::cerr << "activator size: " << num_states_ << std::endl;
+        throw std::invalid_argument("Incompatible states. State and inputs"
+                                    " must be the same size as activator");
       }
+      super_type::ParallelFor(num_states_, [&](Index begin, Index end, Index chunk) {
+        UpdateBlock(state.data(), input_buffer.data(), other_input_buffer.data(),
+                    begin, end);
+      });
     }
 
     virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {
@@ -211,6 +303,40 @@ class CTRNNActivator : public Activator<TReal> {
         }
         biases_ = parameters.slice(0, num_states_);
         rtaus_ = parameters.slice(parameters.stride() * num_states_, num_states_);
+        PackParameters();
+      }
+    }
+
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      if (!((states.size() == num_states_ * batch_size)
+            && (input_buffers.size() == num_states_ * batch_size))) {
+        std::cerr << "states size: " << states.size() << std::endl;
+        std::cerr << "inputs size: " << input_buffers.size() << std::endl;
+        std::cerr << "batch size: " << batch_size << std::endl;
+        throw std::invalid_argument("Incompatible batch states. States and"
+                                    " inputs must match the activator");
+      }
+
+      for (Index member = 0; member < batch_size; ++member) {
+        multi_array::ConstArraySlice<TReal> biases(biases_);
+        multi_array::ConstArraySlice<TReal> rtaus(rtaus_);
+        if (!parameters_are_set_) {
+          const multi_array::ConstArraySlice<TReal>& member_parameters =
+              super_type::MemberParameters(parameters, member);
+          biases = member_parameters.slice(0, num_states_);
+          rtaus = member_parameters.slice(member_parameters.stride() * num_states_,
+                                          num_states_);
+        }
+        TReal* state = states.data() + member * num_states_;
+        const TReal* input = input_buffers.data() + member * num_states_;
+        for (Index iii = 0; iii < num_states_; iii++) {
+          state[iii] += step_size_ * rtaus[iii] * (-state[iii] +
+              utilities::sigmoid(biases[iii] + input[iii]));
+          state[iii] = utilities::BoundState(state[iii]);
+        }
       }
     }
 
@@ -232,7 +358,61 @@ class CTRNNActivator : public Activator<TReal> {
 
     virtual void Reset() {};
 
+    const multi_array::ConstArraySlice<TReal>& GetBiases() const {
+      return biases_;
+    }
+
+    const multi_array::ConstArraySlice<TReal>& GetRtaus() const {
+      return rtaus_;
+    }
+
+    TReal GetStepSize() const {
+      return step_size_;
+    }
+
   protected:
+    /*
+     * The CTRNN update for neurons [begin, end). other_input may be null,
+     * otherwise the input is input + other_input. The loop is multi-versioned
+     * (see ALECTRNN_TARGET_CLONES). Each iteration only touches neuron iii, so
+     * the loop has no dependencies between iterations even when the state is
+     * also an input (ivdep).
+     */
+    ALECTRNN_TARGET_CLONES
+    void UpdateBlock(TReal* state, const TReal* input, const TReal* other_input,
+                     Index begin, Index end) const {
+      const TReal* biases = packed_biases_.data();
+      const TReal* alphas = packed_alphas_.data();
+      if (other_input == nullptr) {
+#pragma GCC ivdep
+        for (Index iii = begin; iii < end; ++iii) {
+          state[iii] = utilities::BoundState(state[iii] + alphas[iii]
+              * (-state[iii] + utilities::vector_sigmoid(biases[iii] + input[iii])));
+        }
+      }
+      else {
+#pragma GCC ivdep
+        for (Index iii = begin; iii < end; ++iii) {
+          state[iii] = utilities::BoundState(state[iii] + alphas[iii]
+              * (-state[iii] + utilities::vector_sigmoid(biases[iii]
+                  + (input[iii] + other_input[iii]))));
+        }
+      }
+    }
+
+    /*
+     * Copies the (possibly strided) parameter slices into contiguous arrays
+     * so the update vectorizes. rtaus are pre-multiplied by the step size.
+     */
+    void PackParameters() {
+      packed_biases_.resize(num_states_);
+      packed_alphas_.resize(num_states_);
+      for (Index iii = 0; iii < num_states_; ++iii) {
+        packed_biases_[iii] = biases_[iii];
+        packed_alphas_[iii] = step_size_ * rtaus_[iii];
+      }
+    }
+
     multi_array::ConstArraySlice<TReal> biases_;
     multi_array::ConstArraySlice<TReal> rtaus_;
     std::size_t num_states_;
@@ -240,6 +420,9 @@ class CTRNNActivator : public Activator<TReal> {
     std::vector<TReal> preset_biases_;
     std::vector<TReal> preset_rtaus_;
     bool parameters_are_set_;
+    Array packed_biases_;
+    // step_size_ * rtaus_
+    Array packed_alphas_;
 };
 
 /*
@@ -276,17 +459,12 @@ class Conv3DCTRNNActivator : public Activator<TReal> {
       const multi_array::TensorView<TReal> input_accessor = input_buffer.accessor();
 
       for (Index filter = 0; filter < shape_[0]; filter++) {
-        for (Index iii = 0; iii < shape_[1]; iii++) {
-          for (Index jjj = 0; jjj < shape_[2]; jjj++) {
-            state_accessor[filter][iii][jjj] += step_size_
-              * rtaus_[filter]
-              * (-state_accessor[filter][iii][jjj] 
-              + utilities::sigmoid(biases_[filter] 
-              + input_accessor[filter][iii][jjj]));
-            state_accessor[filter][iii][jjj] = utilities::BoundState<TReal>(
-                state_accessor[filter][iii][jjj]);
-          }
-        }
+        const TReal bias = biases_[filter];
+        const TReal alpha = step_size_ * rtaus_[filter];
+        multi_array::Update([bias, alpha](TReal state, TReal input) {
+            return utilities::BoundState<TReal>(state + alpha
+              * (-state + utilities::sigmoid(bias + input)));
+          }, input_accessor[filter].span(2), state_accessor[filter].span(2));
       }
     }
 
@@ -301,6 +479,36 @@ class Conv3DCTRNNActivator : public Activator<TReal> {
       rtaus_ = parameters.slice(parameters.stride() * shape_[0], shape_[0]);
     }
 
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      const Index filter_size = shape_[1] * shape_[2];
+      const Index member_size = shape_[0] * filter_size;
+      if (!((states.size() == member_size * batch_size)
+            && (input_buffers.size() == member_size * batch_size))) {
+        throw std::invalid_argument("ConvCTRNN batch states, inputs, and"
+                                    " activator must all be the same shape");
+      }
+
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_parameters =
+            super_type::MemberParameters(parameters, member);
+        for (Index filter = 0; filter < shape_[0]; filter++) {
+          const TReal bias = member_parameters[filter];
+          const TReal rtau = member_parameters[shape_[0] + filter];
+          TReal* state = states.data() + member * member_size + filter * filter_size;
+          const TReal* input = input_buffers.data() + member * member_size
+                               + filter * filter_size;
+          for (Index iii = 0; iii < filter_size; iii++) {
+            state[iii] += step_size_ * rtau
+                * (-state[iii] + utilities::sigmoid(bias + input[iii]));
+            state[iii] = utilities::BoundState<TReal>(state[iii]);
+          }
+        }
+      }
+    }
+
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const {
       std::vector<PARAMETER_TYPE> layout(super_type::parameter_count_);
       for (Index iii = 0; iii < shape_[0]; ++iii) {
@@ -332,6 +540,7 @@ class IafActivator : public Activator<TReal> {
   public:
     typedef Activator<TReal> super_type;
     typedef typename super_type::Index Index;
+    typedef Eigen::Array<TReal, Eigen::Dynamic, 1> Array;
 
     IafActivator(std::size_t num_states, TReal step_size, TReal peak, TReal reset)
                 : num_states_(num_states), step_size_(step_size), peak_(peak),
@@ -348,6 +557,8 @@ class IafActivator : public Activator<TReal> {
       subthreshold_state_ = multi_array::Tensor<TReal>({num_states_});
       alpha_.resize(num_states_);
       vthresh_.resize(num_states_);
+      packed_refractory_.resize(num_states_);
+      packed_resistance_.resize(num_states_);
       Reset();
     }
 
@@ -373,6 +584,8 @@ class IafActivator : public Activator<TReal> {
       subthreshold_state_ = multi_array::Tensor<TReal>({num_states_});
       alpha_.resize(num_states_);
       vthresh_.resize(num_states_);
+      packed_refractory_.resize(num_states_);
+      packed_resistance_.resize(num_states_);
       Reset();
 
       // Configure parameters
@@ -385,11 +598,7 @@ class IafActivator : public Activator<TReal> {
       resistance_ = multi_array::ConstArraySlice<TReal>(preset_resistance_.data(),
                                                         0, preset_resistance_.size());
 
-      // Need to update the precomputed parameters
-      for (Index iii = 0; iii < num_states_; ++iii) {
-        alpha_[iii] = step_size_ * rtaus_[iii];
-        vthresh_[iii] = reset_ + range_[iii];
-      }
+      PackParameters();
     }
 
     virtual void operator()(multi_array::Tensor<TReal>& state,
@@ -402,34 +611,16 @@ class IafActivator : public Activator<TReal> {
                                     " must be the same size as activator");
       }
 
-      // update subthreshold state (if not in refractory period)
-      for (Index iii = 0; iii < num_states_; ++iii) {
-        // update refractory state:
-        // increment the time since last spike by the simulation step_size
-        last_spike_time_[iii] += step_size_;
-
-        // if a spike can occur unclamp state and check for action potential
-        if (last_spike_time_[iii] >= refractory_period_[iii]) {
-          // evaluates the equation: -rtaus * dT * ((u - u_reset) + R * I))
-          subthreshold_state_[iii] += alpha_[iii] * ((reset_ - subthreshold_state_[iii])
-                                      + resistance_[iii] * input_buffer[iii]);
-          subthreshold_state_[iii] = utilities::BoundState<TReal>(subthreshold_state_[iii]);
-
-          /* check for action potential and reset last spike time if a
-           * spike occurred. Also reset the membrane potential */
-          if (subthreshold_state_[iii] > vthresh_[iii]) {
-            state[iii] = peak_;
-            subthreshold_state_[iii] = reset_;
-            last_spike_time_[iii] = 0.0;
-          }
-          else {
-            state[iii] = 0.0;
-          }
-        }
-        else {
-          state[iii] = 0.0;
-        }
-      }
+      /*
+       * Neurons are updated together. Refractory and spiking neurons are
+       * handled with masks rather than branches:
+       * - the time since last spike is incremented by the step_size
+       * - neurons out of their refractory period integrate
+       *   -rtaus * dT * ((u - u_reset) + R * I)
+       * - integrating neurons over threshold spike, reset their membrane
+       *   potential and their last spike time
+       */
+      Update(state.data(), input_buffer.data());
     }
 
     virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {
@@ -447,11 +638,7 @@ class IafActivator : public Activator<TReal> {
         resistance_ = parameters.slice(3 * parameters.stride() * num_states_, num_states_);
 
         Reset();
-        // Need to update the precomputed parameters
-        for (Index iii = 0; iii < num_states_; ++iii) {
-          alpha_[iii] = step_size_ * rtaus_[iii];
-          vthresh_[iii] = reset_ + range_[iii];
-        }
+        PackParameters();
       }
     }
 
@@ -479,13 +666,57 @@ class IafActivator : public Activator<TReal> {
 
     /* The spike times and neuron state are reset */
     virtual void Reset() {
+      last_spike_time_.setConstant(std::numeric_limits<TReal>::max());
+      subthreshold_state_.Fill(0.0);
+    }
+
+  protected:
+    /*
+     * The update loop, multi-versioned (see ALECTRNN_TARGET_CLONES). Each
+     * iteration only touches neuron iii (ivdep), and the members are read
+     * through local pointers so the state writes can't alias them.
+     */
+    ALECTRNN_TARGET_CLONES
+    void Update(TReal* state, const TReal* input) {
+      TReal* subthreshold = subthreshold_state_.data();
+      TReal* last_spike_time = last_spike_time_.data();
+      const TReal* alpha = alpha_.data();
+      const TReal* vthresh = vthresh_.data();
+      const TReal* refractory = packed_refractory_.data();
+      const TReal* resistance = packed_resistance_.data();
+      const TReal step_size = step_size_;
+      const TReal peak = peak_;
+      const TReal reset = reset_;
+      const Index num_states = num_states_;
+#pragma GCC ivdep
+      for (Index iii = 0; iii < num_states; ++iii) {
+        const TReal time = last_spike_time[iii] + step_size;
+        const bool can_spike = time >= refractory[iii];
+        const TReal integrated = utilities::BoundState(subthreshold[iii]
+            + alpha[iii] * ((reset - subthreshold[iii])
+                            + resistance[iii] * input[iii]));
+        const TReal potential = can_spike ? integrated : subthreshold[iii];
+        const bool spiked = can_spike & (potential > vthresh[iii]);
+        state[iii] = spiked ? peak : TReal(0);
+        subthreshold[iii] = spiked ? reset : potential;
+        last_spike_time[iii] = spiked ? TReal(0) : time;
+      }
+    }
+
+    /*
+     * Precomputes alpha and the threshold, and copies the remaining
+     * parameters out of the (possibly strided) slices into contiguous arrays
+     * so that the update vectorizes.
+     */
+    void PackParameters() {
       for (Index iii = 0; iii < num_states_; ++iii) {
-        last_spike_time_[iii] = std::numeric_limits<TReal>::max();
-        subthreshold_state_[iii] = 0.0;
+        alpha_[iii] = step_size_ * rtaus_[iii];
+        vthresh_[iii] = reset_ + range_[iii];
+        packed_refractory_[iii] = refractory_period_[iii];
+        packed_resistance_[iii] = resistance_[iii];
       }
     }
 
-  protected:
     std::size_t num_states_;
     /* The threshold is range_ + reset_ */
     multi_array::ConstArraySlice<TReal> range_;
@@ -499,11 +730,14 @@ class IafActivator : public Activator<TReal> {
     TReal peak_;
     /* The resting state voltage is reset_ */
     TReal reset_;
-    std::vector<TReal> last_spike_time_;
+    Array last_spike_time_;
     // alpha == the pre-computed product of rtaus and step_size_
-    std::vector<TReal> alpha_;
+    Array alpha_;
     // vthresh == the pre-computed reset threshold (reset_ + range_)
-    std::vector<TReal> vthresh_;
+    Array vthresh_;
+    // contiguous copies of refractory_period_ and resistance_
+    Array packed_refractory_;
+    Array packed_resistance_;
     multi_array::Tensor<TReal> subthreshold_state_;
     bool parameters_are_set_;
     std::vector<TReal> preset_range_;
@@ -554,36 +788,36 @@ class Conv3DIafActivator : public Activator<TReal> {
       multi_array::TensorView<TReal> spike_time_accessor = last_spike_time_.accessor();
 
       for (Index filter = 0; filter < shape_[0]; filter++) {
-        for (Index iii = 0; iii < shape_[1]; iii++) {
-          for (Index jjj = 0; jjj < shape_[2]; jjj++) {
-            // update refractory state:
-            // increment the time since last spike by the simulation step_size
-            spike_time_accessor[filter][iii][jjj] += step_size_;
-
-            // if a spike can occur unclamp state and check for action potential
-            if (spike_time_accessor[filter][iii][jjj] >= refractory_period_[filter]) {
-              // evaluates the equation: -rtaus * dT * (u - u_reset) + R * I)
-              subthreshold_accessor[filter][iii][jjj] +=
-                alpha_[filter] * ((reset_ - subthreshold_accessor[filter][iii][jjj])
-                + resistance_[filter] * input_accessor[filter][iii][jjj]);
-              subthreshold_accessor[filter][iii][jjj] =
-                utilities::BoundState<TReal>(subthreshold_accessor[filter][iii][jjj]);
-
-              /* check for action potential and reset last spike time if a
-               * spike occurred. Also reset the membrane potential */
-              if (subthreshold_accessor[filter][iii][jjj] > vthresh_[filter]) {
-                state_accessor[filter][iii][jjj] = peak_;
-                subthreshold_accessor[filter][iii][jjj] = reset_;
-                spike_time_accessor[filter][iii][jjj] = 0.0;
-              }
-              else {
-                state_accessor[filter][iii][jjj] = 0.0;
-              }
+        const multi_array::Span<TReal> filter_state = state_accessor[filter].span(2);
+        const multi_array::Span<TReal> filter_input = input_accessor[filter].span(2);
+        const multi_array::Span<TReal> subthreshold = subthreshold_accessor[filter].span(2);
+        const multi_array::Span<TReal> spike_time = spike_time_accessor[filter].span(2);
+        for (Index iii = 0; iii < filter_state.size(); iii++) {
+          // update refractory state:
+          // increment the time since last spike by the simulation step_size
+          spike_time[iii] += step_size_;
+
+          // if a spike can occur unclamp state and check for action potential
+          if (spike_time[iii] >= refractory_period_[filter]) {
+            // evaluates the equation: -rtaus * dT * (u - u_reset) + R * I)
+            subthreshold[iii] += alpha_[filter] * ((reset_ - subthreshold[iii])
+              + resistance_[filter] * filter_input[iii]);
+            subthreshold[iii] = utilities::BoundState<TReal>(subthreshold[iii]);
+
+            /* check for action potential and reset last spike time if a
+             * spike occurred. Also reset the membrane potential */
+            if (subthreshold[iii] > vthresh_[filter]) {
+              filter_state[iii] = peak_;
+              subthreshold[iii] = reset_;
+              spike_time[iii] = 0.0;
             }
             else {
-              state_accessor[filter][iii][jjj] = 0.0;
+              filter_state[iii] = 0.0;
             }
           }
+          else {
+            filter_state[iii] = 0.0;
+          }
         }
       }
     }
@@ -688,9 +922,27 @@ class TanhActivator: public Activator<TReal> {
     virtual void operator()(multi_array::Tensor<TReal>& state,
                             const multi_array::Tensor<TReal>& input_buffer) {
 
-      for (Index iii = 0; iii < num_states_; iii++) {
-        state[iii] = std::tanh(input_buffer[iii]
-                               + input_bias_[iii]);
+      super_type::ParallelFor(num_states_, [&](Index begin, Index end, Index chunk) {
+        for (Index iii = begin; iii < end; iii++) {
+          state[iii] = std::tanh(input_buffer[iii]
+                                 + input_bias_[iii]);
+        }
+      });
+    }
+
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      const Index num_copies = is_shared_ ? num_states_ / shape_[0] : 1;
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_parameters =
+            super_type::MemberParameters(parameters, member);
+        TReal* state = states.data() + member * num_states_;
+        const TReal* input = input_buffers.data() + member * num_states_;
+        for (Index iii = 0; iii < num_states_; iii++) {
+          state[iii] = std::tanh(input[iii] + member_parameters[iii / num_copies]);
+        }
       }
     }
 
@@ -783,11 +1035,35 @@ class SigmoidActivator : public Activator<TReal> {
     virtual void operator()(multi_array::Tensor<TReal>& state,
                             const multi_array::Tensor<TReal>& input_buffer) {
 
-      for (Index iii = 0; iii < num_states_; iii++) {
-        state[iii] += -decay_[iii] * state[iii]
-                      + (saturation_point_ - state[iii])
-                        * utilities::approx_sigmoid(input_bias_[iii]
-                                                    + input_buffer[iii]);
+      super_type::ParallelFor(num_states_, [&](Index begin, Index end, Index chunk) {
+        for (Index iii = begin; iii < end; iii++) {
+          state[iii] += -decay_[iii] * state[iii]
+                        + (saturation_point_ - state[iii])
+                          * utilities::approx_sigmoid(input_bias_[iii]
+                                                      + input_buffer[iii]);
+        }
+      });
+    }
+
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      const Index num_copies = is_shared_ ? num_states_ / shape_[0] : 1;
+      const Index num_unique = num_states_ / num_copies;
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_parameters =
+            super_type::MemberParameters(parameters, member);
+        TReal* state = states.data() + member * num_states_;
+        const TReal* input = input_buffers.data() + member * num_states_;
+        for (Index iii = 0; iii < num_states_; iii++) {
+          const Index parameter_id = iii / num_copies;
+          state[iii] += -utilities::Wrap0to1(member_parameters[num_unique + parameter_id])
+                        * state[iii]
+                        + (saturation_point_ - state[iii])
+                          * utilities::approx_sigmoid(member_parameters[parameter_id]
+                                                      + input[iii]);
+        }
       }
     }
 
@@ -841,6 +1117,21 @@ class SigmoidActivator : public Activator<TReal> {
 
     virtual void Reset() {};
 
+    /*
+     * Biases and decays are expanded to one value per state during Configure
+     */
+    const multi_array::Tensor<TReal>& GetInputBias() const {
+      return input_bias_;
+    }
+
+    const multi_array::Tensor<TReal>& GetDecay() const {
+      return decay_;
+    }
+
+    TReal GetSaturationPoint() const {
+      return saturation_point_;
+    }
+
   protected:
     const std::vector<Index> shape_;
     const TReal saturation_point_;
@@ -880,6 +1171,31 @@ class NoisySigmoidActivator : public SigmoidActivator<TReal> {
       }
     }
 
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      const Index num_states = super_type::num_states_;
+      const Index num_copies = super_type::is_shared_ ? num_states / super_type::shape_[0] : 1;
+      const Index num_unique = num_states / num_copies;
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_parameters =
+            super_type::MemberParameters(parameters, member);
+        TReal* state = states.data() + member * num_states;
+        const TReal* input = input_buffers.data() + member * num_states;
+        for (Index iii = 0; iii < num_states; iii++) {
+          const Index parameter_id = iii / num_copies;
+          state[iii] += -utilities::Wrap0to1(member_parameters[num_unique + parameter_id])
+                        * state[iii]
+                        + (super_type::saturation_point_ - state[iii])
+                          * utilities::approx_sigmoid(member_parameters[parameter_id]
+                                                      + input[iii]
+                                                      + standard_deviation_
+                                                        * normal_distribution_(rng_));
+        }
+      }
+    }
+
   protected:
     const TReal standard_deviation_;
     pcg32_fast rng_;
@@ -923,8 +1239,27 @@ class ReLuActivator : public Activator<TReal> {
     virtual void operator()(multi_array::Tensor<TReal>& state,
                             const multi_array::Tensor<TReal>& input_buffer) {
 
-      for (Index iii = 0; iii < num_states_; iii++) {
-        state[iii] = std::max<TReal>(0, input_buffer[iii] + input_bias_[iii]);
+      super_type::ParallelFor(num_states_, [&](Index begin, Index end, Index chunk) {
+        for (Index iii = begin; iii < end; iii++) {
+          state[iii] = std::max<TReal>(0, input_buffer[iii] + input_bias_[iii]);
+        }
+      });
+    }
+
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      const Index num_copies = is_shared_ ? num_states_ / shape_[0] : 1;
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_parameters =
+            super_type::MemberParameters(parameters, member);
+        TReal* state = states.data() + member * num_states_;
+        const TReal* input = input_buffers.data() + member * num_states_;
+        for (Index iii = 0; iii < num_states_; iii++) {
+          state[iii] = std::max<TReal>(0, input[iii]
+                                       + member_parameters[iii / num_copies]);
+        }
       }
     }
 
@@ -970,6 +1305,13 @@ class ReLuActivator : public Activator<TReal> {
 
     virtual void Reset() {};
 
+    /*
+     * Biases are expanded to one value per state during Configure
+     */
+    const multi_array::Tensor<TReal>& GetInputBias() const {
+      return input_bias_;
+    }
+
   protected:
     std::vector<Index> shape_;
     Index num_states_;
@@ -1004,6 +1346,25 @@ class NoisyReLuActivator : public ReLuActivator<TReal> {
       }
     }
 
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      const Index num_states = super_type::num_states_;
+      const Index num_copies = super_type::is_shared_ ? num_states / super_type::shape_[0] : 1;
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_parameters =
+            super_type::MemberParameters(parameters, member);
+        TReal* state = states.data() + member * num_states;
+        const TReal* input = input_buffers.data() + member * num_states;
+        for (Index iii = 0; iii < num_states; iii++) {
+          state[iii] = std::max<TReal>(0, input[iii] + member_parameters[iii / num_copies]
+                                          + standard_deviation_
+                                            * normal_distribution_(rng_));
+        }
+      }
+    }
+
   protected:
     const TReal standard_deviation_;
     pcg32_fast rng_;
@@ -1036,6 +1397,24 @@ class BoundedReLuActivator : public ReLuActivator<TReal> {
       }
     }
 
+    virtual void BatchActivate(multi_array::Tensor<TReal>& states,
+                               const multi_array::Tensor<TReal>& input_buffers,
+                               const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = states.shape()[0];
+      const Index num_states = super_type::num_states_;
+      const Index num_copies = super_type::is_shared_ ? num_states / super_type::shape_[0] : 1;
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_parameters =
+            super_type::MemberParameters(parameters, member);
+        TReal* state = states.data() + member * num_states;
+        const TReal* input = input_buffers.data() + member * num_states;
+        for (Index iii = 0; iii < num_states; iii++) {
+          state[iii] = utilities::UpperThreshold(std::max<TReal>(0,
+                           input[iii] + member_parameters[iii / num_copies]), bound_);
+        }
+      }
+    }
+
   protected:
     const TReal bound_;
 };
@@ -0,0 +1,178 @@
+/*
+ * Offline inference over recorded input traces, e.g. for sensitivity and
+ * ablation studies. Each of num_traces traces is a [num_steps, input size]
+ * block of inputs, run from a reset state with its own parameter set (or one
+ * set shared by all traces).
+ *
+ * Traces are split into batches of batch_size that run in lockstep through a
+ * network's batch mode. Each network given is owned by one worker thread for
+ * the duration of the call, so the number of networks sets the number of
+ * threads, and workers claim the next batch as they finish. The networks need
+ * the same architecture (e.g. built from the same arguments).
+ *
+ * Only the requested layers are kept. Each is written straight into its
+ * caller provided [num_traces, num_steps, layer size] output, so nothing is
+ * logged or copied in between.
+ */
+
+#ifndef BATCH_INFERENCE_H_
+#define BATCH_INFERENCE_H_
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include "nervous_system.hpp"
+#include "../common/multi_array.hpp"
+
+namespace nervous_system {
+
+/*
+ * inputs: [num_traces, num_steps, input size]
+ * parameters: [num_parameter_sets, parameter count], num_parameter_sets is
+ *   1 (shared) or num_traces
+ * outputs: one [num_traces, num_steps, layer size] buffer per entry of layers
+ * batch_size: # of traces a network runs at once, 0 splits the traces evenly
+ *   over the networks
+ */
+template<typename TReal>
+void RunBatchInference(const std::vector<NervousSystem<TReal>*>& networks,
+                       const TReal* inputs, std::size_t num_traces,
+                       std::size_t num_steps, const TReal* parameters,
+                       std::size_t num_parameter_sets,
+                       const std::vector<std::size_t>& layers,
+                       const std::vector<TReal*>& outputs,
+                       std::size_t batch_size=0) {
+  typedef std::size_t Index;
+
+  if (networks.empty()) {
+    throw std::invalid_argument("RunBatchInference needs at least one network");
+  }
+  if (layers.size() != outputs.size()) {
+    throw std::invalid_argument("RunBatchInference needs one output per layer");
+  }
+  if ((num_parameter_sets != 1) && (num_parameter_sets != num_traces)) {
+    std::cerr << "# parameter sets: " << num_parameter_sets << std::endl;
+    std::cerr << "# traces: " << num_traces << std::endl;
+    throw std::invalid_argument("RunBatchInference needs one parameter set per"
+                                " trace or a single shared set");
+  }
+  // Each worker steps its own network, so a network given twice would be
+  // stepped by two threads at once
+  std::vector<const NervousSystem<TReal>*> unique_networks(networks.begin(),
+                                                           networks.end());
+  std::sort(unique_networks.begin(), unique_networks.end());
+  if (std::adjacent_find(unique_networks.begin(), unique_networks.end())
+      != unique_networks.end()) {
+    throw std::invalid_argument("RunBatchInference networks must be distinct");
+  }
+  const NervousSystem<TReal>& reference = *networks[0];
+  for (Index layer : layers) {
+    if (layer >= reference.size()) {
+      std::cerr << "layer: " << layer << std::endl;
+      throw std::invalid_argument("RunBatchInference layer index out of range");
+    }
+  }
+  for (const NervousSystem<TReal>* network : networks) {
+    bool is_same = (network->size() == reference.size())
+        && (network->GetParameterCount() == reference.GetParameterCount());
+    for (Index iii = 0; is_same && (iii < reference.size()); ++iii) {
+      is_same = ((*network)[iii].state().shape() == reference[iii].state().shape());
+    }
+    if (!is_same) {
+      throw std::invalid_argument("RunBatchInference networks must share an"
+                                  " architecture");
+    }
+  }
+  if (num_traces == 0) {
+    return;
+  }
+
+  const Index num_workers = std::min(networks.size(), num_traces);
+  if (batch_size == 0) {
+    batch_size = (num_traces + num_workers - 1) / num_workers;
+  }
+  const Index num_batches = (num_traces + batch_size - 1) / batch_size;
+  const Index num_inputs = reference[0].NumNeurons();
+  const Index num_parameters = reference.GetParameterCount();
+  std::vector<Index> layer_sizes(layers.size());
+  for (Index iii = 0; iii < layers.size(); ++iii) {
+    layer_sizes[iii] = reference[layers[iii]].NumNeurons();
+  }
+
+  std::atomic<Index> next_batch(0);
+  std::vector<std::exception_ptr> errors(num_workers);
+  auto worker = [&](Index worker_index) {
+    try {
+      NervousSystem<TReal>& network = *networks[worker_index];
+      std::vector<multi_array::ConstArraySlice<TReal>> member_parameters;
+      for (Index batch = next_batch++; batch < num_batches; batch = next_batch++) {
+        const Index first_trace = batch * batch_size;
+        const Index num_members = std::min(batch_size, num_traces - first_trace);
+        if (network.GetBatchSize() != num_members) {
+          network.SetBatchSize(num_members);
+        }
+
+        // A shared set lets integrators fold the batch into one product
+        member_parameters.clear();
+        if (num_parameter_sets == 1) {
+          member_parameters.emplace_back(parameters, 0, num_parameters, 1);
+        }
+        else {
+          for (Index member = 0; member < num_members; ++member) {
+            member_parameters.emplace_back(
+                parameters + (first_trace + member) * num_parameters,
+                0, num_parameters, 1);
+          }
+        }
+        network.BatchConfigure(member_parameters);
+        network.BatchReset();
+
+        for (Index step = 0; step < num_steps; ++step) {
+          for (Index member = 0; member < num_members; ++member) {
+            network.SetBatchInput(member, inputs
+                + ((first_trace + member) * num_steps + step) * num_inputs);
+          }
+          network.BatchStep();
+          for (Index iii = 0; iii < layers.size(); ++iii) {
+            const TReal* state = network.GetBatchLayerState(layers[iii]).data();
+            for (Index member = 0; member < num_members; ++member) {
+              std::copy(state + member * layer_sizes[iii],
+                        state + (member + 1) * layer_sizes[iii],
+                        outputs[iii] + ((first_trace + member) * num_steps + step)
+                                       * layer_sizes[iii]);
+            }
+          }
+        }
+      }
+    }
+    catch (...) {
+      errors[worker_index] = std::current_exception();
+      // Leave the remaining batches to no one, the call fails anyway
+      next_batch = num_batches;
+    }
+  };
+
+  // The calling thread acts as the first worker
+  std::vector<std::thread> threads;
+  for (Index iii = 1; iii < num_workers; ++iii) {
+    threads.emplace_back(worker, iii);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+} // End nervous_system namespace
+
+#endif /* BATCH_INFERENCE_H_ */
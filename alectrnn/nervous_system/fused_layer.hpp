@@ -0,0 +1,145 @@
+/*
+ * FusedLayers are drop-in replacements for Layer/RecurrentLayer for common
+ * combinations of integrators and activator. The component types are known at
+ * compile time, so the per-step calls are made non-virtually and the
+ * integrator output is handed straight to the activator. This skips clearing
+ * the input buffer and the extra sweeps that the generic layers make between
+ * components, which dominates the cost of small layers. The activations still
+ * run through the activators (and so their thread pools), and the sums are
+ * taken in the same order as in the generic layers, so the states are the
+ * same bit for bit.
+ *
+ * Only the explicit specializations below are defined. The layer generator
+ * checks the integrator and activator types of a new layer and builds the
+ * matching FusedLayer when there is one. Parameter layout, configuration and
+ * batch mode are inherited unchanged from the generic layers.
+ */
+
+#ifndef NN_FUSED_LAYER_H_
+#define NN_FUSED_LAYER_H_
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include "layer.hpp"
+#include "activator.hpp"
+#include "integrator.hpp"
+#include "../common/multi_array.hpp"
+
+namespace nervous_system {
+
+template<typename TReal,
+         template<typename> class TBackIntegrator,
+         template<typename> class TSelfIntegrator,
+         template<typename> class TActivator>
+class FusedLayer;
+
+/*
+ * Conv layer: GEMM is written straight into the layer state, then the
+ * activator applies the bias and ReLu in place.
+ */
+template<typename TReal>
+class FusedLayer<TReal, ConvEigenIntegrator, NoneIntegrator, ReLuActivator>
+    : public Layer<TReal> {
+  public:
+    typedef Layer<TReal> super_type;
+    typedef typename super_type::Index Index;
+
+    FusedLayer(const std::vector<Index>& shape,
+               ConvEigenIntegrator<TReal>* back_integrator,
+               NoneIntegrator<TReal>* self_integrator,
+               ReLuActivator<TReal>* activation_function)
+      : super_type(shape, back_integrator, self_integrator, activation_function),
+        back_(back_integrator), activator_(activation_function) {
+    }
+
+    virtual ~FusedLayer()=default;
+
+    virtual void operator()(const Layer<TReal>* prev_layer) override {
+      back_->ConvEigenIntegrator<TReal>::operator()(prev_layer->state(),
+                                                   super_type::layer_state_);
+      activator_->ReLuActivator<TReal>::operator()(super_type::layer_state_,
+                                                   super_type::layer_state_);
+    }
+
+  protected:
+    ConvEigenIntegrator<TReal>* back_;
+    ReLuActivator<TReal>* activator_;
+};
+
+/*
+ * Feed-forward layer: the GEMV fills the input buffer (no clearing needed)
+ * and the sigmoid activator reads it directly.
+ */
+template<typename TReal>
+class FusedLayer<TReal, All2AllEigenIntegrator, NoneIntegrator, SigmoidActivator>
+    : public Layer<TReal> {
+  public:
+    typedef Layer<TReal> super_type;
+    typedef typename super_type::Index Index;
+
+    FusedLayer(const std::vector<Index>& shape,
+               All2AllEigenIntegrator<TReal>* back_integrator,
+               NoneIntegrator<TReal>* self_integrator,
+               SigmoidActivator<TReal>* activation_function)
+      : super_type(shape, back_integrator, self_integrator, activation_function),
+        back_(back_integrator), activator_(activation_function) {
+    }
+
+    virtual ~FusedLayer()=default;
+
+    virtual void operator()(const Layer<TReal>* prev_layer) override {
+      back_->All2AllEigenIntegrator<TReal>::operator()(prev_layer->state(),
+                                                      super_type::input_buffer_);
+      activator_->SigmoidActivator<TReal>::operator()(super_type::layer_state_,
+                                                      super_type::input_buffer_);
+    }
+
+  protected:
+    All2AllEigenIntegrator<TReal>* back_;
+    SigmoidActivator<TReal>* activator_;
+};
+
+/*
+ * Recurrent layer: follows RecurrentLayer::operator(), but the back and self
+ * inputs are summed by the activator in the same (vectorized and threaded)
+ * pass as the CTRNN update and the bounding.
+ */
+template<typename TReal>
+class FusedLayer<TReal, RecurrentEigenIntegrator, RecurrentEigenIntegrator,
+                 CTRNNActivator> : public RecurrentLayer<TReal> {
+  public:
+    typedef RecurrentLayer<TReal> super_type;
+    typedef typename super_type::Index Index;
+
+    FusedLayer(const std::vector<Index>& shape,
+               RecurrentEigenIntegrator<TReal>* back_integrator,
+               RecurrentEigenIntegrator<TReal>* self_integrator,
+               CTRNNActivator<TReal>* activation_function)
+      : super_type(shape, back_integrator, self_integrator, activation_function),
+        back_(back_integrator), self_(self_integrator),
+        activator_(activation_function) {
+    }
+
+    virtual ~FusedLayer()=default;
+
+    virtual void operator()(const Layer<TReal>* prev_layer) override {
+      back_->RecurrentEigenIntegrator<TReal>::operator()(prev_layer->state(),
+                                                        super_type::input_buffer_);
+      self_->RecurrentEigenIntegrator<TReal>::operator()(super_type::layer_state_,
+                                                        super_type::recurrent_state_buffer_);
+      activator_->CTRNNActivator<TReal>::operator()(super_type::input_buffer_,
+                                                    super_type::recurrent_state_buffer_,
+                                                    super_type::input_buffer_);
+      std::swap(super_type::layer_state_, super_type::input_buffer_);
+    }
+
+  protected:
+    RecurrentEigenIntegrator<TReal>* back_;
+    RecurrentEigenIntegrator<TReal>* self_;
+    CTRNNActivator<TReal>* activator_;
+};
+
+} // End nervous_system namespace
+
+#endif /* NN_FUSED_LAYER_H_ */
@@ -25,11 +25,14 @@
 #include <numeric>
 #include <functional>
 #include <utility>
+#include <algorithm>
 #include <Eigen/Core>
 #include <Eigen/Sparse>
 #include "../common/multi_array.hpp"
 #include "../common/graphs.hpp"
+#include "../common/thread_pool.hpp"
 #include "parameter_types.hpp"
+#include "quantization.hpp"
 #include "../common/utilities.hpp"
 
 namespace nervous_system {
@@ -54,6 +57,24 @@ enum INTEGRATOR_TYPE {
   REWARD_MODULATED
 };
 
+/*
+ * How ConvEigenIntegrator lowers the convolution to GEMM.
+ * IM2COL_CONV builds the whole im2col matrix and does one GEMM.
+ * TILED_CONV builds the im2col matrix one block of output positions at a time
+ * and does a GEMM per block, so the buffer stays cache sized.
+ * Should keep in sync with CONV_ALGORITHM in nervous_system.py
+ */
+enum CONV_ALGORITHM {
+  IM2COL_CONV,
+  TILED_CONV
+};
+
+// Target # elements of a TILED_CONV im2col tile (128KB in single precision,
+// so a tile and its output block fit in L2)
+constexpr std::size_t CONV_TILE_ELEMENTS = 32768;
+// Fewest output positions per tile, below which GEMM efficiency drops off
+constexpr std::size_t MIN_CONV_TILE_SIZE = 64;
+
 // Abstract base class
 template<typename TReal>
 class Integrator {
@@ -63,6 +84,8 @@ class Integrator {
     Integrator() {
       integrator_type_ = BASE_INTEGRATOR;
       parameter_count_ = 0;
+      thread_pool_ = nullptr;
+      source_channel_offset_ = 0;
     }
     virtual ~Integrator()=default;
     virtual void operator()(const multi_array::Tensor<TReal>& src_state,
@@ -85,9 +108,99 @@ class Integrator {
      */
     virtual std::pair<Index, Index> GetWeightIndexRange() const=0;
 
+    /*
+     * Batched version of operator() used by the NervousSystem's batch mode.
+     * src_states and tar_states hold one state per member back to back
+     * ([batch, ...] in C order), so the batch size is the leading dimension
+     * of tar_states. parameters holds one slice per member, or a single slice
+     * that all members share. Integrators without a batched kernel throw.
+     */
+    virtual void BatchIntegrate(const multi_array::Tensor<TReal>& src_states,
+                                multi_array::Tensor<TReal>& tar_states,
+                                const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      std::cerr << "integrator type: " << integrator_type_ << std::endl;
+      throw std::invalid_argument("Integrator does not support batch mode");
+    }
+
+    /*
+     * Gives the integrator a pool (owned by the NervousSystem) to split
+     * operator() over. nullptr, the default, runs serially. Integrators
+     * without a parallel kernel ignore the pool.
+     */
+    virtual void SetThreadPool(parallel::ThreadPool* thread_pool) {
+      thread_pool_ = thread_pool;
+    }
+
+    /*
+     * Lets the source state be a ring of channels: logical source channel c
+     * is stored in channel (channel_offset + c) % # channels. This lets the
+     * NervousSystem overwrite its oldest temporal input channel in place
+     * instead of shifting every channel each frame. Only operator() reads
+     * through the offset; batch states are always in logical order.
+     * Integrators that can't read a rotated source only accept 0.
+     */
+    virtual bool SupportsChannelOffset() const {
+      return false;
+    }
+
+    virtual void SetSourceChannelOffset(Index channel_offset) {
+      if (channel_offset != 0) {
+        std::cerr << "integrator type: " << integrator_type_ << std::endl;
+        throw std::invalid_argument("Integrator does not support source "
+                                    "channel offsets");
+      }
+    }
+
+    /*
+     * Has operator() use reduced precision weights (see quantization.hpp).
+     * The weights are quantized now if the integrator is configured, and on
+     * every Configure after. Batch mode always uses the full precision
+     * weights. Integrators that can't quantize only accept NO_QUANTIZATION.
+     */
+    virtual bool SupportsQuantization() const {
+      return false;
+    }
+
+    virtual void SetQuantization(QUANTIZATION_MODE mode) {
+      if (mode != NO_QUANTIZATION) {
+        std::cerr << "integrator type: " << integrator_type_ << std::endl;
+        throw std::invalid_argument("Integrator does not support quantization");
+      }
+    }
+
   protected:
+    /*
+     * Runs function over [0, size) on the thread pool, or in one chunk when
+     * there is no pool.
+     */
+    template<typename TFunction>
+    void ParallelFor(Index size, Index grain, const TFunction& function) const {
+      if (thread_pool_ == nullptr) {
+        function(0, size, 0);
+      }
+      else {
+        thread_pool_->ParallelFor(size, grain, function);
+      }
+    }
+
+    Index NumThreads() const {
+      return (thread_pool_ == nullptr) ? 1 : thread_pool_->NumThreads();
+    }
+
+    /*
+     * Returns the parameters a member should use. A single slice is shared
+     * by every member of the batch.
+     */
+    static const multi_array::ConstArraySlice<TReal>& MemberParameters(
+        const std::vector<multi_array::ConstArraySlice<TReal>>& parameters,
+        Index member) {
+      return (parameters.size() == 1) ? parameters[0] : parameters[member];
+    }
+
     INTEGRATOR_TYPE integrator_type_;
     std::size_t parameter_count_;
+    parallel::ThreadPool* thread_pool_;
+    Index source_channel_offset_;
 };
 
 template <typename TReal>
@@ -125,6 +238,10 @@ class NoneIntegrator : public virtual Integrator<TReal> {
     virtual void operator()(const multi_array::Tensor<TReal>& src_state, multi_array::Tensor<TReal>& tar_state) {}
     virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {}
 
+    virtual void BatchIntegrate(const multi_array::Tensor<TReal>& src_states,
+                                multi_array::Tensor<TReal>& tar_states,
+                                const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {}
+
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const {
       return std::vector<PARAMETER_TYPE>(super_type::parameter_count_);
     }
@@ -140,6 +257,10 @@ class All2AllIntegrator : public virtual Integrator<TReal> {
   public:
     typedef Integrator<TReal> super_type;
     typedef typename super_type::Index Index;
+    typedef Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef const Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> ConstMatrix;
+    typedef Eigen::Map<Matrix> MatrixView;
+    typedef const Eigen::Map<ConstMatrix> ConstMatrixView;
 
     All2AllIntegrator(Index num_states, Index num_prev_states)
         : num_states_(num_states), num_prev_states_(num_prev_states) {
@@ -177,6 +298,40 @@ class All2AllIntegrator : public virtual Integrator<TReal> {
       weights_ = multi_array::ConstArraySlice<TReal>(parameters);
     }
 
+    /*
+     * Weights are stored target-major, which is the transpose of a column
+     * major (# prev states, # states) matrix. With shared weights the whole
+     * batch is resolved by a single GEMM.
+     */
+    virtual void BatchIntegrate(const multi_array::Tensor<TReal>& src_states,
+                                multi_array::Tensor<TReal>& tar_states,
+                                const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = tar_states.shape()[0];
+      if (!((src_states.size() == num_prev_states_ * batch_size)
+            && (tar_states.size() == num_states_ * batch_size))) {
+        std::cerr << "src states size: " << src_states.size() << std::endl;
+        std::cerr << "tar states size: " << tar_states.size() << std::endl;
+        std::cerr << "batch size: " << batch_size << std::endl;
+        throw std::invalid_argument("batch states incompatible with integrator");
+      }
+
+      MatrixView output(tar_states.data(), num_states_, batch_size);
+      ConstMatrixView input(src_states.data(), num_prev_states_, batch_size);
+      if (parameters.size() == 1) {
+        output.noalias() = ConstMatrixView(parameters[0].data() + parameters[0].start(),
+                                           num_prev_states_, num_states_).transpose()
+                           * input;
+      }
+      else {
+        for (Index member = 0; member < batch_size; ++member) {
+          output.col(member).noalias() = ConstMatrixView(
+              parameters[member].data() + parameters[member].start(),
+              num_prev_states_, num_states_).transpose() * input.col(member);
+        }
+      }
+      output = output.unaryExpr([](TReal x) { return utilities::BoundState(x); });
+    }
+
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const {
       std::vector<PARAMETER_TYPE> layout(super_type::parameter_count_);
       for (Index iii = 0; iii < super_type::parameter_count_; ++iii) {
@@ -288,12 +443,10 @@ class Conv2DIntegrator : public virtual Integrator<TReal> {
           Convolve2D(src_image, secondpass_image, firstpass_image,
                      major_view[iii], minor_view[iii], stride_);
 
-          for (Index kkk = 0; kkk < tar_view.extent(1); ++kkk) {
-            for (Index lll = 0; lll < tar_view.extent(2); ++lll) {
-              tar_image[kkk][lll] += secondpass_image[kkk][lll] * channel_weights_[iii][jjj];
-              tar_image[kkk][lll] = utilities::BoundState<TReal>(tar_image[kkk][lll]);
-            }
-          }
+          const TReal channel_weight = channel_weights_[iii][jjj];
+          multi_array::Update([channel_weight](TReal tar, TReal src) {
+              return utilities::BoundState<TReal>(tar + src * channel_weight);
+            }, secondpass_buffer_.span(), tar_image.span(2));
         }
       }
     }
@@ -558,6 +711,54 @@ class Conv2DIntegrator : public virtual Integrator<TReal> {
 };
 
 // Network integrator -- uses explicit unweighted structure
+/*
+ * Helpers for integrators that store their graph in CSR form (see
+ * graphs::CompressPredecessorGraph). The bounds that .at() used to check per
+ * edge are checked once per call against the smallest src/tar state sizes the
+ * graph can address.
+ */
+inline void CompressedGraphExtent(const std::vector<graphs::Index>& row_ptr,
+                                  const std::vector<graphs::NodeID>& col_idx,
+                                  std::size_t& min_src_size,
+                                  std::size_t& min_tar_size) {
+  min_src_size = 0;
+  for (auto source : col_idx) {
+    min_src_size = std::max<std::size_t>(min_src_size, source + 1);
+  }
+  min_tar_size = 0;
+  for (std::size_t node = 0; node + 1 < row_ptr.size(); ++node) {
+    if (row_ptr[node] != row_ptr[node + 1]) {
+      min_tar_size = node + 1;
+    }
+  }
+}
+
+/*
+ * Accumulates weights * src_state into tar_state, one CSR row per target
+ * node. Rows are summed starting from the current target value, in edge
+ * order, and bounded once per row instead of once per edge. Rows without
+ * edges are left untouched.
+ */
+template<typename TReal>
+void CompressedIntegrate(const std::vector<graphs::Index>& row_ptr,
+                         const std::vector<graphs::NodeID>& col_idx,
+                         const TReal* weights, const TReal* src_state,
+                         TReal* tar_state, std::size_t num_rows) {
+  const graphs::NodeID* sources = col_idx.data();
+  for (std::size_t node = 0; node < num_rows; ++node) {
+    const graphs::Index row_begin = row_ptr[node];
+    const graphs::Index row_end = row_ptr[node + 1];
+    if (row_begin == row_end) {
+      continue;
+    }
+    TReal sum = tar_state[node];
+    for (graphs::Index edge = row_begin; edge < row_end; ++edge) {
+      sum += src_state[sources[edge]] * weights[edge];
+    }
+    tar_state[node] = utilities::BoundState(sum);
+  }
+}
+
 template<typename TReal>
 class RecurrentIntegrator : public virtual Integrator<TReal> {
   public:
@@ -568,6 +769,9 @@ class RecurrentIntegrator : public virtual Integrator<TReal> {
         : network_(network) {
       super_type::integrator_type_ = RECURRENT_INTEGRATOR;
       super_type::parameter_count_ = network_.NumEdges();
+      graphs::CompressPredecessorGraph(network_, row_ptr_, col_idx_);
+      CompressedGraphExtent(row_ptr_, col_idx_, min_src_size_, min_tar_size_);
+      packed_weights_.resize(network_.NumEdges());
     }
 
     virtual ~RecurrentIntegrator()=default;
@@ -579,21 +783,16 @@ class RecurrentIntegrator : public virtual Integrator<TReal> {
        * Graph maybe a connector graph or an internal graph.
        * In case of connector, the num nodes doesn't need to match tar_state,
        * because predecessors should be empty for nodes not in tar_state.
-       * However, src state does have to be checked using (at) when tar_state
+       * However, src state does have to be checked when tar_state
        * is larger than src_state, to ensure nothing invalid is accessed.
        */
-      Index edge_id = 0;
-      for (Index node = 0; node < network_.NumNodes(); ++node) {
-        for (Index iii = 0; iii < network_.Predecessors(node).size(); ++iii) {
-          tar_state.at(node) += src_state.at(network_.Predecessors(node)[iii].source) * weights_[edge_id];
-          tar_state[node] = utilities::BoundState(tar_state[node]);
-          ++edge_id;
-        }
-      }
-      if (edge_id != network_.NumEdges()) {
-        throw std::runtime_error("Miss match between number of edges and the"
-                                 " number integrated");
+      if ((src_state.size() < min_src_size_) || (tar_state.size() < min_tar_size_)) {
+        std::cerr << "src state size: " << src_state.size() << std::endl;
+        std::cerr << "tar state size: " << tar_state.size() << std::endl;
+        throw std::out_of_range("src or tar state too small for network");
       }
+      CompressedIntegrate(row_ptr_, col_idx_, packed_weights_.data(),
+                          src_state.data(), tar_state.data(), min_tar_size_);
     }
 
     virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {
@@ -603,6 +802,7 @@ class RecurrentIntegrator : public virtual Integrator<TReal> {
         throw std::invalid_argument("Wrong number of parameters");
       }
       weights_ = parameters.slice(0, super_type::parameter_count_);
+      PackWeights();
     }
 
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const {
@@ -626,8 +826,23 @@ class RecurrentIntegrator : public virtual Integrator<TReal> {
     }
 
   protected:
+    /*
+     * Copies the (possibly strided) weight slice into edge order
+     */
+    virtual void PackWeights() {
+      for (Index iii = 0; iii < packed_weights_.size(); ++iii) {
+        packed_weights_[iii] = weights_[iii];
+      }
+    }
+
     graphs::PredecessorGraph<> network_;
     multi_array::ConstArraySlice<TReal> weights_;
+    // CSR layout of network_
+    std::vector<graphs::Index> row_ptr_;
+    std::vector<graphs::NodeID> col_idx_;
+    std::vector<TReal> packed_weights_;
+    std::size_t min_src_size_;
+    std::size_t min_tar_size_;
 };
 
 // Truncated Recurrent integrator sets weights to 0 during calculations if
@@ -647,35 +862,24 @@ class TruncatedRecurrentIntegrator : public virtual RecurrentIntegrator<TReal> {
 
     virtual ~TruncatedRecurrentIntegrator()= default;
 
-    virtual void operator()(const multi_array::Tensor<TReal>& src_state,
-                    multi_array::Tensor<TReal>& tar_state) {
-
-      Index edge_id = 0;
-      for (Index node = 0; node < super_type::network_.NumNodes(); ++node) {
-        for (Index iii = 0; iii < super_type::network_.Predecessors(node).size(); ++iii) {
-          // Only carry out calculation if it exceeds magnitude of the threshold
-          if ((super_type::weights_[edge_id] > weight_threshold_
-               && super_type::weights_[edge_id] >= 0) ||
-              (super_type::weights_[edge_id] < -weight_threshold_
-               && super_type::weights_[edge_id] <= 0)) {
-            tar_state.at(node) += src_state.at(super_type::network_.Predecessors(node)[iii].source)
-                               * super_type::weights_[edge_id];
-            tar_state[node] = utilities::BoundState(tar_state[node]);
-          }
-          ++edge_id;
-        }
-      }
-      if (edge_id != super_type::network_.NumEdges()) {
-        throw std::runtime_error("Miss match between number of edges and the"
-                                 " number integrated");
-      }
-    }
-
     TReal GetWeightThreshold() const {
       return weight_threshold_;
     }
 
   protected:
+    /*
+     * Weights that don't exceed the magnitude of the threshold are packed as
+     * 0, so the shared CSR kernel can skip the per-edge test.
+     */
+    virtual void PackWeights() override {
+      for (Index iii = 0; iii < super_type::packed_weights_.size(); ++iii) {
+        const TReal weight = super_type::weights_[iii];
+        super_type::packed_weights_[iii] =
+            ((weight > weight_threshold_ && weight >= 0) ||
+             (weight < -weight_threshold_ && weight <= 0)) ? weight : 0;
+      }
+    }
+
     TReal weight_threshold_;
 };
 
@@ -687,23 +891,25 @@ class ReservoirIntegrator : public virtual Integrator<TReal> {
     typedef typename super_type::Index Index;
 
     ReservoirIntegrator(const graphs::PredecessorGraph<TReal>& network)
-        : network_(network) {
+        : network_(network),
+          packed_weights_(graphs::CompressPredecessorWeights(network)) {
       super_type::integrator_type_ = RESERVOIR_INTEGRATOR;
       super_type::parameter_count_ = 0;
+      graphs::CompressPredecessorGraph(network_, row_ptr_, col_idx_);
+      CompressedGraphExtent(row_ptr_, col_idx_, min_src_size_, min_tar_size_);
     }
 
     ~ReservoirIntegrator()=default;
 
     void operator()(const multi_array::Tensor<TReal>& src_state,
                     multi_array::Tensor<TReal>& tar_state) {
-
-      for (Index node = 0; node < network_.NumNodes(); ++node) {
-        for (Index iii = 0; iii < network_.Predecessors(node).size(); ++iii) {
-          tar_state.at(node) += src_state.at(network_.Predecessors(node)[iii].source)
-                              * network_.Predecessors(node)[iii].weight;
-          tar_state[node] = utilities::BoundState(tar_state[node]);
-        }
+      if ((src_state.size() < min_src_size_) || (tar_state.size() < min_tar_size_)) {
+        std::cerr << "src state size: " << src_state.size() << std::endl;
+        std::cerr << "tar state size: " << tar_state.size() << std::endl;
+        throw std::out_of_range("src or tar state too small for network");
       }
+      CompressedIntegrate(row_ptr_, col_idx_, packed_weights_.data(),
+                          src_state.data(), tar_state.data(), min_tar_size_);
     }
 
     void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {}
@@ -722,6 +928,12 @@ class ReservoirIntegrator : public virtual Integrator<TReal> {
 
   protected:
     graphs::PredecessorGraph<TReal> network_;
+    // CSR layout of network_
+    std::vector<TReal> packed_weights_;
+    std::vector<graphs::Index> row_ptr_;
+    std::vector<graphs::NodeID> col_idx_;
+    std::size_t min_src_size_;
+    std::size_t min_tar_size_;
 };
 
 /*
@@ -750,7 +962,8 @@ class ConvEigenIntegrator : public virtual Integrator<TReal> {
     ConvEigenIntegrator(const multi_array::Array<Index,3>& filter_shape,
                         const multi_array::Array<Index,3>& layer_shape,
                         const multi_array::Array<Index,3>& prev_layer_shape,
-                        Index stride)
+                        Index stride,
+                        CONV_ALGORITHM algorithm=IM2COL_CONV)
                       : num_filters_(layer_shape[0]), layer_shape_(layer_shape),
                         prev_layer_shape_(prev_layer_shape),
                         filter_shape_(filter_shape), stride_(stride),
@@ -765,10 +978,20 @@ class ConvEigenIntegrator : public virtual Integrator<TReal> {
                                        / stride_ + 1)
                                       * ((width_ + 2 * pad_w_ - kernel_w_)
                                          / stride_ + 1)),
-                        buffer_state_(channel_size_,
-                                      kernel_h_ * kernel_w_ * channels_) {
+                        patch_size_(kernel_h_ * kernel_w_ * channels_),
+                        algorithm_(algorithm) {
       super_type::parameter_count_ = kernel_w_ * kernel_h_ * channels_ * num_filters_;
       super_type::integrator_type_ = CONV_EIGEN_INTEGRATOR;
+      if (algorithm_ == TILED_CONV) {
+        tile_size_ = std::min<utilities::Integer>(channel_size_,
+            std::max<utilities::Integer>(MIN_CONV_TILE_SIZE,
+                                         CONV_TILE_ELEMENTS / patch_size_));
+        buffer_state_.resize(tile_size_, patch_size_);
+      }
+      else {
+        tile_size_ = channel_size_;
+        buffer_state_.resize(channel_size_, patch_size_);
+      }
     }
 
     virtual ~ConvEigenIntegrator()=default;
@@ -784,19 +1007,77 @@ class ConvEigenIntegrator : public virtual Integrator<TReal> {
      */
     virtual void operator()(const multi_array::Tensor<TReal>& src_state,
                     multi_array::Tensor<TReal>& tar_state) override {
-
-      utilities::Im2Col(src_state.data(), channels_, height_, width_,
-                        kernel_h_, kernel_w_, pad_h_, pad_w_, stride_, stride_,
-                        1, 1, buffer_state_.data());
-      MatrixView output(tar_state.data(), channel_size_, num_filters_);
-      ConstMatrixView params(weight_view_.data() + weight_view_.start(),
-                             kernel_w_ * kernel_h_ * channels_,
-                             num_filters_);
-      output.noalias() = buffer_state_ * params;
+      if (quantization_ != NO_QUANTIZATION) {
+        quantized_weights_.Dequantize(dequantized_weights_.data());
+        Convolve(src_state.data(), tar_state.data(),
+                 dequantized_weights_.data(), super_type::source_channel_offset_);
+        return;
+      }
+      Convolve(src_state.data(), tar_state.data(),
+               weight_view_.data() + weight_view_.start(),
+               super_type::source_channel_offset_);
     }
 
     virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) override {
       weight_view_ = parameters;
+      Quantize();
+    }
+
+    virtual bool SupportsQuantization() const override {
+      return true;
+    }
+
+    virtual void SetQuantization(QUANTIZATION_MODE mode) override {
+      quantization_ = mode;
+      Quantize();
+    }
+
+    /*
+     * Each member's im2col buffer is multiplied by its own filters, so every
+     * member is already a (channel_size x patch) * (patch x filters) GEMM
+     * (or a sequence of them for TILED_CONV).
+     * Members are walked back to back so the im2col buffer stays hot.
+     */
+    virtual void BatchIntegrate(const multi_array::Tensor<TReal>& src_states,
+                                multi_array::Tensor<TReal>& tar_states,
+                                const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) override {
+      const Index batch_size = tar_states.shape()[0];
+      const Index src_stride = src_states.size() / batch_size;
+      const Index tar_stride = tar_states.size() / batch_size;
+      for (Index member = 0; member < batch_size; ++member) {
+        const multi_array::ConstArraySlice<TReal>& member_weights =
+            super_type::MemberParameters(parameters, member);
+        Convolve(src_states.data() + member * src_stride,
+                 tar_states.data() + member * tar_stride,
+                 member_weights.data() + member_weights.start(), 0);
+      }
+    }
+
+    CONV_ALGORITHM GetAlgorithm() const {
+      return algorithm_;
+    }
+
+    // im2col reads each source channel separately, so a rotation is free
+    virtual bool SupportsChannelOffset() const override {
+      return true;
+    }
+
+    virtual void SetSourceChannelOffset(Index channel_offset) override {
+      if (channel_offset >= static_cast<Index>(channels_)) {
+        std::cerr << "channel offset: " << channel_offset << std::endl;
+        std::cerr << "# channels: " << channels_ << std::endl;
+        throw std::invalid_argument("Source channel offset out of range");
+      }
+      super_type::source_channel_offset_ = channel_offset;
+    }
+
+    // TILED_CONV needs a tile buffer for each thread
+    virtual void SetThreadPool(parallel::ThreadPool* thread_pool) override {
+      super_type::SetThreadPool(thread_pool);
+      if (algorithm_ == TILED_CONV) {
+        thread_buffers_.assign(super_type::NumThreads() - 1,
+                               Matrix(tile_size_, patch_size_));
+      }
     }
 
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const override {
@@ -812,6 +1093,116 @@ class ConvEigenIntegrator : public virtual Integrator<TReal> {
     };
 
   protected:
+    // Each filter's weights are a contiguous column of the parameters
+    void Quantize() {
+      if ((quantization_ != NO_QUANTIZATION) && (weight_view_.data() != nullptr)) {
+        quantized_weights_.Quantize(quantization_,
+                                    weight_view_.data() + weight_view_.start(),
+                                    num_filters_, patch_size_, patch_size_, 1);
+        dequantized_weights_.resize(patch_size_, num_filters_);
+      }
+    }
+
+    /*
+     * IM2COL_CONV: one (channel_size x patch) * (patch x filters) GEMM.
+     * TILED_CONV: the output rows are split into blocks of tile_size_
+     * positions. Each block's slice of the im2col matrix is built into the
+     * (tile_size x patch) buffer and multiplied straight into those output
+     * rows, so the buffer is reused while it is still in cache.
+     * channel_offset is the source's channel ring offset.
+     */
+    void Convolve(const TReal* src, TReal* tar, const TReal* weights,
+                  Index channel_offset) {
+      MatrixView output(tar, channel_size_, num_filters_);
+      ConstMatrixView params(weights, patch_size_, num_filters_);
+      if (algorithm_ == IM2COL_CONV) {
+        if (super_type::thread_pool_ == nullptr) {
+          Im2ColChannels(src, channel_offset, 0, channels_, buffer_state_.data());
+          output.noalias() = buffer_state_ * params;
+          return;
+        }
+
+        // Each input channel fills its own block of im2col columns, then
+        // output rows are split into blocks, each its own GEMM
+        super_type::ParallelFor(channels_, 1,
+          [&](Index begin, Index end, Index chunk) {
+            Im2ColChannels(src, channel_offset, begin, end - begin,
+                           buffer_state_.data());
+          });
+        super_type::ParallelFor(channel_size_,
+          parallel::MIN_WORK_PER_THREAD / (patch_size_ * num_filters_),
+          [&](Index begin, Index end, Index chunk) {
+            output.middleRows(begin, end - begin).noalias() =
+                buffer_state_.middleRows(begin, end - begin) * params;
+          });
+        return;
+      }
+
+      // Tiles are independent, so they are dealt out to the threads
+      const Index num_tiles = (channel_size_ + tile_size_ - 1) / tile_size_;
+      super_type::ParallelFor(num_tiles, 1,
+        [&](Index begin, Index end, Index chunk) {
+          Matrix& buffer = (chunk == 0) ? buffer_state_ : thread_buffers_[chunk - 1];
+          for (Index tile = begin; tile < end; ++tile) {
+            const utilities::Integer tile_begin = tile * tile_size_;
+            const utilities::Integer num_rows = std::min(tile_size_,
+                                                         channel_size_ - tile_begin);
+            ForEachChannelRun(channel_offset, 0, channels_,
+              [&](utilities::Integer physical, utilities::Integer logical,
+                  utilities::Integer count) {
+                utilities::Im2ColTile(src + physical * height_ * width_, count,
+                                      height_, width_, kernel_h_, kernel_w_,
+                                      pad_h_, pad_w_, stride_, stride_,
+                                      tile_begin, num_rows,
+                                      buffer.data() + logical * kernel_h_
+                                                      * kernel_w_ * num_rows);
+              });
+            ConstMatrixView tile_view(buffer.data(), num_rows, patch_size_);
+            output.middleRows(tile_begin, num_rows).noalias() = tile_view * params;
+          }
+        });
+    }
+
+    /*
+     * Calls function(physical channel, logical channel, # channels) for each
+     * run of logical channels [first_channel, first_channel + num_channels)
+     * that is contiguous in the source. With a channel offset the range is
+     * split in two where the channel ring wraps around.
+     */
+    template<typename TFunction>
+    void ForEachChannelRun(Index channel_offset,
+                           utilities::Integer first_channel,
+                           utilities::Integer num_channels,
+                           const TFunction& function) const {
+      utilities::Integer physical = (first_channel
+          + static_cast<utilities::Integer>(channel_offset)) % channels_;
+      while (num_channels > 0) {
+        const utilities::Integer count = std::min(num_channels, channels_ - physical);
+        function(physical, first_channel, count);
+        first_channel += count;
+        num_channels -= count;
+        physical = 0;
+      }
+    }
+
+    /*
+     * Builds the full im2col columns of logical channels
+     * [first_channel, first_channel + num_channels) into data_col.
+     */
+    void Im2ColChannels(const TReal* src, Index channel_offset,
+                        utilities::Integer first_channel,
+                        utilities::Integer num_channels, TReal* data_col) const {
+      const utilities::Integer column_block = kernel_h_ * kernel_w_ * channel_size_;
+      ForEachChannelRun(channel_offset, first_channel, num_channels,
+        [&](utilities::Integer physical, utilities::Integer logical,
+            utilities::Integer count) {
+          utilities::Im2Col(src + physical * height_ * width_, count,
+                            height_, width_, kernel_h_, kernel_w_,
+                            pad_h_, pad_w_, stride_, stride_, 1, 1,
+                            data_col + logical * column_block);
+        });
+    }
+
     const utilities::Integer num_filters_;
     const multi_array::Array<Index, 3> layer_shape_;
     const multi_array::Array<Index, 3> prev_layer_shape_;
@@ -825,8 +1216,19 @@ class ConvEigenIntegrator : public virtual Integrator<TReal> {
     const utilities::Integer pad_h_;
     const utilities::Integer pad_w_;
     const utilities::Integer channel_size_;
+    const utilities::Integer patch_size_;
+    const CONV_ALGORITHM algorithm_;
+    // # output positions per im2col block (channel_size_ for IM2COL_CONV)
+    utilities::Integer tile_size_;
+    // im2col matrix, or a single tile of it for TILED_CONV
     Matrix buffer_state_;
+    // TILED_CONV tile buffers for threads other than the caller
+    std::vector<Matrix> thread_buffers_;
     multi_array::ConstArraySlice<TReal> weight_view_;
+    QUANTIZATION_MODE quantization_ = NO_QUANTIZATION;
+    QuantizedWeights<TReal> quantized_weights_;
+    // Filters rebuilt from quantized_weights_ each step
+    Matrix dequantized_weights_;
 };
 
 template <typename TReal>
@@ -851,15 +1253,22 @@ class RewardModulatedConvIntegrator : public ConvEigenIntegrator<TReal>,
       conv_type::integrator_type_ = REWARD_MODULATED;
     }
 
+    // The weights change as the integrator learns
+    virtual bool SupportsQuantization() const override {
+      return false;
+    }
+
+    virtual void SetQuantization(QUANTIZATION_MODE mode) override {
+      Integrator<TReal>::SetQuantization(mode);
+    }
+
     void operator()(const multi_array::Tensor<TReal>& src_state,
                     multi_array::Tensor<TReal>& tar_state) override {
 
-      utilities::Im2Col(src_state.data(), conv_type::channels_,
-                        conv_type::height_, conv_type::width_,
-                        conv_type::kernel_h_, conv_type::kernel_w_,
-                        conv_type::pad_h_, conv_type::pad_w_,
-                        conv_type::stride_, conv_type::stride_,
-                        1, 1, conv_type::buffer_state_.data());
+      conv_type::Im2ColChannels(src_state.data(),
+                                conv_type::source_channel_offset_,
+                                0, conv_type::channels_,
+                                conv_type::buffer_state_.data());
       MatrixView output(tar_state.data(), conv_type::channel_size_,
                         conv_type::num_filters_);
       ConstMatrixView params(weights_.data(),
@@ -901,11 +1310,6 @@ class RewardModulatedConvIntegrator : public ConvEigenIntegrator<TReal>,
                                    conv_type::channel_size_,
                                    conv_type::num_filters_);
 
-      std::cout << "weights dim: cols " << weights.cols() << " rows " << weights.rows() << std::endl;/////////////
-      std::cout << "tar view dim: cols " << tar_view.cols() << " rows " << tar_view.rows() << std::endl;/////////////
-      std::cout << "tar avg view dim: cols " << tar_avg_view.cols() << " rows " << tar_avg_view.rows() << std::endl;/////////////
-      std::cout << "buff dim: cols " << conv_type::buffer_state_.cols() << " rows " << conv_type::buffer_state_.rows() << std::endl;/////////////
-
       // find max index tar state, updates single filter
       const Index max_neuron_index = utilities::IndexOfMaxElement(tar_state);
       // Get the filter index for the max neuron
@@ -950,6 +1354,8 @@ class All2AllEigenIntegrator : public virtual Integrator<TReal> {
     typedef Eigen::Map<ColVector> ColVectorView;
     typedef const Eigen::Matrix<TReal, Eigen::Dynamic, 1> ConstColVector;
     typedef const Eigen::Map<ConstColVector> ConstColVectorView;
+    typedef Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Map<Matrix> MatrixView;
     typedef const Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> ConstMatrix;
     typedef const Eigen::Map<ConstMatrix> ConstMatrixView;
 
@@ -971,11 +1377,38 @@ class All2AllEigenIntegrator : public virtual Integrator<TReal> {
                                     " size must be equal");
       }
 
+      if (quantization_ != NO_QUANTIZATION) {
+        const Index num_blocks = (num_states_ + ROW_BLOCK - 1) / ROW_BLOCK;
+        super_type::ParallelFor(num_blocks,
+          parallel::MIN_WORK_PER_THREAD / std::max<Index>(1, ROW_BLOCK * num_prev_states_),
+          [&](Index begin, Index end, Index chunk) {
+            quantized_weights_.Gemv(src_state.data(), tar_state.data(),
+                                    begin * ROW_BLOCK,
+                                    std::min(end * ROW_BLOCK, num_states_));
+          });
+        return;
+      }
+
       ColVectorView output(tar_state.data(), tar_state.size());
-      output.noalias() = ConstMatrixView(weight_view_.data() + weight_view_.start(),
-                                         tar_state.size(),
-                                         src_state.size())
-                         * ConstColVectorView(src_state.data(), src_state.size());
+      ConstMatrixView weights(weight_view_.data() + weight_view_.start(),
+                              tar_state.size(), src_state.size());
+      ConstColVectorView input(src_state.data(), src_state.size());
+      if (super_type::thread_pool_ == nullptr) {
+        output.noalias() = weights * input;
+        return;
+      }
+
+      // Each thread takes a block of output rows. Blocks are whole multiples
+      // of ROW_BLOCK so threads don't write to the same cache line.
+      const Index num_blocks = (num_states_ + ROW_BLOCK - 1) / ROW_BLOCK;
+      super_type::ParallelFor(num_blocks,
+        parallel::MIN_WORK_PER_THREAD / std::max<Index>(1, ROW_BLOCK * num_prev_states_),
+        [&](Index begin, Index end, Index chunk) {
+          const Index first_row = begin * ROW_BLOCK;
+          const Index num_rows = std::min(end * ROW_BLOCK, num_states_) - first_row;
+          output.segment(first_row, num_rows).noalias() =
+              weights.middleRows(first_row, num_rows) * input;
+        });
     }
 
     virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {
@@ -985,6 +1418,48 @@ class All2AllEigenIntegrator : public virtual Integrator<TReal> {
         throw std::invalid_argument("Wrong number of parameters");
       }
       weight_view_ = parameters;
+      Quantize();
+    }
+
+    virtual bool SupportsQuantization() const override {
+      return true;
+    }
+
+    virtual void SetQuantization(QUANTIZATION_MODE mode) override {
+      quantization_ = mode;
+      Quantize();
+    }
+
+    /*
+     * States are [batch, # states], which Eigen sees as a column major
+     * (# states, batch) matrix. With shared weights the batch becomes the
+     * column dimension of a single GEMM, otherwise each member gets a GEMV.
+     */
+    virtual void BatchIntegrate(const multi_array::Tensor<TReal>& src_states,
+                                multi_array::Tensor<TReal>& tar_states,
+                                const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = tar_states.shape()[0];
+      if (!((src_states.size() == num_prev_states_ * batch_size)
+            && (tar_states.size() == num_states_ * batch_size))) {
+        std::cerr << "src states size: " << src_states.size() << std::endl;
+        std::cerr << "tar states size: " << tar_states.size() << std::endl;
+        std::cerr << "batch size: " << batch_size << std::endl;
+        throw std::invalid_argument("batch states incompatible with integrator");
+      }
+
+      MatrixView output(tar_states.data(), num_states_, batch_size);
+      ConstMatrixView input(src_states.data(), num_prev_states_, batch_size);
+      if (parameters.size() == 1) {
+        output.noalias() = ConstMatrixView(parameters[0].data() + parameters[0].start(),
+                                           num_states_, num_prev_states_) * input;
+      }
+      else {
+        for (Index member = 0; member < batch_size; ++member) {
+          output.col(member).noalias() = ConstMatrixView(
+              parameters[member].data() + parameters[member].start(),
+              num_states_, num_prev_states_) * input.col(member);
+        }
+      }
     }
 
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const {
@@ -1000,9 +1475,23 @@ class All2AllEigenIntegrator : public virtual Integrator<TReal> {
     }
 
   protected:
+    // The parameters are a column major (# states, # prev states) matrix
+    void Quantize() {
+      if ((quantization_ != NO_QUANTIZATION) && (weight_view_.data() != nullptr)) {
+        quantized_weights_.Quantize(quantization_,
+                                    weight_view_.data() + weight_view_.start(),
+                                    num_states_, num_prev_states_, 1, num_states_);
+      }
+    }
+
+    // Rows per threading block (a cache line of single precision output)
+    static constexpr Index ROW_BLOCK = 16;
+
     Index num_states_;
     Index num_prev_states_;
     multi_array::ConstArraySlice<TReal> weight_view_;
+    QUANTIZATION_MODE quantization_ = NO_QUANTIZATION;
+    QuantizedWeights<TReal> quantized_weights_;
 };
 
 /*
@@ -1020,11 +1509,31 @@ class RecurrentEigenIntegrator : public virtual Integrator<TReal> {
     typedef Eigen::SparseMatrix<TReal> SparseMatrix;
     typedef const Eigen::SparseMatrix<TReal> ConstSparseMatrix;
     typedef const Eigen::Map<ConstSparseMatrix> ConstSparseMatrixView;
+    typedef Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Map<Matrix> MatrixView;
+    typedef const Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> ConstMatrix;
+    typedef const Eigen::Map<ConstMatrix> ConstMatrixView;
+    typedef Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> Permutation;
 
-    RecurrentEigenIntegrator(SparseMatrix network) : network_(std::move(network)) {
+    /*
+     * A square network can be given a node ordering other than the natural
+     * one. The network is then stored permuted, and the src state is gathered
+     * into and the output scattered out of that ordering on each call, so
+     * the layer state and the parameter layout are unaffected.
+     */
+    RecurrentEigenIntegrator(SparseMatrix network,
+                             graphs::NODE_ORDERING ordering=graphs::NATURAL_ORDERING)
+        : network_(std::move(network)), is_reordered_(false) {
       network_.makeCompressed();
       super_type::integrator_type_ = RECURRENT_EIGEN_INTEGRATOR;
       super_type::parameter_count_ = network_.nonZeros();
+      if (ordering != graphs::NATURAL_ORDERING) {
+        if (network_.rows() != network_.cols()) {
+          std::cerr << "rows: " << network_.rows() << " cols: " << network_.cols() << std::endl;
+          throw std::invalid_argument("Node ordering requires a square network");
+        }
+        ReorderNetwork(ordering);
+      }
     }
 
     virtual ~RecurrentEigenIntegrator()=default;
@@ -1038,14 +1547,32 @@ class RecurrentEigenIntegrator : public virtual Integrator<TReal> {
                                     "incompatible with network");
       }
 
+      ColVectorView output_vector(tar_state.data(), tar_state.size());
+      ConstColVectorView src_vector(src_state.data(), src_state.size());
+      // The row blocks can't run in place, so aliased calls stay serial
+      if (!csr_row_ptr_.empty()
+          && (is_reordered_ || (src_state.data() != tar_state.data()))) {
+        IntegrateRowBlocks(src_vector, output_vector);
+        return;
+      }
+
+      if (is_reordered_) {
+        ConstSparseMatrixView weight_matrix(network_.rows(), network_.cols(),
+                                            packed_weights_.size(), network_.outerIndexPtr(),
+                                            network_.innerIndexPtr(),
+                                            packed_weights_.data(),
+                                            network_.innerNonZeroPtr());
+        permuted_src_ = permutation_ * src_vector;
+        permuted_tar_.noalias() = weight_matrix * permuted_src_;
+        output_vector = permutation_.transpose() * permuted_tar_;
+        return;
+      }
+
       ConstSparseMatrixView weight_matrix(network_.rows(), network_.cols(),
                                           weight_view_.size(), network_.outerIndexPtr(),
                                           network_.innerIndexPtr(),
                                           weight_view_.data() + weight_view_.start(),
                                           network_.innerNonZeroPtr());
-      ColVectorView output_vector(tar_state.data(), tar_state.size());
-      ConstColVectorView src_vector(src_state.data(), src_state.size());
-
       output_vector.noalias() = weight_matrix * src_vector;
     }
 
@@ -1056,6 +1583,93 @@ class RecurrentEigenIntegrator : public virtual Integrator<TReal> {
         throw std::invalid_argument("Wrong number of parameters");
       }
       weight_view_ = parameters.slice(0, super_type::parameter_count_);
+      if (is_reordered_) {
+        PackWeights(weight_view_, packed_weights_);
+      }
+      PackRowBlockWeights();
+    }
+
+    /*
+     * The CSC SpMV scatters into the output, so for threading a CSR copy of
+     * the (possibly reordered) network is built and split into row blocks.
+     * Each output element is summed in the same order as the serial SpMV.
+     */
+    virtual void SetThreadPool(parallel::ThreadPool* thread_pool) override {
+      super_type::SetThreadPool(thread_pool);
+      csr_row_ptr_.clear();
+      csr_col_idx_.clear();
+      csr_source_.clear();
+      if (super_type::NumThreads() < 2) {
+        return;
+      }
+
+      // Eigen's sizes and storage indices are signed, but never negative
+      const Index num_rows = static_cast<Index>(network_.rows());
+      const Index num_cols = static_cast<Index>(network_.outerSize());
+      const Index num_nonzeros = static_cast<Index>(network_.nonZeros());
+      const typename SparseMatrix::StorageIndex* col_ptr = network_.outerIndexPtr();
+      csr_row_ptr_.assign(num_rows + 1, 0);
+      for (Index nonzero = 0; nonzero < num_nonzeros; ++nonzero) {
+        ++csr_row_ptr_[network_.innerIndexPtr()[nonzero] + 1];
+      }
+      for (Index row = 0; row < num_rows; ++row) {
+        csr_row_ptr_[row + 1] += csr_row_ptr_[row];
+      }
+      // Columns are walked in order, so each row's columns come out sorted
+      std::vector<Index> next(csr_row_ptr_.begin(), csr_row_ptr_.end() - 1);
+      csr_col_idx_.resize(num_nonzeros);
+      csr_source_.resize(num_nonzeros);
+      for (Index col = 0; col < num_cols; ++col) {
+        for (Index nonzero = static_cast<Index>(col_ptr[col]);
+             nonzero < static_cast<Index>(col_ptr[col + 1]); ++nonzero) {
+          const Index position = next[network_.innerIndexPtr()[nonzero]]++;
+          csr_col_idx_[position] = col;
+          csr_source_[position] = nonzero;
+        }
+      }
+      PackRowBlockWeights();
+    }
+
+    /*
+     * The sparsity pattern is shared by all members, only the values differ.
+     * With shared weights the batch is resolved by a single SpMM.
+     */
+    virtual void BatchIntegrate(const multi_array::Tensor<TReal>& src_states,
+                                multi_array::Tensor<TReal>& tar_states,
+                                const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = tar_states.shape()[0];
+      if ((network_.cols() * batch_size != src_states.size())
+          || (network_.rows() * batch_size != tar_states.size())) {
+        throw std::invalid_argument("src states size and tar states size "
+                                    "incompatible with network");
+      }
+
+      MatrixView output(tar_states.data(), network_.rows(), batch_size);
+      ConstMatrixView input(src_states.data(), network_.cols(), batch_size);
+      if (is_reordered_) {
+        BatchIntegrateReordered(input, output, parameters);
+        return;
+      }
+
+      if (parameters.size() == 1) {
+        ConstSparseMatrixView weight_matrix(network_.rows(), network_.cols(),
+                                            network_.nonZeros(), network_.outerIndexPtr(),
+                                            network_.innerIndexPtr(),
+                                            parameters[0].data() + parameters[0].start(),
+                                            network_.innerNonZeroPtr());
+        output.noalias() = weight_matrix * input;
+      }
+      else {
+        for (Index member = 0; member < batch_size; ++member) {
+          ConstSparseMatrixView weight_matrix(network_.rows(), network_.cols(),
+                                              network_.nonZeros(), network_.outerIndexPtr(),
+                                              network_.innerIndexPtr(),
+                                              parameters[member].data()
+                                              + parameters[member].start(),
+                                              network_.innerNonZeroPtr());
+          output.col(member).noalias() = weight_matrix * input.col(member);
+        }
+      }
     }
 
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const {
@@ -1075,8 +1689,148 @@ class RecurrentEigenIntegrator : public virtual Integrator<TReal> {
     }
 
   protected:
+    // Copies the configured weights into CSR order for the row block kernel
+    void PackRowBlockWeights() {
+      if (csr_row_ptr_.empty() || (weight_view_.size() == 0)) {
+        return;
+      }
+      csr_weights_.resize(csr_source_.size());
+      for (Index iii = 0; iii < csr_source_.size(); ++iii) {
+        csr_weights_[iii] = is_reordered_ ? packed_weights_[csr_source_[iii]]
+                                          : weight_view_[csr_source_[iii]];
+      }
+    }
+
+    void IntegrateRowBlocks(const ConstColVectorView& src_vector,
+                            ColVectorView& output_vector) {
+      const TReal* src = src_vector.data();
+      TReal* tar = output_vector.data();
+      if (is_reordered_) {
+        permuted_src_ = permutation_ * src_vector;
+        src = permuted_src_.data();
+        tar = permuted_tar_.data();
+      }
+
+      const Index num_rows = network_.rows();
+      const Index mean_row_size = std::max<Index>(1, csr_col_idx_.size() / std::max<Index>(1, num_rows));
+      super_type::ParallelFor(num_rows, parallel::MIN_WORK_PER_THREAD / mean_row_size,
+        [&](Index begin, Index end, Index chunk) {
+          for (Index row = begin; row < end; ++row) {
+            TReal sum = 0;
+            for (Index nonzero = csr_row_ptr_[row]; nonzero < csr_row_ptr_[row + 1]; ++nonzero) {
+              sum += csr_weights_[nonzero] * src[csr_col_idx_[nonzero]];
+            }
+            tar[row] = sum;
+          }
+        });
+
+      if (is_reordered_) {
+        output_vector = permutation_.transpose() * permuted_tar_;
+      }
+    }
+
+    /*
+     * Replaces network_ by P * network_ * P^T and records where each of the
+     * original nonzeros ended up, so that parameters (which stay in the
+     * original compressed order) can be scattered into the permuted storage.
+     */
+    void ReorderNetwork(graphs::NODE_ORDERING ordering) {
+      const std::vector<graphs::NodeID> order = graphs::ComputeNodeOrdering(network_, ordering);
+      permutation_.resize(network_.rows());
+      for (Index new_id = 0; new_id < order.size(); ++new_id) {
+        permutation_.indices()[order[new_id]] = static_cast<int>(new_id);
+      }
+
+      const Index num_cols = static_cast<Index>(network_.outerSize());
+      std::vector<Eigen::Triplet<TReal>> triplets;
+      triplets.reserve(network_.nonZeros());
+      for (Index col = 0; col < num_cols; ++col) {
+        for (typename SparseMatrix::InnerIterator it(network_, col); it; ++it) {
+          triplets.emplace_back(permutation_.indices()[it.row()],
+                                permutation_.indices()[col], it.value());
+        }
+      }
+      SparseMatrix reordered(network_.rows(), network_.cols());
+      reordered.setFromTriplets(triplets.begin(), triplets.end());
+      reordered.makeCompressed();
+
+      weight_order_.resize(network_.nonZeros());
+      Index nonzero = 0;
+      for (Index col = 0; col < num_cols; ++col) {
+        const int new_col = permutation_.indices()[col];
+        const int* first = reordered.innerIndexPtr() + reordered.outerIndexPtr()[new_col];
+        const int* last = reordered.innerIndexPtr() + reordered.outerIndexPtr()[new_col + 1];
+        for (typename SparseMatrix::InnerIterator it(network_, col); it; ++it) {
+          const int* position = std::lower_bound(first, last,
+                                                 permutation_.indices()[it.row()]);
+          weight_order_[nonzero++] = position - reordered.innerIndexPtr();
+        }
+      }
+
+      network_ = std::move(reordered);
+      packed_weights_ = ColVector::Zero(network_.nonZeros());
+      permuted_src_.resize(network_.cols());
+      permuted_tar_.resize(network_.rows());
+      is_reordered_ = true;
+    }
+
+    void PackWeights(const multi_array::ConstArraySlice<TReal>& parameters,
+                     ColVector& packed_weights) const {
+      packed_weights.resize(weight_order_.size());
+      for (Index iii = 0; iii < weight_order_.size(); ++iii) {
+        packed_weights[weight_order_[iii]] = parameters[iii];
+      }
+    }
+
+    void BatchIntegrateReordered(const ConstMatrixView& input, MatrixView& output,
+                                 const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = output.cols();
+      permuted_batch_src_ = permutation_ * input;
+      permuted_batch_tar_.resize(network_.rows(), batch_size);
+      if (parameters.size() == 1) {
+        PackWeights(parameters[0], batch_packed_weights_);
+        ConstSparseMatrixView weight_matrix(network_.rows(), network_.cols(),
+                                            batch_packed_weights_.size(),
+                                            network_.outerIndexPtr(),
+                                            network_.innerIndexPtr(),
+                                            batch_packed_weights_.data(),
+                                            network_.innerNonZeroPtr());
+        permuted_batch_tar_.noalias() = weight_matrix * permuted_batch_src_;
+      }
+      else {
+        for (Index member = 0; member < batch_size; ++member) {
+          PackWeights(parameters[member], batch_packed_weights_);
+          ConstSparseMatrixView weight_matrix(network_.rows(), network_.cols(),
+                                              batch_packed_weights_.size(),
+                                              network_.outerIndexPtr(),
+                                              network_.innerIndexPtr(),
+                                              batch_packed_weights_.data(),
+                                              network_.innerNonZeroPtr());
+          permuted_batch_tar_.col(member).noalias() = weight_matrix
+                                                      * permuted_batch_src_.col(member);
+        }
+      }
+      output = permutation_.transpose() * permuted_batch_tar_;
+    }
+
     SparseMatrix network_;
     multi_array::ConstArraySlice<TReal> weight_view_;
+    // Only used when a node ordering is applied
+    bool is_reordered_;
+    Permutation permutation_;
+    std::vector<Index> weight_order_;
+    ColVector packed_weights_;
+    ColVector permuted_src_;
+    ColVector permuted_tar_;
+    ColVector batch_packed_weights_;
+    Matrix permuted_batch_src_;
+    Matrix permuted_batch_tar_;
+    // Only used when a thread pool is set
+    std::vector<Index> csr_row_ptr_;
+    std::vector<Index> csr_col_idx_;
+    // position of each CSR nonzero in network_'s storage
+    std::vector<Index> csr_source_;
+    std::vector<TReal> csr_weights_;
 };
 
 /*
@@ -1092,12 +1846,41 @@ class ReservoirEigenIntegrator : public virtual Integrator<TReal> {
     typedef const Eigen::Matrix<TReal, Eigen::Dynamic, 1> ConstColVector;
     typedef const Eigen::Map <ConstColVector> ConstColVectorView;
     typedef Eigen::SparseMatrix <TReal> SparseMatrix;
+    typedef Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Map<Matrix> MatrixView;
+    typedef const Eigen::Matrix<TReal, Eigen::Dynamic, Eigen::Dynamic> ConstMatrix;
+    typedef const Eigen::Map<ConstMatrix> ConstMatrixView;
+
+    typedef Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> Permutation;
 
-    ReservoirEigenIntegrator(SparseMatrix network)
-    : network_(std::move(network)) {
+    /*
+     * As with RecurrentEigenIntegrator, a square reservoir can be stored in a
+     * different node ordering. Its weights are fixed, so they are permuted
+     * once here.
+     */
+    ReservoirEigenIntegrator(SparseMatrix network,
+                             graphs::NODE_ORDERING ordering=graphs::NATURAL_ORDERING)
+    : network_(std::move(network)), is_reordered_(false) {
       network_.makeCompressed();
       super_type::integrator_type_ = RESERVOIR_EIGEN_INTEGRATOR;
       super_type::parameter_count_ = 0;
+      if (ordering != graphs::NATURAL_ORDERING) {
+        if (network_.rows() != network_.cols()) {
+          std::cerr << "rows: " << network_.rows() << " cols: " << network_.cols() << std::endl;
+          throw std::invalid_argument("Node ordering requires a square network");
+        }
+        const std::vector<graphs::NodeID> order = graphs::ComputeNodeOrdering(network_, ordering);
+        permutation_.resize(network_.rows());
+        for (Index new_id = 0; new_id < order.size(); ++new_id) {
+          permutation_.indices()[order[new_id]] = static_cast<int>(new_id);
+        }
+        SparseMatrix reordered = permutation_ * network_ * permutation_.transpose();
+        network_ = std::move(reordered);
+        network_.makeCompressed();
+        permuted_src_.resize(network_.cols());
+        permuted_tar_.resize(network_.rows());
+        is_reordered_ = true;
+      }
     }
 
     ~ReservoirEigenIntegrator()=default;
@@ -1113,9 +1896,37 @@ class ReservoirEigenIntegrator : public virtual Integrator<TReal> {
 
       ColVectorView output_vector(tar_state.data(), tar_state.size());
       ConstColVectorView src_vector(src_state.data(), src_state.size());
+      if (is_reordered_) {
+        permuted_src_ = permutation_ * src_vector;
+        permuted_tar_.noalias() = network_ * permuted_src_;
+        output_vector = permutation_.transpose() * permuted_tar_;
+        return;
+      }
       output_vector.noalias() = network_ * src_vector;
     }
 
+    // Reservoir weights are fixed, so the whole batch is always a single SpMM
+    void BatchIntegrate(const multi_array::Tensor<TReal>& src_states,
+                        multi_array::Tensor<TReal>& tar_states,
+                        const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      const Index batch_size = tar_states.shape()[0];
+      if ((network_.cols() * batch_size != src_states.size())
+          || (network_.rows() * batch_size != tar_states.size())) {
+        throw std::invalid_argument("src states size and tar states size "
+                                    "incompatible with network");
+      }
+
+      MatrixView output(tar_states.data(), network_.rows(), batch_size);
+      ConstMatrixView input(src_states.data(), network_.cols(), batch_size);
+      if (is_reordered_) {
+        permuted_batch_src_ = permutation_ * input;
+        permuted_batch_tar_.noalias() = network_ * permuted_batch_src_;
+        output = permutation_.transpose() * permuted_batch_tar_;
+        return;
+      }
+      output.noalias() = network_ * input;
+    }
+
     void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {}
 
     std::vector<PARAMETER_TYPE> GetParameterLayout() const {
@@ -1128,6 +1939,13 @@ class ReservoirEigenIntegrator : public virtual Integrator<TReal> {
 
   protected:
     SparseMatrix network_;
+    // Only used when a node ordering is applied
+    bool is_reordered_;
+    Permutation permutation_;
+    ColVector permuted_src_;
+    ColVector permuted_tar_;
+    Matrix permuted_batch_src_;
+    Matrix permuted_batch_tar_;
 };
 
 template <typename TReal>
@@ -1155,6 +1973,15 @@ class RewardModulatedAll2AllIntegrator : public All2AllEigenIntegrator<TReal>,
       all2all_type::integrator_type_ = REWARD_MODULATED;
     }
 
+    // The weights change as the integrator learns
+    virtual bool SupportsQuantization() const override {
+      return false;
+    }
+
+    virtual void SetQuantization(QUANTIZATION_MODE mode) override {
+      Integrator<TReal>::SetQuantization(mode);
+    }
+
     void operator()(const multi_array::Tensor<TReal>& src_state,
                     multi_array::Tensor<TReal>& tar_state) override
     {
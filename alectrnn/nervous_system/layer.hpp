@@ -13,6 +13,7 @@
 #include "activator.hpp"
 #include "integrator.hpp"
 #include "../common/multi_array.hpp"
+#include "../common/thread_pool.hpp"
 #include "parameter_types.hpp"
 #include "../random/pcg_random.hpp"
 
@@ -193,6 +194,141 @@ class Layer {
       return self_integrator_;
     }
 
+    /*
+     * Hands the NervousSystem's thread pool to the layer's components
+     */
+    virtual void SetThreadPool(parallel::ThreadPool* thread_pool) {
+      if (back_integrator_ != nullptr) {
+        back_integrator_->SetThreadPool(thread_pool);
+      }
+      if (self_integrator_ != nullptr) {
+        self_integrator_->SetThreadPool(thread_pool);
+      }
+      if (activation_function_ != nullptr) {
+        activation_function_->SetThreadPool(thread_pool);
+      }
+    }
+
+    /*
+     * Sets the quantization of the layer's integrators that support it, the
+     * others keep full precision weights (see Integrator::SetQuantization)
+     */
+    virtual void SetQuantization(QUANTIZATION_MODE mode) {
+      if ((back_integrator_ != nullptr) && back_integrator_->SupportsQuantization()) {
+        back_integrator_->SetQuantization(mode);
+      }
+      if ((self_integrator_ != nullptr) && self_integrator_->SupportsQuantization()) {
+        self_integrator_->SetQuantization(mode);
+      }
+    }
+
+    /*
+     * Moves the layer's state and buffers into arena (see NervousSystem).
+     * Layers with more per-step tensors move those too. Batch tensors stay on
+     * the heap, as they are reallocated whenever the batch size changes.
+     */
+    virtual void MoveStateInto(multi_array::Arena& arena) {
+      layer_state_.MoveInto(arena);
+      input_buffer_.MoveInto(arena);
+    }
+
+    /*
+     * Whether the layer can read a previous layer whose channels are stored
+     * as a ring (see Integrator::SetSourceChannelOffset)
+     */
+    virtual bool SupportsSourceChannelOffset() const {
+      return (back_integrator_ != nullptr)
+             && back_integrator_->SupportsChannelOffset();
+    }
+
+    virtual void SetSourceChannelOffset(Index channel_offset) {
+      if (back_integrator_ != nullptr) {
+        back_integrator_->SetSourceChannelOffset(channel_offset);
+      }
+    }
+
+    /*
+     * Batch mode: the layer holds a [batch, ...] state for a population of
+     * members that share its architecture but may each have their own
+     * parameters. AllocateBatch has to be called before BatchConfigure.
+     */
+    virtual void AllocateBatch(Index batch_size) {
+      std::vector<Index> batch_shape(1, batch_size);
+      batch_shape.insert(batch_shape.end(), layer_state_.shape().begin(),
+                         layer_state_.shape().end());
+      batch_state_ = multi_array::Tensor<TReal>(batch_shape);
+      batch_buffer_ = multi_array::Tensor<TReal>(batch_shape);
+      BatchReset();
+    }
+
+    /*
+     * Receives one parameter slice per member (or a single shared slice) with
+     * parameter_count_ elements each, split in configure order: back->self->act
+     */
+    virtual void BatchConfigure(const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      if ((back_integrator_ != nullptr
+           && back_integrator_->GetIntegratorType() == REWARD_MODULATED)
+          || (self_integrator_ != nullptr
+              && self_integrator_->GetIntegratorType() == REWARD_MODULATED)) {
+        throw std::invalid_argument("Reward modulated integrators do not"
+                                    " support batch mode");
+      }
+
+      const Index back_count = (back_integrator_ == nullptr) ? 0
+                               : back_integrator_->GetParameterCount();
+      const Index self_count = (self_integrator_ == nullptr) ? 0
+                               : self_integrator_->GetParameterCount();
+      back_parameters_.clear();
+      self_parameters_.clear();
+      activator_parameters_.clear();
+      for (const auto& member_parameters : parameters) {
+        if (member_parameters.size() != parameter_count_) {
+          std::cerr << "parameter size: " << member_parameters.size() << std::endl;
+          std::cerr << "parameter count: " << parameter_count_ << std::endl;
+          throw std::invalid_argument("Wrong number of parameters given.");
+        }
+        back_parameters_.push_back(member_parameters.slice(0, back_count));
+        self_parameters_.push_back(member_parameters.slice(
+            member_parameters.stride() * back_count, self_count));
+        activator_parameters_.push_back(member_parameters.slice(
+            member_parameters.stride() * (back_count + self_count),
+            activation_function_->GetParameterCount()));
+      }
+    }
+
+    /*
+     * Batched version of operator(). Reads the previous layer's batch state.
+     */
+    virtual void BatchStep(const Layer<TReal>* prev_layer) {
+      batch_buffer_.Fill(0.0);
+      back_integrator_->BatchIntegrate(prev_layer->batch_state(), batch_buffer_,
+                                       back_parameters_);
+      if (self_integrator_ != nullptr) {
+        self_integrator_->BatchIntegrate(batch_buffer_, batch_buffer_,
+                                         self_parameters_);
+      }
+      activation_function_->BatchActivate(batch_state_, batch_buffer_,
+                                          activator_parameters_);
+    }
+
+    virtual void BatchReset() {
+      batch_state_.Fill(0.0);
+      batch_buffer_.Fill(0.0);
+    }
+
+    template<typename T>
+    void SetBatchNeuronState(Index member, Index neuron, T value) {
+      batch_state_[member * layer_state_.size() + neuron] = value;
+    }
+
+    const multi_array::Tensor<TReal>& batch_state() const {
+      return batch_state_;
+    }
+
+    multi_array::Tensor<TReal>& batch_state() {
+      return batch_state_;
+    }
+
   protected:
     // calculates inputs from other layers and applies them to input buffer
     Integrator<TReal>* back_integrator_;
@@ -207,6 +343,13 @@ class Layer {
     std::vector<Index> shape_;
     // Number of parameters required by layer
     std::size_t parameter_count_;
+    // [batch, ...] versions of layer_state_ and input_buffer_ for batch mode
+    multi_array::Tensor<TReal> batch_state_;
+    multi_array::Tensor<TReal> batch_buffer_;
+    // per member parameters for each component (or a single shared slice)
+    std::vector<multi_array::ConstArraySlice<TReal>> back_parameters_;
+    std::vector<multi_array::ConstArraySlice<TReal>> self_parameters_;
+    std::vector<multi_array::ConstArraySlice<TReal>> activator_parameters_;
 };
 
 template <typename TReal>
@@ -236,6 +379,12 @@ public:
     recurrent_state_buffer_.Fill(0.0);
   }
 
+  virtual void MoveStateInto(multi_array::Arena& arena) override
+  {
+    super_type::MoveStateInto(arena);
+    recurrent_state_buffer_.MoveInto(arena);
+  }
+
   virtual void operator()(const Layer<TReal>* prev_layer) override
   {
     super_type::input_buffer_.Fill(0.0);
@@ -253,8 +402,44 @@ public:
     std::swap(super_type::layer_state_, super_type::input_buffer_);
   }
 
+  virtual void AllocateBatch(Index batch_size) override
+  {
+    std::vector<Index> batch_shape(1, batch_size);
+    batch_shape.insert(batch_shape.end(), super_type::layer_state_.shape().begin(),
+                       super_type::layer_state_.shape().end());
+    batch_recurrent_state_buffer_ = multi_array::Tensor<TReal>(batch_shape);
+    super_type::AllocateBatch(batch_size);
+  }
+
+  virtual void BatchReset() override
+  {
+    super_type::BatchReset();
+    batch_recurrent_state_buffer_.Fill(0.0);
+  }
+
+  virtual void BatchStep(const Layer<TReal>* prev_layer) override
+  {
+    super_type::batch_buffer_.Fill(0.0);
+    super_type::back_integrator_->BatchIntegrate(prev_layer->batch_state(),
+                                                 super_type::batch_buffer_,
+                                                 super_type::back_parameters_);
+    super_type::self_integrator_->BatchIntegrate(super_type::batch_state_,
+                                                 batch_recurrent_state_buffer_,
+                                                 super_type::self_parameters_);
+    ColVectorView state_vector(batch_recurrent_state_buffer_.data(),
+                               batch_recurrent_state_buffer_.size());
+    ConstColVectorView buffer(super_type::batch_buffer_.data(),
+                              super_type::batch_buffer_.size());
+    state_vector += buffer;
+    super_type::activation_function_->BatchActivate(super_type::batch_buffer_,
+                                                    batch_recurrent_state_buffer_,
+                                                    super_type::activator_parameters_);
+    std::swap(super_type::batch_state_, super_type::batch_buffer_);
+  }
+
 protected:
   multi_array::Tensor<TReal> recurrent_state_buffer_;
+  multi_array::Tensor<TReal> batch_recurrent_state_buffer_;
 };
 
 template <typename TReal>
@@ -291,6 +476,23 @@ public:
     feedback_state_.Fill(0.0);
   }
 
+  virtual void MoveStateInto(multi_array::Arena& arena) override {
+    super_type::MoveStateInto(arena);
+    feedback_state_.MoveInto(arena);
+  }
+
+  virtual void SetThreadPool(parallel::ThreadPool* thread_pool) override {
+    super_type::SetThreadPool(thread_pool);
+    feedback_integrator_->SetThreadPool(thread_pool);
+  }
+
+  virtual void SetQuantization(QUANTIZATION_MODE mode) override {
+    super_type::SetQuantization(mode);
+    if (feedback_integrator_->SupportsQuantization()) {
+      feedback_integrator_->SetQuantization(mode);
+    }
+  }
+
   virtual void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {
 
     if (parameters.size() != super_type::parameter_count_) {
@@ -374,9 +576,15 @@ public:
     std::swap(super_type::layer_state_, super_type::input_buffer_);
   }
 
+  // Feedback depends on each member's own motor output and reward
+  virtual void AllocateBatch(Index batch_size) override
+  {
+    throw std::invalid_argument("FeedbackLayer does not support batch mode");
+  }
+
   virtual void update_feedback(TReal reward, const Layer<TReal>* motor_layer)
   {
-    auto motor_state = motor_layer->state();
+    const multi_array::Tensor<TReal>& motor_state = motor_layer->state();
     Index state_size(motor_state.size());
     for (Index i = 0; i < (state_size - 1); ++i)
     {
@@ -445,6 +653,17 @@ class RewardModulatedLayer : public Layer<TReal> {
       reward_average_ = 0.0;
     }
 
+    virtual void MoveStateInto(multi_array::Arena& arena) override {
+      super_type::MoveStateInto(arena);
+      activation_averages_.MoveInto(arena);
+    }
+
+    // Weights are learned online by a single member
+    virtual void AllocateBatch(Index batch_size) override {
+      throw std::invalid_argument("Reward modulated layers do not support"
+                                  " batch mode");
+    }
+
     /*
      * Called after all integrators and activators have been called.
      */
@@ -534,6 +753,11 @@ class NoisyRewardModulatedLayer : public Layer<TReal> {
       reward_average_ = 0.0;
     }
 
+    virtual void MoveStateInto(multi_array::Arena& arena) override {
+      super_type::MoveStateInto(arena);
+      activation_averages_.MoveInto(arena);
+    }
+
     virtual void operator()(const Layer<TReal>* prev_layer) {
       // First clear input buffer
       super_type::input_buffer_.Fill(0.0);
@@ -551,6 +775,12 @@ class NoisyRewardModulatedLayer : public Layer<TReal> {
                                           super_type::input_buffer_);
     }
 
+    // Weights are learned online by a single member
+    virtual void AllocateBatch(Index batch_size) override {
+      throw std::invalid_argument("Reward modulated layers do not support"
+                                  " batch mode");
+    }
+
     /*
      * Called after all integrators and activators have been called.
      */
@@ -634,6 +864,18 @@ class InputLayer : public Layer<TReal> {
 
     virtual void Reset() { super_type::layer_state_.Fill(0.0); }
 
+    virtual void AllocateBatch(Index batch_size) {
+      std::vector<Index> batch_shape(1, batch_size);
+      batch_shape.insert(batch_shape.end(), super_type::layer_state_.shape().begin(),
+                         super_type::layer_state_.shape().end());
+      super_type::batch_state_ = multi_array::Tensor<TReal>(batch_shape);
+      super_type::batch_state_.Fill(0.0);
+    }
+
+    virtual void BatchConfigure(const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {}
+
+    virtual void BatchStep(const Layer<TReal>* prev_layer) {}
+
     virtual std::vector<PARAMETER_TYPE> GetParameterLayout() const {
       return std::vector<PARAMETER_TYPE>(0);
     }
@@ -23,6 +23,10 @@
  * CreateFunction
  * Layer {"back": TYPE, (TUPLE); "self": TYPE, (TUPLE); "act": TYPE, (TUPLE), "shape": (TUPLE)}
  * Motor ("ale": ALE, "in": NUM, "act": TYPE, (TUPLE))
+ *
+ * Built as layer_generator_double when ALECTRNN_DOUBLE is defined (see
+ * precision.hpp). Scalar arguments and float32 arrays are read the same way in
+ * both builds, so a double layer has exactly the constants of its float twin.
  */
 
 #include <Python.h>
@@ -34,11 +38,15 @@
 #include "layer_generator.hpp"
 #include "numpy/arrayobject.h"
 #include "layer.hpp"
+#include "fused_layer.hpp"
 #include "../common/graphs.hpp"
 #include "../common/capi_tools.hpp"
 #include "../common/multi_array.hpp"
 #include "activator.hpp"
 #include "integrator.hpp"
+#include "precision.hpp"
+
+using nervous_system::Real;
 
 /*
  * DeleteLayer can be shared among the Layers as a destructor
@@ -47,7 +55,68 @@
  */
 static void DeleteLayer(PyObject *layer_capsule) {
   // delete (nervous_system::Layer *)PyCapsule_GetPointer(
-  //       layer_capsule, "layer_generator.layer");
+  //       layer_capsule, nervous_system::LAYER_CAPSULE_NAME);
+}
+
+/*
+ * Builds a Layer, or the matching FusedLayer if the combination of components
+ * has one. Ownership of the components is transfered to the new layer.
+ */
+static nervous_system::Layer<Real>* NewLayer(
+    const std::vector<std::size_t>& layer_shape,
+    nervous_system::Integrator<Real>* back_integrator,
+    nervous_system::Integrator<Real>* self_integrator,
+    nervous_system::Activator<Real>* activator) {
+
+  if (back_integrator->GetIntegratorType() == nervous_system::CONV_EIGEN_INTEGRATOR
+      && self_integrator->GetIntegratorType() == nervous_system::NONE_INTEGRATOR
+      && activator->GetActivatorType() == nervous_system::RELU_ACTIVATOR) {
+    return new nervous_system::FusedLayer<Real,
+        nervous_system::ConvEigenIntegrator, nervous_system::NoneIntegrator,
+        nervous_system::ReLuActivator>(layer_shape,
+        dynamic_cast<nervous_system::ConvEigenIntegrator<Real>*>(back_integrator),
+        dynamic_cast<nervous_system::NoneIntegrator<Real>*>(self_integrator),
+        dynamic_cast<nervous_system::ReLuActivator<Real>*>(activator));
+  }
+  else if (back_integrator->GetIntegratorType() == nervous_system::ALL2ALL_EIGEN_INTEGRATOR
+      && self_integrator->GetIntegratorType() == nervous_system::NONE_INTEGRATOR
+      && activator->GetActivatorType() == nervous_system::SIGMOID_ACTIVATOR) {
+    return new nervous_system::FusedLayer<Real,
+        nervous_system::All2AllEigenIntegrator, nervous_system::NoneIntegrator,
+        nervous_system::SigmoidActivator>(layer_shape,
+        dynamic_cast<nervous_system::All2AllEigenIntegrator<Real>*>(back_integrator),
+        dynamic_cast<nervous_system::NoneIntegrator<Real>*>(self_integrator),
+        dynamic_cast<nervous_system::SigmoidActivator<Real>*>(activator));
+  }
+
+  return new nervous_system::Layer<Real>(
+    layer_shape, back_integrator, self_integrator, activator);
+}
+
+/*
+ * Recurrent counterpart of NewLayer
+ */
+static nervous_system::Layer<Real>* NewRecurrentLayer(
+    const std::vector<std::size_t>& layer_shape,
+    nervous_system::Integrator<Real>* back_integrator,
+    nervous_system::Integrator<Real>* self_integrator,
+    nervous_system::Activator<Real>* activator) {
+
+  if (back_integrator->GetIntegratorType() == nervous_system::RECURRENT_EIGEN_INTEGRATOR
+      && self_integrator->GetIntegratorType() == nervous_system::RECURRENT_EIGEN_INTEGRATOR
+      && (activator->GetActivatorType() == nervous_system::CTRNN_ACTIVATOR
+          || activator->GetActivatorType() == nervous_system::RESERVOIR_CTRNN_ACTIVATOR)) {
+    return new nervous_system::FusedLayer<Real,
+        nervous_system::RecurrentEigenIntegrator,
+        nervous_system::RecurrentEigenIntegrator,
+        nervous_system::CTRNNActivator>(layer_shape,
+        dynamic_cast<nervous_system::RecurrentEigenIntegrator<Real>*>(back_integrator),
+        dynamic_cast<nervous_system::RecurrentEigenIntegrator<Real>*>(self_integrator),
+        dynamic_cast<nervous_system::CTRNNActivator<Real>*>(activator));
+  }
+
+  return new nervous_system::RecurrentLayer<Real>(
+    layer_shape, back_integrator, self_integrator, activator);
 }
 
 /*
@@ -76,19 +145,19 @@ static PyObject *CreateLayer(PyObject *self, PyObject *args, PyObject *kwargs) {
 
   // Call parsers -> they create NEW integrators and activators
   std::vector<std::size_t> layer_shape = alectrnn::uInt64PyArrayToVector<std::size_t>(shape);
-  nervous_system::Integrator<float>* back_integrator = IntegratorParser(
+  nervous_system::Integrator<Real>* back_integrator = IntegratorParser(
     (nervous_system::INTEGRATOR_TYPE) back_integrator_type, back_integrator_args);
-  nervous_system::Integrator<float>* self_integrator = IntegratorParser(
+  nervous_system::Integrator<Real>* self_integrator = IntegratorParser(
     (nervous_system::INTEGRATOR_TYPE) self_integrator_type, self_integrator_args);
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
     (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
   // Ownership is transfered to new layer
-  nervous_system::Layer<float>* layer = new nervous_system::Layer<float>(
+  nervous_system::Layer<Real>* layer = NewLayer(
     layer_shape, back_integrator, self_integrator, activator);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                "layer_generator.layer", DeleteLayer);
+                                nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -115,19 +184,19 @@ static PyObject *CreateRecurrentLayer(PyObject *self, PyObject *args, PyObject *
 
   // Call parsers -> they create NEW integrators and activators
   std::vector<std::size_t> layer_shape = alectrnn::uInt64PyArrayToVector<std::size_t>(shape);
-  nervous_system::Integrator<float>* back_integrator = IntegratorParser(
+  nervous_system::Integrator<Real>* back_integrator = IntegratorParser(
     (nervous_system::INTEGRATOR_TYPE) back_integrator_type, back_integrator_args);
-  nervous_system::Integrator<float>* self_integrator = IntegratorParser(
+  nervous_system::Integrator<Real>* self_integrator = IntegratorParser(
     (nervous_system::INTEGRATOR_TYPE) self_integrator_type, self_integrator_args);
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
     (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
   // Ownership is transfered to new layer
-  nervous_system::Layer<float>* layer = new nervous_system::RecurrentLayer<float>(
+  nervous_system::Layer<Real>* layer = NewRecurrentLayer(
     layer_shape, back_integrator, self_integrator, activator);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                "layer_generator.layer", DeleteLayer);
+                                nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -160,22 +229,22 @@ static PyObject *CreateFeedbackLayer(PyObject *self, PyObject *args, PyObject *k
 
   // Call parsers -> they create NEW integrators and activators
   std::vector<std::size_t> layer_shape = alectrnn::uInt64PyArrayToVector<std::size_t>(shape);
-  nervous_system::Integrator<float>* back_integrator = IntegratorParser(
+  nervous_system::Integrator<Real>* back_integrator = IntegratorParser(
     (nervous_system::INTEGRATOR_TYPE) back_integrator_type, back_integrator_args);
-  nervous_system::Integrator<float>* self_integrator = IntegratorParser(
+  nervous_system::Integrator<Real>* self_integrator = IntegratorParser(
     (nervous_system::INTEGRATOR_TYPE) self_integrator_type, self_integrator_args);
-  nervous_system::Integrator<float>* feedback_integrator = IntegratorParser(
+  nervous_system::Integrator<Real>* feedback_integrator = IntegratorParser(
     (nervous_system::INTEGRATOR_TYPE) feedback_integrator_type, feedback_integrator_args);
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
     (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
   // Ownership is transfered to new layer
-  nervous_system::Layer<float>* layer = new nervous_system::FeedbackLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::FeedbackLayer<Real>(
     layer_shape, back_integrator, self_integrator, activator,
     motor_size, feedback_integrator);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                "layer_generator.layer", DeleteLayer);
+                                nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -212,24 +281,24 @@ static PyObject *CreateRewardModulatedLayer(PyObject *self, PyObject *args,
   // Call parsers -> they create NEW integrators and activators
   std::vector<std::size_t> layer_shape = alectrnn::uInt64PyArrayToVector<std::size_t>(shape);
 
-  nervous_system::Integrator<float>* back_integrator =
+  nervous_system::Integrator<Real>* back_integrator =
       IntegratorParser((nervous_system::INTEGRATOR_TYPE) back_integrator_type,
                        back_integrator_args);
 
-  nervous_system::Integrator<float>* self_integrator =
+  nervous_system::Integrator<Real>* self_integrator =
       IntegratorParser((nervous_system::INTEGRATOR_TYPE) self_integrator_type,
                        self_integrator_args);
 
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
       (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
   // Ownership is transferred to new layer
-  nervous_system::Layer<float>* layer = new nervous_system::RewardModulatedLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::RewardModulatedLayer<Real>(
       layer_shape, back_integrator, self_integrator, activator, reward_smoothing_factor,
       activation_smoothing_factor);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                          "layer_generator.layer", DeleteLayer);
+                                          nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -272,24 +341,24 @@ static PyObject *CreateNoisyRewardModulatedLayer(PyObject *self, PyObject *args,
   // Call parsers -> they create NEW integrators and activators
   std::vector<std::size_t> layer_shape = alectrnn::uInt64PyArrayToVector<std::size_t>(shape);
 
-  nervous_system::Integrator<float>* back_integrator =
+  nervous_system::Integrator<Real>* back_integrator =
     IntegratorParser((nervous_system::INTEGRATOR_TYPE) back_integrator_type,
                    back_integrator_args);
 
-  nervous_system::Integrator<float>* self_integrator =
+  nervous_system::Integrator<Real>* self_integrator =
     IntegratorParser((nervous_system::INTEGRATOR_TYPE) self_integrator_type,
                    self_integrator_args);
 
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
     (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
   // Ownership is transferred to new layer
-  nervous_system::Layer<float>* layer = new nervous_system::NoisyRewardModulatedLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::NoisyRewardModulatedLayer<Real>(
     layer_shape, back_integrator, self_integrator, activator, reward_smoothing_factor,
     activation_smoothing_factor, standard_deviation, seed);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                          "layer_generator.layer", DeleteLayer);
+                                          nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -308,14 +377,14 @@ static PyObject *CreateMotorLayer(PyObject *self, PyObject *args, PyObject *kwar
     return NULL;
   }
 
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
     (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
-  nervous_system::Layer<float>* layer = new nervous_system::MotorLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::MotorLayer<Real>(
     num_outputs, num_inputs, activator);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                "layer_generator.layer", DeleteLayer);
+                                nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -346,15 +415,15 @@ static PyObject *CreateRewardModulatedMotorLayer(PyObject *self, PyObject *args,
     return NULL;
   }
 
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
       (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
-  nervous_system::Layer<float>* layer = new nervous_system::RewardModulatedMotorLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::RewardModulatedMotorLayer<Real>(
       num_outputs, num_inputs, activator, reward_smoothing_factor,
       activation_smoothing_factor, learning_rate);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                          "layer_generator.layer", DeleteLayer);
+                                          nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -392,15 +461,15 @@ static PyObject *CreateNoisyRewardModulatedMotorLayer(PyObject *self, PyObject *
     return NULL;
   }
 
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
   (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
-  nervous_system::Layer<float>* layer = new nervous_system::NoisyRewardModulatedMotorLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::NoisyRewardModulatedMotorLayer<Real>(
     num_outputs, num_inputs, activator, reward_smoothing_factor, standard_deviation, seed,
     activation_smoothing_factor, learning_rate);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                          "layer_generator.layer", DeleteLayer);
+                                          nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -420,14 +489,14 @@ static PyObject *CreateEigenMotorLayer(PyObject *self, PyObject *args, PyObject
     return NULL;
   }
 
-  nervous_system::Activator<float>* activator = ActivatorParser(
+  nervous_system::Activator<Real>* activator = ActivatorParser(
       (nervous_system::ACTIVATOR_TYPE) activator_type, activator_args);
 
-  nervous_system::Layer<float>* layer = new nervous_system::EigenMotorLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::EigenMotorLayer<Real>(
       num_outputs, num_inputs, activator);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                          "layer_generator.layer", DeleteLayer);
+                                          nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
@@ -445,15 +514,15 @@ static PyObject *CreateSoftMaxMotorLayer(PyObject *self, PyObject *args, PyObjec
     return NULL;
   }
 
-  nervous_system::Layer<float>* layer = new nervous_system::SoftMaxMotorLayer<float>(
+  nervous_system::Layer<Real>* layer = new nervous_system::SoftMaxMotorLayer<Real>(
     num_outputs, num_inputs, temperature);
 
   PyObject* layer_capsule = PyCapsule_New(static_cast<void*>(layer),
-                                          "layer_generator.layer", DeleteLayer);
+                                          nervous_system::LAYER_CAPSULE_NAME, DeleteLayer);
   return layer_capsule;
 }
 
-nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE type, PyObject* args) {
+nervous_system::Activator<Real>* ActivatorParser(nervous_system::ACTIVATOR_TYPE type, PyObject* args) {
   /*
    * CONV activators should take a shape argument
    * Non-conv activators should take a # states argument
@@ -462,10 +531,10 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
    * shared.
    */
 
-  nervous_system::Activator<float>* new_activator;
+  nervous_system::Activator<Real>* new_activator;
   switch(type) {
     case nervous_system::IDENTITY_ACTIVATOR: {
-      new_activator = new nervous_system::IdentityActivator<float>();
+      new_activator = new nervous_system::IdentityActivator<Real>();
       break;
     }
 
@@ -476,7 +545,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
         std::cerr << "Error parsing Activator arguments" << std::endl;
         throw std::invalid_argument("CTRNN_Activator couldn't parse tuple");
       }
-      new_activator = new nervous_system::CTRNNActivator<float>(num_states, step_size);
+      new_activator = new nervous_system::CTRNNActivator<Real>(num_states, step_size);
       break;
     }
 
@@ -495,7 +564,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " CONV CTRNN ACTIVATOR (needs 3)");
       }
 
-      new_activator = new nervous_system::Conv3DCTRNNActivator<float>(
+      new_activator = new nervous_system::Conv3DCTRNNActivator<Real>(
         multi_array::Array<std::size_t,3>(alectrnn::uInt64PyArrayToCArray(
         shape)), step_size);
       break;
@@ -512,7 +581,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
         throw std::invalid_argument("IAF Activator couldn't parse tuple");
       }
 
-      new_activator = new nervous_system::IafActivator<float>(
+      new_activator = new nervous_system::IafActivator<Real>(
         num_states, step_size, peak, reset);
       break;
     }
@@ -535,7 +604,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " CONV IAF ACTIVATOR (needs 3)");
       }
 
-      new_activator = new nervous_system::Conv3DIafActivator<float>(
+      new_activator = new nervous_system::Conv3DIafActivator<Real>(
         multi_array::Array<std::size_t,3>(alectrnn::uInt64PyArrayToCArray(
         shape)), step_size, peak, reset);
       break;
@@ -552,9 +621,9 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
         throw std::invalid_argument("RESERVOIR_CTRNN_ACTIVATOR couldn't parse tuple");
       }
 
-      new_activator = new nervous_system::CTRNNActivator<float>(
-          num_states, step_size, alectrnn::float32PyArrayToVector<float>(biases),
-          alectrnn::float32PyArrayToVector<float>(rtaus));
+      new_activator = new nervous_system::CTRNNActivator<Real>(
+          num_states, step_size, alectrnn::float32PyArrayToVector<Real>(biases),
+          alectrnn::float32PyArrayToVector<Real>(rtaus));
       break;
     }
 
@@ -574,12 +643,12 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
         throw std::invalid_argument("RESERVOIR_IAF_ACTIVATOR couldn't parse tuple");
       }
 
-      new_activator = new nervous_system::IafActivator<float>(
+      new_activator = new nervous_system::IafActivator<Real>(
           num_states, step_size, peak, reset,
-          alectrnn::float32PyArrayToVector<float>(range),
-          alectrnn::float32PyArrayToVector<float>(rtaus),
-          alectrnn::float32PyArrayToVector<float>(refractory),
-          alectrnn::float32PyArrayToVector<float>(resistance));
+          alectrnn::float32PyArrayToVector<Real>(range),
+          alectrnn::float32PyArrayToVector<Real>(rtaus),
+          alectrnn::float32PyArrayToVector<Real>(refractory),
+          alectrnn::float32PyArrayToVector<Real>(resistance));
       break;
     }
 
@@ -598,7 +667,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " TANH_ACTIVATOR (needs 3 when shared)");
       }
 
-      new_activator = new nervous_system::TanhActivator<float>(
+      new_activator = new nervous_system::TanhActivator<Real>(
           alectrnn::uInt64PyArrayToVector<std::size_t>(shape),
           static_cast<bool>(is_shared));
       break;
@@ -620,7 +689,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " SIGMOID_ACTIVATOR (needs 3 when shared)");
       }
 
-      new_activator = new nervous_system::SigmoidActivator<float>(
+      new_activator = new nervous_system::SigmoidActivator<Real>(
           alectrnn::uInt64PyArrayToVector<std::size_t>(shape),
           static_cast<bool>(is_shared), saturation_point);
       break;
@@ -645,7 +714,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " NOISY_SIGMOID_ACTIVATOR (needs 3 when shared)");
       }
 
-      new_activator = new nervous_system::NoisySigmoidActivator<float>(
+      new_activator = new nervous_system::NoisySigmoidActivator<Real>(
           alectrnn::uInt64PyArrayToVector<std::size_t>(shape),
           static_cast<bool>(is_shared), saturation_point,
           standard_deviation, static_cast<std::uint64_t>(seed));
@@ -667,7 +736,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " RELU_ACTIVATOR (needs 3 when shared)");
       }
 
-      new_activator = new nervous_system::ReLuActivator<float>(
+      new_activator = new nervous_system::ReLuActivator<Real>(
           alectrnn::uInt64PyArrayToVector<std::size_t>(shape),
           static_cast<bool>(is_shared));
       break;
@@ -691,7 +760,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " NOISY_RELU_ACTIVATOR (needs 3 when shared)");
       }
 
-      new_activator = new nervous_system::NoisyReLuActivator<float>(
+      new_activator = new nervous_system::NoisyReLuActivator<Real>(
           alectrnn::uInt64PyArrayToVector<std::size_t>(shape),
           static_cast<bool>(is_shared), standard_deviation,
           static_cast<std::uint64_t>(seed));
@@ -714,7 +783,7 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
                                     " BOUNDED RELU_ACTIVATOR (needs 3 when shared)");
       }
 
-      new_activator = new nervous_system::BoundedReLuActivator<float>(
+      new_activator = new nervous_system::BoundedReLuActivator<Real>(
           alectrnn::uInt64PyArrayToVector<std::size_t>(shape),
           static_cast<bool>(is_shared), bound);
       break;
@@ -729,12 +798,12 @@ nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE
   return new_activator;
 }
 
-nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_TYPE type, PyObject* args) {
+nervous_system::Integrator<Real>* IntegratorParser(nervous_system::INTEGRATOR_TYPE type, PyObject* args) {
 
-  nervous_system::Integrator<float>* new_integrator;
+  nervous_system::Integrator<Real>* new_integrator;
   switch(type) {
     case nervous_system::NONE_INTEGRATOR: {
-      new_integrator = new nervous_system::NoneIntegrator<float>();
+      new_integrator = new nervous_system::NoneIntegrator<Real>();
       break;
     }
 
@@ -746,7 +815,7 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("ALL2ALL Integrator failed to parse"
                                     " tuples");
       }
-      new_integrator = new nervous_system::All2AllIntegrator<float>(
+      new_integrator = new nervous_system::All2AllIntegrator<Real>(
         num_states, num_prev_states);
       break;
     }
@@ -779,7 +848,7 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("prev layer has wrong number of elements (needs 3)");
       }
 
-      new_integrator = new nervous_system::Conv2DIntegrator<float>(
+      new_integrator = new nervous_system::Conv2DIntegrator<Real>(
         multi_array::Array<std::size_t,3>(
         alectrnn::uInt64PyArrayToCArray(filter_shape)),
         multi_array::Array<std::size_t,3>(
@@ -810,7 +879,7 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("edge list is the wrong size");
       }
 
-      new_integrator = new nervous_system::RecurrentIntegrator<float>(
+      new_integrator = new nervous_system::RecurrentIntegrator<Real>(
         graphs::ConvertEdgeListToPredecessorGraph(
           alectrnn::PyArrayToSharedMultiArray<std::uint64_t,2>(edge_list)));
       break;
@@ -849,10 +918,13 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("Need same number of weights as edges");
       }
 
-      new_integrator = new nervous_system::ReservoirIntegrator<float>(
+      // The graph copies the weights
+      std::vector<Real> weight_vector = alectrnn::float32PyArrayToVector<Real>(weights);
+      new_integrator = new nervous_system::ReservoirIntegrator<Real>(
         graphs::ConvertEdgeListToPredecessorGraph(
           alectrnn::PyArrayToSharedMultiArray<std::uint64_t,2>(edge_list),
-        alectrnn::PyArrayToSharedMultiArray<float,1>(weights)));
+        multi_array::SharedMultiArray<Real,1>(weight_vector.data(),
+                                              {weight_vector.size()})));
       break;
     }
 
@@ -884,7 +956,7 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("edge list is the wrong size");
       }
 
-      new_integrator = new nervous_system::TruncatedRecurrentIntegrator<float>(
+      new_integrator = new nervous_system::TruncatedRecurrentIntegrator<Real>(
         graphs::ConvertEdgeListToPredecessorGraph(
           alectrnn::PyArrayToSharedMultiArray<std::uint64_t,2>(edge_list)),
         weight_threshold);
@@ -896,8 +968,9 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
       PyArrayObject* layer_shape;
       PyArrayObject* prev_layer_shape;
       int stride;
-      if (!PyArg_ParseTuple(args, "OOOi", &filter_shape,
-                            &layer_shape, &prev_layer_shape, &stride)) {
+      int algorithm = nervous_system::IM2COL_CONV; // optional conv algorithm
+      if (!PyArg_ParseTuple(args, "OOOi|i", &filter_shape,
+                            &layer_shape, &prev_layer_shape, &stride, &algorithm)) {
         std::cerr << "Error parsing Integrator arguments" << std::endl;
         throw std::invalid_argument("CONV_EIGEN_INTEGRATOR failed to parse tuples");
       }
@@ -919,14 +992,14 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("prev layer has wrong number of elements (needs 3)");
       }
 
-      new_integrator = new nervous_system::ConvEigenIntegrator<float>(
+      new_integrator = new nervous_system::ConvEigenIntegrator<Real>(
         multi_array::Array<std::size_t,3>(
         alectrnn::uInt64PyArrayToCArray(filter_shape)),
         multi_array::Array<std::size_t,3>(
         alectrnn::uInt64PyArrayToCArray(layer_shape)),
         multi_array::Array<std::size_t,3>(
         alectrnn::uInt64PyArrayToCArray(prev_layer_shape)),
-        stride);
+        stride, static_cast<nervous_system::CONV_ALGORITHM>(algorithm));
       break;
     }
 
@@ -938,7 +1011,7 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("ALL2ALL Eigen Integrator failed to parse"
                                     " tuples");
       }
-      new_integrator = new nervous_system::All2AllEigenIntegrator<float>(
+      new_integrator = new nervous_system::All2AllEigenIntegrator<Real>(
         num_states, num_prev_states);
       break;
     }
@@ -947,7 +1020,9 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
       PyArrayObject* edge_list; // Nx2 dimensional array
       int num_head_states; // states
       int num_tail_states; // states or tail states
-      if (!PyArg_ParseTuple(args, "Oii", &edge_list, &num_head_states, &num_tail_states)) {
+      int ordering = graphs::NATURAL_ORDERING; // optional node ordering
+      if (!PyArg_ParseTuple(args, "Oii|i", &edge_list, &num_head_states,
+                            &num_tail_states, &ordering)) {
         std::cerr << "Error parsing Integrator arguments" << std::endl;
         throw std::invalid_argument("RECCURENT EIGEN INTEGRATOR ERROR");
       }
@@ -965,10 +1040,11 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("edge list is the wrong size");
       }
 
-      new_integrator = new nervous_system::RecurrentEigenIntegrator<float>(
-        graphs::ConvertEdgeListToSparseMatrix<float>(
+      new_integrator = new nervous_system::RecurrentEigenIntegrator<Real>(
+        graphs::ConvertEdgeListToSparseMatrix<Real>(
           alectrnn::PyArrayToSharedMultiArray<std::uint64_t,2>(edge_list),
-          num_tail_states, num_head_states));
+          num_tail_states, num_head_states),
+        static_cast<graphs::NODE_ORDERING>(ordering));
       break;
     }
 
@@ -977,8 +1053,9 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
       int num_head_states; //states
       int num_tail_states; // states or tail states
       PyArrayObject* weights; // N element array
-      if (!PyArg_ParseTuple(args, "OiiO", &edge_list, &num_head_states,
-                            &num_tail_states, &weights)) {
+      int ordering = graphs::NATURAL_ORDERING; // optional node ordering
+      if (!PyArg_ParseTuple(args, "OiiO|i", &edge_list, &num_head_states,
+                            &num_tail_states, &weights, &ordering)) {
         std::cerr << "Error parsing Integrator arguments" << std::endl;
         throw std::invalid_argument("FAILURE IN RESERVOIR EIGEN INTEGRATOR");
       }
@@ -1008,11 +1085,15 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("Need same number of weights as edges");
       }
 
-      new_integrator = new nervous_system::ReservoirEigenIntegrator<float>(
+      // The matrix copies the weights
+      std::vector<Real> weight_vector = alectrnn::float32PyArrayToVector<Real>(weights);
+      new_integrator = new nervous_system::ReservoirEigenIntegrator<Real>(
       graphs::ConvertEdgeListToSparseMatrix(
         alectrnn::PyArrayToSharedMultiArray<std::uint64_t,2>(edge_list),
         num_tail_states, num_head_states,
-        alectrnn::PyArrayToSharedMultiArray<float,1>(weights)));
+        multi_array::SharedMultiArray<Real,1>(weight_vector.data(),
+                                              {weight_vector.size()})),
+        static_cast<graphs::NODE_ORDERING>(ordering));
       break;
     }
 
@@ -1026,7 +1107,7 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("Reward modulated ALL2ALL Integrator failed to parse"
                                     " tuples");
       }
-      new_integrator = new nervous_system::RewardModulatedAll2AllIntegrator<float>(num_states,
+      new_integrator = new nervous_system::RewardModulatedAll2AllIntegrator<Real>(num_states,
                                                                                    num_prev_states,
                                                                                    learning_rate);
       break;
@@ -1056,8 +1137,8 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("edge list is the wrong size");
       }
 
-      new_integrator = new nervous_system::RewardModulatedRecurrentIntegrator<float>(
-          graphs::ConvertEdgeListToSparseMatrix<float>(
+      new_integrator = new nervous_system::RewardModulatedRecurrentIntegrator<Real>(
+          graphs::ConvertEdgeListToSparseMatrix<Real>(
           alectrnn::PyArrayToSharedMultiArray<std::uint64_t,2>(edge_list),
           num_tail_states, num_head_states), learning_rate);
       break;
@@ -1093,7 +1174,7 @@ nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_T
         throw std::invalid_argument("prev layer has wrong number of elements (needs 3)");
       }
 
-      new_integrator = new nervous_system::RewardModulatedConvIntegrator<float>(
+      new_integrator = new nervous_system::RewardModulatedConvIntegrator<Real>(
           multi_array::Array<std::size_t,3>(
           alectrnn::uInt64PyArrayToCArray(filter_shape)),
           multi_array::Array<std::size_t,3>(
@@ -1151,6 +1232,23 @@ static PyMethodDef LayerMethods[] = {
   { NULL, NULL, 0, NULL}
 };
 
+#ifdef ALECTRNN_DOUBLE
+
+static struct PyModuleDef LayerModule = {
+  PyModuleDef_HEAD_INIT,
+  "layer_generator_double",
+  "Returns a handle to a double precision Layer",
+  -1,
+  LayerMethods
+};
+
+PyMODINIT_FUNC PyInit_layer_generator_double(void) {
+  import_array();
+  return PyModule_Create(&LayerModule);
+}
+
+#else
+
 static struct PyModuleDef LayerModule = {
   PyModuleDef_HEAD_INIT,
   "layer_generator",
@@ -1163,3 +1261,5 @@ PyMODINIT_FUNC PyInit_layer_generator(void) {
   import_array();
   return PyModule_Create(&LayerModule);
 }
+
+#endif
@@ -5,9 +5,14 @@
 #include <Python.h>
 #include "activator.hpp"
 #include "integrator.hpp"
+#include "precision.hpp"
 
-nervous_system::Activator<float>* ActivatorParser(nervous_system::ACTIVATOR_TYPE type, PyObject* args);
-nervous_system::Integrator<float>* IntegratorParser(nervous_system::INTEGRATOR_TYPE type, PyObject* args);
+nervous_system::Activator<nervous_system::Real>* ActivatorParser(nervous_system::ACTIVATOR_TYPE type, PyObject* args);
+nervous_system::Integrator<nervous_system::Real>* IntegratorParser(nervous_system::INTEGRATOR_TYPE type, PyObject* args);
+#ifdef ALECTRNN_DOUBLE
+PyMODINIT_FUNC PyInit_layer_generator_double(void);
+#else
 PyMODINIT_FUNC PyInit_layer_generator(void);
+#endif
 
 #endif /* LAYER_GENERATOR_H_ */
@@ -0,0 +1,9 @@
+/*
+ * layer_generator_double.cpp
+ *
+ * Builds layer_generator.cpp as the layer_generator_double module, which
+ * makes layers for double networks (see precision.hpp).
+ */
+
+#define ALECTRNN_DOUBLE
+#include "layer_generator.cpp"
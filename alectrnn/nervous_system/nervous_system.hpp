@@ -5,23 +5,37 @@
 #include <cstddef>
 #include <stdexcept>
 #include <vector>
+#include <memory>
 #include <initializer_list>
+#include <algorithm>
+#include <iostream>
 #include "layer.hpp"
 #include "../common/multi_array.hpp"
+#include "../common/thread_pool.hpp"
+#include "../common/arena.hpp"
+#include "../common/allocation_counter.hpp"
 #include "parameter_types.hpp"
+#include "quantization.hpp"
 
 namespace nervous_system {
 
 /*
- * NervousSystem takes ownership of the layers it is given.
+ * NervousSystem takes ownership of the layers it is given. Their states and
+ * buffers are moved into the network's arena, so the data a step touches is
+ * contiguous and aligned.
  */
 template<typename TReal>
 class NervousSystem {
   public:
     typedef std::size_t Index ;
 
-    NervousSystem(const std::vector<Index>& input_shape) : parameter_count_(0) {
+    NervousSystem(const std::vector<Index>& input_shape) : parameter_count_(0),
+                                                           batch_size_(0),
+                                                           input_channel_offset_(0),
+                                                           step_allocations_(0),
+                                                           quantization_(NO_QUANTIZATION) {
       network_layers_.push_back(new InputLayer<TReal>(input_shape));
+      network_layers_.back()->MoveStateInto(arena_);
     }
 
     // If NervousSystem is owner, it needs this destructor
@@ -32,15 +46,31 @@ class NervousSystem {
     }
 
     void Step() {
+      const std::size_t num_allocations = debug::NumAllocations();
       for (Index iii = 1; iii < network_layers_.size(); ++iii) {
         (*network_layers_[iii])(network_layers_[iii-1]);
       }
+      step_allocations_ = debug::NumAllocations() - num_allocations;
+    }
+
+    /*
+     * # of heap allocations made during the last Step() or BatchStep(). Only
+     * counted in builds with ALECTRNN_COUNT_ALLOCATIONS (see
+     * allocation_counter.hpp), 0 otherwise.
+     */
+    std::size_t GetStepAllocations() const {
+      return step_allocations_;
+    }
+
+    const multi_array::Arena& GetArena() const {
+      return arena_;
     }
 
     void Reset() {
       for (auto iter = network_layers_.begin(); iter != network_layers_.end(); ++iter) {
         (*iter)->Reset();
       }
+      SetInputChannelOffset(0);
     }
 
     void Configure(const multi_array::ConstArraySlice<TReal>& parameters) {
@@ -62,10 +92,85 @@ class NervousSystem {
      */
     template<typename T>
     void SetInput(const std::vector<T>& inputs) {
-      for (Index iii = 0; iii < network_layers_[0]->NumNeurons(); iii++)
-      {
-        network_layers_[0]->SetNeuronState(iii, inputs[iii]);
+      SetInput(inputs.data());
+    }
+
+    /*
+     * Reads one input per input neuron from a contiguous array
+     */
+    template<typename T>
+    void SetInput(const T* inputs) {
+      multi_array::Tensor<TReal>& input_state = network_layers_[0]->state();
+      std::copy(inputs, inputs + input_state.size(), input_state.data());
+      SetInputChannelOffset(0);
+    }
+
+    /*
+     * Makes room for a new most recent frame in the input's temporal channels
+     * (the leading dimension of the input, oldest channel first) and returns
+     * where to write it, so a frame can be preprocessed straight into the
+     * input layer.
+     * If the first layer can read a rotated source, the channels are kept as
+     * a ring: the oldest channel is overwritten in place and the ring offset
+     * advances, so K channels of history cost one frame write per step.
+     * Otherwise the older channels are shifted down one and the last channel
+     * is returned.
+     * With a ring, GetLayerState(0) is stored rotated by
+     * GetInputChannelOffset() channels.
+     */
+    TReal* AdvanceInputChannel() {
+      multi_array::Tensor<TReal>& input_state = network_layers_[0]->state();
+      const Index num_channels = input_state.shape()[0];
+      const Index channel_size = input_state.size() / num_channels;
+      if ((network_layers_.size() > 1)
+          && network_layers_[1]->SupportsSourceChannelOffset()) {
+        // The oldest channel sits at the ring offset
+        TReal* channel_begin = input_state.data()
+                               + input_channel_offset_ * channel_size;
+        SetInputChannelOffset((input_channel_offset_ + 1) % num_channels);
+        return channel_begin;
       }
+      std::copy(input_state.data() + channel_size,
+                input_state.data() + input_state.size(),
+                input_state.data());
+      return input_state.data() + (num_channels - 1) * channel_size;
+    }
+
+    /*
+     * Copies a new most recent frame into the input (see AdvanceInputChannel)
+     */
+    template<typename T>
+    void PushInputChannel(const std::vector<T>& channel_inputs) {
+      const multi_array::Tensor<TReal>& input_state = network_layers_[0]->state();
+      const Index channel_size = input_state.size() / input_state.shape()[0];
+      if (channel_inputs.size() != channel_size) {
+        std::cerr << "channel size: " << channel_size << std::endl;
+        std::cerr << "# inputs: " << channel_inputs.size() << std::endl;
+        throw std::invalid_argument("NervousSystem input channel has the "
+                                    "wrong number of elements");
+      }
+      std::copy(channel_inputs.begin(), channel_inputs.end(),
+                AdvanceInputChannel());
+    }
+
+    /*
+     * Copies the input state into destination with its channels in logical
+     * (oldest first) order, undoing the ring rotation
+     */
+    void CopyInputState(TReal* destination) const {
+      const multi_array::Tensor<TReal>& input_state = network_layers_[0]->state();
+      const TReal* begin = input_state.data();
+      const TReal* oldest = begin + input_channel_offset_
+          * (input_state.size() / input_state.shape()[0]);
+      destination = std::copy(oldest, begin + input_state.size(), destination);
+      std::copy(begin, oldest, destination);
+    }
+
+    /*
+     * Physical channel of the input layer that holds its oldest channel
+     */
+    Index GetInputChannelOffset() const {
+      return input_channel_offset_;
     }
 
     /*
@@ -87,7 +192,62 @@ class NervousSystem {
      * the parameter count */
     void AddLayer(Layer<TReal>* layer) {
       network_layers_.push_back(layer);
+      layer->MoveStateInto(arena_);
       parameter_count_ += layer->GetParameterCount();
+      layer->SetThreadPool(thread_pool_.get());
+      layer->SetQuantization(quantization_);
+      if (network_layers_.size() == 2) {
+        SetInputChannelOffset(0);
+      }
+    }
+
+    /*
+     * Opt-in intra-network threading for evaluating a single large network.
+     * With more than one thread, Step() splits the GEMMs/SpMVs of the Eigen
+     * integrators and the elementwise activator updates into blocks that run
+     * on a pool owned by the NervousSystem. Blocks smaller than
+     * parallel::MIN_WORK_PER_THREAD stay on the calling thread, so small
+     * networks are unaffected. 1 (the default) disables threading.
+     */
+    void SetNumThreads(Index num_threads) {
+      if (num_threads == 0) {
+        throw std::invalid_argument("NervousSystem needs at least one thread");
+      }
+      // Layers drop the old pool before it is destroyed
+      for (auto layer_ptr = network_layers_.begin();
+          layer_ptr != network_layers_.end(); ++layer_ptr) {
+        (*layer_ptr)->SetThreadPool(nullptr);
+      }
+      thread_pool_.reset();
+      if (num_threads > 1) {
+        thread_pool_.reset(new parallel::ThreadPool(num_threads));
+      }
+      for (auto layer_ptr = network_layers_.begin();
+          layer_ptr != network_layers_.end(); ++layer_ptr) {
+        (*layer_ptr)->SetThreadPool(thread_pool_.get());
+      }
+    }
+
+    Index GetNumThreads() const {
+      return (thread_pool_ == nullptr) ? 1 : thread_pool_->NumThreads();
+    }
+
+    /*
+     * Evaluation mode where the conv and all2all Eigen integrators step with
+     * int8 or fp16 weights (see quantization.hpp). Other integrators, and
+     * batch mode, keep full precision. Takes effect on the current
+     * configuration and every Configure after it.
+     */
+    void SetQuantization(QUANTIZATION_MODE mode) {
+      quantization_ = mode;
+      for (auto layer_ptr = network_layers_.begin();
+          layer_ptr != network_layers_.end(); ++layer_ptr) {
+        (*layer_ptr)->SetQuantization(quantization_);
+      }
+    }
+
+    QUANTIZATION_MODE GetQuantization() const {
+      return quantization_;
     }
 
     std::size_t GetParameterCount() const {
@@ -149,6 +309,119 @@ class NervousSystem {
       return normalization_factors;
     }
 
+    /*
+     * Batch mode runs batch_size members of a population through the network
+     * in lockstep. Each layer keeps a [batch, ...] state, so integrators can
+     * fold the batch into one GEMM/SpMM when members share weights, and walk
+     * contiguous member states back to back when they don't. Batch mode is
+     * independent of the single-member Step()/Configure() path.
+     */
+    void SetBatchSize(Index batch_size) {
+      if (batch_size == 0) {
+        throw std::invalid_argument("NervousSystem batch size must be positive");
+      }
+      batch_size_ = batch_size;
+      for (auto layer_ptr = network_layers_.begin();
+          layer_ptr != network_layers_.end(); ++layer_ptr) {
+        (*layer_ptr)->AllocateBatch(batch_size_);
+      }
+    }
+
+    Index GetBatchSize() const {
+      return batch_size_;
+    }
+
+    /*
+     * Takes either one parameter slice per member or a single slice that is
+     * shared by all members. The slices must outlive the configuration.
+     */
+    void BatchConfigure(const std::vector<multi_array::ConstArraySlice<TReal>>& parameters) {
+      if (batch_size_ == 0) {
+        throw std::invalid_argument("NervousSystem batch size must be set"
+                                    " before batch configuration");
+      }
+      if ((parameters.size() != 1) && (parameters.size() != batch_size_)) {
+        std::cerr << "number of parameter sets: " << parameters.size() << std::endl;
+        std::cerr << "batch size: " << batch_size_ << std::endl;
+        throw std::invalid_argument("NervousSystem needs one parameter set per"
+                                    " member or a single shared set");
+      }
+      for (const auto& member_parameters : parameters) {
+        if (member_parameters.size() != parameter_count_) {
+          throw std::invalid_argument("NervousSystem received parameters with"
+                                      " the wrong number of elements");
+        }
+      }
+
+      Index slice_start(0);
+      std::vector<multi_array::ConstArraySlice<TReal>> layer_parameters(parameters.size());
+      for (auto layer_ptr = network_layers_.begin()+1;
+          layer_ptr != network_layers_.end(); ++layer_ptr) {
+        for (Index member = 0; member < parameters.size(); ++member) {
+          layer_parameters[member] = parameters[member].slice(
+            parameters[member].stride() * slice_start,
+            (*layer_ptr)->GetParameterCount());
+        }
+        (*layer_ptr)->BatchConfigure(layer_parameters);
+        slice_start += (*layer_ptr)->GetParameterCount();
+      }
+    }
+
+    void BatchStep() {
+      const std::size_t num_allocations = debug::NumAllocations();
+      for (Index iii = 1; iii < network_layers_.size(); ++iii) {
+        network_layers_[iii]->BatchStep(network_layers_[iii-1]);
+      }
+      step_allocations_ = debug::NumAllocations() - num_allocations;
+    }
+
+    void BatchReset() {
+      for (auto iter = network_layers_.begin(); iter != network_layers_.end(); ++iter) {
+        (*iter)->BatchReset();
+      }
+    }
+
+    /*
+     * Sets the input layer state of a single member of the batch
+     */
+    template<typename T>
+    void SetBatchInput(Index member, const std::vector<T>& inputs) {
+      SetBatchInput(member, inputs.data());
+    }
+
+    template<typename T>
+    void SetBatchInput(Index member, const T* inputs) {
+      const Index num_inputs = network_layers_[0]->NumNeurons();
+      std::copy(inputs, inputs + num_inputs,
+                network_layers_[0]->batch_state().data() + member * num_inputs);
+    }
+
+    /*
+     * Batch version of AdvanceInputChannel for one member. Batch inputs are
+     * never stored as a ring, so the member's older channels are shifted down
+     * one and its last channel is returned.
+     */
+    TReal* AdvanceBatchInputChannel(Index member) {
+      multi_array::Tensor<TReal>& input_state = network_layers_[0]->batch_state();
+      const Index member_size = network_layers_[0]->NumNeurons();
+      const Index channel_size = member_size / network_layers_[0]->shape()[0];
+      TReal* member_begin = input_state.data() + member * member_size;
+      std::copy(member_begin + channel_size, member_begin + member_size,
+                member_begin);
+      return member_begin + member_size - channel_size;
+    }
+
+    /*
+     * Returns the [batch, ...] state of a layer
+     */
+    multi_array::Tensor<TReal>& GetBatchLayerState(const Index layer) {
+      return network_layers_[layer]->batch_state();
+    }
+
+    const multi_array::Tensor<TReal>& GetBatchOutput() const {
+      return network_layers_[network_layers_.size()-1]->batch_state();
+    }
+
     const Layer<TReal>& operator[](Index index) const {
       return *network_layers_[index];
     }
@@ -162,8 +435,26 @@ class NervousSystem {
     }
 
   protected:
+    /*
+     * Tells the first layer where the oldest input channel is stored
+     */
+    void SetInputChannelOffset(Index channel_offset) {
+      input_channel_offset_ = channel_offset;
+      if (network_layers_.size() > 1) {
+        network_layers_[1]->SetSourceChannelOffset(input_channel_offset_);
+      }
+    }
+
     std::size_t parameter_count_;
+    // Holds the layers' states and buffers, outlives the layers
+    multi_array::Arena arena_;
     std::vector< Layer<TReal>* > network_layers_;
+    Index batch_size_;
+    std::unique_ptr<parallel::ThreadPool> thread_pool_;
+    // Physical input channel holding the oldest temporal channel
+    Index input_channel_offset_;
+    std::size_t step_allocations_;
+    QUANTIZATION_MODE quantization_;
 };
 
 } // End nervous_system namespace
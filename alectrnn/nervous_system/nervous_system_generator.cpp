@@ -9,6 +9,9 @@
  * the owners and will not destroy them once they go out of scope in Python.
  * The capsules act only to pass the Layers to the NervousSystem, and should
  * be discarded and can be considered temporary.
+ *
+ * Built as nn_generator_double when ALECTRNN_DOUBLE is defined, which only
+ * takes layers from layer_generator_double (see precision.hpp).
  */
 
 #include <Python.h>
@@ -18,14 +21,17 @@
 #include "nervous_system_generator.hpp"
 #include "layer.hpp"
 #include "nervous_system.hpp"
+#include "precision.hpp"
 #include "../common/capi_tools.hpp"
 
+using nervous_system::Real;
+
 /*
  * DeleteLayer can be shared among the Layers as a destructor
  */
 static void DeleteNervousSystem(PyObject *nervous_system_capsule) {
-  delete (nervous_system::NervousSystem<float> *)PyCapsule_GetPointer(
-        nervous_system_capsule, "nervous_system_generator.nn");
+  delete (nervous_system::NervousSystem<Real> *)PyCapsule_GetPointer(
+        nervous_system_capsule, nervous_system::NN_CAPSULE_NAME);
 }
 
 /*
@@ -44,28 +50,28 @@ static PyObject *CreateNervousSystem(PyObject *self, PyObject *args, PyObject *k
   }
 
   std::vector<std::size_t> shape = alectrnn::uInt64PyArrayToVector<std::size_t>(input_shape);
-  nervous_system::NervousSystem<float>* nervous_system = ParseLayers(shape, layers_tuple);
+  nervous_system::NervousSystem<Real>* nervous_system = ParseLayers(shape, layers_tuple);
 
   PyObject* nervous_system_capsule = PyCapsule_New(static_cast<void*>(nervous_system),
-                            "nervous_system_generator.nn", DeleteNervousSystem);
+                            nervous_system::NN_CAPSULE_NAME, DeleteNervousSystem);
   return nervous_system_capsule;
 }
 
-nervous_system::NervousSystem<float>* ParseLayers(std::vector<std::size_t> shape, PyObject* args) {
-  nervous_system::NervousSystem<float>* nervous_system = new nervous_system::NervousSystem<float>(shape);
+nervous_system::NervousSystem<Real>* ParseLayers(std::vector<std::size_t> shape, PyObject* args) {
+  nervous_system::NervousSystem<Real>* nervous_system = new nervous_system::NervousSystem<Real>(shape);
   Py_ssize_t num_layers = PyTuple_Size(args);
   for (Py_ssize_t iii = 0; iii < num_layers; ++iii) {
     PyObject* layer_capsule = PyTuple_GetItem(args, iii);
 
-    if (!PyCapsule_IsValid(layer_capsule, "layer_generator.layer"))
+    if (!PyCapsule_IsValid(layer_capsule, nervous_system::LAYER_CAPSULE_NAME))
     {
       std::cerr << "Invalid pointer to Layer returned from capsule,"
           " or is not a capsule." << std::endl;
       return NULL;
     }
 
-    nervous_system::Layer<float>* layer = static_cast<nervous_system::Layer<float>*>(
-      PyCapsule_GetPointer(layer_capsule, "layer_generator.layer"));
+    nervous_system::Layer<Real>* layer = static_cast<nervous_system::Layer<Real>*>(
+      PyCapsule_GetPointer(layer_capsule, nervous_system::LAYER_CAPSULE_NAME));
 
     nervous_system->AddLayer(layer);
   }
@@ -84,6 +90,23 @@ static PyMethodDef NervousSystemMethods[] = {
   { NULL, NULL, 0, NULL}
 };
 
+#ifdef ALECTRNN_DOUBLE
+
+static struct PyModuleDef NervousSystemModule = {
+  PyModuleDef_HEAD_INIT,
+  "nervous_system_generator_double",
+  "Returns a handle to a double precision Nervous System",
+  -1,
+  NervousSystemMethods
+};
+
+PyMODINIT_FUNC PyInit_nn_generator_double(void) {
+  import_array();
+  return PyModule_Create(&NervousSystemModule);
+}
+
+#else
+
 static struct PyModuleDef NervousSystemModule = {
   PyModuleDef_HEAD_INIT,
   "nervous_system_generator",
@@ -96,3 +119,5 @@ PyMODINIT_FUNC PyInit_nn_generator(void) {
   import_array();
   return PyModule_Create(&NervousSystemModule);
 }
+
+#endif
@@ -14,8 +14,13 @@
 #include <cstddef>
 #include <vector>
 #include "nervous_system.hpp"
+#include "precision.hpp"
 
-nervous_system::NervousSystem<float>* ParseLayers(std::vector<std::size_t> shape, PyObject* args);
+nervous_system::NervousSystem<nervous_system::Real>* ParseLayers(std::vector<std::size_t> shape, PyObject* args);
+#ifdef ALECTRNN_DOUBLE
+PyMODINIT_FUNC PyInit_nn_generator_double(void);
+#else
 PyMODINIT_FUNC PyInit_nn_generator(void);
+#endif
 
 #endif /* NERVOUS_SYSTEM_GENERATOR_H_ */
@@ -0,0 +1,9 @@
+/*
+ * nervous_system_generator_double.cpp
+ *
+ * Builds nervous_system_generator.cpp as the nn_generator_double module,
+ * which makes double networks (see precision.hpp).
+ */
+
+#define ALECTRNN_DOUBLE
+#include "nervous_system_generator.cpp"
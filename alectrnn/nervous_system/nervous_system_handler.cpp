@@ -5,91 +5,328 @@
  *      Author: Nathaniel Rodriguez
  *
  * Allows calling and returning information from the NervousSystem in for Python
+ *
+ * Built as nn_handler_double when ALECTRNN_DOUBLE is defined, which only takes
+ * networks from nn_generator_double (see precision.hpp). Its inputs,
+ * parameters and states are then float64 arrays.
  */
 
 #include <Python.h>
 #include <cstddef>
 #include <iostream>
+#include <exception>
 #include <vector>
+#include <string>
+#include <memory>
 #include <utility>
+#include <algorithm>
 #include "nervous_system_handler.hpp"
 #include "numpy/arrayobject.h"
 #include "../common/multi_array.hpp"
 #include "../nervous_system/state_logger.hpp"
+#include "batch_inference.hpp"
 #include "layer.hpp"
 #include "nervous_system.hpp"
 #include "parameter_types.hpp"
+#include "precision.hpp"
+#include "quantization.hpp"
 #include "../common/capi_tools.hpp"
+#include "../common/allocation_counter.hpp"
+
+using nervous_system::Real;
 
 static PyObject *RunNeuralNetwork(PyObject *self, PyObject *args, PyObject *kwargs) {
   static char *keyword_list[] = {"neural_network", "inputs", "parameters", NULL};
   PyObject* nn_capsule;
-  PyArrayObject* inputs;
+  PyObject* py_inputs;
   PyArrayObject* py_parameter_array;
   if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO", keyword_list,
-      &nn_capsule, &inputs, &py_parameter_array)) {
+      &nn_capsule, &py_inputs, &py_parameter_array)) {
     std::cerr << "Error parsing RunNeuralNetwork arguments" << std::endl;
     return NULL;
   }
 
   // handle neural_network
-  if (!PyCapsule_IsValid(nn_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NN returned from capsule,"
         " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nn =
-      static_cast<nervous_system::NervousSystem<float>*>(
-      PyCapsule_GetPointer(nn_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
   nn->Reset();
 
-  // handle parameters
-  float* cparameter_array(alectrnn::PyArrayToCArray(py_parameter_array));
-  nn->Configure(multi_array::ConstArraySlice<float>(
-    cparameter_array, 0, nn->GetParameterCount(), 1));
+  // handle inputs, each row is read in place when inputs is already a
+  // contiguous array of Real
+  PyArrayObject* inputs = alectrnn::ContiguousPyArray<Real>(py_inputs, 2);
+  if (inputs == NULL) {
+    return NULL;
+  }
+  if (static_cast<std::size_t>(PyArray_DIM(inputs, 1)) != (*nn)[0].NumNeurons()) {
+    PyErr_SetString(PyExc_ValueError, "inputs need one column per input neuron");
+    Py_DECREF(inputs);
+    return NULL;
+  }
+
+  // handle parameters, which are converted to Real if they need to be
+  PyArrayObject* parameters = alectrnn::ContiguousPyArray<Real>(
+      reinterpret_cast<PyObject*>(py_parameter_array), 1);
+  if (parameters == NULL) {
+    Py_DECREF(inputs);
+    return NULL;
+  }
+  nn->Configure(multi_array::ConstArraySlice<Real>(
+    reinterpret_cast<const Real*>(PyArray_DATA(parameters)), 0,
+    nn->GetParameterCount(), 1));
+  Py_DECREF(parameters);
 
-  // create StateLogger
-  nervous_system::StateLogger<float> log = nervous_system::StateLogger<float>(*nn);
+  // create StateLogger, with room for every step
+  const npy_intp num_steps = PyArray_DIM(inputs, 0);
+  nervous_system::StateLogger<Real> log(*nn, num_steps);
 
   // run NN on inputs
-  std::vector<float> nn_input(PyArray_DIM(inputs, 1));
-  // npy_intp stride = PyArray_STRIDE(inputs, 0);
-  for (npy_intp i = 0; i < PyArray_DIM(inputs, 0); i++)
-  {
-    for (npy_intp j = 0; j < PyArray_DIM(inputs, 1); ++j)
-    {
-        nn_input[j] = static_cast<float>(*reinterpret_cast<npy_float32*>(PyArray_GETPTR2(inputs, i, j)));
-    }
-    nn->SetInput(nn_input);
+  const Real* input_data = reinterpret_cast<const Real*>(PyArray_DATA(inputs));
+  for (npy_intp iii = 0; iii < num_steps; ++iii) {
+    nn->SetInput(input_data + iii * PyArray_DIM(inputs, 1));
     nn->Step();
     log(*nn);
   }
+  Py_DECREF(inputs);
 
-  // convert log to tuple of numpy arrays for each layer
+  // Hand each layer's log to numpy as is. The log is dropped on return, so
+  // the arrays end up the only owners of the buffers and can be writeable.
   PyObject *py_layers = PyTuple_New(static_cast<npy_intp>(log.size()));
   for (std::size_t layer_index = 0; layer_index < log.size(); ++layer_index)
   {
-      const std::vector<multi_array::Tensor<float>>& history(log.GetLayerHistory(layer_index));
-      std::vector<npy_intp> shape(1+history[0].ndimensions());
-      shape[0] = history.size();
-      for (std::size_t iii = 0; iii < history[0].ndimensions(); ++iii) {
-        shape[iii+1] = history[0].shape()[iii];
+      const std::vector<std::size_t>& record_shape = log.GetRecordShape(layer_index);
+      std::vector<npy_intp> shape(1+record_shape.size());
+      shape[0] = num_steps;
+      std::copy(record_shape.begin(), record_shape.end(), shape.begin() + 1);
+      PyObject* py_array = alectrnn::SharedBufferToPyArray<Real>(
+          log.GetLayerHistory(layer_index), shape,
+          alectrnn::NumpyType<Real>::value, true);
+      if (py_array == NULL) {
+        Py_DECREF(py_layers);
+        return NULL;
       }
-      PyObject* py_array = PyArray_SimpleNew(shape.size(), shape.data(), NPY_FLOAT32);
-      PyArrayObject *np_array = reinterpret_cast<PyArrayObject*>(py_array);
-      npy_float32* data = reinterpret_cast<npy_float32*>(np_array->data);
-      std::vector<std::size_t> strides(shape.size());
-      multi_array::CalculateStrides(shape.data(), strides.data(), shape.size());
-      for (std::size_t iii = 0; iii < history.size(); ++iii) {
-        for (std::size_t jjj = 0; jjj < history[iii].size(); ++jjj) {
-          data[iii * strides[0] + jjj] = history[iii][jjj];
+      PyTuple_SET_ITEM(py_layers, layer_index, py_array);
+  }
+
+  return py_layers;
+}
+
+/*
+ * Reads a capsule or a sequence of capsules of NervousSystems. Returns false
+ * with a Python exception set if it can't.
+ */
+static bool CapsulesToNetworks(PyObject* capsules,
+    std::vector<nervous_system::NervousSystem<Real>*>& networks) {
+  if (PyCapsule_CheckExact(capsules)) {
+    if (!PyCapsule_IsValid(capsules, nervous_system::NN_CAPSULE_NAME)) {
+      PyErr_SetString(PyExc_TypeError, "expected a NervousSystem capsule");
+      return false;
+    }
+    networks.assign(1, static_cast<nervous_system::NervousSystem<Real>*>(
+        PyCapsule_GetPointer(capsules, nervous_system::NN_CAPSULE_NAME)));
+    return true;
+  }
+
+  PyObject* fast_capsules = PySequence_Fast(capsules, "expected a NervousSystem"
+                                            " capsule or a sequence of them");
+  if (fast_capsules == NULL) {
+    return false;
+  }
+  networks.resize(PySequence_Fast_GET_SIZE(fast_capsules));
+  for (std::size_t iii = 0; iii < networks.size(); ++iii) {
+    PyObject* capsule = PySequence_Fast_GET_ITEM(fast_capsules, iii);
+    if (!PyCapsule_IsValid(capsule, nervous_system::NN_CAPSULE_NAME)) {
+      PyErr_SetString(PyExc_TypeError, "expected a NervousSystem capsule");
+      Py_DECREF(fast_capsules);
+      return false;
+    }
+    networks[iii] = static_cast<nervous_system::NervousSystem<Real>*>(
+        PyCapsule_GetPointer(capsule, nervous_system::NN_CAPSULE_NAME));
+  }
+  Py_DECREF(fast_capsules);
+
+  // Each network gets its own worker thread
+  std::vector<nervous_system::NervousSystem<Real>*> sorted_networks(networks);
+  std::sort(sorted_networks.begin(), sorted_networks.end());
+  if (std::adjacent_find(sorted_networks.begin(), sorted_networks.end())
+      != sorted_networks.end()) {
+    PyErr_SetString(PyExc_ValueError, "each NervousSystem can only be given"
+                    " once, replicas must be separate networks");
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Runs a block of recorded input traces through the network(s) in batch mode
+ * and returns only the requested layers (see batch_inference.hpp).
+ * inputs: Real [# traces, # steps, input shape...]
+ * parameters: Real [parameter count] shared by every trace, or
+ *   [# traces, parameter count]
+ * layers: layer indices to return, None for the output layer
+ * outputs: optional preallocated C contiguous Real arrays, one per layer,
+ *   of shape [# traces, # steps, layer shape...] (e.g. numpy.memmaps)
+ * Real is float32, or float64 for nn_handler_double.
+ * Several networks with the same architecture run batches in parallel, one
+ * thread each. Returns a tuple with an array per layer.
+ */
+static PyObject *RunBatchInference(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"neural_networks", "inputs", "parameters",
+                                 "layers", "batch_size", "outputs", NULL};
+  PyObject* nn_capsules;
+  PyObject* py_inputs;
+  PyObject* py_parameters;
+  PyObject* py_layers = Py_None;
+  int batch_size = 0;
+  PyObject* py_outputs = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|OiO", keyword_list,
+      &nn_capsules, &py_inputs, &py_parameters, &py_layers, &batch_size,
+      &py_outputs)) {
+    std::cerr << "Error parsing RunBatchInference arguments" << std::endl;
+    return NULL;
+  }
+
+  std::vector<nervous_system::NervousSystem<Real>*> networks;
+  if (!CapsulesToNetworks(nn_capsules, networks)) {
+    return NULL;
+  }
+  if (networks.empty() || (batch_size < 0)) {
+    PyErr_SetString(PyExc_ValueError, "needs at least one network and a"
+                    " non-negative batch_size");
+    return NULL;
+  }
+  const nervous_system::NervousSystem<Real>& reference = *networks[0];
+
+  std::vector<std::size_t> layers;
+  if (py_layers == Py_None) {
+    layers.assign(1, reference.size() - 1);
+  }
+  else {
+    PyObject* fast_layers = PySequence_Fast(py_layers, "layers must be a"
+                                            " sequence of ints");
+    if (fast_layers == NULL) {
+      return NULL;
+    }
+    for (Py_ssize_t iii = 0; iii < PySequence_Fast_GET_SIZE(fast_layers); ++iii) {
+      const long layer = PyLong_AsLong(PySequence_Fast_GET_ITEM(fast_layers, iii));
+      if ((layer < 0) || (static_cast<std::size_t>(layer) >= reference.size())) {
+        if (!PyErr_Occurred()) {
+          PyErr_SetString(PyExc_ValueError, "layer index out of range");
         }
+        Py_DECREF(fast_layers);
+        return NULL;
       }
-      PyTuple_SetItem(py_layers, layer_index, py_array);
+      layers.push_back(static_cast<std::size_t>(layer));
+    }
+    Py_DECREF(fast_layers);
   }
 
-  return py_layers;
+  // Both arrays are only copied if they aren't contiguous Real already
+  PyArrayObject* inputs = reinterpret_cast<PyArrayObject*>(
+      PyArray_FROM_OTF(py_inputs, alectrnn::NumpyType<Real>::value,
+                       NPY_ARRAY_IN_ARRAY));
+  if (inputs == NULL) {
+    return NULL;
+  }
+  PyArrayObject* parameters = reinterpret_cast<PyArrayObject*>(
+      PyArray_FROM_OTF(py_parameters, alectrnn::NumpyType<Real>::value,
+                       NPY_ARRAY_IN_ARRAY));
+  if (parameters == NULL) {
+    Py_DECREF(inputs);
+    return NULL;
+  }
+
+  npy_intp trace_size = 1;
+  for (int iii = 2; iii < PyArray_NDIM(inputs); ++iii) {
+    trace_size *= PyArray_DIM(inputs, iii);
+  }
+  const npy_intp num_parameters = static_cast<npy_intp>(reference.GetParameterCount());
+  const bool is_shared = (PyArray_NDIM(parameters) == 1);
+  if ((PyArray_NDIM(inputs) < 3)
+      || (static_cast<std::size_t>(trace_size) != reference[0].NumNeurons())
+      || (PyArray_NDIM(parameters) < 1) || (PyArray_NDIM(parameters) > 2)
+      || (PyArray_DIM(parameters, PyArray_NDIM(parameters) - 1) != num_parameters)
+      || (!is_shared && (PyArray_DIM(parameters, 0) != PyArray_DIM(inputs, 0)))) {
+    PyErr_SetString(PyExc_ValueError, "inputs must be [# traces, # steps,"
+                    " input shape...] and parameters [parameter count] or"
+                    " [# traces, parameter count]");
+    Py_DECREF(inputs);
+    Py_DECREF(parameters);
+    return NULL;
+  }
+  const npy_intp num_traces = PyArray_DIM(inputs, 0);
+  const npy_intp num_steps = PyArray_DIM(inputs, 1);
+
+  // Results are written straight into the output arrays
+  PyObject* py_results = PyTuple_New(layers.size());
+  std::vector<Real*> outputs(layers.size());
+  for (std::size_t iii = 0; iii < layers.size(); ++iii) {
+    const std::vector<std::size_t>& layer_shape = reference[layers[iii]].state().shape();
+    std::vector<npy_intp> shape = {num_traces, num_steps};
+    shape.insert(shape.end(), layer_shape.begin(), layer_shape.end());
+
+    PyObject* py_output = NULL;
+    if (py_outputs == Py_None) {
+      py_output = PyArray_SimpleNew(shape.size(), shape.data(),
+                                    alectrnn::NumpyType<Real>::value);
+    }
+    else {
+      py_output = PySequence_GetItem(py_outputs, iii);
+      PyArrayObject* np_output = reinterpret_cast<PyArrayObject*>(py_output);
+      if ((py_output != NULL)
+          && (!PyArray_Check(py_output)
+              || (PyArray_TYPE(np_output) != alectrnn::NumpyType<Real>::value)
+              || !PyArray_IS_C_CONTIGUOUS(np_output)
+              || !PyArray_ISWRITEABLE(np_output)
+              || (PyArray_SIZE(np_output) != num_traces * num_steps
+                  * static_cast<npy_intp>(reference[layers[iii]].NumNeurons())))) {
+        PyErr_SetString(PyExc_ValueError, "outputs must be writeable C contiguous"
+                        " arrays of the network's dtype, shaped [# traces,"
+                        " # steps, layer shape...]");
+        Py_CLEAR(py_output);
+      }
+    }
+    if (py_output == NULL) {
+      Py_DECREF(py_results);
+      Py_DECREF(inputs);
+      Py_DECREF(parameters);
+      return NULL;
+    }
+    outputs[iii] = reinterpret_cast<Real*>(
+        PyArray_DATA(reinterpret_cast<PyArrayObject*>(py_output)));
+    PyTuple_SET_ITEM(py_results, iii, py_output);
+  }
+
+  const Real* input_data = reinterpret_cast<const Real*>(PyArray_DATA(inputs));
+  const Real* parameter_data = reinterpret_cast<const Real*>(PyArray_DATA(parameters));
+  bool is_done = true;
+  std::string error_message;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    nervous_system::RunBatchInference<Real>(networks, input_data, num_traces,
+        num_steps, parameter_data, is_shared ? 1 : num_traces, layers, outputs,
+        static_cast<std::size_t>(batch_size));
+  }
+  catch (const std::exception& error) {
+    is_done = false;
+    error_message = error.what();
+  }
+  Py_END_ALLOW_THREADS
+  Py_DECREF(inputs);
+  Py_DECREF(parameters);
+
+  if (!is_done) {
+    PyErr_SetString(PyExc_ValueError, error_message.c_str());
+    Py_DECREF(py_results);
+    return NULL;
+  }
+  return py_results;
 }
 
 static PyObject *GetParameterCount(PyObject *self, PyObject *args, PyObject *kwargs) {
@@ -103,15 +340,15 @@ static PyObject *GetParameterCount(PyObject *self, PyObject *args, PyObject *kwa
     return NULL;
   }
 
-  if (!PyCapsule_IsValid(nn_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NN returned from capsule,"
         " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nn =
-      static_cast<nervous_system::NervousSystem<float>*>(
-      PyCapsule_GetPointer(nn_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
 
   int num_params = nn->GetParameterCount();
 
@@ -129,15 +366,15 @@ static PyObject *GetParameterLayout(PyObject *self, PyObject *args, PyObject *kw
     return NULL;
   }
 
-  if (!PyCapsule_IsValid(nn_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NN returned from capsule,"
         " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nn =
-      static_cast<nervous_system::NervousSystem<float>*>(
-      PyCapsule_GetPointer(nn_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
   std::vector<nervous_system::PARAMETER_TYPE> par_types = nn->GetParameterLayout();
   PyObject* parameter_layout = ConvertParameterTypesToPyArray(par_types);
   return parameter_layout;
@@ -154,15 +391,15 @@ static PyObject *GetParameterLayerIndices(PyObject *self, PyObject *args, PyObje
     return NULL;
   }
 
-  if (!PyCapsule_IsValid(nn_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NN returned from capsule,"
         " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nn =
-      static_cast<nervous_system::NervousSystem<float>*>(
-      PyCapsule_GetPointer(nn_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
   std::vector<int> par_indices = nn->GetParameterLayerIndices();
   PyObject* parameter_indices = ConvertToNumpyIntArray(par_indices);
   return parameter_indices;
@@ -179,21 +416,151 @@ static PyObject *GetSize(PyObject *self, PyObject *args, PyObject *kwargs) {
     return NULL;
   }
 
-  if (!PyCapsule_IsValid(nn_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NN returned from capsule,"
         " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nn =
-      static_cast<nervous_system::NervousSystem<float>*>(
-      PyCapsule_GetPointer(nn_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
 
   int nn_size = nn->size();
 
   return Py_BuildValue("i", nn_size);
 }
 
+static PyObject *SetNumThreads(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"neural_network", "num_threads", NULL};
+
+  PyObject* nn_capsule;
+  int num_threads;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oi", keyword_list,
+      &nn_capsule, &num_threads)) {
+    std::cerr << "Error parsing SetNumThreads arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
+  {
+    std::cerr << "Invalid pointer to NN returned from capsule,"
+        " or is not a capsule." << std::endl;
+    return NULL;
+  }
+  if (num_threads < 1) {
+    std::cerr << "num_threads: " << num_threads << std::endl;
+    PyErr_SetString(PyExc_ValueError, "num_threads must be at least 1");
+    return NULL;
+  }
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
+  nn->SetNumThreads(num_threads);
+
+  Py_RETURN_NONE;
+}
+
+/*
+ * Sets the network's quantization mode (see quantization.hpp)
+ */
+static PyObject *SetQuantization(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"neural_network", "quantization", NULL};
+
+  PyObject* nn_capsule;
+  int quantization;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oi", keyword_list,
+      &nn_capsule, &quantization)) {
+    std::cerr << "Error parsing SetQuantization arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
+  {
+    std::cerr << "Invalid pointer to NN returned from capsule,"
+        " or is not a capsule." << std::endl;
+    return NULL;
+  }
+  if ((quantization < nervous_system::NO_QUANTIZATION)
+      || (quantization > nervous_system::FP16_QUANTIZATION)) {
+    std::cerr << "quantization: " << quantization << std::endl;
+    PyErr_SetString(PyExc_ValueError, "Unknown quantization mode");
+    return NULL;
+  }
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
+  try {
+    nn->SetQuantization(static_cast<nervous_system::QUANTIZATION_MODE>(quantization));
+  }
+  catch (const std::exception& error) {
+    PyErr_SetString(PyExc_ValueError, error.what());
+    return NULL;
+  }
+
+  Py_RETURN_NONE;
+}
+
+static PyObject *GetQuantization(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"neural_network", NULL};
+
+  PyObject* nn_capsule;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keyword_list,
+      &nn_capsule)) {
+    std::cerr << "Error parsing GetQuantization arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
+  {
+    std::cerr << "Invalid pointer to NN returned from capsule,"
+        " or is not a capsule." << std::endl;
+    return NULL;
+  }
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
+
+  return Py_BuildValue("i", static_cast<int>(nn->GetQuantization()));
+}
+
+/*
+ * Returns the # of heap allocations made by the network's last step, e.g.
+ * the final step of RunNeuralNetwork. Raises NotImplementedError unless built
+ * with ALECTRNN_COUNT_ALLOCATIONS.
+ */
+static PyObject *GetStepAllocations(PyObject *self, PyObject *args, PyObject *kwargs) {
+  static char *keyword_list[] = {"neural_network", NULL};
+
+  PyObject* nn_capsule;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keyword_list,
+      &nn_capsule)) {
+    std::cerr << "Error parsing GetStepAllocations arguments" << std::endl;
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
+  {
+    std::cerr << "Invalid pointer to NN returned from capsule,"
+        " or is not a capsule." << std::endl;
+    return NULL;
+  }
+  if (!debug::IS_COUNTING_ALLOCATIONS) {
+    PyErr_SetString(PyExc_NotImplementedError, "allocations are only counted"
+        " when built with ALECTRNN_COUNT_ALLOCATIONS set");
+    return NULL;
+  }
+  nervous_system::NervousSystem<Real>* nn =
+      static_cast<nervous_system::NervousSystem<Real>*>(
+      PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
+
+  return Py_BuildValue("n", static_cast<Py_ssize_t>(nn->GetStepAllocations()));
+}
+
 static PyObject *GetWeightNormalizationFactors(PyObject *self, PyObject *args, PyObject *kwargs) {
   static char *keyword_list[] = {"neural_network", NULL};
 
@@ -205,20 +572,22 @@ static PyObject *GetWeightNormalizationFactors(PyObject *self, PyObject *args, P
     return NULL;
   }
 
-  if (!PyCapsule_IsValid(nn_capsule, "nervous_system_generator.nn"))
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME))
   {
     std::cerr << "Invalid pointer to NN returned from capsule,"
     " or is not a capsule." << std::endl;
     return NULL;
   }
-  nervous_system::NervousSystem<float>* nn =
-    static_cast<nervous_system::NervousSystem<float>*>(
-    PyCapsule_GetPointer(nn_capsule, "nervous_system_generator.nn"));
+  nervous_system::NervousSystem<Real>* nn =
+    static_cast<nervous_system::NervousSystem<Real>*>(
+    PyCapsule_GetPointer(nn_capsule, nervous_system::NN_CAPSULE_NAME));
 
   // call function and get vector
   std::vector<float> normalization_factors = nn->GetWeightNormalizationFactors();
-  // convert vector<float> -> numpy array float32
-  return ConvertFloatVectorToPyFloat32Array(normalization_factors);
+  // hand the vector<float> over to a numpy array float32
+  std::vector<npy_intp> shape(1, normalization_factors.size());
+  return alectrnn::VectorToPyArray(std::move(normalization_factors), shape,
+                                   NPY_FLOAT32);
 }
 
 PyObject* ConvertFloatVectorToPyFloat32Array(const std::vector<float>& vec) {
@@ -232,9 +601,7 @@ PyObject* ConvertFloatVectorToPyFloat32Array(const std::vector<float>& vec) {
   npy_float32* data = reinterpret_cast<npy_float32*>(np_array->data);
 
   // Copy vect data to numpy array
-  for (std::size_t iii = 0; iii < vec.size(); ++iii) {
-    data[iii] = static_cast<npy_float32>(vec[iii]);
-  }
+  std::copy(vec.begin(), vec.end(), data);
   return py_array;
 }
 
@@ -277,6 +644,9 @@ static PyMethodDef NervousSystemHandlerMethods[] = {
   { "RunNeuralNetwork", (PyCFunction) RunNeuralNetwork,
           METH_VARARGS | METH_KEYWORDS,
           "Evaluates NN on given inputs"},
+  { "RunBatchInference", (PyCFunction) RunBatchInference,
+          METH_VARARGS | METH_KEYWORDS,
+          "Evaluates NNs on a batch of input traces, returning chosen layers"},
   { "GetParameterCount", (PyCFunction) GetParameterCount,
           METH_VARARGS | METH_KEYWORDS,
           "Returns # parameters"},
@@ -293,9 +663,38 @@ static PyMethodDef NervousSystemHandlerMethods[] = {
     "GetWeightNormalizationFactors", (PyCFunction) GetWeightNormalizationFactors,
           METH_VARARGS | METH_KEYWORDS,
           "Returns a numpy array with normalization factors for each parameter"},
+  { "SetNumThreads", (PyCFunction) SetNumThreads,
+          METH_VARARGS | METH_KEYWORDS,
+          "Sets the # of threads a single network step is split over (1 is serial)"},
+  { "SetQuantization", (PyCFunction) SetQuantization,
+          METH_VARARGS | METH_KEYWORDS,
+          "Sets whether conv/all2all weights are evaluated as int8 or fp16"},
+  { "GetQuantization", (PyCFunction) GetQuantization,
+          METH_VARARGS | METH_KEYWORDS,
+          "Returns the network's quantization mode"},
+  { "GetStepAllocations", (PyCFunction) GetStepAllocations,
+          METH_VARARGS | METH_KEYWORDS,
+          "Returns # heap allocations made by the last step (debug builds)"},
   { NULL, NULL, 0, NULL}
 };
 
+#ifdef ALECTRNN_DOUBLE
+
+static struct PyModuleDef NervousSystemHandlerModule = {
+  PyModuleDef_HEAD_INIT,
+  "nervous_system_handler_double",
+  "Access and modification function for double precision nervous system",
+  -1,
+  NervousSystemHandlerMethods
+};
+
+PyMODINIT_FUNC PyInit_nn_handler_double(void) {
+  import_array();
+  return PyModule_Create(&NervousSystemHandlerModule);
+}
+
+#else
+
 static struct PyModuleDef NervousSystemHandlerModule = {
   PyModuleDef_HEAD_INIT,
   "nervous_system_handler",
@@ -308,3 +707,5 @@ PyMODINIT_FUNC PyInit_nn_handler(void) {
   import_array();
   return PyModule_Create(&NervousSystemHandlerModule);
 }
+
+#endif
@@ -0,0 +1,9 @@
+/*
+ * nervous_system_handler_double.cpp
+ *
+ * Builds nervous_system_handler.cpp as the nn_handler_double module, which
+ * works with double networks (see precision.hpp).
+ */
+
+#define ALECTRNN_DOUBLE
+#include "nervous_system_handler.cpp"
@@ -0,0 +1,42 @@
+/*
+ * Floating point type of the networks built from Python.
+ *
+ * The layer_generator, nn_generator, nn_handler, agent_generator,
+ * agent_handler and objective extensions are compiled twice from the same
+ * sources. The plain build works with float networks. The *_double.cpp
+ * sources define ALECTRNN_DOUBLE and include the plain ones to make the
+ * *_double modules, which build and run double networks and the agents and
+ * objectives that play with them. These can check whether evolved dynamics
+ * are sensitive to float rounding (NervousSystem's dtype in nervous_system.py
+ * and the handlers' dtype in handlers.py pick the modules).
+ *
+ * Each variant names its capsules differently, so a double layer can't be
+ * added to a float network, or a double agent given to a float objective,
+ * and vice versa. Parameters from the optimizer stay float32 in both; double
+ * agents widen them (see NervousSystemAgent).
+ */
+
+#ifndef NN_PRECISION_H_
+#define NN_PRECISION_H_
+
+namespace nervous_system {
+
+#ifdef ALECTRNN_DOUBLE
+
+typedef double Real;
+constexpr const char* LAYER_CAPSULE_NAME = "layer_generator_double.layer";
+constexpr const char* NN_CAPSULE_NAME = "nervous_system_generator_double.nn";
+constexpr const char* AGENT_CAPSULE_NAME = "agent_generator_double.agent";
+
+#else
+
+typedef float Real;
+constexpr const char* LAYER_CAPSULE_NAME = "layer_generator.layer";
+constexpr const char* NN_CAPSULE_NAME = "nervous_system_generator.nn";
+constexpr const char* AGENT_CAPSULE_NAME = "agent_generator.agent";
+
+#endif
+
+} // End nervous_system namespace
+
+#endif /* NN_PRECISION_H_ */
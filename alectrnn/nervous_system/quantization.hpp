@@ -0,0 +1,287 @@
+/*
+ * Reduced precision weights for evaluating networks.
+ *
+ * Evolution only needs fitnesses good enough to rank agents, so the weights of
+ * the large feedforward integrators (ConvEigenIntegrator and
+ * All2AllEigenIntegrator) can be stored as int8 or fp16 during evaluation.
+ * This cuts the bytes streamed per step to a quarter or a half. Weights are
+ * quantized once when the integrator is configured. Each output (a filter
+ * or a neuron) gets its own int8 scale: scale = max |w| / 127, and
+ * w ~= scale * q. States, accumulation and activation stay in TReal.
+ *
+ * Only the weights are reduced, so the GEMV kernel takes an int8 or fp16
+ * operand and accumulates in TReal, rather than being an integer GEMV. Conv
+ * filters are small enough that their bandwidth doesn't matter, so the conv
+ * dequantizes them each step and keeps the float GEMM. It still sees the
+ * quantization error.
+ *
+ * The int8 to float conversion needs SSE4.1 and fp16 needs F16C to be fast,
+ * so build with ALECTRNN_MARCH set (see setup.py). On plain SSE2 the reduced
+ * precision kernels are slower than the float path. Compare a quantized
+ * network with its float path using NervousSystem.quantization_drift
+ * (nervous_system.py).
+ */
+
+#ifndef NN_QUANTIZATION_H_
+#define NN_QUANTIZATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <Eigen/Core>
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+#include "../common/multi_array.hpp"
+
+namespace nervous_system {
+
+/*
+ * Should keep in sync with QUANTIZATION in nervous_system.py
+ */
+enum QUANTIZATION_MODE {
+  NO_QUANTIZATION,
+  INT8_QUANTIZATION,
+  FP16_QUANTIZATION
+};
+
+/*
+ * fp16 is stored as raw IEEE half bits. Conversion to float is branchless so
+ * that it vectorizes inside the kernels.
+ */
+inline std::uint16_t FloatToHalf(float value) {
+  return Eigen::half(value).x;
+}
+
+inline float HalfToFloat(std::uint16_t half) {
+  // Move exponent and mantissa into place, then rebias the exponent by
+  // multiplying by 2^112. This handles subnormal halfs as well.
+  const std::uint32_t shifted = static_cast<std::uint32_t>(half & 0x7fffu) << 13;
+  float magnitude;
+  std::memcpy(&magnitude, &shifted, sizeof(float));
+  magnitude *= 5.192296858534828e+33f;
+  std::uint32_t bits;
+  std::memcpy(&bits, &magnitude, sizeof(float));
+  // Inf and NaN keep an all ones exponent
+  bits |= ((half & 0x7c00u) == 0x7c00u) ? 0x7f800000u : 0u;
+  bits |= static_cast<std::uint32_t>(half & 0x8000u) << 16;
+  float value;
+  std::memcpy(&value, &bits, sizeof(float));
+  return value;
+}
+
+/*
+ * Converts size halfs, with the F16C instructions when they are enabled
+ * (e.g. ALECTRNN_MARCH=haswell)
+ */
+inline void HalfToFloat(const std::uint16_t* half, std::size_t size, float* value) {
+  std::size_t iii = 0;
+#ifdef __F16C__
+  for (; iii + 8 <= size; iii += 8) {
+    _mm256_storeu_ps(value + iii, _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(half + iii))));
+  }
+#endif
+  for (; iii < size; ++iii) {
+    value[iii] = HalfToFloat(half[iii]);
+  }
+}
+
+/*
+ * A num_outputs x num_inputs weight matrix in reduced precision. It is stored
+ * input major, so that the weights from an input to every output are
+ * contiguous and the kernels are built from axpys, which vectorize without
+ * reassociating floating point sums.
+ */
+template<typename TReal>
+class QuantizedWeights {
+  public:
+    typedef std::size_t Index;
+
+    QuantizedWeights() : mode_(NO_QUANTIZATION), num_outputs_(0),
+                         num_inputs_(0) {
+    }
+
+    /*
+     * Quantizes the weights, where weight (output, input) is
+     * weights[output * output_stride + input * input_stride]. Storage is
+     * reused when the shape doesn't change, so re-configuring doesn't
+     * allocate.
+     */
+    void Quantize(QUANTIZATION_MODE mode, const TReal* weights,
+                  Index num_outputs, Index num_inputs,
+                  Index output_stride, Index input_stride) {
+      mode_ = mode;
+      num_outputs_ = num_outputs;
+      num_inputs_ = num_inputs;
+      scales_.resize(num_outputs_);
+      if (mode_ == INT8_QUANTIZATION) {
+        int8_weights_.resize(num_outputs_ * num_inputs_);
+        fp16_weights_.clear();
+        for (Index output = 0; output < num_outputs_; ++output) {
+          const TReal* row = weights + output * output_stride;
+          TReal max_weight = 0;
+          for (Index iii = 0; iii < num_inputs_; ++iii) {
+            max_weight = std::max(max_weight, std::abs(row[iii * input_stride]));
+          }
+          // An all zero output quantizes to zeros with any scale
+          scales_[output] = (max_weight > 0) ? max_weight / INT8_LIMIT : 1;
+          const TReal inverse_scale = 1 / scales_[output];
+          for (Index iii = 0; iii < num_inputs_; ++iii) {
+            int8_weights_[iii * num_outputs_ + output] = static_cast<std::int8_t>(
+                std::max<TReal>(-INT8_LIMIT, std::min<TReal>(INT8_LIMIT,
+                std::round(row[iii * input_stride] * inverse_scale))));
+          }
+        }
+      }
+      else if (mode_ == FP16_QUANTIZATION) {
+        fp16_weights_.resize(num_outputs_ * num_inputs_);
+        int8_weights_.clear();
+        for (Index output = 0; output < num_outputs_; ++output) {
+          const TReal* row = weights + output * output_stride;
+          scales_[output] = 1;
+          for (Index iii = 0; iii < num_inputs_; ++iii) {
+            fp16_weights_[iii * num_outputs_ + output] =
+                FloatToHalf(static_cast<float>(row[iii * input_stride]));
+          }
+        }
+      }
+      else {
+        std::cerr << "quantization mode: " << mode_ << std::endl;
+        throw std::invalid_argument("Can't quantize weights without a "
+                                    "quantization mode");
+      }
+    }
+
+    QUANTIZATION_MODE GetMode() const {
+      return mode_;
+    }
+
+    // Bytes of reduced precision weights
+    Index NumBytes() const {
+      return int8_weights_.size() * sizeof(std::int8_t)
+             + fp16_weights_.size() * sizeof(std::uint16_t);
+    }
+
+    /*
+     * output[o] = sum_i W(o, i) * input[i] for outputs in
+     * [first_output, last_output)
+     */
+    void Gemv(const TReal* input, TReal* output,
+              Index first_output, Index last_output) const {
+      if (mode_ == INT8_QUANTIZATION) {
+        GemvImpl(int8_weights_.data(), input, output, first_output, last_output);
+      }
+      else {
+        GemvImpl(fp16_weights_.data(), input, output, first_output, last_output);
+      }
+    }
+
+    /*
+     * Writes W^T as a column major num_inputs x num_outputs matrix, i.e.
+     * each output's weights contiguous. For small weight matrices, like
+     * conv filters, this per step copy is cheap and keeps the float GEMM.
+     */
+    void Dequantize(TReal* weights) const {
+      for (Index output = 0; output < num_outputs_; ++output) {
+        const TReal scale = scales_[output];
+        TReal* row = weights + output * num_inputs_;
+        if (mode_ == INT8_QUANTIZATION) {
+          for (Index iii = 0; iii < num_inputs_; ++iii) {
+            row[iii] = scale * ToReal(int8_weights_[iii * num_outputs_ + output]);
+          }
+        }
+        else {
+          for (Index iii = 0; iii < num_inputs_; ++iii) {
+            row[iii] = scale * ToReal(fp16_weights_[iii * num_outputs_ + output]);
+          }
+        }
+      }
+    }
+
+  protected:
+    static constexpr TReal INT8_LIMIT = 127;
+    // Outputs per fp16 Gemv block
+    static constexpr Index FP16_BLOCK = 256;
+
+    static TReal ToReal(std::int8_t weight) {
+      return static_cast<TReal>(weight);
+    }
+
+    static TReal ToReal(std::uint16_t weight) {
+      return static_cast<TReal>(HalfToFloat(weight));
+    }
+
+    /*
+     * fp16 columns are converted a block at a time into a buffer on the
+     * stack, so the conversion runs as bulk (F16C) instructions
+     */
+    void GemvImpl(const std::uint16_t* weights, const TReal* input,
+                  TReal* output, Index first_output, Index last_output) const {
+      const Index num_outputs = last_output - first_output;
+      TReal* ALECTRNN_RESTRICT out = output + first_output;
+      for (Index out_index = 0; out_index < num_outputs; ++out_index) {
+        out[out_index] = 0;
+      }
+      float column[FP16_BLOCK];
+      for (Index iii = 0; iii < num_inputs_; ++iii) {
+        const std::uint16_t* weight_column = weights + iii * num_outputs_
+                                             + first_output;
+        const TReal value = input[iii];
+        for (Index block = 0; block < num_outputs; block += FP16_BLOCK) {
+          const Index block_size = std::min(FP16_BLOCK, num_outputs - block);
+          HalfToFloat(weight_column + block, block_size, column);
+          TReal* ALECTRNN_RESTRICT block_out = out + block;
+          const float* ALECTRNN_RESTRICT converted = column;
+          for (Index out_index = 0; out_index < block_size; ++out_index) {
+            block_out[out_index] += value * converted[out_index];
+          }
+        }
+      }
+    }
+
+    template<typename TWeight>
+    void GemvImpl(const TWeight* weights, const TReal* input, TReal* output,
+                  Index first_output, Index last_output) const {
+      const Index num_outputs = last_output - first_output;
+      TReal* ALECTRNN_RESTRICT out = output + first_output;
+      for (Index out_index = 0; out_index < num_outputs; ++out_index) {
+        out[out_index] = 0;
+      }
+      for (Index iii = 0; iii < num_inputs_; ++iii) {
+        const TWeight* ALECTRNN_RESTRICT column = weights + iii * num_outputs_
+                                                  + first_output;
+        const TReal value = input[iii];
+        for (Index out_index = 0; out_index < num_outputs; ++out_index) {
+          out[out_index] += value * ToReal(column[out_index]);
+        }
+      }
+      const TReal* ALECTRNN_RESTRICT scales = scales_.data() + first_output;
+      for (Index out_index = 0; out_index < num_outputs; ++out_index) {
+        out[out_index] *= scales[out_index];
+      }
+    }
+
+    QUANTIZATION_MODE mode_;
+    Index num_outputs_;
+    Index num_inputs_;
+    std::vector<std::int8_t> int8_weights_;
+    // IEEE half bits
+    std::vector<std::uint16_t> fp16_weights_;
+    std::vector<TReal> scales_;
+};
+
+template<typename TReal>
+constexpr TReal QuantizedWeights<TReal>::INT8_LIMIT;
+
+template<typename TReal>
+constexpr typename QuantizedWeights<TReal>::Index QuantizedWeights<TReal>::FP16_BLOCK;
+
+} // End nervous_system namespace
+
+#endif /* NN_QUANTIZATION_H_ */
@@ -6,38 +6,93 @@
  *
  * Builds a logger from a nervous system object and can be called with that
  * object to add states to it.
+ *
+ * By default each layer's states are kept in memory as one contiguous buffer
+ * of records. The buffers are shared copy-on-write: GetLayerHistory hands out
+ * a reference to the buffer (e.g. for numpy to wrap without copying), and the
+ * logger only copies it if it has to log more while the reference is held.
+ * Given a directory, the logger instead streams each layer into its own
+ * memory mapped file of fixed size records (layer_<index>.bin), with the
+ * time stamps in times.bin and the dtype and record shapes in log_info.txt,
+ * so long episodes of large networks are limited by disk rather than RAM. The
+ * files are raw C order arrays that numpy.memmap can open once Flush() has
+ * been called or the logger is destroyed.
+ *
+ * A LoggingSpec narrows what is logged: a subset of layers, a subset of
+ * neurons in each, and a record every stride steps, optionally reduced over
+ * the stride's window of steps.
+ *
+ * The input layer is logged with its temporal channels in logical order.
  */
 
 #ifndef STATE_LOGGER_H_
 #define STATE_LOGGER_H_
 
 #include <cstddef>
+#include <cerrno>
+#include <string>
 #include <vector>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include <sys/stat.h>
 #include "nervous_system.hpp"
 #include "../common/multi_array.hpp"
+#include "../common/record_file.hpp"
 
 namespace nervous_system {
 
+/*
+ * What a record holds for each logged neuron, given the window of stride
+ * steps since the last record.
+ * Should keep in sync with LOG_REDUCTION in handlers.py
+ */
+enum LOG_REDUCTION {
+  NO_REDUCTION, // state at the record step, other steps are skipped
+  MEAN_REDUCTION,
+  VARIANCE_REDUCTION,
+  SPIKE_COUNT_REDUCTION // # of steps with state > spike_threshold
+};
+
+/*
+ * layers: indices of the layers to log, all layers if empty.
+ * neurons: for each entry of layers, the flat indices of the neurons to log
+ *   (all of them if empty). A layer logged in full keeps its shape, a subset
+ *   is recorded as a flat vector. Leave neurons empty to log all neurons of
+ *   every layer.
+ * stride: # of steps per record.
+ * reduction: how the steps of a window are combined.
+ * screen_stride: # of frames per screen log for agents, 0 turns screen
+ *   logging off.
+ */
+template<typename TReal>
+struct LoggingSpec {
+  LoggingSpec() : stride(1), reduction(NO_REDUCTION), spike_threshold(0),
+                  screen_stride(1) {}
+
+  std::vector<std::size_t> layers;
+  std::vector<std::vector<std::size_t>> neurons;
+  std::size_t stride;
+  LOG_REDUCTION reduction;
+  TReal spike_threshold;
+  std::size_t screen_stride;
+};
+
 template<typename TReal, typename Time=std::size_t>
 class StateLogger {
   public:
     typedef std::size_t Index;
 
-    StateLogger() {}
+    StateLogger() : fill_count_(0), step_count_(0), window_step_(0) {}
 
     StateLogger(const NervousSystem<TReal>& neural_net, Index num_iter)
-        : time_stamps_(num_iter) {
-      fill_count_ = 0;
-      // Allocate space for the vectors
-      history_.resize(neural_net.size());
-      for (auto layer_iter = history_.begin(); layer_iter != history_.end(); ++layer_iter) {
-        layer_iter->resize(num_iter);
-      }
-      // Allocate space for the states
-      for (Index iii = 0; iii < history_.size(); ++iii) {
-        for (Index jjj = 0; jjj < num_iter; ++jjj) {
-          history_[iii][jjj] = multi_array::Tensor<TReal>(neural_net[iii].state().shape());
-        }
+        : StateLogger(neural_net, LoggingSpec<TReal>()) {
+      time_stamps_.reserve(num_iter);
+      // Reserve space for the states
+      for (Index iii = 0; iii < logged_layers_.size(); ++iii) {
+        history_[logged_layers_[iii]]->reserve(num_iter * RecordSize(iii));
       }
     }
 
@@ -45,44 +100,93 @@ class StateLogger {
         : StateLogger(neural_net, 0) {
     }
 
+    /*
+     * Streams the log into memory mapped files in directory, which is
+     * created if it doesn't exist
+     */
+    StateLogger(const NervousSystem<TReal>& neural_net,
+                const std::string& directory)
+        : StateLogger(neural_net, LoggingSpec<TReal>(), directory) {
+    }
+
+    /*
+     * Logs what spec asks for, in memory or, given a directory, into memory
+     * mapped files
+     */
+    StateLogger(const NervousSystem<TReal>& neural_net,
+                const LoggingSpec<TReal>& spec,
+                const std::string& directory="")
+        : spec_(spec), fill_count_(0), step_count_(0), window_step_(0),
+          directory_(directory) {
+      SetLoggedNeurons(neural_net);
+      history_.resize(neural_net.size());
+      for (auto& layer_history : history_) {
+        layer_history = std::make_shared<std::vector<TReal>>();
+      }
+      if (IsMapped()) {
+        OpenFiles();
+      }
+    }
+
     ~StateLogger()=default;
 
+    StateLogger(StateLogger&&)=default;
+    StateLogger& operator=(StateLogger&&)=default;
+
     void operator()(const NervousSystem<TReal>& neural_net) {
-      // If no time-stamp is specified, then the next available time is used.
-      // This time corresponds with the access index of the state.
-      (*this)(neural_net, fill_count_);
+      // If no time-stamp is specified, then the step # is used. Without a
+      // stride this is the access index of the state.
+      (*this)(neural_net, step_count_);
     }
 
     void operator()(const NervousSystem<TReal>& neural_net, Time time_stamp) {
-      if (fill_count_ >= time_stamps_.size()) {
-        time_stamps_.push_back(time_stamp);
-        for (Index iii = 0; iii < history_.size(); ++iii) {
-          history_[iii].push_back(multi_array::Tensor<TReal>(neural_net[iii].state()));
-        }
+      ++step_count_;
+      ++window_step_;
+      const bool is_record_step = (window_step_ == spec_.stride);
+      if (!is_record_step && (spec_.reduction == NO_REDUCTION)) {
+        return;
       }
-      else {
-        time_stamps_[fill_count_] = time_stamp;
-        for (Index iii = 0; iii < history_.size(); ++iii) {
-          history_[iii][fill_count_].Fill(neural_net[iii].state());
+
+      for (Index iii = 0; iii < logged_layers_.size(); ++iii) {
+        const Index layer = logged_layers_[iii];
+        const TReal* state = neural_net[layer].state().data();
+        if (layer == 0) {
+          neural_net.CopyInputState(input_buffer_.data());
+          state = input_buffer_.data();
+        }
+
+        if (spec_.reduction != NO_REDUCTION) {
+          Accumulate(iii, state);
+        }
+        if (is_record_step) {
+          WriteRecord(iii, state, NextRecord(iii));
         }
       }
-      ++fill_count_;
-    }
 
-    const std::vector<multi_array::Tensor<TReal>>& GetLayerHistory(Index layer) const {
-      return history_[layer];
+      if (is_record_step) {
+        if (IsMapped()) {
+          *mapped_times_.NextRecord() = time_stamp;
+        }
+        else {
+          time_stamps_.push_back(time_stamp);
+        }
+        ++fill_count_;
+        window_step_ = 0;
+      }
     }
 
-    std::vector<multi_array::Tensor<TReal>>& GetLayerHistory(Index layer) {
+    /*
+     * The records of a layer back to back, each of GetRecordShape(layer).
+     * Layers that aren't logged have an empty history. The buffer stays valid
+     * and unchanged for as long as the pointer is held.
+     */
+    std::shared_ptr<const std::vector<TReal>> GetLayerHistory(Index layer) const {
       return history_[layer];
     }
 
-    const std::vector<std::vector<multi_array::Tensor<TReal>>>& GetHistory() const {
-        return history_;
-    }
-
-    std::vector<std::vector<multi_array::Tensor<TReal>>>& GetHistory() {
-        return history_;
+    // Shape of one record of a layer, empty if the layer isn't logged
+    const std::vector<Index>& GetRecordShape(Index layer) const {
+      return record_shapes_[layer];
     }
 
     const std::vector<Time>& GetTimes() const {
@@ -94,13 +198,235 @@ class StateLogger {
     }
 
     Index size() const {
-        return history_.size();
+        return IsMapped() ? mapped_history_.size() : history_.size();
+    }
+
+    const LoggingSpec<TReal>& GetSpec() const {
+      return spec_;
+    }
+
+    /*
+     * Whether the log is streamed to files. A mapped log keeps nothing in
+     * memory, so GetLayerHistory and GetTimes are empty.
+     */
+    bool IsMapped() const {
+      return !directory_.empty();
+    }
+
+    const std::string& GetDirectory() const {
+      return directory_;
+    }
+
+    // # of records logged
+    Index GetNumRecords() const {
+      return fill_count_;
+    }
+
+    /*
+     * Trims the log files to the steps logged so far and writes them out, so
+     * they can be opened while logging continues. Does nothing in memory.
+     */
+    void Flush() {
+      for (auto& layer_file : mapped_history_) {
+        layer_file.Flush();
+      }
+      mapped_times_.Flush();
     }
 
   protected:
-  std::vector<std::vector<multi_array::Tensor<TReal>>> history_;
+    /*
+     * Checks the spec against the network and works out what each logged
+     * layer records
+     */
+    void SetLoggedNeurons(const NervousSystem<TReal>& neural_net) {
+      if (spec_.stride == 0) {
+        throw std::invalid_argument("StateLogger stride must be positive");
+      }
+      logged_layers_ = spec_.layers;
+      if (logged_layers_.empty()) {
+        for (Index iii = 0; iii < neural_net.size(); ++iii) {
+          logged_layers_.push_back(iii);
+        }
+      }
+      logged_neurons_ = spec_.neurons;
+      if (logged_neurons_.empty()) {
+        logged_neurons_.resize(logged_layers_.size());
+      }
+      if (logged_neurons_.size() != logged_layers_.size()) {
+        std::cerr << "# logged layers: " << logged_layers_.size() << std::endl;
+        std::cerr << "# neuron subsets: " << logged_neurons_.size() << std::endl;
+        throw std::invalid_argument("StateLogger needs a neuron subset for"
+                                    " each logged layer");
+      }
+
+      record_shapes_.resize(neural_net.size());
+      accumulators_.resize(logged_layers_.size());
+      square_accumulators_.resize(logged_layers_.size());
+      for (Index iii = 0; iii < logged_layers_.size(); ++iii) {
+        const Index layer = logged_layers_[iii];
+        if (layer >= neural_net.size()) {
+          std::cerr << "layer: " << layer << std::endl;
+          throw std::invalid_argument("StateLogger layer index out of range");
+        }
+        const Index num_neurons = neural_net[layer].state().size();
+        for (Index neuron : logged_neurons_[iii]) {
+          if (neuron >= num_neurons) {
+            std::cerr << "layer: " << layer << " neuron: " << neuron << std::endl;
+            throw std::invalid_argument("StateLogger neuron index out of range");
+          }
+        }
+
+        if (logged_neurons_[iii].empty()) {
+          record_shapes_[layer] = neural_net[layer].state().shape();
+        }
+        else {
+          record_shapes_[layer] = std::vector<Index>(1, logged_neurons_[iii].size());
+        }
+        if (spec_.reduction != NO_REDUCTION) {
+          accumulators_[iii].assign(RecordSize(iii), 0.0);
+        }
+        if (spec_.reduction == VARIANCE_REDUCTION) {
+          square_accumulators_[iii].assign(RecordSize(iii), 0.0);
+        }
+        if (layer == 0) {
+          input_buffer_.resize(num_neurons);
+        }
+      }
+    }
+
+    void OpenFiles() {
+      if ((::mkdir(directory_.c_str(), 0755) != 0) && (errno != EEXIST)) {
+        std::cerr << "log directory: " << directory_ << std::endl;
+        throw std::runtime_error("StateLogger failed to create log directory");
+      }
+
+      std::ofstream info_file(directory_ + "/log_info.txt");
+      info_file << "dtype float" << 8 * sizeof(TReal) << std::endl;
+      info_file << "times uint" << 8 * sizeof(Time) << std::endl;
+      info_file << "stride " << spec_.stride << std::endl;
+      info_file << "reduction " << spec_.reduction << std::endl;
+      mapped_history_.reserve(logged_layers_.size());
+      for (Index iii = 0; iii < logged_layers_.size(); ++iii) {
+        const Index layer = logged_layers_[iii];
+        const std::string file_name = "layer_" + std::to_string(layer) + ".bin";
+        mapped_history_.emplace_back(directory_ + "/" + file_name,
+                                     RecordSize(iii));
+        info_file << file_name;
+        for (Index dimension : record_shapes_[layer]) {
+          info_file << " " << dimension;
+        }
+        info_file << std::endl;
+      }
+      if (!info_file) {
+        std::cerr << "log directory: " << directory_ << std::endl;
+        throw std::runtime_error("StateLogger failed to write log_info.txt");
+      }
+      mapped_times_ = logging::RecordFile<Time>(directory_ + "/times.bin", 1);
+    }
+
+    Index RecordSize(Index logged_index) const {
+      const std::vector<Index>& shape = record_shapes_[logged_layers_[logged_index]];
+      Index size = 1;
+      for (Index dimension : shape) {
+        size *= dimension;
+      }
+      return size;
+    }
+
+    // Value of the element'th logged neuron of a logged layer
+    TReal LoggedState(Index logged_index, const TReal* state, Index element) const {
+      const std::vector<Index>& neurons = logged_neurons_[logged_index];
+      return neurons.empty() ? state[element] : state[neurons[element]];
+    }
+
+    void Accumulate(Index logged_index, const TReal* state) {
+      std::vector<double>& sums = accumulators_[logged_index];
+      for (Index iii = 0; iii < sums.size(); ++iii) {
+        const TReal value = LoggedState(logged_index, state, iii);
+        if (spec_.reduction == SPIKE_COUNT_REDUCTION) {
+          sums[iii] += (value > spec_.spike_threshold) ? 1.0 : 0.0;
+        }
+        else {
+          sums[iii] += value;
+        }
+      }
+      if (spec_.reduction == VARIANCE_REDUCTION) {
+        std::vector<double>& square_sums = square_accumulators_[logged_index];
+        for (Index iii = 0; iii < square_sums.size(); ++iii) {
+          const double value = LoggedState(logged_index, state, iii);
+          square_sums[iii] += value * value;
+        }
+      }
+    }
+
+    // Writes the record for the window that ends this step and clears it
+    void WriteRecord(Index logged_index, const TReal* state, TReal* record) {
+      const Index record_size = RecordSize(logged_index);
+      if (spec_.reduction == NO_REDUCTION) {
+        for (Index iii = 0; iii < record_size; ++iii) {
+          record[iii] = LoggedState(logged_index, state, iii);
+        }
+        return;
+      }
+
+      std::vector<double>& sums = accumulators_[logged_index];
+      const double window = static_cast<double>(spec_.stride);
+      for (Index iii = 0; iii < record_size; ++iii) {
+        if (spec_.reduction == SPIKE_COUNT_REDUCTION) {
+          record[iii] = static_cast<TReal>(sums[iii]);
+        }
+        else if (spec_.reduction == MEAN_REDUCTION) {
+          record[iii] = static_cast<TReal>(sums[iii] / window);
+        }
+        else {
+          const double mean = sums[iii] / window;
+          const double variance = square_accumulators_[logged_index][iii]
+                                  / window - mean * mean;
+          record[iii] = static_cast<TReal>(std::max(variance, 0.0));
+          square_accumulators_[logged_index][iii] = 0.0;
+        }
+        sums[iii] = 0.0;
+      }
+    }
+
+    // Storage for the next record of a logged layer
+    TReal* NextRecord(Index logged_index) {
+      if (IsMapped()) {
+        return mapped_history_[logged_index].NextRecord();
+      }
+      std::shared_ptr<std::vector<TReal>>& layer_history =
+          history_[logged_layers_[logged_index]];
+      // Someone still holds the buffer, so leave it be and log into a copy
+      if (layer_history.use_count() > 1) {
+        layer_history = std::make_shared<std::vector<TReal>>(*layer_history);
+      }
+      const Index record_size = RecordSize(logged_index);
+      layer_history->resize(layer_history->size() + record_size);
+      return layer_history->data() + layer_history->size() - record_size;
+    }
+
+  // Records of each layer (indexed by layer)
+  std::vector<std::shared_ptr<std::vector<TReal>>> history_;
   std::vector<Time> time_stamps_;
+  LoggingSpec<TReal> spec_;
   Index fill_count_;
+  // # of steps seen and # of steps into the current window
+  Index step_count_;
+  Index window_step_;
+  std::vector<Index> logged_layers_;
+  // Neuron subset of each logged layer, empty for all
+  std::vector<std::vector<Index>> logged_neurons_;
+  // Shape of a record for each layer (indexed by layer)
+  std::vector<std::vector<Index>> record_shapes_;
+  // Window sums (and sums of squares) of each logged layer
+  std::vector<std::vector<double>> accumulators_;
+  std::vector<std::vector<double>> square_accumulators_;
+  // Input state in logical channel order
+  std::vector<TReal> input_buffer_;
+  // Mapped mode
+  std::string directory_;
+  std::vector<logging::RecordFile<TReal>> mapped_history_;
+  logging::RecordFile<Time> mapped_times_;
 };
 
 } // End nervous_system namespace
@@ -9,41 +9,113 @@
  * as well as a handler (python capsule) to the ALE environment, and
  * a handler to an agent.
  *
+ * Built as objective_double when ALECTRNN_DOUBLE is defined, which only takes
+ * agents from agent_generator_double and networks from nn_generator_double
+ * (see precision.hpp). Parameters are float32 in both builds.
  */
 
 #include <Python.h>
 #include <vector>
+#include <string>
 #include <memory>
 #include <cstdint>
 #include <cstddef>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <stdexcept>
 #include <ale_interface.hpp>
 #include <iostream>
 #include "numpy/arrayobject.h"
 #include "objective.hpp"
 #include "../controllers/controller.hpp"
+#include "../controllers/pipelined_controller.hpp"
+#include "../controllers/vec_controller.hpp"
 #include "../agents/player_agent.hpp"
 #include "../agents/nervous_system_agent.hpp"
 #include "../nervous_system/nervous_system.hpp"
 #include "../common/capi_tools.hpp"
 #include "../nervous_system/integrator.hpp"
 #include "../common/multi_array.hpp"
+#include "../nervous_system/precision.hpp"
+
+using nervous_system::Real;
+
+static void DeleteResetCache(PyObject *reset_cache_capsule) {
+  delete (alectrnn::ResetStateCache *)PyCapsule_GetPointer(reset_cache_capsule,
+                                                            "objective.reset_cache");
+}
+
+/*
+ * Creates a ResetStateCache of post-reset emulator states, which objectives
+ * given it as reset_cache reuse across calls. It is freed with the capsule.
+ */
+static PyObject *CreateResetCache(PyObject *self, PyObject *args,
+                                  PyObject *kwargs) {
+  static char *keyword_list[] = {"max_states", NULL};
+
+  int max_states(64);
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|i", keyword_list,
+      &max_states)) {
+    std::cerr << "Error parsing CreateResetCache arguments" << std::endl;
+    return NULL;
+  }
+
+  if (max_states < 0) {
+    PyErr_SetString(PyExc_ValueError, "max_states must be non-negative");
+    return NULL;
+  }
+
+  alectrnn::ResetStateCache* reset_cache = new alectrnn::ResetStateCache(
+      static_cast<std::size_t>(max_states));
+  return PyCapsule_New(static_cast<void*>(reset_cache), "objective.reset_cache",
+                       DeleteResetCache);
+}
+
+/*
+ * reset_cache is None or a capsule made by CreateResetCache
+ */
+static bool ParseResetCache(PyObject* reset_cache_capsule,
+                            alectrnn::ResetStateCache*& reset_cache) {
+  reset_cache = nullptr;
+  if (reset_cache_capsule == Py_None) {
+    return true;
+  }
+  if (!PyCapsule_IsValid(reset_cache_capsule, "objective.reset_cache")) {
+    PyErr_SetString(PyExc_TypeError, "reset_cache must be None or made by"
+        " CreateResetCache");
+    return false;
+  }
+  reset_cache = static_cast<alectrnn::ResetStateCache*>(PyCapsule_GetPointer(
+      reset_cache_capsule, "objective.reset_cache"));
+  return true;
+}
 
 static PyObject *TotalCostObjective(PyObject *self, PyObject *args,
                                       PyObject *kwargs) {
-  static char *keyword_list[] = {"parameters", "ale", "agent", NULL};
+  static char *keyword_list[] = {"parameters", "ale", "agent",
+                                 "reset_cache", NULL};
 
   PyArrayObject* py_parameter_array;
   PyObject* ale_capsule;
   PyObject* agent_capsule;
+  PyObject* reset_cache_capsule = Py_None;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO", keyword_list,
-      &py_parameter_array, &ale_capsule, &agent_capsule)) {
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|O", keyword_list,
+      &py_parameter_array, &ale_capsule, &agent_capsule, &reset_cache_capsule)) {
     std::cout << "Invalid argument in put into objective!" << std::endl;
     return NULL;
   }
 
+  alectrnn::ResetStateCache* reset_cache;
+  if (!ParseResetCache(reset_cache_capsule, reset_cache)) {
+    return NULL;
+  }
+
   if (!PyCapsule_IsValid(ale_capsule, "ale_generator.ale") ||
-      !PyCapsule_IsValid(agent_capsule, "agent_generator.agent"))
+      !PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
   {
     std::cout << "Invalid pointer to returned from capsule,"
         " or is not correct capsule." << std::endl;
@@ -54,13 +126,13 @@ static PyObject *TotalCostObjective(PyObject *self, PyObject *args,
       ale_capsule, "ale_generator.ale"));
   alectrnn::PlayerAgent* player_agent =
       static_cast<alectrnn::PlayerAgent*>(PyCapsule_GetPointer(agent_capsule,
-          "agent_generator.agent"));
+          nervous_system::AGENT_CAPSULE_NAME));
 
   float* cparameter_array(alectrnn::PyArrayToCArray(py_parameter_array));
   float total_cost(0);
   Py_BEGIN_ALLOW_THREADS
   total_cost = alectrnn::CalculateTotalCost(cparameter_array, ale,
-                                            player_agent);
+                                            player_agent, reset_cache);
   Py_END_ALLOW_THREADS
   return Py_BuildValue("f", total_cost);
 }
@@ -94,7 +166,7 @@ static PyObject *ScoreAndConnectionCostObjective(PyObject *self, PyObject *args,
   }
 
   if (!PyCapsule_IsValid(ale_capsule, "ale_generator.ale") ||
-      !PyCapsule_IsValid(agent_capsule, "agent_generator.agent"))
+      !PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
   {
     std::cout << "Invalid pointer to returned from capsule,"
     " or is not correct capsule." << std::endl;
@@ -105,7 +177,7 @@ static PyObject *ScoreAndConnectionCostObjective(PyObject *self, PyObject *args,
                                                  ale_capsule, "ale_generator.ale"));
   alectrnn::PlayerAgent* player_agent =
     static_cast<alectrnn::PlayerAgent*>(PyCapsule_GetPointer(agent_capsule,
-                                                           "agent_generator.agent"));
+                                                           nervous_system::AGENT_CAPSULE_NAME));
 
   float* cparameter_array(alectrnn::PyArrayToCArray(py_parameter_array));
   float total_cost(alectrnn::CalculateTotalCost(cparameter_array, ale,
@@ -115,22 +187,482 @@ static PyObject *ScoreAndConnectionCostObjective(PyObject *self, PyObject *args,
   // can configure the agent first.
   // Note: s&cc only compatible with NervousSystemAgents atm
   std::uint64_t connection_cost(alectrnn::CalculateConnectionCost(
-    dynamic_cast<alectrnn::NervousSystemAgent*>(player_agent)));
+    dynamic_cast<alectrnn::NervousSystemAgent<Real>*>(player_agent)));
   total_cost += static_cast<float>(cc_scale * connection_cost);
   return Py_BuildValue("f", total_cost);
 }
 
+/*
+ * Checks that the population parameters are a 2D float32 array and unpacks
+ * the ale/agent capsule sequences, one pair per worker. Every row must have
+ * each agent's parameter count, and no two workers may share an ale, an
+ * agent or an agent's NervousSystem, since workers step them concurrently.
+ * Sets a Python error and returns false if they are invalid.
+ */
+static bool ParsePopulationArgs(PyArrayObject* py_parameter_array,
+                                PyObject* ale_sequence, PyObject* agent_sequence,
+                                std::vector<ALEInterface*>& ales,
+                                std::vector<alectrnn::PlayerAgent*>& agents) {
+  if (!PyArray_Check(py_parameter_array)
+      || PyArray_NDIM(py_parameter_array) != 2
+      || PyArray_TYPE(py_parameter_array) != NPY_FLOAT32
+      || !PyArray_IS_C_CONTIGUOUS(py_parameter_array)) {
+    PyErr_SetString(PyExc_TypeError, "parameters must be a C-contiguous 2D"
+        " numpy array of type float32");
+    return false;
+  }
+
+  if (!PySequence_Check(ale_sequence) || !PySequence_Check(agent_sequence)
+      || PySequence_Size(ale_sequence) != PySequence_Size(agent_sequence)
+      || PySequence_Size(ale_sequence) < 1) {
+    PyErr_SetString(PyExc_ValueError, "ales and agents must be non-empty"
+        " sequences of equal length");
+    return false;
+  }
+
+  Py_ssize_t num_workers = PySequence_Size(ale_sequence);
+  ales.resize(num_workers);
+  agents.resize(num_workers);
+  for (Py_ssize_t iii = 0; iii < num_workers; ++iii) {
+    PyObject* ale_capsule = PySequence_GetItem(ale_sequence, iii);
+    PyObject* agent_capsule = PySequence_GetItem(agent_sequence, iii);
+    bool is_valid = (ale_capsule != NULL) && (agent_capsule != NULL)
+        && PyCapsule_IsValid(ale_capsule, "ale_generator.ale")
+        && PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME);
+    if (is_valid) {
+      ales[iii] = static_cast<ALEInterface*>(PyCapsule_GetPointer(
+          ale_capsule, "ale_generator.ale"));
+      agents[iii] = static_cast<alectrnn::PlayerAgent*>(PyCapsule_GetPointer(
+          agent_capsule, nervous_system::AGENT_CAPSULE_NAME));
+    }
+    Py_XDECREF(ale_capsule);
+    Py_XDECREF(agent_capsule);
+    if (!is_valid) {
+      std::cout << "Invalid pointer to returned from capsule,"
+          " or is not correct capsule." << std::endl;
+      return false;
+    }
+  }
+
+  for (Py_ssize_t iii = 0; iii < num_workers; ++iii) {
+    if (agents[iii]->GetParameterCount()
+        != static_cast<std::size_t>(PyArray_DIM(py_parameter_array, 1))) {
+      std::cerr << "agent parameter count: " << agents[iii]->GetParameterCount()
+                << std::endl;
+      std::cerr << "# parameters per member: "
+                << PyArray_DIM(py_parameter_array, 1) << std::endl;
+      PyErr_SetString(PyExc_ValueError, "parameters must have one column per"
+          " agent parameter");
+      return false;
+    }
+    const alectrnn::NervousSystemAgent<Real>* nervous_system_agent =
+        dynamic_cast<const alectrnn::NervousSystemAgent<Real>*>(agents[iii]);
+    for (Py_ssize_t jjj = 0; jjj < iii; ++jjj) {
+      const alectrnn::NervousSystemAgent<Real>* other_agent =
+          dynamic_cast<const alectrnn::NervousSystemAgent<Real>*>(agents[jjj]);
+      if (ales[iii] == ales[jjj] || agents[iii] == agents[jjj]
+          || (nervous_system_agent != nullptr && other_agent != nullptr
+              && &nervous_system_agent->GetNeuralNet()
+                 == &other_agent->GetNeuralNet())) {
+        PyErr_SetString(PyExc_ValueError, "each worker needs its own ale,"
+            " agent and nervous system");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/*
+ * Evaluates a whole population in one call. Parameters should be a 2D
+ * float32 numpy array with one member per row. ales and agents are equal
+ * length sequences of capsules; each (ale, agent) pair is owned by exactly one
+ * worker thread for the duration of the call, so the number of pairs sets the
+ * number of threads. Rows are handed out to workers dynamically as they
+ * finish. Returns a 1D float32 numpy array of costs, one per row.
+ *
+ * With pipeline_depth > 1 the pairs are grouped into pipelines of that many
+ * pairs (see PipelinedController), each of which uses one thread for its
+ * emulators and one for two batched network steps, each over half of the
+ * pipeline's members.
+ */
+static PyObject *PopulationCostObjective(PyObject *self, PyObject *args,
+                                         PyObject *kwargs) {
+  static char *keyword_list[] = {"parameters", "ales", "agents",
+                                 "reset_cache", "pipeline_depth", NULL};
+
+  PyArrayObject* py_parameter_array;
+  PyObject* ale_sequence;
+  PyObject* agent_sequence;
+  PyObject* reset_cache_capsule = Py_None;
+  int pipeline_depth(1);
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|Oi", keyword_list,
+      &py_parameter_array, &ale_sequence, &agent_sequence,
+      &reset_cache_capsule, &pipeline_depth)) {
+    std::cout << "Invalid argument in put into objective!" << std::endl;
+    return NULL;
+  }
+
+  if (pipeline_depth < 1) {
+    PyErr_SetString(PyExc_ValueError, "pipeline_depth must be at least 1");
+    return NULL;
+  }
+
+  alectrnn::ResetStateCache* reset_cache;
+  if (!ParseResetCache(reset_cache_capsule, reset_cache)) {
+    return NULL;
+  }
+
+  std::vector<ALEInterface*> ales;
+  std::vector<alectrnn::PlayerAgent*> agents;
+  if (!ParsePopulationArgs(py_parameter_array, ale_sequence, agent_sequence,
+                           ales, agents)) {
+    return NULL;
+  }
+
+  npy_intp num_members = PyArray_DIM(py_parameter_array, 0);
+  npy_intp num_parameters = PyArray_DIM(py_parameter_array, 1);
+  float* cparameter_array(alectrnn::PyArrayToCArray(py_parameter_array));
+  std::vector<float> costs;
+  bool is_done = true;
+  std::string error_message;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    costs = alectrnn::CalculatePopulationCost(cparameter_array, num_members,
+                                              num_parameters, ales, agents,
+                                              reset_cache, pipeline_depth);
+  }
+  catch (const std::exception& error) {
+    is_done = false;
+    error_message = error.what();
+  }
+  Py_END_ALLOW_THREADS
+
+  if (!is_done) {
+    PyErr_SetString(PyExc_ValueError, error_message.c_str());
+    return NULL;
+  }
+
+  PyObject* py_costs = PyArray_SimpleNew(1, &num_members, NPY_FLOAT32);
+  if (py_costs == NULL) {
+    return NULL;
+  }
+  float* py_costs_data = static_cast<float*>(PyArray_DATA(
+      reinterpret_cast<PyArrayObject*>(py_costs)));
+  std::copy(costs.begin(), costs.end(), py_costs_data);
+  return py_costs;
+}
+
+/*
+ * Like TotalCostObjective, but stops playing once one of the early stop rules
+ * fires (see controller.hpp). Rules with a limit of 0 are off. Returns
+ * (cost, stopped_early), where the cost of a stopped member is the negative
+ * score it had when it was stopped.
+ */
+static PyObject *EarlyStopCostObjective(PyObject *self, PyObject *args,
+                                        PyObject *kwargs) {
+  static char *keyword_list[] = {"parameters", "ale", "agent",
+                                 "inactivity_frames", "repeated_action_frames",
+                                 "rate_check_frames", "min_score_rate",
+                                 "reset_cache", NULL};
+
+  PyArrayObject* py_parameter_array;
+  PyObject* ale_capsule;
+  PyObject* agent_capsule;
+  alectrnn::EarlyStopRules rules;
+  PyObject* reset_cache_capsule = Py_None;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|iiifO", keyword_list,
+      &py_parameter_array, &ale_capsule, &agent_capsule,
+      &rules.inactivity_frames, &rules.repeated_action_frames,
+      &rules.rate_check_frames, &rules.min_score_rate, &reset_cache_capsule)) {
+    std::cout << "Invalid argument in put into objective!" << std::endl;
+    return NULL;
+  }
+
+  alectrnn::ResetStateCache* reset_cache;
+  if (!ParseResetCache(reset_cache_capsule, reset_cache)) {
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(ale_capsule, "ale_generator.ale") ||
+      !PyCapsule_IsValid(agent_capsule, nervous_system::AGENT_CAPSULE_NAME))
+  {
+    std::cout << "Invalid pointer to returned from capsule,"
+        " or is not correct capsule." << std::endl;
+    return NULL;
+  }
+
+  ALEInterface* ale = static_cast<ALEInterface*>(PyCapsule_GetPointer(
+      ale_capsule, "ale_generator.ale"));
+  alectrnn::PlayerAgent* player_agent =
+      static_cast<alectrnn::PlayerAgent*>(PyCapsule_GetPointer(agent_capsule,
+          nervous_system::AGENT_CAPSULE_NAME));
+
+  float* cparameter_array(alectrnn::PyArrayToCArray(py_parameter_array));
+  alectrnn::EarlyStopCost result;
+  Py_BEGIN_ALLOW_THREADS
+  result = alectrnn::CalculateEarlyStopCost(cparameter_array, ale,
+                                            player_agent, rules, nullptr,
+                                            reset_cache);
+  Py_END_ALLOW_THREADS
+  return Py_BuildValue("(fN)", result.cost, PyBool_FromLong(result.stopped_early));
+}
+
+/*
+ * PopulationCostObjective with early stop rules. Besides the rules of
+ * EarlyStopCostObjective, members whose score at a rate checkpoint is below
+ * score_rate_percentile of the scores of the members that reached it before
+ * them are stopped, once min_rate_samples members have. Returns a float32
+ * array of costs and a bool array of which members were stopped early.
+ */
+static PyObject *PopulationEarlyStopObjective(PyObject *self, PyObject *args,
+                                              PyObject *kwargs) {
+  static char *keyword_list[] = {"parameters", "ales", "agents",
+                                 "inactivity_frames", "repeated_action_frames",
+                                 "rate_check_frames", "min_score_rate",
+                                 "score_rate_percentile", "min_rate_samples",
+                                 "reset_cache", NULL};
+
+  PyArrayObject* py_parameter_array;
+  PyObject* ale_sequence;
+  PyObject* agent_sequence;
+  alectrnn::EarlyStopRules rules;
+  int min_rate_samples(static_cast<int>(rules.min_rate_samples));
+  PyObject* reset_cache_capsule = Py_None;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|iiiffiO", keyword_list,
+      &py_parameter_array, &ale_sequence, &agent_sequence,
+      &rules.inactivity_frames, &rules.repeated_action_frames,
+      &rules.rate_check_frames, &rules.min_score_rate,
+      &rules.score_rate_percentile, &min_rate_samples, &reset_cache_capsule)) {
+    std::cout << "Invalid argument in put into objective!" << std::endl;
+    return NULL;
+  }
+
+  if (rules.score_rate_percentile < 0 || rules.score_rate_percentile >= 100
+      || min_rate_samples < 0) {
+    PyErr_SetString(PyExc_ValueError, "score_rate_percentile must be in"
+        " [0, 100) and min_rate_samples must be non-negative");
+    return NULL;
+  }
+  rules.min_rate_samples = static_cast<std::size_t>(min_rate_samples);
+
+  alectrnn::ResetStateCache* reset_cache;
+  if (!ParseResetCache(reset_cache_capsule, reset_cache)) {
+    return NULL;
+  }
+
+  std::vector<ALEInterface*> ales;
+  std::vector<alectrnn::PlayerAgent*> agents;
+  if (!ParsePopulationArgs(py_parameter_array, ale_sequence, agent_sequence,
+                           ales, agents)) {
+    return NULL;
+  }
+
+  npy_intp num_members = PyArray_DIM(py_parameter_array, 0);
+  npy_intp num_parameters = PyArray_DIM(py_parameter_array, 1);
+  float* cparameter_array(alectrnn::PyArrayToCArray(py_parameter_array));
+  std::vector<alectrnn::EarlyStopCost> results;
+  bool is_done = true;
+  std::string error_message;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    results = alectrnn::CalculatePopulationEarlyStopCost(cparameter_array,
+        num_members, num_parameters, ales, agents, rules, reset_cache);
+  }
+  catch (const std::exception& error) {
+    is_done = false;
+    error_message = error.what();
+  }
+  Py_END_ALLOW_THREADS
+
+  if (!is_done) {
+    PyErr_SetString(PyExc_ValueError, error_message.c_str());
+    return NULL;
+  }
+
+  PyObject* py_costs = PyArray_SimpleNew(1, &num_members, NPY_FLOAT32);
+  if (py_costs == NULL) {
+    return NULL;
+  }
+  PyObject* py_stopped = PyArray_SimpleNew(1, &num_members, NPY_BOOL);
+  if (py_stopped == NULL) {
+    Py_DECREF(py_costs);
+    return NULL;
+  }
+  float* py_costs_data = static_cast<float*>(PyArray_DATA(
+      reinterpret_cast<PyArrayObject*>(py_costs)));
+  npy_bool* py_stopped_data = static_cast<npy_bool*>(PyArray_DATA(
+      reinterpret_cast<PyArrayObject*>(py_stopped)));
+  for (npy_intp iii = 0; iii < num_members; ++iii) {
+    py_costs_data[iii] = results[iii].cost;
+    py_stopped_data[iii] = results[iii].stopped_early ? NPY_TRUE : NPY_FALSE;
+  }
+  return Py_BuildValue("(NN)", py_costs, py_stopped);
+}
+
+/*
+ * Plays every ale in lockstep with one set of parameters and a single batched
+ * network (see VecController), e.g. to average over several seeds. ales is a
+ * sequence of distinct ale capsules and neural_network the capsule of a
+ * network that supports batch mode. Parameters should be a 1D float32 numpy
+ * array with the network's parameter count. Returns the mean cost over the
+ * ales.
+ */
+static PyObject *VecTotalCostObjective(PyObject *self, PyObject *args,
+                                       PyObject *kwargs) {
+  static char *keyword_list[] = {"parameters", "ales", "neural_network",
+                                 "update_rate", "reset_cache", NULL};
+
+  PyArrayObject* py_parameter_array;
+  PyObject* ale_sequence;
+  PyObject* nn_capsule;
+  int update_rate(1);
+  PyObject* reset_cache_capsule = Py_None;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOO|iO", keyword_list,
+      &py_parameter_array, &ale_sequence, &nn_capsule, &update_rate,
+      &reset_cache_capsule)) {
+    std::cout << "Invalid argument in put into objective!" << std::endl;
+    return NULL;
+  }
+
+  if (!PySequence_Check(ale_sequence) || PySequence_Size(ale_sequence) < 1
+      || update_rate < 1) {
+    PyErr_SetString(PyExc_ValueError, "ales must be a non-empty sequence and"
+        " update_rate must be at least 1");
+    return NULL;
+  }
+
+  if (!PyCapsule_IsValid(nn_capsule, nervous_system::NN_CAPSULE_NAME)) {
+    std::cout << "Invalid pointer to returned from capsule,"
+        " or is not correct capsule." << std::endl;
+    return NULL;
+  }
+  nervous_system::NervousSystem<Real>* neural_net =
+      static_cast<nervous_system::NervousSystem<Real>*>(PyCapsule_GetPointer(
+          nn_capsule, nervous_system::NN_CAPSULE_NAME));
+
+  if (!PyArray_Check(py_parameter_array)
+      || PyArray_NDIM(py_parameter_array) != 1
+      || PyArray_TYPE(py_parameter_array) != NPY_FLOAT32
+      || !PyArray_IS_C_CONTIGUOUS(py_parameter_array)) {
+    PyErr_SetString(PyExc_TypeError, "parameters must be a C-contiguous 1D"
+        " numpy array of type float32");
+    return NULL;
+  }
+  if (static_cast<std::size_t>(PyArray_DIM(py_parameter_array, 0))
+      != neural_net->GetParameterCount()) {
+    std::cerr << "network parameter count: "
+              << neural_net->GetParameterCount() << std::endl;
+    std::cerr << "# parameters: " << PyArray_DIM(py_parameter_array, 0)
+              << std::endl;
+    PyErr_SetString(PyExc_ValueError, "parameters must have one entry per"
+        " network parameter");
+    return NULL;
+  }
+
+  alectrnn::ResetStateCache* reset_cache;
+  if (!ParseResetCache(reset_cache_capsule, reset_cache)) {
+    return NULL;
+  }
+
+  Py_ssize_t num_ales = PySequence_Size(ale_sequence);
+  std::vector<ALEInterface*> ales(num_ales);
+  for (Py_ssize_t iii = 0; iii < num_ales; ++iii) {
+    PyObject* ale_capsule = PySequence_GetItem(ale_sequence, iii);
+    bool is_valid = (ale_capsule != NULL)
+        && PyCapsule_IsValid(ale_capsule, "ale_generator.ale");
+    if (is_valid) {
+      ales[iii] = static_cast<ALEInterface*>(PyCapsule_GetPointer(
+          ale_capsule, "ale_generator.ale"));
+    }
+    Py_XDECREF(ale_capsule);
+    if (!is_valid) {
+      std::cout << "Invalid pointer to returned from capsule,"
+          " or is not correct capsule." << std::endl;
+      return NULL;
+    }
+    for (Py_ssize_t jjj = 0; jjj < iii; ++jjj) {
+      if (ales[iii] == ales[jjj]) {
+        PyErr_SetString(PyExc_ValueError, "each environment needs its own"
+            " ale");
+        return NULL;
+      }
+    }
+  }
+
+  float* cparameter_array(alectrnn::PyArrayToCArray(py_parameter_array));
+  std::vector<float> costs;
+  bool is_done = true;
+  std::string error_message;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    costs = alectrnn::CalculateVecTotalCost(cparameter_array, ales, *neural_net,
+                                            update_rate, reset_cache);
+  }
+  catch (const std::exception& error) {
+    is_done = false;
+    error_message = error.what();
+  }
+  Py_END_ALLOW_THREADS
+
+  if (!is_done) {
+    PyErr_SetString(PyExc_ValueError, error_message.c_str());
+    return NULL;
+  }
+  float total_cost(0);
+  for (float cost : costs) {
+    total_cost += cost;
+  }
+  return Py_BuildValue("f", total_cost / costs.size());
+}
+
 static PyMethodDef ObjectiveMethods[] = {
+  { "CreateResetCache", (PyCFunction) CreateResetCache,
+      METH_VARARGS | METH_KEYWORDS,
+      "Creates a cache of post-reset emulator states for the objectives"},
   { "TotalCostObjective", (PyCFunction) TotalCostObjective,
       METH_VARARGS | METH_KEYWORDS,
       "Objective function that sums game reward"},
   { "ScoreAndConnectionCostObjective", (PyCFunction) ScoreAndConnectionCostObjective,
     METH_VARARGS | METH_KEYWORDS,
     "Objective function that sums game reward and penalizes connections"},
+  { "PopulationCostObjective", (PyCFunction) PopulationCostObjective,
+    METH_VARARGS | METH_KEYWORDS,
+    "Evaluates the total cost of each member of a population in parallel"},
+  { "EarlyStopCostObjective", (PyCFunction) EarlyStopCostObjective,
+    METH_VARARGS | METH_KEYWORDS,
+    "Total cost objective that stops members that have obviously failed"},
+  { "PopulationEarlyStopObjective", (PyCFunction) PopulationEarlyStopObjective,
+    METH_VARARGS | METH_KEYWORDS,
+    "Population cost objective that stops members that have obviously failed"},
+  { "VecTotalCostObjective", (PyCFunction) VecTotalCostObjective,
+    METH_VARARGS | METH_KEYWORDS,
+    "Mean total cost over several environments played with one batched network"},
       //Additional objectives here
   { NULL, NULL, 0, NULL}
 };
 
+#ifdef ALECTRNN_DOUBLE
+
+static struct PyModuleDef ObjectiveModule = {
+  PyModuleDef_HEAD_INIT,
+  "objective_double",
+  "Objective functions for agents with double precision Nervous Systems",
+  -1,
+  ObjectiveMethods
+};
+
+PyMODINIT_FUNC PyInit_objective_double(void) {
+  import_array();
+  return PyModule_Create(&ObjectiveModule);
+}
+
+#else
+
 static struct PyModuleDef ObjectiveModule = {
   PyModuleDef_HEAD_INIT,
   "objective",
@@ -144,41 +676,255 @@ PyMODINIT_FUNC PyInit_objective(void) {
   return PyModule_Create(&ObjectiveModule);
 }
 
+#endif
+
 namespace alectrnn {
 
+namespace {
+
+/*
+ * Calls evaluate(worker_index, member) for every member. One worker thread
+ * is launched per (ale, agent) pair, and each worker repeatedly claims the
+ * next unevaluated member until none remain. The calling thread acts as the
+ * first worker. If a worker throws, the other workers stop claiming members,
+ * and the first exception is rethrown once every worker has been joined.
+ */
+template<typename Evaluator>
+void EvaluatePopulation(std::size_t num_members, std::size_t num_pairs,
+                        Evaluator evaluate) {
+  std::atomic<std::size_t> next_member(0);
+  std::size_t num_workers = std::min(num_pairs, num_members);
+  std::vector<std::exception_ptr> errors(num_workers, nullptr);
+
+  auto worker = [&](std::size_t worker_index) {
+    try {
+      for (std::size_t member = next_member++; member < num_members;
+           member = next_member++) {
+        evaluate(worker_index, member);
+      }
+    }
+    catch (...) {
+      errors[worker_index] = std::current_exception();
+      next_member = num_members;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (std::size_t iii = 1; iii < num_workers; ++iii) {
+    threads.emplace_back(worker, iii);
+  }
+  if (num_workers > 0) {
+    worker(0);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const std::exception_ptr& error : errors) {
+    if (error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+}
+
 /*
  * Adds up the negative of the score of the agent on the atari game.
  */
 float CalculateTotalCost(const float* parameters, ALEInterface *ale,
-    PlayerAgent* agent) {
+    PlayerAgent* agent, ResetStateCache* reset_cache) {
 
   agent->Configure(parameters);
-  Controller game_controller = Controller(ale, agent);
+  Controller game_controller = Controller(ale, agent, reset_cache);
   game_controller.Run();
   float total_cost(-(float)game_controller.getCumulativeScore());
 
   return total_cost;
 }
 
+/*
+ * Calculates the total cost of each row of a [num_members, num_parameters]
+ * parameter array, with one worker per (ale, agent) pair. Because members are
+ * claimed dynamically the results do not depend on which worker evaluated
+ * them, only on the state of the pair it was given.
+ *
+ * With pipeline_depth > 1, each worker instead runs a PipelinedController
+ * over pipeline_depth consecutive pairs. Its ales are split into two stages,
+ * each batched through the network of the stage's first agent (which must
+ * be a NervousSystemAgent), with that agent's update rate. The other agents
+ * are unused. Every ale of a stage claims its next member once the whole
+ * stage is done. Costs match the agents' own unless an agent skips a step
+ * while others act (see VecController).
+ */
+std::vector<float> CalculatePopulationCost(const float* parameters,
+    std::size_t num_members, std::size_t num_parameters,
+    const std::vector<ALEInterface*>& ales,
+    const std::vector<PlayerAgent*>& agents, ResetStateCache* reset_cache,
+    std::size_t pipeline_depth) {
+
+  std::vector<float> costs(num_members, 0.0);
+  if (pipeline_depth <= 1) {
+    EvaluatePopulation(num_members, ales.size(),
+        [&](std::size_t worker_index, std::size_t member) {
+          costs[member] = CalculateTotalCost(parameters + member * num_parameters,
+                                             ales[worker_index],
+                                             agents[worker_index],
+                                             reset_cache);
+        });
+    return costs;
+  }
+
+  std::atomic<std::size_t> next_member(0);
+  auto pipeline = [&](std::size_t first_pair) {
+    const std::size_t last_pair = std::min(first_pair + pipeline_depth,
+                                           ales.size());
+    const std::size_t num_stages = std::min<std::size_t>(2,
+                                                         last_pair - first_pair);
+    std::vector<nervous_system::NervousSystem<Real>*> neural_nets;
+    std::size_t update_rate(1);
+    for (std::size_t stage = 0; stage < num_stages; ++stage) {
+      // Stages are split like PipelinedController splits them
+      NervousSystemAgent<Real>* agent = dynamic_cast<NervousSystemAgent<Real>*>(
+          agents[first_pair + stage * ((last_pair - first_pair + 1) / 2)]);
+      if (agent == nullptr) {
+        throw std::invalid_argument("Pipelining needs NervousSystemAgents");
+      }
+      neural_nets.push_back(&agent->GetNeuralNet());
+      if (stage == 0) {
+        update_rate = agent->GetUpdateRate();
+      }
+    }
+    PipelinedController<Real> controller(
+        std::vector<ALEInterface*>(ales.begin() + first_pair,
+                                   ales.begin() + last_pair),
+        neural_nets, update_rate, reset_cache);
+    // Member each ale is playing, num_members before its first
+    std::vector<std::size_t> members(controller.size(), num_members);
+    controller.Run([&](std::size_t pair) -> const float* {
+      if (members[pair] < num_members) {
+        costs[members[pair]] = -(float)controller.GetController(pair)
+            .getCumulativeScore();
+      }
+      members[pair] = next_member++;
+      if (members[pair] >= num_members) {
+        return nullptr;
+      }
+      return parameters + members[pair] * num_parameters;
+    });
+  };
+
+  // The calling thread runs the first pipeline. A failed pipeline claims the
+  // remaining members, so the others stop after their current games, and its
+  // error is rethrown once all have been joined.
+  const std::size_t num_pipelines = (ales.size() + pipeline_depth - 1)
+                                    / pipeline_depth;
+  std::vector<std::exception_ptr> errors(num_pipelines);
+  auto run_pipeline = [&](std::size_t pipeline_index) {
+    try {
+      pipeline(pipeline_index * pipeline_depth);
+    }
+    catch (...) {
+      errors[pipeline_index] = std::current_exception();
+      next_member = num_members;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t pipeline_index = 1; pipeline_index < num_pipelines;
+       ++pipeline_index) {
+    threads.emplace_back(run_pipeline, pipeline_index);
+  }
+  run_pipeline(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const std::exception_ptr& error : errors) {
+    if (error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  return costs;
+}
+
+/*
+ * Negative score on each of the ales, played in lockstep by a VecController
+ * with the parameters shared by all of them.
+ */
+std::vector<float> CalculateVecTotalCost(const float* parameters,
+    const std::vector<ALEInterface*>& ales,
+    nervous_system::NervousSystem<Real>& neural_net, std::size_t update_rate,
+    ResetStateCache* reset_cache) {
+
+  VecController<Real> game_controller(ales, neural_net, update_rate, reset_cache);
+  game_controller.Configure(parameters);
+  game_controller.Run();
+  std::vector<float> costs(game_controller.size());
+  for (std::size_t env = 0; env < costs.size(); ++env) {
+    costs[env] = -(float)game_controller.GetController(env).getCumulativeScore();
+  }
+  return costs;
+}
+
+/*
+ * Plays until the agent is done or an early stop rule fires. The score rate
+ * percentile rule is only used if a board is given.
+ */
+EarlyStopCost CalculateEarlyStopCost(const float* parameters, ALEInterface *ale,
+    PlayerAgent* agent, const EarlyStopRules& rules,
+    ScoreRateBoard* score_rate_board, ResetStateCache* reset_cache) {
+
+  agent->Configure(parameters);
+  Controller game_controller = Controller(ale, agent, reset_cache, &rules,
+                                          score_rate_board);
+  game_controller.Run();
+  EarlyStopCost result;
+  result.cost = -(float)game_controller.getCumulativeScore();
+  result.stopped_early = game_controller.StoppedEarly();
+  return result;
+}
+
+/*
+ * CalculatePopulationCost with early stopping. All members share one
+ * ScoreRateBoard, so each is compared with the members that reached a
+ * checkpoint before it.
+ */
+std::vector<EarlyStopCost> CalculatePopulationEarlyStopCost(
+    const float* parameters, std::size_t num_members,
+    std::size_t num_parameters, const std::vector<ALEInterface*>& ales,
+    const std::vector<PlayerAgent*>& agents, const EarlyStopRules& rules,
+    ResetStateCache* reset_cache) {
+
+  std::vector<EarlyStopCost> results(num_members);
+  ScoreRateBoard score_rate_board(rules.score_rate_percentile,
+                                  rules.min_rate_samples);
+  EvaluatePopulation(num_members, ales.size(),
+      [&](std::size_t worker_index, std::size_t member) {
+        results[member] = CalculateEarlyStopCost(
+            parameters + member * num_parameters, ales[worker_index],
+            agents[worker_index], rules, &score_rate_board, reset_cache);
+      });
+  return results;
+}
+
 /*
  * Adds up the number of weights whose absolute value is greater than the
  * threshold. Such weights are considered non-zero and count as a connection.
  * Hence, this function adds up the number of connections.
  */
-std::uint64_t CalculateConnectionCost(alectrnn::NervousSystemAgent* agent) {
+std::uint64_t CalculateConnectionCost(alectrnn::NervousSystemAgent<Real>* agent) {
 
   std::uint64_t cost = 0;
 
   // Loop through the agent's nervous system layers
-  const nervous_system::NervousSystem<float>& neural_net = agent->GetNeuralNet();
+  const nervous_system::NervousSystem<Real>& neural_net = agent->GetNeuralNet();
   for (std::size_t iii = 0; iii < neural_net.size(); ++iii) {
 
     if (neural_net[iii].GetBackIntegrator() != nullptr) {
       if (neural_net[iii].GetBackIntegrator()->GetIntegratorType()
           == nervous_system::TRUNCATED_RECURRENT_INTEGRATOR) {
         // Get the number of connections present
-        const nervous_system::TruncatedRecurrentIntegrator<float>* integrator =
-        dynamic_cast<const nervous_system::TruncatedRecurrentIntegrator<float>*>(
+        const nervous_system::TruncatedRecurrentIntegrator<Real>* integrator =
+        dynamic_cast<const nervous_system::TruncatedRecurrentIntegrator<Real>*>(
         neural_net[iii].GetBackIntegrator());
         cost += CalculateNumConnection(integrator->GetWeights(), integrator->GetWeightThreshold());
       }
@@ -188,8 +934,8 @@ std::uint64_t CalculateConnectionCost(alectrnn::NervousSystemAgent* agent) {
       if (neural_net[iii].GetSelfIntegrator()->GetIntegratorType()
           == nervous_system::TRUNCATED_RECURRENT_INTEGRATOR) {
         // Get the number of connections present
-        const nervous_system::TruncatedRecurrentIntegrator<float>* integrator =
-        dynamic_cast<const nervous_system::TruncatedRecurrentIntegrator<float>*>(
+        const nervous_system::TruncatedRecurrentIntegrator<Real>* integrator =
+        dynamic_cast<const nervous_system::TruncatedRecurrentIntegrator<Real>*>(
         neural_net[iii].GetSelfIntegrator());
         cost += CalculateNumConnection(integrator->GetWeights(), integrator->GetWeightThreshold());
       }
@@ -199,8 +945,8 @@ std::uint64_t CalculateConnectionCost(alectrnn::NervousSystemAgent* agent) {
   return cost;
 }
 
-std::uint64_t CalculateNumConnection(const multi_array::ConstArraySlice<float>& weights,
-                                     float weight_threshold) {
+std::uint64_t CalculateNumConnection(const multi_array::ConstArraySlice<Real>& weights,
+                                     Real weight_threshold) {
   std::uint64_t num_connections = 0;
   for (std::size_t iii = 0; iii < weights.size(); ++iii) {
     if ((weights[iii] > weight_threshold && weights[iii] >= 0) ||
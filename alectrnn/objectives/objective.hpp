@@ -18,19 +18,56 @@
 #include <Python.h>
 #include <ale_interface.hpp>
 #include <cstdint>
+#include <cstddef>
+#include <vector>
 #include "../agents/player_agent.hpp"
 #include "../common/multi_array.hpp"
 #include "../agents/nervous_system_agent.hpp"
+#include "../nervous_system/nervous_system.hpp"
+#include "../nervous_system/precision.hpp"
+#include "../controllers/controller.hpp"
 
+#ifdef ALECTRNN_DOUBLE
+PyMODINIT_FUNC PyInit_objective_double(void);
+#else
 PyMODINIT_FUNC PyInit_objective(void);
+#endif
 
 namespace alectrnn {
 
 float CalculateTotalCost(const float* parameters, ALEInterface *ale,
-                         PlayerAgent* agent);
-std::uint64_t CalculateConnectionCost(alectrnn::NervousSystemAgent* agent);
-std::uint64_t CalculateNumConnection(const multi_array::ConstArraySlice<float>& weights,
-                                     float weight_threshold);
+                         PlayerAgent* agent,
+                         ResetStateCache* reset_cache=nullptr);
+std::vector<float> CalculatePopulationCost(const float* parameters,
+    std::size_t num_members, std::size_t num_parameters,
+    const std::vector<ALEInterface*>& ales,
+    const std::vector<PlayerAgent*>& agents,
+    ResetStateCache* reset_cache=nullptr, std::size_t pipeline_depth=1);
+std::vector<float> CalculateVecTotalCost(const float* parameters,
+    const std::vector<ALEInterface*>& ales,
+    nervous_system::NervousSystem<nervous_system::Real>& neural_net,
+    std::size_t update_rate=1,
+    ResetStateCache* reset_cache=nullptr);
+
+struct EarlyStopCost {
+  float cost;
+  bool stopped_early;
+};
+
+EarlyStopCost CalculateEarlyStopCost(const float* parameters, ALEInterface *ale,
+    PlayerAgent* agent, const EarlyStopRules& rules,
+    ScoreRateBoard* score_rate_board=nullptr,
+    ResetStateCache* reset_cache=nullptr);
+std::vector<EarlyStopCost> CalculatePopulationEarlyStopCost(
+    const float* parameters, std::size_t num_members,
+    std::size_t num_parameters, const std::vector<ALEInterface*>& ales,
+    const std::vector<PlayerAgent*>& agents, const EarlyStopRules& rules,
+    ResetStateCache* reset_cache=nullptr);
+std::uint64_t CalculateConnectionCost(
+    alectrnn::NervousSystemAgent<nervous_system::Real>* agent);
+std::uint64_t CalculateNumConnection(
+    const multi_array::ConstArraySlice<nervous_system::Real>& weights,
+    nervous_system::Real weight_threshold);
 }
 
 #endif /* ALECTRNN_OBJECTIVES_OBJECTIVE_H_ */
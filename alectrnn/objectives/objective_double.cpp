@@ -0,0 +1,9 @@
+/*
+ * objective_double.cpp
+ *
+ * Builds objective.cpp as the objective_double module, which plays agents of
+ * double networks (see precision.hpp).
+ */
+
+#define ALECTRNN_DOUBLE
+#include "objective.cpp"
@@ -79,7 +79,38 @@ class build_ext(setuptools.command.build_ext.build_ext):
         setuptools.command.build_ext.build_ext.run(self)
 
 
+class build_benchmarks(Command):
+    """
+    Builds the header-only C++ benchmarks in alectrnn/benchmarks with the
+    extension modules' compiler settings. They don't need ALE or numpy.
+    """
+    description = "build the C++ benchmarks in alectrnn/benchmarks"
+    user_options = [("build-dir=", "b", "directory for the benchmarks")]
+
+    def initialize_options(self):
+        self.build_dir = None
+
+    def finalize_options(self):
+        if self.build_dir is None:
+            self.build_dir = os.path.join('build', 'benchmarks')
+
+    def run(self):
+        compiler = distutils.ccompiler.new_compiler()
+        distutils.sysconfig.customize_compiler(compiler)
+        for source in benchmark_sources:
+            name = os.path.splitext(os.path.basename(source))[0]
+            objects = compiler.compile([source],
+                                       output_dir=os.path.join(self.build_dir,
+                                                               'obj'),
+                                       include_dirs=include_dirs,
+                                       extra_postargs=extra_compile_args)
+            compiler.link_executable(objects, name, output_dir=self.build_dir,
+                                     extra_postargs=['-pthread'],
+                                     target_lang='c++')
+
+
 # Remove setuptools dumb c warnings
+import distutils.ccompiler
 import distutils.sysconfig
 cfg_vars = distutils.sysconfig.get_config_vars()
 for key, value in cfg_vars.items():
@@ -87,7 +118,27 @@ for key, value in cfg_vars.items():
         cfg_vars[key] = value.replace("-Wstrict-prototypes", "")
 
 # Compiler settings
-extra_compile_args = ['-std=c++14', '-Wno-write-strings', '-Wno-undef']
+# -pthread: the objectives and the nervous system's thread pool use std::thread
+extra_compile_args = ['-std=c++14', '-Wno-write-strings', '-Wno-undef', '-pthread']
+# The activator loops are multi-versioned for AVX2/AVX-512 and the CPU picks
+# one at load time (see ALECTRNN_TARGET_CLONES in common/utilities.hpp).
+# -fno-trapping-math lets those loops vectorize, and -ffp-contract=off keeps
+# every version's results the same by not fusing multiply-adds.
+extra_compile_args += ['-fno-trapping-math', '-ffp-contract=off']
+# Eigen vectorizes for the instruction set enabled at compile time, which is
+# SSE2 by default. Set ALECTRNN_MARCH (e.g. native, haswell, skylake-avx512)
+# to build the integrators with AVX2/AVX-512 as well.
+if os.environ.get('ALECTRNN_MARCH'):
+    extra_compile_args += ['-march=' + os.environ['ALECTRNN_MARCH']]
+# Eigen's GEMM packs its operands into buffers on the stack up to this many
+# bytes and on the heap past it. The default (128KB) is too small for the
+# convolutions of Atari networks, which then allocate every step.
+extra_compile_args += ['-DEIGEN_STACK_ALLOCATION_LIMIT=1048576']
+# Set ALECTRNN_COUNT_ALLOCATIONS to count heap allocations (malloc and
+# operator new, needs glibc), which lets NeuralNetwork.step_allocations()
+# check that stepping doesn't allocate.
+if os.environ.get('ALECTRNN_COUNT_ALLOCATIONS'):
+    extra_compile_args += ['-DALECTRNN_COUNT_ALLOCATIONS']
 
 # Includes
 include_dirs = []
@@ -111,7 +162,7 @@ library_dirs = [lib_path]
 ALE_LIB = os.path.join(lib_path, "libale.so")
 main_link_args = [ALE_LIB,"-lstdc++"]
 main_libraries = ['ale']
-extra_link_args = ['-Wl,--verbose']
+extra_link_args = ['-Wl,--verbose', '-pthread']
 
 # Sources
 ale_sources = [
@@ -129,7 +180,8 @@ agent_sources = [
     "alectrnn/agents/soft_max_agent.cpp",
     "alectrnn/agents/shared_motor_agent.cpp",
     "alectrnn/agents/reward_mod_agent.cpp",
-    "alectrnn/agents/feedback_agent.cpp"
+    "alectrnn/agents/feedback_agent.cpp",
+    "alectrnn/common/allocation_counter.cpp"
 ]
 
 objective_sources = [
@@ -138,33 +190,100 @@ objective_sources = [
     "alectrnn/agents/player_agent.cpp",
     "alectrnn/agents/nervous_system_agent.cpp",
     "alectrnn/common/screen_preprocessing.cpp",
-    "alectrnn/controllers/controller.cpp"
+    "alectrnn/controllers/controller.cpp",
+    "alectrnn/controllers/pipelined_controller.cpp",
+    "alectrnn/controllers/vec_controller.cpp",
+    "alectrnn/common/allocation_counter.cpp"
 ]
 
 layer_sources = [
     "alectrnn/nervous_system/layer_generator.cpp",
-    "alectrnn/common/capi_tools.cpp"
+    "alectrnn/common/capi_tools.cpp",
+    "alectrnn/common/allocation_counter.cpp"
 ]
 
 nn_sources = [
     "alectrnn/nervous_system/nervous_system_generator.cpp",
-    "alectrnn/common/capi_tools.cpp"
+    "alectrnn/common/capi_tools.cpp",
+    "alectrnn/common/allocation_counter.cpp"
 ]
 
 nn_handler_sources = [
     "alectrnn/nervous_system/nervous_system_handler.cpp",
-    "alectrnn/common/capi_tools.cpp"
+    "alectrnn/common/capi_tools.cpp",
+    "alectrnn/common/allocation_counter.cpp"
+]
+
+# The *_double modules are the same sources built for double networks
+layer_double_sources = [
+    "alectrnn/nervous_system/layer_generator_double.cpp",
+    "alectrnn/common/capi_tools.cpp",
+    "alectrnn/common/allocation_counter.cpp"
+]
+
+nn_double_sources = [
+    "alectrnn/nervous_system/nervous_system_generator_double.cpp",
+    "alectrnn/common/capi_tools.cpp",
+    "alectrnn/common/allocation_counter.cpp"
+]
+
+nn_handler_double_sources = [
+    "alectrnn/nervous_system/nervous_system_handler_double.cpp",
+    "alectrnn/common/capi_tools.cpp",
+    "alectrnn/common/allocation_counter.cpp"
+]
+
+agent_double_sources = [
+    "alectrnn/agents/agent_generator_double.cpp",
+    "alectrnn/agents/player_agent.cpp",
+    "alectrnn/agents/ctrnn_agent.cpp",
+    "alectrnn/agents/nervous_system_agent.cpp",
+    "alectrnn/common/network_constructor.cpp",
+    "alectrnn/common/ctrnn.cpp",
+    "alectrnn/common/screen_preprocessing.cpp",
+    "alectrnn/agents/soft_max_agent.cpp",
+    "alectrnn/agents/shared_motor_agent.cpp",
+    "alectrnn/agents/reward_mod_agent.cpp",
+    "alectrnn/agents/feedback_agent.cpp",
+    "alectrnn/common/allocation_counter.cpp"
+]
+
+objective_double_sources = [
+    "alectrnn/objectives/objective_double.cpp",
+    "alectrnn/common/capi_tools.cpp",
+    "alectrnn/agents/player_agent.cpp",
+    "alectrnn/agents/nervous_system_agent.cpp",
+    "alectrnn/common/screen_preprocessing.cpp",
+    "alectrnn/controllers/controller.cpp",
+    "alectrnn/controllers/pipelined_controller.cpp",
+    "alectrnn/controllers/vec_controller.cpp",
+    "alectrnn/common/allocation_counter.cpp"
 ]
 
 ale_handler_sources = [
     "alectrnn/common/ale_handler.cpp"
 ]
 
+# Standalone programs built by the build_benchmarks command
+benchmark_sources = [
+    "alectrnn/benchmarks/conv_benchmark.cpp",
+    "alectrnn/benchmarks/precision_benchmark.cpp"
+]
+
 agent_handler_sources = [
     "alectrnn/agents/agent_handler.cpp",
     "alectrnn/agents/player_agent.cpp",
     "alectrnn/agents/nervous_system_agent.cpp",
-    "alectrnn/common/screen_preprocessing.cpp"
+    "alectrnn/common/screen_preprocessing.cpp",
+    "alectrnn/common/allocation_counter.cpp"
+]
+
+agent_handler_double_sources = [
+    "alectrnn/agents/agent_handler_double.cpp",
+    "alectrnn/agents/player_agent.cpp",
+    "alectrnn/agents/nervous_system_agent.cpp",
+    "alectrnn/common/screen_preprocessing.cpp",
+    "alectrnn/common/allocation_counter.cpp"
 ]
 
 PACKAGE_NAME = 'alectrnn'
@@ -229,6 +348,56 @@ nn_handler_module = Extension('nn_handler',
                     extra_link_args=extra_link_args + main_link_args
                         + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
 
+layer_double_module = Extension('layer_generator_double',
+                    language = "c++14",
+                    sources=layer_double_sources,
+                    libraries=main_libraries,
+                    extra_compile_args=extra_compile_args,
+                    include_dirs=include_dirs,
+                    library_dirs=library_dirs,
+                    extra_link_args=extra_link_args + main_link_args
+                        + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
+
+nn_double_module = Extension('nn_generator_double',
+                    language = "c++14",
+                    sources=nn_double_sources,
+                    libraries=main_libraries,
+                    extra_compile_args=extra_compile_args,
+                    include_dirs=include_dirs,
+                    library_dirs=library_dirs,
+                    extra_link_args=extra_link_args + main_link_args
+                        + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
+
+nn_handler_double_module = Extension('nn_handler_double',
+                    language = "c++14",
+                    sources=nn_handler_double_sources,
+                    libraries=main_libraries,
+                    extra_compile_args=extra_compile_args,
+                    include_dirs=include_dirs,
+                    library_dirs=library_dirs,
+                    extra_link_args=extra_link_args + main_link_args
+                        + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
+
+agent_double_module = Extension('agent_generator_double',
+                    language = "c++14",
+                    sources=agent_double_sources,
+                    libraries=main_libraries,
+                    extra_compile_args=extra_compile_args,
+                    include_dirs=include_dirs,
+                    library_dirs=library_dirs,
+                    extra_link_args=extra_link_args + main_link_args
+                        + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
+
+objective_double_module = Extension('objective_double',
+                    language = "c++14",
+                    sources=objective_double_sources,
+                    libraries=main_libraries,
+                    extra_compile_args=extra_compile_args,
+                    include_dirs=include_dirs,
+                    library_dirs=library_dirs,
+                    extra_link_args=extra_link_args + main_link_args
+                        + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
+
 ale_handler = Extension('ale_handler',
                     language = "c++14",
                     sources=ale_handler_sources,
@@ -249,12 +418,23 @@ agent_handler = Extension('agent_handler',
                     extra_link_args=extra_link_args + main_link_args
                         + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
 
+agent_handler_double = Extension('agent_handler_double',
+                    language = "c++14",
+                    sources=agent_handler_double_sources,
+                    libraries=main_libraries,
+                    extra_compile_args=extra_compile_args,
+                    include_dirs=include_dirs,
+                    library_dirs=library_dirs,
+                    extra_link_args=extra_link_args + main_link_args
+                        + ['-Wl,-rpath,$ORIGIN/alelib/lib'])
+
 setup(name=PACKAGE_NAME,
       version='1.13',
       author='Nathaniel Rodriguez',
       cmdclass={'build_ext': build_ext,
                 'install': install,
-                'develop': develop
+                'develop': develop,
+                'build_benchmarks': build_benchmarks
                 },
       description='A wrapper for a ctrnn implementation of ALE',
       url='https://github.com/neuro-evolution/alectrnn.git',
@@ -266,7 +446,10 @@ setup(name=PACKAGE_NAME,
       ext_package=PACKAGE_NAME,
       ext_modules=[ale_module, agent_module, objective_module,
                    layer_module, nn_module, nn_handler_module,
-                   ale_handler, agent_handler],
+                   layer_double_module, nn_double_module,
+                   nn_handler_double_module, agent_double_module,
+                   objective_double_module,
+                   ale_handler, agent_handler, agent_handler_double],
       package_data={PACKAGE_NAME: [
         'roms/*.bin',
         'alelib/bin/ale',